@@ -1,10 +1,22 @@
 #include "sokol_app.h"
 #include "clock.h"
+#include "prof.h"
+#include "journal.h"
 #include <assert.h>
+#include <string.h>
+
+// max number of emulated frames per host frame in warp mode
+#define CLOCK_MAX_WARP_FACTOR (64)
+// host milliseconds per frame the emulator may spend in warp mode
+#define CLOCK_WARP_BUDGET_MS (12.0f)
 
 typedef struct {
     bool valid;
     uint64_t cur_time;
+    clock_warp_mode_t warp_mode;
+    bool auto_warp;
+    bool warp_active;
+    int warp_factor;
 } clock_state_t;
 static clock_state_t state;
 
@@ -12,9 +24,72 @@ void clock_init(void) {
     state = (clock_state_t) {
         .valid = true,
         .cur_time = 0,
+        .warp_mode = state.warp_mode,
+        .warp_factor = 1,
     };
 }
 
+void clock_set_warp_mode(clock_warp_mode_t mode) {
+    state.warp_mode = mode;
+}
+
+clock_warp_mode_t clock_warp_mode(void) {
+    return state.warp_mode;
+}
+
+void clock_set_warp_mode_from_string(const char* str) {
+    if ((str == 0) || (str[0] == 0)) {
+        return;
+    }
+    // same boolean spellings as sargs_boolean()
+    if ((0 == strcmp(str, "on")) || (0 == strcmp(str, "true")) || (0 == strcmp(str, "yes"))) {
+        clock_set_warp_mode(CLOCK_WARP_ON);
+    }
+    else if (0 == strcmp(str, "auto")) {
+        clock_set_warp_mode(CLOCK_WARP_AUTO);
+    }
+    else {
+        clock_set_warp_mode(CLOCK_WARP_OFF);
+    }
+}
+
+void clock_set_auto_warp(bool active) {
+    state.auto_warp = active;
+}
+
+bool clock_warp_active(void) {
+    return state.warp_active;
+}
+
+int clock_warp_factor(void) {
+    return state.warp_active ? state.warp_factor : 1;
+}
+
+// adapt the warp factor to the host time the emulator took in the previous frame
+static void clock_update_warp_factor(void) {
+    const int count = prof_count(PROF_EMU);
+    const float emu_ms = (count > 0) ? prof_value(PROF_EMU, count - 1) : 0.0f;
+    int factor = state.warp_factor;
+    if (emu_ms > 0.0f) {
+        const float frame_ms = emu_ms / (float)state.warp_factor;
+        const int target = (int)(CLOCK_WARP_BUDGET_MS / frame_ms);
+        // grow slowly, but shrink immediately if the host can't keep up
+        if (target > factor) {
+            factor += (target - factor + 1) / 2;
+        }
+        else {
+            factor = target;
+        }
+    }
+    if (factor < 1) {
+        factor = 1;
+    }
+    else if (factor > CLOCK_MAX_WARP_FACTOR) {
+        factor = CLOCK_MAX_WARP_FACTOR;
+    }
+    state.warp_factor = factor;
+}
+
 uint32_t clock_frame_time(void) {
     assert(state.valid);
     uint32_t frame_time_us = (uint32_t) (sapp_frame_duration() * 1000000.0);
@@ -23,6 +98,19 @@ uint32_t clock_frame_time(void) {
     if (frame_time_us > 24000) {
         frame_time_us = 24000;
     }
+    const bool warp = (state.warp_mode == CLOCK_WARP_ON) || ((state.warp_mode == CLOCK_WARP_AUTO) && state.auto_warp);
+    if (warp) {
+        if (state.warp_active) {
+            clock_update_warp_factor();
+        }
+        frame_time_us *= (uint32_t)state.warp_factor;
+    }
+    else {
+        state.warp_factor = 1;
+    }
+    state.warp_active = warp;
+    // a replayed input journal overrides the host frame duration
+    frame_time_us = journal_frame_time(frame_time_us);
     state.cur_time += frame_time_us;
     return frame_time_us;
 }
@@ -1,6 +1,43 @@
 #pragma once
+/*
+    Frame timing for the emulators.
+
+    In warp mode, each frame runs the emulator for a multiple of the host
+    frame duration, so that only every Nth emulated frame is presented.
+    The warp factor adapts to the host time spent in the emulator (taken
+    from the PROF_EMU profiling bucket) so that the emulation still fits
+    into a host frame. In the default auto mode, warp is only active
+    while the emulator requests it (for instance while the tape motor or
+    the floppy drive motor is on).
+*/
 #include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    CLOCK_WARP_AUTO,    // warp while requested by the emulator (default)
+    CLOCK_WARP_ON,      // always warp
+    CLOCK_WARP_OFF,     // never warp
+} clock_warp_mode_t;
 
 void clock_init(void);
 uint32_t clock_frame_time(void);
 uint32_t clock_frame_count_60hz(void);
+// set the warp mode (survives clock_init())
+void clock_set_warp_mode(clock_warp_mode_t mode);
+clock_warp_mode_t clock_warp_mode(void);
+// set the warp mode from a "warp=on|off|auto" command line value, null or empty keeps the current mode
+void clock_set_warp_mode_from_string(const char* str);
+// call once per frame before clock_frame_time() to request warp in auto mode
+void clock_set_auto_warp(bool active);
+// true if the current frame runs in warp mode (audio output should be dropped)
+bool clock_warp_active(void);
+// number of emulated frames per host frame
+int clock_warp_factor(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
@@ -10,6 +10,8 @@
 #include "prof.h"
 #include "fs.h"
 #include "gfx.h"
+#include "journal.h"
 #include "keybuf.h"
+#include "rewind.h"
 #include "webapi.h"
 #include <ctype.h> // isupper, islower, toupper, tolower
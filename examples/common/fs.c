@@ -14,11 +14,53 @@
 #endif
 #if defined(WIN32)
 #include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 
 #define FS_EXT_SIZE (16)
 #define FS_PATH_SIZE (256)
 #define FS_MAX_SIZE (2024 * 1024)
+#define FS_MAX_SAVE_JOBS (16)
+#define FS_MAX_SNAPSHOT_LOADS (32)
+#define FS_DEFAULT_NUM_CHANNELS (4)
+#define FS_DEFAULT_NUM_LANES (1)
+#define FS_SYSTEM_NAME_SIZE (32)
+// slot handles are the slot index in the lower bits and the allocation generation above
+#define FS_SLOT_INDEX_BITS (16)
+#define FS_SLOT_INDEX_MASK ((1 << FS_SLOT_INDEX_BITS) - 1)
+
+// there are no threads on the web, pending snapshots are written in fs_dowork() instead
+#if !defined(__EMSCRIPTEN__)
+#define FS_SAVE_THREAD
+#endif
+
+// native platforms map files into memory without size limit, on the web
+// fetched files still land in static per-slot buffers of FS_MAX_SIZE bytes,
+// base64 payloads and memory loads go into heap buffers everywhere
+#if !defined(__EMSCRIPTEN__)
+#define FS_MMAP
+#endif
+
+// base64 payloads are decoded in blocks of characters with SSE2, WASM SIMD or NEON when available
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define FS_BASE64_SSE2
+#define FS_BASE64_SIMD_CHARS (16)
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define FS_BASE64_WASM_SIMD
+#define FS_BASE64_SIMD_CHARS (16)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define FS_BASE64_NEON
+#define FS_BASE64_SIMD_CHARS (64)
+#endif
 
 typedef struct {
     char cstr[FS_PATH_SIZE];
@@ -31,34 +73,521 @@ typedef struct {
     fs_snapshot_load_callback_t callback;
 } fs_snapshot_load_context_t;
 
+// file data owned by fs, a heap buffer or on native platforms a private mapping
+// of the file, the data is always followed by a zero byte in case it's a text file
+typedef struct {
+    uint8_t* ptr;
+    size_t size;
+    bool mapped;
+} fs_file_t;
+
+#if defined(FS_MMAP)
+// a snapshot load waiting for fs_dowork()
 typedef struct {
+    fs_path_t path;
+    fs_snapshot_load_context_t context;
+} fs_snapshot_load_t;
+#endif
+
+typedef struct {
+    bool in_use;
+    uint16_t alloc_generation; // bumped when the slot is freed, invalidates its handle
     fs_path_t path;
     fs_result_t result;
     uint8_t* ptr;
     size_t size;
+    fs_file_t file;
+    #if !defined(FS_MMAP)
+    sfetch_handle_t fetch;
+    uint32_t generation;    // bumped on reset, stale fetch callbacks are ignored
     alignas(64) uint8_t buf[FS_MAX_SIZE + 1];
+    #endif
 } fs_slot_t;
 
+#if !defined(FS_MMAP)
+// passed through sokol-fetch to identify the slot and the load
+typedef struct {
+    size_t slot_index;
+    uint32_t generation;
+} fs_fetch_user_data_t;
+#endif
+
+typedef enum {
+    FS_SAVE_JOB_FREE,
+    FS_SAVE_JOB_PENDING,    // waiting for the writer
+    FS_SAVE_JOB_BUSY,       // owned by the writer
+    FS_SAVE_JOB_DONE,       // waiting for fs_dowork() to report the result
+} fs_save_job_state_t;
+
+// a pooled snapshot copy on its way to storage
+typedef struct {
+    fs_save_job_state_t state;
+    uint64_t seq;
+    char system_name[FS_SYSTEM_NAME_SIZE];
+    size_t snapshot_index;
+    fs_snapshot_save_callback_t callback;
+    bool success;
+    uint8_t* buf;
+    size_t buf_size;
+    size_t size;
+} fs_save_job_t;
+
 typedef struct {
     bool valid;
-    fs_slot_t slots[FS_NUM_SLOTS];
+    fs_desc_t desc;
+    // slots are allocated individually so that they don't move when the pool grows
+    fs_slot_t** slots;
+    size_t num_slots;
+    size_t max_slots;
+    struct {
+        uint64_t seq;
+        fs_save_job_t jobs[FS_MAX_SAVE_JOBS];
+        #if defined(FS_SAVE_THREAD)
+        bool quit;
+        #if defined(WIN32)
+        CRITICAL_SECTION lock;
+        CONDITION_VARIABLE cond;
+        HANDLE thread;
+        #else
+        pthread_mutex_t lock;
+        pthread_cond_t cond;
+        pthread_t thread;
+        #endif
+        #endif
+    } save;
+    #if defined(FS_MMAP)
+    struct {
+        size_t num;
+        fs_snapshot_load_t loads[FS_MAX_SNAPSHOT_LOADS];
+    } load;
+    #endif
 } fs_state_t;
 static fs_state_t state;
 
-void fs_init(void) {
+static bool fs_write_snapshot(const char* system_name, size_t snapshot_index, chips_range_t data);
+
+#if defined(FS_SAVE_THREAD)
+static void fs_save_lock(void) {
+    #if defined(WIN32)
+    EnterCriticalSection(&state.save.lock);
+    #else
+    pthread_mutex_lock(&state.save.lock);
+    #endif
+}
+
+static void fs_save_unlock(void) {
+    #if defined(WIN32)
+    LeaveCriticalSection(&state.save.lock);
+    #else
+    pthread_mutex_unlock(&state.save.lock);
+    #endif
+}
+
+static void fs_save_wait(void) {
+    #if defined(WIN32)
+    SleepConditionVariableCS(&state.save.cond, &state.save.lock, INFINITE);
+    #else
+    pthread_cond_wait(&state.save.cond, &state.save.lock);
+    #endif
+}
+
+static void fs_save_signal(void) {
+    #if defined(WIN32)
+    WakeAllConditionVariable(&state.save.cond);
+    #else
+    pthread_cond_broadcast(&state.save.cond);
+    #endif
+}
+#else
+static void fs_save_lock(void) { }
+static void fs_save_unlock(void) { }
+#endif
+
+static bool fs_alloc_file(fs_file_t* file, size_t size) {
+    file->ptr = malloc(size + 1);
+    if (!file->ptr) {
+        return false;
+    }
+    file->ptr[size] = 0;
+    file->size = size;
+    file->mapped = false;
+    return true;
+}
+
+static void fs_release_file(fs_file_t* file) {
+    if (file->ptr) {
+        #if defined(FS_MMAP)
+        if (file->mapped) {
+            #if defined(WIN32)
+            UnmapViewOfFile(file->ptr);
+            #else
+            munmap(file->ptr, file->size);
+            #endif
+        }
+        else
+        #endif
+        {
+            free(file->ptr);
+        }
+    }
+    memset(file, 0, sizeof(fs_file_t));
+}
+
+#if defined(FS_MMAP)
+static size_t fs_page_size(void) {
+    #if defined(WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t)info.dwPageSize;
+    #else
+    return (size_t)sysconf(_SC_PAGESIZE);
+    #endif
+}
+
+/*
+    Map a file into memory. The mapping is private and copy-on-write, so
+    loaders which patch the data in place don't change the file. The unused
+    tail of the last mapped page is zero-filled by the OS, which provides
+    the terminating zero for text files. Files with a size that's a
+    multiple of the page size (and empty files) have no such tail and are
+    read into a heap buffer instead.
+*/
+#if defined(WIN32)
+static bool fs_map_file(const char* path, fs_file_t* file) {
+    WCHAR wc_path[1024];
+    if (0 == MultiByteToWideChar(CP_UTF8, 0, path, -1, wc_path, sizeof(wc_path)/sizeof(WCHAR))) {
+        return false;
+    }
+    HANDLE fh = CreateFileW(wc_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fh == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(fh, &file_size) || ((uint64_t)file_size.QuadPart >= SIZE_MAX)) {
+        CloseHandle(fh);
+        return false;
+    }
+    const size_t size = (size_t)file_size.QuadPart;
+    if ((size % fs_page_size()) != 0) {
+        // the view keeps the mapping object alive
+        HANDLE mh = CreateFileMappingW(fh, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if (mh) {
+            void* ptr = MapViewOfFile(mh, FILE_MAP_COPY, 0, 0, 0);
+            CloseHandle(mh);
+            if (ptr) {
+                CloseHandle(fh);
+                *file = (fs_file_t){ .ptr = ptr, .size = size, .mapped = true };
+                return true;
+            }
+        }
+    }
+    bool success = fs_alloc_file(file, size);
+    size_t pos = 0;
+    while (success && (pos < size)) {
+        const DWORD chunk_size = ((size - pos) > 0x40000000) ? 0x40000000 : (DWORD)(size - pos);
+        DWORD num_read = 0;
+        success = ReadFile(fh, file->ptr + pos, chunk_size, &num_read, NULL) && (num_read > 0);
+        pos += num_read;
+    }
+    CloseHandle(fh);
+    if (!success) {
+        fs_release_file(file);
+    }
+    return success;
+}
+#else
+static bool fs_map_file(const char* path, fs_file_t* file) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if ((0 != fstat(fd, &st)) || !S_ISREG(st.st_mode) || ((uint64_t)st.st_size >= SIZE_MAX)) {
+        close(fd);
+        return false;
+    }
+    const size_t size = (size_t)st.st_size;
+    if ((size % fs_page_size()) != 0) {
+        void* ptr = mmap(0, size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+            close(fd);
+            *file = (fs_file_t){ .ptr = ptr, .size = size, .mapped = true };
+            return true;
+        }
+    }
+    bool success = fs_alloc_file(file, size);
+    size_t pos = 0;
+    while (success && (pos < size)) {
+        ssize_t res = read(fd, file->ptr + pos, size - pos);
+        if ((res < 0) && (errno == EINTR)) {
+            continue;
+        }
+        success = res > 0;
+        if (success) {
+            pos += (size_t)res;
+        }
+    }
+    close(fd);
+    if (!success) {
+        fs_release_file(file);
+    }
+    return success;
+}
+#endif
+#endif
+
+// the oldest pending save job, or 0
+static fs_save_job_t* fs_save_next_job(void) {
+    fs_save_job_t* next = 0;
+    for (size_t i = 0; i < FS_MAX_SAVE_JOBS; i++) {
+        fs_save_job_t* job = &state.save.jobs[i];
+        if ((job->state == FS_SAVE_JOB_PENDING) && ((next == 0) || (job->seq < next->seq))) {
+            next = job;
+        }
+    }
+    return next;
+}
+
+// called with the lock held, the job data is written without the lock
+static void fs_save_run_job(fs_save_job_t* job) {
+    job->state = FS_SAVE_JOB_BUSY;
+    fs_save_unlock();
+    const bool success = fs_write_snapshot(job->system_name, job->snapshot_index, (chips_range_t){ .ptr = job->buf, .size = job->size });
+    fs_save_lock();
+    job->success = success;
+    job->state = FS_SAVE_JOB_DONE;
+}
+
+#if defined(FS_SAVE_THREAD)
+#if defined(WIN32)
+static DWORD WINAPI fs_save_thread_func(LPVOID arg) {
+#else
+static void* fs_save_thread_func(void* arg) {
+#endif
+    (void)arg;
+    fs_save_lock();
+    for (;;) {
+        fs_save_job_t* job = fs_save_next_job();
+        if (job) {
+            fs_save_run_job(job);
+            fs_save_signal();
+        }
+        else if (state.save.quit) {
+            break;
+        }
+        else {
+            fs_save_wait();
+        }
+    }
+    fs_save_unlock();
+    return 0;
+}
+#endif
+
+void fs_init(const fs_desc_t* desc) {
+    assert(desc);
+    assert((desc->num_channels >= 0) && (desc->num_lanes >= 0));
     memset(&state, 0, sizeof(state));
     state.valid = true;
+    state.desc = *desc;
+    if (state.desc.num_channels == 0) {
+        state.desc.num_channels = FS_DEFAULT_NUM_CHANNELS;
+    }
+    if (state.desc.num_lanes == 0) {
+        state.desc.num_lanes = FS_DEFAULT_NUM_LANES;
+    }
+    for (size_t i = 0; i < FS_NUM_SLOTS; i++) {
+        fs_alloc_slot();
+    }
+    #if !defined(FS_MMAP)
+    // each slot loads into its own buffer, slots are spread over the channels
     sfetch_setup(&(sfetch_desc_t){
         .max_requests = 128,
-        .num_channels = FS_NUM_SLOTS,
-        .num_lanes = 1,
+        .num_channels = state.desc.num_channels,
+        .num_lanes = state.desc.num_lanes,
         .logger.func = slog_func,
     });
+    #endif
+    #if defined(FS_SAVE_THREAD)
+        #if defined(WIN32)
+            InitializeCriticalSection(&state.save.lock);
+            InitializeConditionVariable(&state.save.cond);
+            state.save.thread = CreateThread(0, 0, fs_save_thread_func, 0, 0, 0);
+            assert(state.save.thread);
+        #else
+            pthread_mutex_init(&state.save.lock, 0);
+            pthread_cond_init(&state.save.cond, 0);
+            int res = pthread_create(&state.save.thread, 0, fs_save_thread_func, 0);
+            assert(0 == res); (void)res;
+        #endif
+    #endif
+}
+
+void fs_shutdown(void) {
+    assert(state.valid);
+    // the writer finishes all pending snapshots before it quits
+    #if defined(FS_SAVE_THREAD)
+        fs_save_lock();
+        state.save.quit = true;
+        fs_save_signal();
+        fs_save_unlock();
+        #if defined(WIN32)
+            WaitForSingleObject(state.save.thread, INFINITE);
+            CloseHandle(state.save.thread);
+            DeleteCriticalSection(&state.save.lock);
+        #else
+            pthread_join(state.save.thread, 0);
+            pthread_cond_destroy(&state.save.cond);
+            pthread_mutex_destroy(&state.save.lock);
+        #endif
+    #else
+        fs_save_job_t* job;
+        while ((job = fs_save_next_job())) {
+            fs_save_run_job(job);
+        }
+    #endif
+    for (size_t i = 0; i < FS_MAX_SAVE_JOBS; i++) {
+        free(state.save.jobs[i].buf);
+    }
+    #if !defined(FS_MMAP)
+    // sokol-fetch may still own slot buffers
+    sfetch_shutdown();
+    #endif
+    for (size_t i = 0; i < state.num_slots; i++) {
+        fs_release_file(&state.slots[i]->file);
+        free(state.slots[i]);
+    }
+    free(state.slots);
+    state.valid = false;
+}
+
+#if defined(FS_MMAP)
+static void fs_snapshot_loaded(const fs_snapshot_load_context_t* ctx, chips_range_t file);
+
+static void fs_load_snapshots(void) {
+    // load callbacks may start new loads, those are handled in the next frame
+    fs_snapshot_load_t loads[FS_MAX_SNAPSHOT_LOADS];
+    const size_t num_loads = state.load.num;
+    memcpy(loads, state.load.loads, num_loads * sizeof(fs_snapshot_load_t));
+    state.load.num = 0;
+    for (size_t i = 0; i < num_loads; i++) {
+        const fs_snapshot_load_context_t* ctx = &loads[i].context;
+        fs_file_t file = {0};
+        if (fs_map_file(loads[i].path.cstr, &file)) {
+            fs_snapshot_loaded(ctx, (chips_range_t){ .ptr = file.ptr, .size = file.size });
+            fs_release_file(&file);
+        }
+        else {
+            ctx->callback(&(fs_snapshot_response_t){
+                .snapshot_index = ctx->snapshot_index,
+                .result = FS_RESULT_FAILED,
+            });
+        }
+    }
 }
 
+// snapshot load callbacks are called from fs_dowork(), like on the web
+static bool fs_queue_snapshot_load(const fs_path_t* path, size_t snapshot_index, fs_snapshot_load_callback_t callback) {
+    if ((path->len == 0) || path->clamped || (state.load.num >= FS_MAX_SNAPSHOT_LOADS)) {
+        return false;
+    }
+    state.load.loads[state.load.num++] = (fs_snapshot_load_t){
+        .path = *path,
+        .context = {
+            .snapshot_index = snapshot_index,
+            .callback = callback,
+        },
+    };
+    return true;
+}
+#endif
+
 void fs_dowork(void) {
     assert(state.valid);
+    #if defined(FS_MMAP)
+    fs_load_snapshots();
+    #else
     sfetch_dowork();
+    #endif
+    fs_snapshot_save_response_t responses[FS_MAX_SAVE_JOBS];
+    fs_snapshot_save_callback_t callbacks[FS_MAX_SAVE_JOBS];
+    size_t num_responses = 0;
+    fs_save_lock();
+    #if !defined(FS_SAVE_THREAD)
+        // without a writer thread, write one snapshot per frame
+        fs_save_job_t* next = fs_save_next_job();
+        if (next) {
+            fs_save_run_job(next);
+        }
+    #endif
+    for (size_t i = 0; i < FS_MAX_SAVE_JOBS; i++) {
+        fs_save_job_t* job = &state.save.jobs[i];
+        if (job->state == FS_SAVE_JOB_DONE) {
+            if (job->callback) {
+                callbacks[num_responses] = job->callback;
+                responses[num_responses++] = (fs_snapshot_save_response_t){
+                    .snapshot_index = job->snapshot_index,
+                    .result = job->success ? FS_RESULT_SUCCESS : FS_RESULT_FAILED,
+                };
+            }
+            job->state = FS_SAVE_JOB_FREE;
+        }
+    }
+    fs_save_unlock();
+    // callbacks are called without the lock held so they may save again
+    for (size_t i = 0; i < num_responses; i++) {
+        callbacks[i](&responses[i]);
+    }
+}
+
+bool fs_save_snapshot(const char* system_name, size_t snapshot_index, chips_range_t data, fs_snapshot_save_callback_t callback) {
+    assert(state.valid);
+    assert(system_name && data.ptr && (data.size > 0));
+    if (strlen(system_name) >= FS_SYSTEM_NAME_SIZE) {
+        return false;
+    }
+    fs_save_lock();
+    // a pending save into the same snapshot slot is replaced, so that spamming
+    // the save key doesn't queue up writes of outdated snapshots
+    fs_save_job_t* job = 0;
+    for (size_t i = 0; i < FS_MAX_SAVE_JOBS; i++) {
+        fs_save_job_t* cur = &state.save.jobs[i];
+        if ((cur->state == FS_SAVE_JOB_PENDING) && (cur->snapshot_index == snapshot_index) && (0 == strcmp(cur->system_name, system_name))) {
+            job = cur;
+            break;
+        }
+        else if ((cur->state == FS_SAVE_JOB_FREE) && (job == 0)) {
+            job = cur;
+        }
+    }
+    if (job == 0) {
+        fs_save_unlock();
+        return false;
+    }
+    if (job->buf_size < data.size) {
+        // on failure a pending save into the same slot is left untouched
+        uint8_t* buf = malloc(data.size);
+        if (buf == 0) {
+            fs_save_unlock();
+            return false;
+        }
+        free(job->buf);
+        job->buf = buf;
+        job->buf_size = data.size;
+    }
+    memcpy(job->buf, data.ptr, data.size);
+    job->size = data.size;
+    job->state = FS_SAVE_JOB_PENDING;
+    job->seq = state.save.seq++;
+    strcpy(job->system_name, system_name);
+    job->snapshot_index = snapshot_index;
+    job->callback = callback;
+    job->success = false;
+    #if defined(FS_SAVE_THREAD)
+        fs_save_signal();
+    #endif
+    fs_save_unlock();
+    return true;
 }
 
 static void fs_path_reset(fs_path_t* path) {
@@ -96,108 +625,313 @@ static void fs_path_extract_extension(fs_path_t* path, char* buf, size_t buf_siz
     }
 }
 
-// http://web.mit.edu/freebsd/head/contrib/wpa/src/utils/base64.c
-static const unsigned char fs_base64_table[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-static bool fs_base64_decode(fs_slot_t* slot, const char* src) {
-    int len = (int)strlen(src);
-
-    uint8_t dtable[256];
-    memset(dtable, 0x80, sizeof(dtable));
-    for (int i = 0; i < (int)sizeof(fs_base64_table)-1; i++) {
-        dtable[fs_base64_table[i]] = (uint8_t)i;
-    }
-    dtable['='] = 0;
+// base64 decoding table, characters which are not part of the base64 alphabet
+// (whitespace, line breaks...) are skipped, the terminating zero ends the input
+#define FS_BASE64_PAD (0x40)
+#define FS_BASE64_SKIP (0x80)
+#define FS_BASE64_END (0xC0)
+static const uint8_t fs_base64_dtable[256] = {
+    0xC0, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3E, 0x80, 0x80, 0x80, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x80, 0x80, 0x80, 0x40, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
 
-    int count = 0;
-    for (int i = 0; i < len; i++) {
-        if (dtable[(int)src[i]] != 0x80) {
-            count++;
-        }
+/*
+    The SIMD block decoders decode FS_BASE64_SIMD_CHARS characters into 3/4
+    as many bytes, and return false without writing anything if any
+    character isn't one of the 64 base64 characters. They may write one
+    byte past the decoded bytes, the caller keeps room for it.
+*/
+#if defined(FS_BASE64_SSE2)
+static bool fs_base64_decode_simd(const uint8_t* src, uint8_t* dst) {
+    const __m128i c = _mm_loadu_si128((const __m128i*)src);
+    // characters >= 0x80 are negative and don't fall into any of the ranges
+    const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('Z' + 1)));
+    const __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('z' + 1)));
+    const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+    const __m128i plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+    const __m128i slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+    const __m128i valid = _mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, plus)), slash);
+    if (_mm_movemask_epi8(valid) != 0xFFFF) {
+        return false;
     }
-
-    // input length must be multiple of 4
-    if ((count == 0) || (count & 3)) {
+    // add the offset from the character to its 6-bit value
+    __m128i offset = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    offset = _mm_or_si128(offset, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    offset = _mm_or_si128(offset, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    offset = _mm_or_si128(offset, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+    offset = _mm_or_si128(offset, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+    const __m128i val = _mm_add_epi8(c, offset);
+    // merge pairs of 6-bit values into 12 bits, and pairs of those into 24 bits
+    const __m128i pairs = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(val, _mm_set1_epi16(0x00FF)), 6), _mm_srli_epi16(val, 8));
+    const __m128i quads = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pairs, _mm_set1_epi32(0xFFFF)), 12), _mm_srli_epi32(pairs, 16));
+    // swap the first and last of the 3 bytes into memory order
+    const __m128i bytes = _mm_or_si128(_mm_or_si128(
+        _mm_slli_epi32(_mm_and_si128(quads, _mm_set1_epi32(0xFF)), 16),
+        _mm_and_si128(quads, _mm_set1_epi32(0xFF00))),
+        _mm_and_si128(_mm_srli_epi32(quads, 16), _mm_set1_epi32(0xFF)));
+    // each 4-byte store overlaps the next by one byte
+    uint32_t bits[4];
+    _mm_storeu_si128((__m128i*)bits, bytes);
+    memcpy(dst + 0, &bits[0], 4);
+    memcpy(dst + 3, &bits[1], 4);
+    memcpy(dst + 6, &bits[2], 4);
+    memcpy(dst + 9, &bits[3], 4);
+    return true;
+}
+#elif defined(FS_BASE64_WASM_SIMD)
+static bool fs_base64_decode_simd(const uint8_t* src, uint8_t* dst) {
+    const v128_t c = wasm_v128_load(src);
+    // unsigned compares, characters >= 0x80 don't fall into any of the ranges
+    const v128_t upper = wasm_v128_and(wasm_u8x16_ge(c, wasm_u8x16_splat('A')), wasm_u8x16_le(c, wasm_u8x16_splat('Z')));
+    const v128_t lower = wasm_v128_and(wasm_u8x16_ge(c, wasm_u8x16_splat('a')), wasm_u8x16_le(c, wasm_u8x16_splat('z')));
+    const v128_t digit = wasm_v128_and(wasm_u8x16_ge(c, wasm_u8x16_splat('0')), wasm_u8x16_le(c, wasm_u8x16_splat('9')));
+    const v128_t plus = wasm_i8x16_eq(c, wasm_u8x16_splat('+'));
+    const v128_t slash = wasm_i8x16_eq(c, wasm_u8x16_splat('/'));
+    const v128_t valid = wasm_v128_or(wasm_v128_or(wasm_v128_or(upper, lower), wasm_v128_or(digit, plus)), slash);
+    if (!wasm_i8x16_all_true(valid)) {
         return false;
     }
+    // add the offset from the character to its 6-bit value
+    v128_t offset = wasm_v128_and(upper, wasm_i8x16_splat(-'A'));
+    offset = wasm_v128_or(offset, wasm_v128_and(lower, wasm_i8x16_splat(26 - 'a')));
+    offset = wasm_v128_or(offset, wasm_v128_and(digit, wasm_i8x16_splat(52 - '0')));
+    offset = wasm_v128_or(offset, wasm_v128_and(plus, wasm_i8x16_splat(62 - '+')));
+    offset = wasm_v128_or(offset, wasm_v128_and(slash, wasm_i8x16_splat(63 - '/')));
+    const v128_t val = wasm_i8x16_add(c, offset);
+    // merge pairs of 6-bit values into 12 bits, and pairs of those into 24 bits
+    const v128_t pairs = wasm_v128_or(wasm_i16x8_shl(wasm_v128_and(val, wasm_i16x8_splat(0x00FF)), 6), wasm_u16x8_shr(val, 8));
+    const v128_t quads = wasm_v128_or(wasm_i32x4_shl(wasm_v128_and(pairs, wasm_i32x4_splat(0xFFFF)), 12), wasm_u32x4_shr(pairs, 16));
+    // gather the 3 bytes of each 24-bit value in memory order
+    const v128_t bytes = wasm_i8x16_shuffle(quads, quads, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, 3, 7, 11, 15);
+    const uint64_t lo = (uint64_t)wasm_i64x2_extract_lane(bytes, 0);
+    const uint32_t hi = (uint32_t)wasm_i32x4_extract_lane(bytes, 2);
+    memcpy(dst + 0, &lo, 8);
+    memcpy(dst + 8, &hi, 4);
+    return true;
+}
+#elif defined(FS_BASE64_NEON)
+// map 16 characters to their 6-bit values, clears valid lanes of characters which aren't base64
+static uint8x16_t fs_base64_neon_values(uint8x16_t c, uint8x16_t* valid) {
+    // unsigned compares, characters >= 0x80 don't fall into any of the ranges
+    const uint8x16_t upper = vandq_u8(vcgeq_u8(c, vdupq_n_u8('A')), vcleq_u8(c, vdupq_n_u8('Z')));
+    const uint8x16_t lower = vandq_u8(vcgeq_u8(c, vdupq_n_u8('a')), vcleq_u8(c, vdupq_n_u8('z')));
+    const uint8x16_t digit = vandq_u8(vcgeq_u8(c, vdupq_n_u8('0')), vcleq_u8(c, vdupq_n_u8('9')));
+    const uint8x16_t plus = vceqq_u8(c, vdupq_n_u8('+'));
+    const uint8x16_t slash = vceqq_u8(c, vdupq_n_u8('/'));
+    *valid = vandq_u8(*valid, vorrq_u8(vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, plus)), slash));
+    uint8x16_t offset = vandq_u8(upper, vdupq_n_u8((uint8_t)-'A'));
+    offset = vorrq_u8(offset, vandq_u8(lower, vdupq_n_u8((uint8_t)(26 - 'a'))));
+    offset = vorrq_u8(offset, vandq_u8(digit, vdupq_n_u8((uint8_t)(52 - '0'))));
+    offset = vorrq_u8(offset, vandq_u8(plus, vdupq_n_u8((uint8_t)(62 - '+'))));
+    offset = vorrq_u8(offset, vandq_u8(slash, vdupq_n_u8((uint8_t)(63 - '/'))));
+    return vaddq_u8(c, offset);
+}
 
-    // output length
-    int olen = (count / 4) * 3;
-    if (olen >= (int)sizeof(slot->buf)) {
+// the 64 characters are de-interleaved into the 1st to 4th characters of 16 blocks
+static bool fs_base64_decode_simd(const uint8_t* src, uint8_t* dst) {
+    const uint8x16x4_t c = vld4q_u8(src);
+    uint8x16_t valid = vdupq_n_u8(0xFF);
+    const uint8x16_t a = fs_base64_neon_values(c.val[0], &valid);
+    const uint8x16_t b = fs_base64_neon_values(c.val[1], &valid);
+    const uint8x16_t cc = fs_base64_neon_values(c.val[2], &valid);
+    const uint8x16_t d = fs_base64_neon_values(c.val[3], &valid);
+    const uint8x8_t valid8 = vand_u8(vget_low_u8(valid), vget_high_u8(valid));
+    if (vget_lane_u64(vreinterpret_u64_u8(valid8), 0) != UINT64_MAX) {
         return false;
     }
+    uint8x16x3_t bytes;
+    bytes.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+    bytes.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(cc, 2));
+    bytes.val[2] = vorrq_u8(vshlq_n_u8(cc, 6), d);
+    vst3q_u8(dst, bytes);
+    return true;
+}
+#endif
 
-    // decode loop
-    count = 0;
+// decode in a single pass, valid characters are decoded in SIMD blocks or
+// blocks of 4 until a skipped character or padding is encountered, src_len is
+// only needed to keep the SIMD loads within the string
+static bool fs_base64_decode(const char* src, size_t src_len, uint8_t* dst, size_t dst_size, size_t* out_size) {
+    assert(dst_size > 0);
+    const uint8_t* ptr = (const uint8_t*)src;
+    #if defined(FS_BASE64_SIMD_CHARS)
+    const uint8_t* end = ptr + src_len;
+    #else
+    (void)src_len;
+    #endif
+    // keep room for the terminating zero byte
+    const size_t max_size = dst_size - 1;
+    size_t pos = 0;
+    size_t num_blocks = 0;
+    uint32_t block = 0;
+    int count = 0;
     int pad = 0;
-    uint8_t block[4];
-    for (int i = 0; i < len; i++) {
-        uint8_t tmp = dtable[(int)src[i]];
-        if (tmp == 0x80) {
+    for (;;) {
+        if (count == 0) {
+            #if defined(FS_BASE64_SIMD_CHARS)
+            const size_t simd_bytes = (FS_BASE64_SIMD_CHARS / 4) * 3;
+            while (((end - ptr) >= FS_BASE64_SIMD_CHARS) && ((pos + simd_bytes) <= max_size) && fs_base64_decode_simd(ptr, &dst[pos])) {
+                pos += simd_bytes;
+                num_blocks += FS_BASE64_SIMD_CHARS / 4;
+                ptr += FS_BASE64_SIMD_CHARS;
+            }
+            #endif
+            uint8_t a, b, c, d;
+            while (((a = fs_base64_dtable[ptr[0]]) < 64) && ((b = fs_base64_dtable[ptr[1]]) < 64) &&
+                   ((c = fs_base64_dtable[ptr[2]]) < 64) && ((d = fs_base64_dtable[ptr[3]]) < 64))
+            {
+                if ((pos + 3) > max_size) {
+                    return false;
+                }
+                const uint32_t bits = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | d;
+                dst[pos++] = (uint8_t)(bits >> 16);
+                dst[pos++] = (uint8_t)(bits >> 8);
+                dst[pos++] = (uint8_t)bits;
+                num_blocks++;
+                ptr += 4;
+            }
+        }
+        uint8_t val = fs_base64_dtable[*ptr++];
+        if (val == FS_BASE64_END) {
+            break;
+        }
+        else if (val == FS_BASE64_SKIP) {
             continue;
         }
-        if (src[i] == '=') {
+        else if (val == FS_BASE64_PAD) {
             pad++;
+            val = 0;
         }
-        block[count] = tmp;
-        count++;
-        if (count == 4) {
+        block = (block << 6) | val;
+        if (++count == 4) {
+            if ((pos + 3) > max_size) {
+                return false;
+            }
+            dst[pos++] = (uint8_t)(block >> 16);
+            dst[pos++] = (uint8_t)(block >> 8);
+            dst[pos++] = (uint8_t)block;
+            num_blocks++;
             count = 0;
-            slot->buf[slot->size++] = (block[0] << 2) | (block[1] >> 4);
-            slot->buf[slot->size++] = (block[1] << 4) | (block[2] >> 2);
-            slot->buf[slot->size++] = (block[2] << 6) | block[3];
+            block = 0;
             if (pad > 0) {
-                if (pad <= 2) {
-                    slot->size -= pad;
-                }
-                else {
+                if (pad > 2) {
                     // invalid padding
                     return false;
                 }
+                // padding ends the data
+                pos -= pad;
                 break;
             }
         }
     }
+    // input length must be a multiple of 4
+    if ((num_blocks == 0) || (count != 0)) {
+        return false;
+    }
+    *out_size = pos;
     return true;
 }
 
-bool fs_ext(size_t slot_index, const char* ext) {
+static size_t fs_slot_handle(size_t index, uint16_t alloc_generation) {
+    return index | ((size_t)alloc_generation << FS_SLOT_INDEX_BITS);
+}
+
+// the standard slots are never freed, so their handle is their index
+static fs_slot_t* fs_get_slot(size_t slot_handle) {
     assert(state.valid);
-    assert(slot_index < FS_NUM_SLOTS);
+    const size_t index = slot_handle & FS_SLOT_INDEX_MASK;
+    assert(index < state.num_slots);
+    fs_slot_t* slot = state.slots[index];
+    // catches handles of freed slots, even if the slot has been allocated again
+    assert(slot->in_use && (fs_slot_handle(index, slot->alloc_generation) == slot_handle));
+    return slot;
+}
+
+static size_t fs_slot_index(size_t slot_handle) {
+    (void)fs_get_slot(slot_handle);
+    return slot_handle & FS_SLOT_INDEX_MASK;
+}
+
+size_t fs_alloc_slot(void) {
+    assert(state.valid);
+    size_t slot_index = 0;
+    while ((slot_index < state.num_slots) && state.slots[slot_index]->in_use) {
+        slot_index++;
+    }
+    if (slot_index == state.num_slots) {
+        // all slots are in use, grow the pool
+        if (state.num_slots == state.max_slots) {
+            state.max_slots = (state.max_slots == 0) ? FS_NUM_SLOTS : (state.max_slots * 2);
+            state.slots = realloc(state.slots, state.max_slots * sizeof(fs_slot_t*));
+            assert(state.slots);
+        }
+        assert(state.num_slots <= FS_SLOT_INDEX_MASK);
+        state.slots[state.num_slots++] = calloc(1, sizeof(fs_slot_t));
+        assert(state.slots[slot_index]);
+    }
+    fs_slot_t* slot = state.slots[slot_index];
+    slot->in_use = true;
+    slot->result = FS_RESULT_IDLE;
+    return fs_slot_handle(slot_index, slot->alloc_generation);
+}
+
+void fs_free_slot(size_t slot_handle) {
+    assert(fs_slot_index(slot_handle) >= FS_NUM_SLOTS);
+    fs_reset(slot_handle);
+    fs_slot_t* slot = fs_get_slot(slot_handle);
+    slot->in_use = false;
+    slot->alloc_generation++;
+}
+
+bool fs_ext(size_t slot_index, const char* ext) {
     char buf[FS_EXT_SIZE];
-    fs_path_extract_extension(&state.slots[slot_index].path, buf, sizeof(buf));
+    fs_path_extract_extension(&fs_get_slot(slot_index)->path, buf, sizeof(buf));
     return 0 == strcmp(ext, buf);
 }
 
 const char* fs_filename(size_t slot_index) {
-    assert(state.valid);
-    assert(slot_index < FS_NUM_SLOTS);
-    return state.slots[slot_index].path.cstr;
+    return fs_get_slot(slot_index)->path.cstr;
 }
 
 void fs_reset(size_t slot_index) {
-    assert(state.valid);
-    assert(slot_index < FS_NUM_SLOTS);
-    fs_slot_t* slot = &state.slots[slot_index];
+    fs_slot_t* slot = fs_get_slot(slot_index);
+    #if !defined(FS_MMAP)
+    if (slot->result == FS_RESULT_PENDING) {
+        sfetch_cancel(slot->fetch);
+    }
+    slot->generation++;
+    #endif
     fs_path_reset(&slot->path);
     slot->result = FS_RESULT_IDLE;
     slot->ptr = 0;
     slot->size = 0;
+    fs_release_file(&slot->file);
 }
 
 void fs_load_mem(size_t slot_index, const char* path, chips_range_t data) {
-    assert(state.valid);
-    assert(slot_index < FS_NUM_SLOTS);
     assert(data.ptr && (data.size > 0));
     fs_reset(slot_index);
-    fs_slot_t* slot = &state.slots[slot_index];
-    if ((data.size > 0) && (data.size <= FS_MAX_SIZE)) {
+    fs_slot_t* slot = fs_get_slot(slot_index);
+    if ((data.size > 0) && fs_alloc_file(&slot->file, data.size)) {
+        slot->ptr = slot->file.ptr;
         fs_path_append(&slot->path, path);
         slot->result = FS_RESULT_SUCCESS;
         slot->size = data.size;
-        slot->ptr = slot->buf;
         memcpy(slot->ptr, data.ptr, data.size);
-        /* zero-terminate in case this is a text file */
-        slot->ptr[slot->size] = 0;
     }
     else {
         slot->result = FS_RESULT_FAILED;
@@ -205,14 +939,23 @@ void fs_load_mem(size_t slot_index, const char* path, chips_range_t data) {
 }
 
 bool fs_load_base64(size_t slot_index, const char* name, const char* payload) {
-    assert(state.valid);
-    assert(slot_index < FS_NUM_SLOTS);
     fs_reset(slot_index);
-    fs_slot_t* slot = &state.slots[slot_index];
+    fs_slot_t* slot = fs_get_slot(slot_index);
     fs_path_append(&slot->path, name);
-    if (fs_base64_decode(slot, payload)) {
+    const size_t payload_len = strlen(payload);
+    // the decoded size is at most 3/4 of the encoded size, the payload isn't
+    // limited by FS_MAX_SIZE on the web either
+    if (!fs_alloc_file(&slot->file, (payload_len / 4) * 3 + 1)) {
+        slot->result = FS_RESULT_FAILED;
+        return false;
+    }
+    uint8_t* dst = slot->file.ptr;
+    const size_t dst_size = slot->file.size;
+    if (fs_base64_decode(payload, payload_len, dst, dst_size, &slot->size)) {
         slot->result = FS_RESULT_SUCCESS;
-        slot->ptr = slot->buf;
+        slot->ptr = dst;
+        // in case it's a text file, zero-terminate the data
+        slot->ptr[slot->size] = 0;
         return true;
     }
     else {
@@ -221,11 +964,25 @@ bool fs_load_base64(size_t slot_index, const char* name, const char* payload) {
     }
 }
 
-static void fs_fetch_callback(const sfetch_response_t* response) {
+#if !defined(FS_MMAP)
+// a load may complete after its slot was reset or freed, returns 0 in that case
+static fs_slot_t* fs_get_load_slot(const fs_fetch_user_data_t* user_data) {
     assert(state.valid);
-    size_t slot_index = *(size_t*)response->user_data;
-    assert(slot_index < FS_NUM_SLOTS);
-    fs_slot_t* slot = &state.slots[slot_index];
+    if (user_data->slot_index >= state.num_slots) {
+        return 0;
+    }
+    fs_slot_t* slot = state.slots[user_data->slot_index];
+    if (!slot->in_use || (slot->generation != user_data->generation)) {
+        return 0;
+    }
+    return slot;
+}
+
+static void fs_fetch_callback(const sfetch_response_t* response) {
+    fs_slot_t* slot = fs_get_load_slot((const fs_fetch_user_data_t*)response->user_data);
+    if (!slot) {
+        return;
+    }
     if (response->fetched) {
         slot->result = FS_RESULT_SUCCESS;
         slot->ptr = (uint8_t*)response->data.ptr;
@@ -238,12 +995,16 @@ static void fs_fetch_callback(const sfetch_response_t* response) {
         slot->result = FS_RESULT_FAILED;
     }
 }
+#endif
 
 #if defined(__EMSCRIPTEN__)
 static void fs_emsc_dropped_file_callback(const sapp_html5_fetch_response* response) {
-    size_t slot_index = (size_t)(uintptr_t)response->user_data;
-    assert(slot_index < FS_NUM_SLOTS);
-    fs_slot_t* slot = &state.slots[slot_index];
+    fs_fetch_user_data_t* user_data = (fs_fetch_user_data_t*)response->user_data;
+    fs_slot_t* slot = fs_get_load_slot(user_data);
+    free(user_data);
+    if (!slot) {
+        return;
+    }
     if (response->succeeded) {
         slot->result = FS_RESULT_SUCCESS;
         slot->ptr = (uint8_t*)response->data.ptr;
@@ -259,35 +1020,55 @@ static void fs_emsc_dropped_file_callback(const sapp_html5_fetch_response* respo
 #endif
 
 void fs_start_load_file(size_t slot_index, const char* path) {
-    assert(state.valid);
-    assert(slot_index < FS_NUM_SLOTS);
     fs_reset(slot_index);
-    fs_slot_t* slot = &state.slots[slot_index];
+    fs_slot_t* slot = fs_get_slot(slot_index);
     fs_path_append(&slot->path, path);
+    #if defined(FS_MMAP)
+    // mapping a file is cheap, the data is paged in when it's accessed
+    if (fs_map_file(path, &slot->file)) {
+        slot->result = FS_RESULT_SUCCESS;
+        slot->ptr = slot->file.ptr;
+        slot->size = slot->file.size;
+    }
+    else {
+        slot->result = FS_RESULT_FAILED;
+    }
+    #else
     slot->result = FS_RESULT_PENDING;
-    sfetch_send(&(sfetch_request_t){
+    const fs_fetch_user_data_t user_data = {
+        .slot_index = fs_slot_index(slot_index),
+        .generation = slot->generation,
+    };
+    slot->fetch = sfetch_send(&(sfetch_request_t){
         .path = path,
-        .channel = (int)slot_index,
+        .channel = (int)(user_data.slot_index % (size_t)state.desc.num_channels),
         .callback = fs_fetch_callback,
         .buffer = { .ptr = slot->buf, .size = FS_MAX_SIZE },
-        .user_data = { .ptr = &slot_index, .size = sizeof(slot_index) },
+        .user_data = { .ptr = &user_data, .size = sizeof(user_data) },
     });
+    if (!sfetch_handle_valid(slot->fetch)) {
+        slot->result = FS_RESULT_FAILED;
+    }
+    #endif
 }
 
 void fs_start_load_dropped_file(size_t slot_index) {
-    assert(state.valid);
-    assert(slot_index < FS_NUM_SLOTS);
     fs_reset(slot_index);
-    fs_slot_t* slot = &state.slots[slot_index];
+    fs_slot_t* slot = fs_get_slot(slot_index);
     const char* path = sapp_get_dropped_file_path(0);
     fs_path_append(&slot->path, path);
     slot->result = FS_RESULT_PENDING;
     #if defined(__EMSCRIPTEN__)
+        // the dropped file fetch can't be cancelled, the callback checks if the slot is still waiting for it
+        fs_fetch_user_data_t* user_data = calloc(1, sizeof(fs_fetch_user_data_t));
+        assert(user_data);
+        user_data->slot_index = fs_slot_index(slot_index);
+        user_data->generation = slot->generation;
         sapp_html5_fetch_dropped_file(&(sapp_html5_fetch_request){
             .dropped_file_index = 0,
             .callback = fs_emsc_dropped_file_callback,
             .buffer = { .ptr = slot->buf, .size = FS_MAX_SIZE },
-            .user_data = (void*)(intptr_t)slot_index,
+            .user_data = user_data,
         });
     #else
         fs_start_load_file(slot_index, path);
@@ -295,9 +1076,7 @@ void fs_start_load_dropped_file(size_t slot_index) {
 }
 
 fs_result_t fs_result(size_t slot_index) {
-    assert(state.valid);
-    assert(slot_index < FS_NUM_SLOTS);
-    return state.slots[slot_index].result;
+    return fs_get_slot(slot_index)->result;
 }
 
 bool fs_success(size_t slot_index) {
@@ -313,9 +1092,7 @@ bool fs_pending(size_t slot_index) {
 }
 
 chips_range_t fs_data(size_t slot_index) {
-    assert(state.valid);
-    assert(slot_index < FS_NUM_SLOTS);
-    fs_slot_t* slot = &state.slots[slot_index];
+    fs_slot_t* slot = fs_get_slot(slot_index);
     if (slot->result == FS_RESULT_SUCCESS) {
         return (chips_range_t){ .ptr = slot->ptr, .size = slot->size };
     }
@@ -336,29 +1113,337 @@ fs_path_t fs_make_snapshot_path(const char* dir, const char* system_name, size_t
     return path;
 }
 
-#if !defined(__EMSCRIPTEN__)
-static void fs_snapshot_fetch_callback(const sfetch_response_t* response) {
-    const fs_snapshot_load_context_t* ctx = (fs_snapshot_load_context_t*) response->user_data;
-    size_t snapshot_index = ctx->snapshot_index;
-    fs_snapshot_load_callback_t callback = ctx->callback;
-    if (response->fetched) {
-        callback(&(fs_snapshot_response_t){
-            .snapshot_index = snapshot_index,
-            .result = FS_RESULT_SUCCESS,
-            .data = {
-                .ptr = (uint8_t*)response->data.ptr,
-                .size = response->data.size
+/*
+    Snapshot files are a small container around the snapshot data
+    (all values little endian):
+
+        u32 magic ('CSNP'), u16 format version, u16 num_chunks,
+        u32 snapshot data size, u32 FNV-1a hash of the snapshot data
+
+    Followed by the chunks:
+
+        u16 chunk id, u16 codec, u32 stored size, stored bytes
+
+    The snapshot data is split into 64 KByte chunks, the chunk id is
+    the chunk index. All-zero chunks (unused RAM, cleared host pointers)
+    store no bytes, other chunks are LZ4-style compressed, or stored
+    uncompressed if that doesn't make them smaller. Loading decodes the
+    container before the data is handed to the load callback, so the
+    frontends still see the plain snapshot struct. Files without the
+    magic are treated as uncompressed snapshots from older versions.
+
+    The chunks are fixed-size slices of the snapshot struct, not
+    per-chip sections, so the container doesn't make snapshots portable
+    across struct layout changes: the frontends still reject snapshots
+    whose size doesn't match their snapshot struct, and a layout change
+    which keeps the size isn't detected at all.
+*/
+#define FS_SNAPSHOT_MAGIC (0x504E5343)
+#define FS_SNAPSHOT_FORMAT_VERSION (1)
+#define FS_SNAPSHOT_HEADER_SIZE (16)
+#define FS_SNAPSHOT_CHUNK_HEADER_SIZE (8)
+#define FS_SNAPSHOT_CHUNK_SIZE (64 * 1024)
+// upper bound for the decoded size, way above the largest snapshot struct
+#define FS_SNAPSHOT_MAX_SIZE (64 * 1024 * 1024)
+#define FS_SNAPSHOT_CODEC_ZERO (0)
+#define FS_SNAPSHOT_CODEC_STORE (1)
+#define FS_SNAPSHOT_CODEC_LZ (2)
+#define FS_LZ_MIN_MATCH (4)
+#define FS_LZ_HASH_BITS (12)
+// worst case size of LZ compressed data
+#define FS_LZ_MAX_SIZE(size) ((size) + ((size) / 255) + 16)
+
+static void fs_put_u16(uint8_t* dst, uint16_t val) {
+    dst[0] = (uint8_t)val;
+    dst[1] = (uint8_t)(val >> 8);
+}
+
+static void fs_put_u32(uint8_t* dst, uint32_t val) {
+    dst[0] = (uint8_t)val;
+    dst[1] = (uint8_t)(val >> 8);
+    dst[2] = (uint8_t)(val >> 16);
+    dst[3] = (uint8_t)(val >> 24);
+}
+
+static uint16_t fs_get_u16(const uint8_t* src) {
+    return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static uint32_t fs_get_u32(const uint8_t* src) {
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static uint32_t fs_hash(const uint8_t* ptr, size_t size) {
+    uint32_t hash = 0x811C9DC5;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ ptr[i]) * 0x01000193;
+    }
+    return hash;
+}
+
+static uint8_t* fs_lz_put_len(uint8_t* dst, size_t len) {
+    while (len >= 255) {
+        *dst++ = 255;
+        len -= 255;
+    }
+    *dst++ = (uint8_t)len;
+    return dst;
+}
+
+// write a sequence of literals followed by a match (no match if match_len is 0)
+static uint8_t* fs_lz_put_sequence(uint8_t* dst, const uint8_t* lit, size_t lit_len, size_t offset, size_t match_len) {
+    uint8_t* token = dst++;
+    *token = (uint8_t)(((lit_len < 15) ? lit_len : 15) << 4);
+    if (lit_len >= 15) {
+        dst = fs_lz_put_len(dst, lit_len - 15);
+    }
+    memcpy(dst, lit, lit_len);
+    dst += lit_len;
+    if (match_len > 0) {
+        const size_t len = match_len - FS_LZ_MIN_MATCH;
+        *dst++ = (uint8_t)offset;
+        *dst++ = (uint8_t)(offset >> 8);
+        *token |= (uint8_t)((len < 15) ? len : 15);
+        if (len >= 15) {
+            dst = fs_lz_put_len(dst, len - 15);
+        }
+    }
+    return dst;
+}
+
+// LZ4-style compression of up to 64 KBytes, dst must have room for FS_LZ_MAX_SIZE(size) bytes
+static size_t fs_lz_compress(uint8_t* dst, const uint8_t* src, size_t size) {
+    assert(size <= FS_SNAPSHOT_CHUNK_SIZE);
+    uint32_t table[1<<FS_LZ_HASH_BITS] = {0};
+    uint8_t* out = dst;
+    size_t anchor = 0;
+    size_t pos = 0;
+    while ((pos + FS_LZ_MIN_MATCH) <= size) {
+        const uint32_t seq = fs_get_u32(&src[pos]);
+        const uint32_t hash = (seq * 2654435761u) >> (32 - FS_LZ_HASH_BITS);
+        const size_t cand = table[hash];
+        table[hash] = (uint32_t)pos;
+        if ((cand >= pos) || (fs_get_u32(&src[cand]) != seq)) {
+            pos++;
+            continue;
+        }
+        size_t match_len = FS_LZ_MIN_MATCH;
+        while (((pos + match_len) < size) && (src[cand + match_len] == src[pos + match_len])) {
+            match_len++;
+        }
+        out = fs_lz_put_sequence(out, &src[anchor], pos - anchor, pos - cand, match_len);
+        pos += match_len;
+        anchor = pos;
+    }
+    out = fs_lz_put_sequence(out, &src[anchor], size - anchor, 0, 0);
+    return (size_t)(out - dst);
+}
+
+static bool fs_lz_get_len(const uint8_t** src, const uint8_t* end, size_t* len) {
+    uint8_t b;
+    do {
+        if (*src >= end) {
+            return false;
+        }
+        b = *(*src)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+static bool fs_lz_decompress(uint8_t* dst, size_t dst_size, const uint8_t* src, size_t src_size) {
+    const uint8_t* end = src + src_size;
+    size_t pos = 0;
+    while (src < end) {
+        const uint8_t token = *src++;
+        size_t lit_len = token >> 4;
+        if ((lit_len == 15) && !fs_lz_get_len(&src, end, &lit_len)) {
+            return false;
+        }
+        if ((lit_len > (size_t)(end - src)) || (lit_len > (dst_size - pos))) {
+            return false;
+        }
+        memcpy(&dst[pos], src, lit_len);
+        src += lit_len;
+        pos += lit_len;
+        if (src == end) {
+            break;
+        }
+        if ((end - src) < 2) {
+            return false;
+        }
+        const size_t offset = fs_get_u16(src);
+        src += 2;
+        size_t match_len = token & 15;
+        if ((match_len == 15) && !fs_lz_get_len(&src, end, &match_len)) {
+            return false;
+        }
+        match_len += FS_LZ_MIN_MATCH;
+        if ((offset == 0) || (offset > pos) || (match_len > (dst_size - pos))) {
+            return false;
+        }
+        // matches may overlap with their own output
+        for (size_t i = 0; i < match_len; i++, pos++) {
+            dst[pos] = dst[pos - offset];
+        }
+    }
+    return pos == dst_size;
+}
+
+static bool fs_is_zero(const uint8_t* ptr, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (ptr[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// encode snapshot data into a snapshot container, the result must be freed with free()
+static chips_range_t fs_snapshot_encode(chips_range_t data) {
+    const uint8_t* src = data.ptr;
+    const size_t num_chunks = (data.size + FS_SNAPSHOT_CHUNK_SIZE - 1) / FS_SNAPSHOT_CHUNK_SIZE;
+    if ((num_chunks > 0xFFFF) || (data.size > 0xFFFFFFFF)) {
+        return (chips_range_t){0};
+    }
+    uint8_t* dst = malloc(FS_SNAPSHOT_HEADER_SIZE + num_chunks * FS_SNAPSHOT_CHUNK_HEADER_SIZE + data.size);
+    uint8_t* scratch = malloc(FS_LZ_MAX_SIZE(FS_SNAPSHOT_CHUNK_SIZE));
+    if ((dst == 0) || (scratch == 0)) {
+        free(dst);
+        free(scratch);
+        return (chips_range_t){0};
+    }
+    fs_put_u32(&dst[0], FS_SNAPSHOT_MAGIC);
+    fs_put_u16(&dst[4], FS_SNAPSHOT_FORMAT_VERSION);
+    fs_put_u16(&dst[6], (uint16_t)num_chunks);
+    fs_put_u32(&dst[8], (uint32_t)data.size);
+    fs_put_u32(&dst[12], fs_hash(src, data.size));
+    size_t pos = FS_SNAPSHOT_HEADER_SIZE;
+    for (size_t i = 0; i < num_chunks; i++) {
+        const uint8_t* chunk = &src[i * FS_SNAPSHOT_CHUNK_SIZE];
+        const size_t chunk_size = (i == (num_chunks - 1)) ? (data.size - i * FS_SNAPSHOT_CHUNK_SIZE) : FS_SNAPSHOT_CHUNK_SIZE;
+        uint16_t codec;
+        size_t stored_size;
+        const uint8_t* stored;
+        if (fs_is_zero(chunk, chunk_size)) {
+            codec = FS_SNAPSHOT_CODEC_ZERO;
+            stored_size = 0;
+            stored = 0;
+        }
+        else {
+            stored_size = fs_lz_compress(scratch, chunk, chunk_size);
+            if (stored_size < chunk_size) {
+                codec = FS_SNAPSHOT_CODEC_LZ;
+                stored = scratch;
             }
-        });
+            else {
+                codec = FS_SNAPSHOT_CODEC_STORE;
+                stored_size = chunk_size;
+                stored = chunk;
+            }
+        }
+        fs_put_u16(&dst[pos + 0], (uint16_t)i);
+        fs_put_u16(&dst[pos + 2], codec);
+        fs_put_u32(&dst[pos + 4], (uint32_t)stored_size);
+        pos += FS_SNAPSHOT_CHUNK_HEADER_SIZE;
+        if (stored_size > 0) {
+            memcpy(&dst[pos], stored, stored_size);
+            pos += stored_size;
+        }
     }
-    else if (response->failed) {
-        callback(&(fs_snapshot_response_t){
-            .snapshot_index = snapshot_index,
-            .result = FS_RESULT_FAILED,
-        });
+    free(scratch);
+    return (chips_range_t){ .ptr = dst, .size = pos };
+}
+
+static bool fs_is_snapshot_container(chips_range_t file) {
+    return (file.size >= FS_SNAPSHOT_HEADER_SIZE) && (fs_get_u32(file.ptr) == FS_SNAPSHOT_MAGIC);
+}
+
+// decode a snapshot container, the result must be freed with free(), returns
+// an empty range if the container is corrupt or has an unknown format version
+static chips_range_t fs_snapshot_decode(chips_range_t file) {
+    assert(fs_is_snapshot_container(file));
+    const uint8_t* src = file.ptr;
+    const uint8_t* end = src + file.size;
+    if (fs_get_u16(&src[4]) != FS_SNAPSHOT_FORMAT_VERSION) {
+        return (chips_range_t){0};
+    }
+    const size_t num_chunks = fs_get_u16(&src[6]);
+    const size_t size = fs_get_u32(&src[8]);
+    const uint32_t hash = fs_get_u32(&src[12]);
+    if ((size == 0) || (num_chunks != ((size + FS_SNAPSHOT_CHUNK_SIZE - 1) / FS_SNAPSHOT_CHUNK_SIZE))) {
+        return (chips_range_t){0};
+    }
+    // don't trust the header with the allocation size, every chunk needs at least its header in the file
+    if ((size > FS_SNAPSHOT_MAX_SIZE) || ((num_chunks * FS_SNAPSHOT_CHUNK_HEADER_SIZE) > (file.size - FS_SNAPSHOT_HEADER_SIZE))) {
+        return (chips_range_t){0};
+    }
+    uint8_t* dst = malloc(size);
+    if (dst == 0) {
+        return (chips_range_t){0};
+    }
+    src += FS_SNAPSHOT_HEADER_SIZE;
+    for (size_t i = 0; i < num_chunks; i++) {
+        uint8_t* chunk = &dst[i * FS_SNAPSHOT_CHUNK_SIZE];
+        const size_t chunk_size = (i == (num_chunks - 1)) ? (size - i * FS_SNAPSHOT_CHUNK_SIZE) : FS_SNAPSHOT_CHUNK_SIZE;
+        if ((end - src) < FS_SNAPSHOT_CHUNK_HEADER_SIZE) {
+            goto error;
+        }
+        const size_t id = fs_get_u16(&src[0]);
+        const uint16_t codec = fs_get_u16(&src[2]);
+        const size_t stored_size = fs_get_u32(&src[4]);
+        src += FS_SNAPSHOT_CHUNK_HEADER_SIZE;
+        if ((id != i) || (stored_size > (size_t)(end - src))) {
+            goto error;
+        }
+        bool ok;
+        switch (codec) {
+            case FS_SNAPSHOT_CODEC_ZERO:
+                memset(chunk, 0, chunk_size);
+                ok = (stored_size == 0);
+                break;
+            case FS_SNAPSHOT_CODEC_STORE:
+                ok = (stored_size == chunk_size);
+                if (ok) {
+                    memcpy(chunk, src, chunk_size);
+                }
+                break;
+            case FS_SNAPSHOT_CODEC_LZ:
+                ok = fs_lz_decompress(chunk, chunk_size, src, stored_size);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) {
+            goto error;
+        }
+        src += stored_size;
+    }
+    if (fs_hash(dst, size) != hash) {
+        goto error;
+    }
+    return (chips_range_t){ .ptr = dst, .size = size };
+error:
+    free(dst);
+    return (chips_range_t){0};
+}
+
+// decode a loaded snapshot file and forward the snapshot data to the load callback
+static void fs_snapshot_loaded(const fs_snapshot_load_context_t* ctx, chips_range_t file) {
+    chips_range_t data = file;
+    if (fs_is_snapshot_container(file)) {
+        data = fs_snapshot_decode(file);
+    }
+    ctx->callback(&(fs_snapshot_response_t){
+        .snapshot_index = ctx->snapshot_index,
+        .result = data.ptr ? FS_RESULT_SUCCESS : FS_RESULT_FAILED,
+        .data = data,
+    });
+    if (data.ptr != file.ptr) {
+        free(data.ptr);
     }
 }
-#endif
 
 #if defined (WIN32)
 fs_path_t fs_win32_make_snapshot_path_utf8(const char* system_name, size_t snapshot_index) {
@@ -384,43 +1469,44 @@ bool fs_win32_make_snapshot_path_wide(const char* system_name, size_t snapshot_i
     return true;
 }
 
-bool fs_save_snapshot(const char* system_name, size_t snapshot_index, chips_range_t data) {
+// the snapshot is written to a temporary file which then replaces the old snapshot,
+// so that a failed save never leaves a truncated snapshot behind
+static bool fs_write_snapshot(const char* system_name, size_t snapshot_index, chips_range_t data) {
     WCHAR wc_path[1024];
     if (!fs_win32_make_snapshot_path_wide(system_name, snapshot_index, wc_path, sizeof(wc_path)/sizeof(WCHAR))) {
         return false;
     }
-    HANDLE fp = CreateFileW(wc_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (fp == INVALID_HANDLE_VALUE) {
+    WCHAR wc_tmp_path[1024];
+    if ((lstrlenW(wc_path) + 5) > (int)(sizeof(wc_tmp_path)/sizeof(WCHAR))) {
         return false;
     }
-    if (!WriteFile(fp, data.ptr, data.size, NULL, NULL)) {
-        CloseHandle(fp);
+    lstrcpyW(wc_tmp_path, wc_path);
+    lstrcatW(wc_tmp_path, L".tmp");
+    chips_range_t file = fs_snapshot_encode(data);
+    if (!file.ptr) {
         return false;
     }
-    CloseHandle(fp);
-    return true;
+    HANDLE fp = CreateFileW(wc_tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fp == INVALID_HANDLE_VALUE) {
+        free(file.ptr);
+        return false;
+    }
+    DWORD num_written = 0;
+    bool success = WriteFile(fp, file.ptr, (DWORD)file.size, &num_written, NULL) && (num_written == file.size);
+    free(file.ptr);
+    success &= (0 != CloseHandle(fp));
+    success = success && MoveFileExW(wc_tmp_path, wc_path, MOVEFILE_REPLACE_EXISTING);
+    if (!success) {
+        DeleteFileW(wc_tmp_path);
+    }
+    return success;
 }
 
 bool fs_start_load_snapshot(size_t slot_index, const char* system_name, size_t snapshot_index, fs_snapshot_load_callback_t callback) {
-    assert(slot_index < FS_NUM_SLOTS);
     assert(system_name && callback);
-    fs_path_t path = fs_win32_make_snapshot_path_utf8(system_name, snapshot_index);
-    if ((path.len == 0) || path.clamped) {
-        return false;
-    }
-    fs_snapshot_load_context_t context = {
-        .snapshot_index = snapshot_index,
-        .callback = callback
-    };
-    fs_slot_t* slot = &state.slots[slot_index];
-    sfetch_send(&(sfetch_request_t){
-        .path = path.cstr,
-        .channel = slot_index,
-        .callback = fs_snapshot_fetch_callback,
-        .buffer = { .ptr = slot->buf, .size = FS_MAX_SIZE },
-        .user_data = { .ptr = &context, .size = sizeof(context) }
-    });
-    return true;
+    (void)fs_get_slot(slot_index);
+    const fs_path_t path = fs_win32_make_snapshot_path_utf8(system_name, snapshot_index);
+    return fs_queue_snapshot_load(&path, snapshot_index, callback);
 }
 
 #elif defined(__EMSCRIPTEN__)
@@ -429,6 +1515,7 @@ EM_JS(void, fs_js_save_snapshot, (const char* system_name_cstr, int snapshot_ind
     const db_name = 'chips';
     const db_store_name = 'store';
     const system_name = UTF8ToString(system_name_cstr);
+    const blob = HEAPU8.slice(bytes, bytes + num_bytes);
     console.log('fs_js_save_snapshot: called with', system_name, snapshot_index);
     let open_request;
     try {
@@ -448,7 +1535,6 @@ EM_JS(void, fs_js_save_snapshot, (const char* system_name_cstr, int snapshot_ind
         let transaction = db.transaction([db_store_name], 'readwrite');
         let file = transaction.objectStore(db_store_name);
         let key = system_name + '_' + snapshot_index;
-        let blob = HEAPU8.subarray(bytes, bytes + num_bytes);
         let put_request = file.put(blob, key);
         put_request.onsuccess = () => {
             console.log('fs_js_save_snapshot:', key, 'successfully stored')
@@ -515,9 +1601,15 @@ EM_JS(void, fs_js_load_snapshot, (const char* system_name_cstr, int snapshot_ind
     }
 });
 
-bool fs_save_snapshot(const char* system_name, size_t snapshot_index, chips_range_t data) {
+static bool fs_write_snapshot(const char* system_name, size_t snapshot_index, chips_range_t data) {
     assert(system_name && data.ptr && data.size > 0);
-    fs_js_save_snapshot(system_name, (int)snapshot_index, data.ptr, data.size);
+    chips_range_t file = fs_snapshot_encode(data);
+    if (!file.ptr) {
+        return false;
+    }
+    // the JS side copies the bytes before returning
+    fs_js_save_snapshot(system_name, (int)snapshot_index, file.ptr, (int)file.size);
+    free(file.ptr);
     return true;
 }
 
@@ -529,14 +1621,7 @@ EMSCRIPTEN_KEEPALIVE void fs_emsc_load_snapshot_callback(const fs_snapshot_load_
     size_t snapshot_index = ctx->snapshot_index;
     fs_snapshot_load_callback_t callback = ctx->callback;
     if (bytes) {
-        callback(&(fs_snapshot_response_t){
-            .snapshot_index = snapshot_index,
-            .result = FS_RESULT_SUCCESS,
-            .data = {
-                .ptr = bytes,
-                .size = (size_t)num_bytes
-            }
-        });
+        fs_snapshot_loaded(ctx, (chips_range_t){ .ptr = bytes, .size = (size_t)num_bytes });
         free(bytes);
     }
     else {
@@ -549,9 +1634,8 @@ EMSCRIPTEN_KEEPALIVE void fs_emsc_load_snapshot_callback(const fs_snapshot_load_
 }
 
 bool fs_start_load_snapshot(size_t slot_index, const char* system_name, size_t snapshot_index, fs_snapshot_load_callback_t callback) {
-    assert(slot_index < FS_NUM_SLOTS);
     assert(system_name && callback);
-    (void)slot_index;
+    (void)fs_get_slot(slot_index);
 
     // allocate a 'context' struct which needs to be tunneled through JS to the fs_emsc_load_snapshot_callback() function
     fs_snapshot_load_context_t* context = calloc(1, sizeof(fs_snapshot_load_context_t));
@@ -564,42 +1648,42 @@ bool fs_start_load_snapshot(size_t slot_index, const char* system_name, size_t s
 }
 #else // Apple or Linux
 
-bool fs_save_snapshot(const char* system_name, size_t snapshot_index, chips_range_t data) {
+static bool fs_write_snapshot(const char* system_name, size_t snapshot_index, chips_range_t data) {
     assert(system_name && data.ptr && data.size > 0);
     fs_path_t path = fs_make_snapshot_path("/tmp", system_name, snapshot_index);
     if (path.clamped) {
         return false;
     }
-    FILE* fp = fopen(path.cstr, "wb");
-    if (fp) {
-        fwrite(data.ptr, data.size, 1, fp);
-        fclose(fp);
-        return true;
+    // the snapshot is written to a temporary file which then replaces the old snapshot,
+    // so that a failed save never leaves a truncated snapshot behind
+    fs_path_t tmp_path = path;
+    fs_path_append(&tmp_path, ".tmp");
+    if (tmp_path.clamped) {
+        return false;
     }
-    else {
+    chips_range_t file = fs_snapshot_encode(data);
+    if (!file.ptr) {
         return false;
     }
+    FILE* fp = fopen(tmp_path.cstr, "wb");
+    if (!fp) {
+        free(file.ptr);
+        return false;
+    }
+    bool success = (1 == fwrite(file.ptr, file.size, 1, fp));
+    free(file.ptr);
+    success &= (0 == fclose(fp));
+    success = success && (0 == rename(tmp_path.cstr, path.cstr));
+    if (!success) {
+        remove(tmp_path.cstr);
+    }
+    return success;
 }
 
 bool fs_start_load_snapshot(size_t slot_index, const char* system_name, size_t snapshot_index, fs_snapshot_load_callback_t callback) {
-    assert(slot_index < FS_NUM_SLOTS);
     assert(system_name && callback);
-    fs_path_t path = fs_make_snapshot_path("/tmp", system_name, snapshot_index);
-    if (path.clamped) {
-        return false;
-    }
-    fs_snapshot_load_context_t context = {
-        .snapshot_index = snapshot_index,
-        .callback = callback
-    };
-    fs_slot_t* slot = &state.slots[slot_index];
-    sfetch_send(&(sfetch_request_t){
-        .path = path.cstr,
-        .channel = (int)slot_index,
-        .callback = fs_snapshot_fetch_callback,
-        .buffer = { .ptr = slot->buf, .size = FS_MAX_SIZE },
-        .user_data = { .ptr = &context, .size = sizeof(context) }
-    });
-    return true;
+    (void)fs_get_slot(slot_index);
+    const fs_path_t path = fs_make_snapshot_path("/tmp", system_name, snapshot_index);
+    return fs_queue_snapshot_load(&path, snapshot_index, callback);
 }
 #endif
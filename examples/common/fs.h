@@ -2,7 +2,7 @@
 #include <stdint.h>
 #include <stddef.h>
 
-// standard loading slots
+// standard loading slots, more slots can be allocated with fs_alloc_slot()
 #define FS_SLOT_IMAGE (0)
 #define FS_SLOT_SNAPSHOTS (1)
 #define FS_NUM_SLOTS (2)
@@ -22,14 +22,34 @@ typedef struct {
 
 typedef void (*fs_snapshot_load_callback_t)(const fs_snapshot_response_t* response);
 
-void fs_init(void);
+typedef struct {
+    size_t snapshot_index;
+    fs_result_t result;
+} fs_snapshot_save_response_t;
+
+typedef void (*fs_snapshot_save_callback_t)(const fs_snapshot_save_response_t* response);
+
+// only used on the web, native platforms map files synchronously
+typedef struct {
+    int num_channels;       // number of sokol-fetch channels, default 4
+    int num_lanes;          // number of concurrent loads per channel, default 1
+} fs_desc_t;
+
+void fs_init(const fs_desc_t* desc);
+void fs_shutdown(void);
 void fs_dowork(void);
+// allocate an additional loading slot, loads in different slots run concurrently,
+// returns a slot handle which becomes invalid when the slot is freed
+size_t fs_alloc_slot(void);
+// free a slot from fs_alloc_slot(), a pending load is cancelled
+void fs_free_slot(size_t slot_handle);
 void fs_reset(size_t slot_index);
 void fs_start_load_file(size_t slot_index, const char* path);
 void fs_start_load_dropped_file(size_t slot_index);
 bool fs_load_base64(size_t slot_index, const char* name, const char* payload);
 void fs_load_mem(size_t slot_index, const char* path, chips_range_t data);
-bool fs_save_snapshot(const char* system_name, size_t snapshot_index, chips_range_t data);
+// copies the snapshot data and writes it in the background, the optional callback is called from fs_dowork()
+bool fs_save_snapshot(const char* system_name, size_t snapshot_index, chips_range_t data, fs_snapshot_save_callback_t callback);
 bool fs_start_load_snapshot(size_t slot_index, const char* system_name, size_t snapshot_index, fs_snapshot_load_callback_t callback);
 
 fs_result_t fs_result(size_t slot_index);
@@ -25,6 +25,10 @@ typedef struct {
         sg_sampler smp;
         chips_dim_t dim;
         bool paletted;
+        bool dirty;         // texture content isn't valid, upload needed
+        bool skip_unchanged;
+        uint64_t* row_hashes;   // hash of each row of the last uploaded pixel data
+        int num_rows;
     } fb;
     struct {
         chips_rect_t view;
@@ -210,6 +214,7 @@ static void gfx_init_images_and_pass(void) {
         .pixel_format = state.fb.paletted ? SG_PIXELFORMAT_R8 : SG_PIXELFORMAT_RGBA8,
         .usage = SG_USAGE_STREAM,
     });
+    state.fb.dirty = true;
 
     // a sampler for sampling the emulators raw pixel data
     state.fb.smp = sg_make_sampler(&(sg_sampler_desc){
@@ -272,6 +277,7 @@ void gfx_init(const gfx_desc_t* desc) {
     state.offscreen.pixel_aspect.width = GFX_DEF(desc->pixel_aspect.width, 1);
     state.offscreen.pixel_aspect.height = GFX_DEF(desc->pixel_aspect.height, 1);
     state.offscreen.view = desc->display_info.screen;
+    state.fb.skip_unchanged = desc->skip_unchanged_frames;
 
     if (state.fb.paletted) {
         static uint32_t palette_buf[256];
@@ -405,6 +411,93 @@ static void apply_viewport(chips_dim_t canvas, chips_rect_t view, chips_dim_t pi
     sg_apply_viewportf(vp_x, vp_y, vp_w, vp_h, true);
 }
 
+static uint64_t gfx_hash_row(const uint8_t* ptr, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325;
+    size_t i = 0;
+    for (; (i + 8) <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, &ptr[i], 8);
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ ptr[i]) * 0x100000001B3;
+    }
+    return hash;
+}
+
+// check if the framebuffer content has changed since the last upload, sokol-gfx
+// can only replace the whole texture, so instead of uploading changed rows, static
+// screens (BASIC prompts, menus, a paused emulator...) skip the texture upload and
+// upscale pass altogether, the rows are only hashed, not copied
+static bool gfx_framebuffer_changed(chips_range_t buffer) {
+    if (!state.fb.skip_unchanged) {
+        return true;
+    }
+    const int num_rows = state.fb.dim.height;
+    const size_t row_size = buffer.size / (size_t)num_rows;
+    if (num_rows != state.fb.num_rows) {
+        free(state.fb.row_hashes);
+        state.fb.row_hashes = calloc((size_t)num_rows, sizeof(uint64_t));
+        assert(state.fb.row_hashes);
+        state.fb.num_rows = num_rows;
+        state.fb.dirty = true;
+    }
+    bool changed = state.fb.dirty;
+    const uint8_t* ptr = buffer.ptr;
+    for (int y = 0; y < num_rows; y++) {
+        // the last row also covers any bytes left over by the division
+        const size_t size = (y == (num_rows - 1)) ? (buffer.size - (size_t)y * row_size) : row_size;
+        const uint64_t hash = gfx_hash_row(ptr, size);
+        ptr += size;
+        if (hash != state.fb.row_hashes[y]) {
+            state.fb.row_hashes[y] = hash;
+            changed = true;
+        }
+    }
+    state.fb.dirty = false;
+    return changed;
+}
+
+// copy emulator pixel data into emulator framebuffer texture and
+// upscale the original framebuffer 2x with nearest filtering
+static void gfx_upscale_framebuffer(chips_range_t buffer) {
+    sg_update_image(state.fb.img, &(sg_image_data){
+        .subimage[0][0] = {
+            .ptr = buffer.ptr,
+            .size = buffer.size,
+        }
+    });
+    sg_begin_pass(&(sg_pass){
+        .action = state.offscreen.pass_action,
+        .attachments = state.offscreen.attachments
+    });
+    sg_apply_pipeline(state.offscreen.pip);
+    sg_apply_bindings(&(sg_bindings){
+        .vertex_buffers[0] = state.offscreen.vbuf,
+        .fs = {
+            .images = {
+                [SLOT_fb_tex] = state.fb.img,
+                [SLOT_pal_tex] = state.fb.pal_img,
+            },
+            .samplers[SLOT_smp] = state.fb.smp,
+        }
+    });
+    const offscreen_vs_params_t vs_params = {
+        .uv_offset = {
+            (float)state.offscreen.view.x / (float)state.fb.dim.width,
+            (float)state.offscreen.view.y / (float)state.fb.dim.height,
+        },
+        .uv_scale = {
+            (float)state.offscreen.view.width / (float)state.fb.dim.width,
+            (float)state.offscreen.view.height / (float)state.fb.dim.height
+        }
+    };
+    sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_offscreen_vs_params, &SG_RANGE(vs_params));
+    sg_draw(0, 4, 1);
+    sg_end_pass();
+}
+
 void gfx_draw(chips_display_info_t display_info) {
     assert(state.valid);
     assert((display_info.frame.dim.width > 0) && (display_info.frame.dim.height > 0));
@@ -412,6 +505,12 @@ void gfx_draw(chips_display_info_t display_info) {
     assert((display_info.screen.width > 0) && (display_info.screen.height > 0));
     const chips_dim_t display = { .width = sapp_width(), .height = sapp_height() };
 
+    // a different visible area needs a new upscale pass
+    if ((display_info.screen.x != state.offscreen.view.x) || (display_info.screen.y != state.offscreen.view.y) ||
+        (display_info.screen.width != state.offscreen.view.width) || (display_info.screen.height != state.offscreen.view.height))
+    {
+        state.fb.dirty = true;
+    }
     state.offscreen.view = display_info.screen;
 
     // check if emulator framebuffer size has changed, need to create new backing texture
@@ -442,43 +541,10 @@ void gfx_draw(chips_display_info_t display_info) {
         sgl_end();
     }
 
-    // copy emulator pixel data into emulator framebuffer texture
-    sg_update_image(state.fb.img, &(sg_image_data){
-        .subimage[0][0] = {
-            .ptr = display_info.frame.buffer.ptr,
-            .size = display_info.frame.buffer.size,
-        }
-    });
-
-    // upscale the original framebuffer 2x with nearest filtering
-    sg_begin_pass(&(sg_pass){
-        .action = state.offscreen.pass_action,
-        .attachments = state.offscreen.attachments
-    });
-    sg_apply_pipeline(state.offscreen.pip);
-    sg_apply_bindings(&(sg_bindings){
-        .vertex_buffers[0] = state.offscreen.vbuf,
-        .fs = {
-            .images = {
-                [SLOT_fb_tex] = state.fb.img,
-                [SLOT_pal_tex] = state.fb.pal_img,
-            },
-            .samplers[SLOT_smp] = state.fb.smp,
-        }
-    });
-    const offscreen_vs_params_t vs_params = {
-        .uv_offset = {
-            (float)state.offscreen.view.x / (float)state.fb.dim.width,
-            (float)state.offscreen.view.y / (float)state.fb.dim.height,
-        },
-        .uv_scale = {
-            (float)state.offscreen.view.width / (float)state.fb.dim.width,
-            (float)state.offscreen.view.height / (float)state.fb.dim.height
-        }
-    };
-    sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_offscreen_vs_params, &SG_RANGE(vs_params));
-    sg_draw(0, 4, 1);
-    sg_end_pass();
+    // the upscaled texture keeps its content while the framebuffer doesn't change
+    if (gfx_framebuffer_changed(display_info.frame.buffer)) {
+        gfx_upscale_framebuffer(display_info.frame.buffer);
+    }
 
     // tint the clear color red or green if flash feedback is requested
     if (state.flash_error_count > 0) {
@@ -522,6 +588,9 @@ void gfx_draw(chips_display_info_t display_info) {
 
 void gfx_shutdown() {
     assert(state.valid);
+    free(state.fb.row_hashes);
+    state.fb.row_hashes = 0;
+    state.fb.num_rows = 0;
     sgl_shutdown();
     sdtx_shutdown();
     sg_shutdown();
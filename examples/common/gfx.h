@@ -25,6 +25,7 @@ typedef struct {
     gfx_border_t border;
     chips_display_info_t display_info;
     chips_dim_t pixel_aspect;   // optional pixel aspect ratio, default is 1:1
+    bool skip_unchanged_frames; // hash framebuffer rows and skip the upload for unchanged frames
     void (*draw_extra_cb)(void);
 } gfx_desc_t;
 
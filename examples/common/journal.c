@@ -0,0 +1,206 @@
+#include "journal.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define JOURNAL_VERSION (1)
+#define JOURNAL_MAX_SYSTEM_NAME (32)
+
+typedef enum {
+    JOURNAL_MODE_NONE,
+    JOURNAL_MODE_RECORD,
+    JOURNAL_MODE_REPLAY,
+} journal_mode_t;
+
+typedef struct {
+    bool valid;
+    journal_desc_t desc;
+    journal_mode_t mode;
+    FILE* fp;
+    uint64_t ticks;             // emulated ticks executed so far
+    uint32_t frame_count;
+    uint32_t frame_time_us;     // record: duration of the current frame
+    bool frame_pending;         // replay: a frame record has been read
+    uint32_t frame_ticks;       // replay: recorded ticks of the current frame
+    int desync_count;
+} journal_state_t;
+static journal_state_t state;
+
+static bool journal_path_valid(const char* path) {
+    return path && (path[0] != 0);
+}
+
+static bool journal_read_header(void) {
+    char system_name[JOURNAL_MAX_SYSTEM_NAME] = { 0 };
+    int version = 0;
+    if (2 != fscanf(state.fp, "chips-journal %d %31s", &version, system_name)) {
+        fprintf(stderr, "journal: '%s' is not a journal file\n", state.desc.replay_path);
+        return false;
+    }
+    if (version != JOURNAL_VERSION) {
+        fprintf(stderr, "journal: unsupported journal version %d\n", version);
+        return false;
+    }
+    if (state.desc.system_name && (0 != strcmp(system_name, state.desc.system_name))) {
+        fprintf(stderr, "journal: journal was recorded on '%s', not '%s'\n", system_name, state.desc.system_name);
+        return false;
+    }
+    return true;
+}
+
+void journal_init(const journal_desc_t* desc) {
+    assert(desc);
+    journal_shutdown();
+    memset(&state, 0, sizeof(state));
+    state.desc = *desc;
+    if (journal_path_valid(desc->replay_path)) {
+        state.fp = fopen(desc->replay_path, "r");
+        if (!state.fp) {
+            fprintf(stderr, "journal: failed to open '%s'\n", desc->replay_path);
+        }
+        else if (!journal_read_header()) {
+            fclose(state.fp);
+            state.fp = 0;
+        }
+        else {
+            state.mode = JOURNAL_MODE_REPLAY;
+        }
+    }
+    else if (journal_path_valid(desc->record_path)) {
+        state.fp = fopen(desc->record_path, "w");
+        if (!state.fp) {
+            fprintf(stderr, "journal: failed to create '%s'\n", desc->record_path);
+        }
+        else {
+            fprintf(state.fp, "chips-journal %d %s\n", JOURNAL_VERSION, desc->system_name ? desc->system_name : "unknown");
+            state.mode = JOURNAL_MODE_RECORD;
+        }
+    }
+    state.valid = true;
+}
+
+void journal_shutdown(void) {
+    if (state.valid) {
+        if (state.fp) {
+            fclose(state.fp);
+        }
+        memset(&state, 0, sizeof(state));
+    }
+}
+
+static void journal_desync(const char* what, uint64_t recorded, uint64_t actual) {
+    if (0 == state.desync_count) {
+        fprintf(stderr, "journal: desync in frame %u, %s (recorded: tick %llu, replayed: tick %llu)\n",
+            state.frame_count, what, (unsigned long long)recorded, (unsigned long long)actual);
+    }
+    state.desync_count++;
+}
+
+// the end of the journal has been reached (or it is broken), continue with live input
+static void journal_end_replay(void) {
+    fprintf(stderr, "journal: replay finished after %u frames with %d desyncs\n", state.frame_count, state.desync_count);
+    fclose(state.fp);
+    state.fp = 0;
+    state.mode = JOURNAL_MODE_NONE;
+}
+
+uint32_t journal_frame_time(uint32_t frame_time_us) {
+    if (!state.valid) {
+        return frame_time_us;
+    }
+    if (state.mode != JOURNAL_MODE_REPLAY) {
+        state.frame_time_us = frame_time_us;
+        return frame_time_us;
+    }
+    // inject all input events up to the next frame record
+    for (;;) {
+        char type = 0;
+        unsigned long long a = 0, b = 0;
+        if (3 != fscanf(state.fp, " %c %llu %llu", &type, &a, &b)) {
+            journal_end_replay();
+            return frame_time_us;
+        }
+        switch (type) {
+            case 'd':
+            case 'u':
+                if (a != state.ticks) {
+                    journal_desync("input event", a, state.ticks);
+                }
+                if (type == 'd') {
+                    if (state.desc.key_down_cb) {
+                        state.desc.key_down_cb((int)b, state.desc.user_data);
+                    }
+                }
+                else if (state.desc.key_up_cb) {
+                    state.desc.key_up_cb((int)b, state.desc.user_data);
+                }
+                break;
+            case 'f':
+                state.frame_pending = true;
+                state.frame_ticks = (uint32_t)b;
+                return (uint32_t)a;
+            default:
+                fprintf(stderr, "journal: invalid record '%c'\n", type);
+                journal_end_replay();
+                return frame_time_us;
+        }
+    }
+}
+
+void journal_frame_ticks(uint32_t ticks) {
+    if (!state.valid) {
+        return;
+    }
+    if (state.mode == JOURNAL_MODE_RECORD) {
+        fprintf(state.fp, "f %u %u\n", state.frame_time_us, ticks);
+        // flush each record so that the journal survives a crash
+        fflush(state.fp);
+    }
+    else if (state.frame_pending) {
+        state.frame_pending = false;
+        if (ticks != state.frame_ticks) {
+            journal_desync("end of frame", state.ticks + state.frame_ticks, state.ticks + ticks);
+        }
+    }
+    state.ticks += ticks;
+    state.frame_count++;
+}
+
+static void journal_key(char type, int key_code, void (*cb)(int, void*)) {
+    assert(state.valid);
+    if (state.mode == JOURNAL_MODE_REPLAY) {
+        // live input would break the replay
+        return;
+    }
+    if (state.mode == JOURNAL_MODE_RECORD) {
+        fprintf(state.fp, "%c %llu %d\n", type, (unsigned long long)state.ticks, key_code);
+        fflush(state.fp);
+    }
+    if (cb) {
+        cb(key_code, state.desc.user_data);
+    }
+}
+
+void journal_key_down(int key_code) {
+    journal_key('d', key_code, state.desc.key_down_cb);
+}
+
+void journal_key_up(int key_code) {
+    journal_key('u', key_code, state.desc.key_up_cb);
+}
+
+bool journal_active(void) {
+    return state.valid && (state.mode != JOURNAL_MODE_NONE);
+}
+
+bool journal_replaying(void) {
+    return state.valid && (state.mode == JOURNAL_MODE_REPLAY);
+}
+
+uint32_t journal_frame_count(void) {
+    return state.valid ? state.frame_count : 0;
+}
+
+int journal_desync_count(void) {
+    return state.valid ? state.desync_count : 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+/*
+    Deterministic input recording and replay.
+
+    In record mode, the host frame durations and all keyboard and
+    joystick input events are written to a text file, each input event
+    is stamped with the number of emulated ticks executed so far.
+
+    In replay mode, the recorded frame durations replace the host frame
+    durations, and the recorded input events are injected again at the
+    start of the frame they were recorded before. The emulator thus sees
+    the same input at the same emulated tick, and the whole run is
+    reproduced bit-exactly (as long as the emulator is configured the
+    same way). Live input is ignored while replaying, when the end of the
+    journal is reached, the emulator continues with live input.
+
+    The number of emulated ticks per frame is recorded too, a replay
+    which goes off track is detected and counted as desync.
+
+    Journal files are plain text with one record per line:
+
+        chips-journal 1 [system]    header
+        d [tick] [key_code]         key down at emulated tick
+        u [tick] [key_code]         key up at emulated tick
+        f [frame_us] [ticks]        end of a frame
+*/
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    const char* system_name;    // written to the header, must match on replay
+    const char* record_path;    // optional, record into this file
+    const char* replay_path;    // optional, replay from this file (takes precedence)
+    void (*key_down_cb)(int key_code, void* user_data);
+    void (*key_up_cb)(int key_code, void* user_data);
+    void* user_data;
+} journal_desc_t;
+
+// initialize the journal, without record or replay path, input is just passed through
+void journal_init(const journal_desc_t* desc);
+// shutdown the journal and close the journal file (ok to call if not initialized)
+void journal_shutdown(void);
+// call once per frame before running the emulator with the host frame
+// duration, returns the frame duration to run the emulator with
+uint32_t journal_frame_time(uint32_t frame_time_us);
+// call once per frame with the number of emulated ticks executed
+void journal_frame_ticks(uint32_t ticks);
+// send a key down event to the emulator through the journal
+void journal_key_down(int key_code);
+// send a key up event to the emulator through the journal
+void journal_key_up(int key_code);
+// true while recording or replaying
+bool journal_active(void);
+// true while replaying
+bool journal_replaying(void);
+// number of frames recorded or replayed so far
+uint32_t journal_frame_count(void);
+// number of replayed frames and events which didn't match the recorded tick count
+int journal_desync_count(void);
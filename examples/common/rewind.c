@@ -0,0 +1,340 @@
+#include "sokol_app.h"
+#include "rewind.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define REWIND_DEFAULT_FRAME_INTERVAL (6)
+#define REWIND_DEFAULT_KEYFRAME_INTERVAL (32)
+#define REWIND_DEFAULT_MAX_SNAPSHOTS (4096)
+#define REWIND_DEFAULT_MAX_BYTES (16 * 1024 * 1024)
+// a run of unchanged bytes shorter than this is cheaper to store as part of a literal
+#define REWIND_MIN_ZERO_RUN (4)
+
+// an encoded snapshot in the byte ring, a keyframe if key_seq is its own sequence number
+typedef struct {
+    size_t offset;
+    size_t size;
+    uint64_t key_seq;
+} rewind_entry_t;
+
+typedef struct {
+    bool valid;
+    rewind_desc_t desc;
+    bool rewinding;
+    int frame_count;
+    // ring of entries, indexed by sequence number modulo max_snapshots
+    rewind_entry_t* entries;
+    uint64_t head_seq;      // oldest entry
+    uint64_t tail_seq;      // next entry to write
+    // ring of encoded bytes
+    uint8_t* buf;
+    size_t write_pos;
+    size_t used_bytes;
+    // the decoded keyframe of the newest entry, the base for new deltas
+    uint8_t* key;
+    uint64_t key_seq;
+    // current snapshot and encoding scratch buffer
+    uint8_t* snapshot;
+    uint8_t* enc;
+} rewind_state_t;
+static rewind_state_t state;
+
+static size_t rewind_max_enc_size(size_t snapshot_size) {
+    // worst case is a 2-byte varint overhead for every literal byte
+    return 2 * snapshot_size + 32;
+}
+
+void rewind_init(const rewind_desc_t* desc) {
+    assert(desc && (desc->snapshot_size > 0) && desc->save_cb && desc->load_cb);
+    rewind_shutdown();
+    memset(&state, 0, sizeof(state));
+    state.desc = *desc;
+    if (state.desc.frame_interval <= 0) {
+        state.desc.frame_interval = REWIND_DEFAULT_FRAME_INTERVAL;
+    }
+    if (state.desc.keyframe_interval <= 0) {
+        state.desc.keyframe_interval = REWIND_DEFAULT_KEYFRAME_INTERVAL;
+    }
+    if (state.desc.max_snapshots <= 0) {
+        state.desc.max_snapshots = REWIND_DEFAULT_MAX_SNAPSHOTS;
+    }
+    if (0 == state.desc.max_bytes) {
+        state.desc.max_bytes = REWIND_DEFAULT_MAX_BYTES;
+    }
+    state.entries = calloc((size_t)state.desc.max_snapshots, sizeof(rewind_entry_t));
+    state.buf = malloc(state.desc.max_bytes);
+    state.key = calloc(1, desc->snapshot_size);
+    state.snapshot = calloc(1, desc->snapshot_size);
+    state.enc = malloc(rewind_max_enc_size(desc->snapshot_size));
+    state.valid = true;
+}
+
+void rewind_shutdown(void) {
+    if (state.valid) {
+        free(state.entries);
+        free(state.buf);
+        free(state.key);
+        free(state.snapshot);
+        free(state.enc);
+        memset(&state, 0, sizeof(state));
+    }
+}
+
+void rewind_reset(void) {
+    if (state.valid) {
+        state.head_seq = state.tail_seq = 0;
+        state.write_pos = 0;
+        state.used_bytes = 0;
+        state.frame_count = 0;
+    }
+}
+
+static rewind_entry_t* rewind_entry(uint64_t seq) {
+    return &state.entries[seq % (uint64_t)state.desc.max_snapshots];
+}
+
+static size_t rewind_put_varint(uint8_t* dst, size_t val) {
+    size_t n = 0;
+    while (val >= 0x80) {
+        dst[n++] = (uint8_t)(val | 0x80);
+        val >>= 7;
+    }
+    dst[n++] = (uint8_t)val;
+    return n;
+}
+
+static const uint8_t* rewind_get_varint(const uint8_t* src, size_t* val) {
+    size_t v = 0;
+    int shift = 0;
+    uint8_t b;
+    do {
+        b = *src++;
+        v |= (size_t)(b & 0x7F) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    *val = v;
+    return src;
+}
+
+static inline uint8_t rewind_xor(const uint8_t* src, const uint8_t* base, size_t pos) {
+    return base ? (src[pos] ^ base[pos]) : src[pos];
+}
+
+// XOR src against base (or zeros without base), and encode the result as
+// a sequence of (zero run length, literal length, literal bytes), the
+// trailing zero run isn't stored
+static size_t rewind_encode(uint8_t* dst, const uint8_t* src, const uint8_t* base, size_t size) {
+    size_t pos = 0;
+    size_t out = 0;
+    while (pos < size) {
+        // skip unchanged bytes, 8 bytes at a time where possible
+        const size_t zero_start = pos;
+        if (base) {
+            while (((pos + 8) <= size) && (0 == memcmp(&src[pos], &base[pos], 8))) {
+                pos += 8;
+            }
+        }
+        else {
+            static const uint8_t zeros[8];
+            while (((pos + 8) <= size) && (0 == memcmp(&src[pos], zeros, 8))) {
+                pos += 8;
+            }
+        }
+        while ((pos < size) && (0 == rewind_xor(src, base, pos))) {
+            pos++;
+        }
+        if (pos == size) {
+            break;
+        }
+        const size_t zero_run = pos - zero_start;
+        // the literal ends at the next long enough run of unchanged bytes
+        const size_t lit_start = pos;
+        size_t zeros = 0;
+        while ((pos < size) && (zeros < REWIND_MIN_ZERO_RUN)) {
+            zeros = (0 == rewind_xor(src, base, pos)) ? (zeros + 1) : 0;
+            pos++;
+        }
+        pos -= zeros;
+        const size_t lit_len = pos - lit_start;
+        out += rewind_put_varint(&dst[out], zero_run);
+        out += rewind_put_varint(&dst[out], lit_len);
+        for (size_t i = 0; i < lit_len; i++) {
+            dst[out++] = rewind_xor(src, base, lit_start + i);
+        }
+    }
+    return out;
+}
+
+// decode an encoded snapshot against base (or zeros without base)
+static void rewind_decode(uint8_t* dst, const uint8_t* base, const uint8_t* src, size_t src_size, size_t size) {
+    if (base) {
+        memcpy(dst, base, size);
+    }
+    else {
+        memset(dst, 0, size);
+    }
+    const uint8_t* end = src + src_size;
+    size_t pos = 0;
+    while (src < end) {
+        size_t zero_run, lit_len;
+        src = rewind_get_varint(src, &zero_run);
+        src = rewind_get_varint(src, &lit_len);
+        pos += zero_run;
+        assert((pos + lit_len) <= size);
+        for (size_t i = 0; i < lit_len; i++) {
+            dst[pos + i] ^= src[i];
+        }
+        src += lit_len;
+        pos += lit_len;
+    }
+}
+
+// drop the oldest keyframe with all its deltas
+static void rewind_drop_oldest_group(void) {
+    assert(state.head_seq < state.tail_seq);
+    do {
+        state.used_bytes -= rewind_entry(state.head_seq)->size;
+        state.head_seq++;
+    } while ((state.head_seq < state.tail_seq) && (rewind_entry(state.head_seq)->key_seq != state.head_seq));
+    if (state.head_seq == state.tail_seq) {
+        state.write_pos = 0;
+    }
+}
+
+// find space for size bytes in the byte ring without dropping anything,
+// returns false if there's not enough space
+static bool rewind_find_space(size_t size, size_t* out_offset) {
+    if (state.head_seq == state.tail_seq) {
+        *out_offset = 0;
+        return size <= state.desc.max_bytes;
+    }
+    const size_t oldest = rewind_entry(state.head_seq)->offset;
+    if (state.write_pos > oldest) {
+        // used range is [oldest, write_pos), free space at the end and at the start
+        if ((state.write_pos + size) <= state.desc.max_bytes) {
+            *out_offset = state.write_pos;
+            return true;
+        }
+        else if (size < oldest) {
+            *out_offset = 0;
+            return true;
+        }
+    }
+    else if ((state.write_pos + size) < oldest) {
+        // used range wraps around, free space is [write_pos, oldest)
+        *out_offset = state.write_pos;
+        return true;
+    }
+    return false;
+}
+
+static void rewind_capture(void) {
+    const size_t snapshot_size = state.desc.snapshot_size;
+    state.desc.save_cb(state.snapshot);
+    bool keyframe = (state.head_seq == state.tail_seq) ||
+                    ((state.tail_seq - state.key_seq) >= (uint64_t)state.desc.keyframe_interval);
+    size_t size = rewind_encode(state.enc, state.snapshot, keyframe ? 0 : state.key, snapshot_size);
+    size_t offset = 0;
+    for (;;) {
+        const bool full = (state.tail_seq - state.head_seq) >= (uint64_t)state.desc.max_snapshots;
+        if (!full && rewind_find_space(size, &offset)) {
+            break;
+        }
+        if (state.head_seq == state.tail_seq) {
+            // a single snapshot doesn't fit into the budget
+            return;
+        }
+        if (!keyframe && (rewind_entry(state.head_seq)->key_seq == state.key_seq)) {
+            // the keyframe of this delta is about to be dropped, store a new keyframe instead
+            keyframe = true;
+            size = rewind_encode(state.enc, state.snapshot, 0, snapshot_size);
+        }
+        rewind_drop_oldest_group();
+    }
+    memcpy(&state.buf[offset], state.enc, size);
+    rewind_entry_t* entry = rewind_entry(state.tail_seq);
+    entry->offset = offset;
+    entry->size = size;
+    if (keyframe) {
+        memcpy(state.key, state.snapshot, snapshot_size);
+        state.key_seq = state.tail_seq;
+    }
+    entry->key_seq = state.key_seq;
+    state.tail_seq++;
+    state.write_pos = offset + size;
+    state.used_bytes += size;
+}
+
+// load the newest snapshot and remove it from the history (but keep the
+// oldest snapshot so that rewinding stops there)
+static void rewind_step_back(void) {
+    if (state.head_seq == state.tail_seq) {
+        return;
+    }
+    const size_t snapshot_size = state.desc.snapshot_size;
+    const uint64_t seq = state.tail_seq - 1;
+    const rewind_entry_t* entry = rewind_entry(seq);
+    const bool keyframe = entry->key_seq == seq;
+    rewind_decode(state.snapshot, keyframe ? 0 : state.key, &state.buf[entry->offset], entry->size, snapshot_size);
+    state.desc.load_cb(state.snapshot);
+    if ((state.tail_seq - state.head_seq) > 1) {
+        state.tail_seq = seq;
+        state.used_bytes -= entry->size;
+        const rewind_entry_t* prev = rewind_entry(seq - 1);
+        state.write_pos = prev->offset + prev->size;
+        if (keyframe) {
+            // continue with the previous keyframe
+            const rewind_entry_t* key_entry = rewind_entry(prev->key_seq);
+            state.key_seq = prev->key_seq;
+            rewind_decode(state.key, 0, &state.buf[key_entry->offset], key_entry->size, snapshot_size);
+        }
+    }
+}
+
+bool rewind_frame(void) {
+    if (!state.valid) {
+        return false;
+    }
+    if (state.rewinding) {
+        rewind_step_back();
+        state.frame_count = 0;
+        return true;
+    }
+    if (++state.frame_count >= state.desc.frame_interval) {
+        state.frame_count = 0;
+        rewind_capture();
+    }
+    return false;
+}
+
+bool rewind_input(const sapp_event* event) {
+    if (!state.valid) {
+        return false;
+    }
+    switch (event->type) {
+        case SAPP_EVENTTYPE_KEY_DOWN:
+            if ((event->key_code == SAPP_KEYCODE_LEFT) && (event->modifiers & SAPP_MODIFIER_ALT)) {
+                state.rewinding = true;
+                return true;
+            }
+            break;
+        case SAPP_EVENTTYPE_KEY_UP:
+            if (state.rewinding) {
+                if (event->key_code == SAPP_KEYCODE_LEFT) {
+                    state.rewinding = false;
+                    return true;
+                }
+                else if ((event->key_code == SAPP_KEYCODE_LEFT_ALT) || (event->key_code == SAPP_KEYCODE_RIGHT_ALT)) {
+                    state.rewinding = false;
+                }
+            }
+            break;
+        case SAPP_EVENTTYPE_UNFOCUSED:
+            state.rewinding = false;
+            break;
+        default:
+            break;
+    }
+    return false;
+}
@@ -0,0 +1,42 @@
+#pragma once
+/*
+    Continuous rewind history for the emulators.
+
+    A snapshot of the emulator state is captured every few frames into a
+    ring buffer with a fixed memory budget. Snapshots are stored as the
+    XOR-delta against the last keyframe (a full snapshot every few
+    captures), with the runs of unchanged (zero) bytes run-length encoded,
+    so minutes of history fit into a few MBytes. When the budget is
+    exhausted the oldest keyframe and its deltas are dropped.
+
+    While the rewind key (Alt+Left) is held, each frame steps back to the
+    previous snapshot instead of running the emulator, every step only
+    needs to decode one delta against the current keyframe. The history
+    after the rewound-to point is discarded when the emulation continues.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sokol_app.h"
+
+typedef struct {
+    size_t snapshot_size;           // size of the snapshot struct in bytes
+    void (*save_cb)(void* dst);     // save the emulator state into a snapshot
+    bool (*load_cb)(void* src);     // load the emulator state from a snapshot
+    int frame_interval;             // capture a snapshot every N frames (default: 6)
+    int keyframe_interval;          // a keyframe every N snapshots (default: 32)
+    int max_snapshots;              // max number of snapshots in the history (default: 4096)
+    size_t max_bytes;               // memory budget for the encoded snapshots (default: 16 MBytes)
+} rewind_desc_t;
+
+// initialize the rewind history
+void rewind_init(const rewind_desc_t* desc);
+// shutdown the rewind history (ok to call if not initialized)
+void rewind_shutdown(void);
+// discard the history, for instance after a reboot
+void rewind_reset(void);
+// call once per frame before running the emulator, returns true if the
+// emulator state was rewound instead and the emulator must not run this frame
+bool rewind_frame(void);
+// handle the rewind key, returns true if the event was consumed
+bool rewind_input(const sapp_event* event);
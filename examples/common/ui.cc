@@ -9,6 +9,7 @@
 #define SOKOL_IMGUI_IMPL
 #include "sokol_imgui.h"
 #include "gfx.h"
+#include "clock.h"
 #include <stdlib.h> // calloc
 
 #define UI_DELETE_STACK_SIZE (32)
@@ -107,6 +108,26 @@ void ui_draw(void) {
     if (state.draw_cb) {
         state.draw_cb();
     }
+    // the warp mode toggle is appended to the system's main menu bar
+    if (ImGui::BeginMainMenuBar()) {
+        if (ImGui::BeginMenu("Speed")) {
+            const clock_warp_mode_t mode = clock_warp_mode();
+            if (ImGui::MenuItem("Auto Warp", 0, mode == CLOCK_WARP_AUTO)) {
+                clock_set_warp_mode(CLOCK_WARP_AUTO);
+            }
+            if (ImGui::MenuItem("Warp", 0, mode == CLOCK_WARP_ON)) {
+                clock_set_warp_mode(CLOCK_WARP_ON);
+            }
+            if (ImGui::MenuItem("Real Time", 0, mode == CLOCK_WARP_OFF)) {
+                clock_set_warp_mode(CLOCK_WARP_OFF);
+            }
+            ImGui::EndMenu();
+        }
+        if (clock_warp_active()) {
+            ImGui::Text("WARP x%d", clock_warp_factor());
+        }
+        ImGui::EndMainMenuBar();
+    }
     simgui_render();
 }
 
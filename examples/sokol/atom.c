@@ -73,7 +73,10 @@ static void ui_load_snapshots_from_storage(void);
 
 static void push_audio(const float* samples, int num_samples, void* user_data) {
     (void)user_data;
-    saudio_push(samples, num_samples);
+    // audio is dropped in warp mode
+    if (!clock_warp_active()) {
+        saudio_push(samples, num_samples);
+    }
 }
 
 atom_desc_t atom_desc(atom_joystick_type_t joy_type) {
@@ -94,6 +97,26 @@ atom_desc_t atom_desc(atom_joystick_type_t joy_type) {
     };
 }
 
+static void save_rewind_snapshot(void* dst) {
+    atom_snapshot_t* snapshot = dst;
+    snapshot->version = atom_save_snapshot(&state.atom, &snapshot->atom);
+}
+
+static bool load_rewind_snapshot(void* src) {
+    atom_snapshot_t* snapshot = src;
+    return atom_load_snapshot(&state.atom, snapshot->version, &snapshot->atom);
+}
+
+static void inject_key_down(int key_code, void* user_data) {
+    (void)user_data;
+    atom_key_down(&state.atom, key_code);
+}
+
+static void inject_key_up(int key_code, void* user_data) {
+    (void)user_data;
+    atom_key_up(&state.atom, key_code);
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
@@ -108,6 +131,7 @@ void app_init(void) {
     atom_init(&state.atom, &desc);
     gfx_init(&(gfx_desc_t) {
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .skip_unchanged_frames = true,
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -121,8 +145,24 @@ void app_init(void) {
     });
     keybuf_init(&(keybuf_desc_t){ .key_delay_frames = 10 });
     clock_init();
+    clock_set_warp_mode_from_string(sargs_value("warp"));
     prof_init();
-    fs_init();
+    fs_init(&(fs_desc_t){0});
+    journal_init(&(journal_desc_t){
+        .system_name = "atom",
+        .record_path = sargs_value("record"),
+        .replay_path = sargs_value("replay"),
+        .key_down_cb = inject_key_down,
+        .key_up_cb = inject_key_up,
+    });
+    // rewinding would go out of sync with a recorded or replayed input journal
+    if (sargs_exists("rewind") && !journal_active()) {
+        rewind_init(&(rewind_desc_t){
+            .snapshot_size = sizeof(atom_snapshot_t),
+            .save_cb = save_rewind_snapshot,
+            .load_cb = load_rewind_snapshot,
+        });
+    }
     #ifdef CHIPS_USE_UI
         ui_init(ui_draw_cb);
         ui_atom_init(&state.ui, &(ui_atom_desc_t){
@@ -170,8 +210,9 @@ static void draw_status_bar(void);
 void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = atom_exec(&state.atom, state.frame_time_us);
+    state.ticks = rewind_frame() ? 0 : atom_exec(&state.atom, state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
+    journal_frame_ticks(state.ticks);
     draw_status_bar();
     gfx_draw(atom_display_info(&state.atom));
     handle_file_loading();
@@ -184,6 +225,9 @@ void app_input(const sapp_event* event) {
     if (event->type == SAPP_EVENTTYPE_FILES_DROPPED) {
         fs_start_load_dropped_file(FS_SLOT_IMAGE);
     }
+    if (rewind_input(event)) {
+        return;
+    }
     #ifdef CHIPS_USE_UI
     if (ui_input(event)) {
         /* input was handled by UI */
@@ -202,8 +246,8 @@ void app_input(const sapp_event* event) {
                 else if (islower(c)) {
                     c = toupper(c);
                 }
-                atom_key_down(&state.atom, c);
-                atom_key_up(&state.atom, c);
+                journal_key_down(c);
+                journal_key_up(c);
             }
             break;
         case SAPP_EVENTTYPE_KEY_UP:
@@ -224,10 +268,10 @@ void app_input(const sapp_event* event) {
             }
             if (c) {
                 if (event->type == SAPP_EVENTTYPE_KEY_DOWN) {
-                    atom_key_down(&state.atom, c);
+                    journal_key_down(c);
                 }
                 else {
-                    atom_key_up(&state.atom, c);
+                    journal_key_up(c);
                 }
             }
             break;
@@ -242,6 +286,9 @@ void app_cleanup(void) {
         ui_atom_discard(&state.ui);
         ui_discard();
     #endif
+    journal_shutdown();
+    rewind_shutdown();
+    fs_shutdown();
     saudio_shutdown();
     gfx_shutdown();
     sargs_shutdown();
@@ -300,6 +347,7 @@ static void ui_draw_cb(void) {
 static void ui_boot_cb(atom_t* sys) {
     atom_desc_t desc = atom_desc(sys->joystick_type);
     atom_init(sys, &desc);
+    rewind_reset();
 }
 
 static void ui_update_snapshot_screenshot(size_t slot) {
@@ -312,11 +360,17 @@ static void ui_update_snapshot_screenshot(size_t slot) {
     }
 }
 
+static void ui_save_snapshot_callback(const fs_snapshot_save_response_t* response) {
+    if (response->result != FS_RESULT_SUCCESS) {
+        gfx_flash_error();
+    }
+}
+
 static void ui_save_snapshot(size_t slot) {
     if (slot < UI_SNAPSHOT_MAX_SLOTS) {
         state.snapshots[slot].version = atom_save_snapshot(&state.atom, &state.snapshots[slot].atom);
         ui_update_snapshot_screenshot(slot);
-        fs_save_snapshot("atom", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(atom_snapshot_t) });
+        fs_save_snapshot("atom", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(atom_snapshot_t) }, ui_save_snapshot_callback);
     }
 }
 
@@ -324,6 +378,9 @@ static bool ui_load_snapshot(size_t slot) {
     bool success = false;
     if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.snapshot.slots[slot].valid)) {
         success = atom_load_snapshot(&state.atom, state.snapshots[slot].version, &state.snapshots[slot].atom);
+        if (success) {
+            rewind_reset();
+        }
     }
     return success;
 }
@@ -59,7 +59,33 @@ static void ui_load_snapshots_from_storage(void);
 
 static void push_audio(const float* samples, int num_samples, void* user_data) {
     (void)user_data;
-    saudio_push(samples, num_samples);
+    // audio is dropped in warp mode
+    if (!clock_warp_active()) {
+        saudio_push(samples, num_samples);
+    }
+}
+
+static void save_rewind_snapshot(void* dst) {
+    bombjack_snapshot_t* snapshot = dst;
+    snapshot->version = bombjack_save_snapshot(&state.sys, &snapshot->sys);
+}
+
+static bool load_rewind_snapshot(void* src) {
+    bombjack_snapshot_t* snapshot = src;
+    return bombjack_load_snapshot(&state.sys, snapshot->version, &snapshot->sys);
+}
+
+// joystick bits in the low byte, system bits (coin, start) in the high byte
+static void inject_key_down(int key_code, void* user_data) {
+    (void)user_data;
+    state.sys.mainboard.p1 |= key_code & 0xFF;
+    state.sys.mainboard.sys |= (key_code >> 8) & 0xFF;
+}
+
+static void inject_key_up(int key_code, void* user_data) {
+    (void)user_data;
+    state.sys.mainboard.p1 &= ~(key_code & 0xFF);
+    state.sys.mainboard.sys &= ~((key_code >> 8) & 0xFF);
 }
 
 static void app_init(void) {
@@ -111,8 +137,24 @@ static void app_init(void) {
         }
     });
     clock_init();
+    clock_set_warp_mode_from_string(sargs_value("warp"));
     prof_init();
-    fs_init();
+    fs_init(&(fs_desc_t){0});
+    journal_init(&(journal_desc_t){
+        .system_name = "bombjack",
+        .record_path = sargs_value("record"),
+        .replay_path = sargs_value("replay"),
+        .key_down_cb = inject_key_down,
+        .key_up_cb = inject_key_up,
+    });
+    // rewinding would go out of sync with a recorded or replayed input journal
+    if (sargs_exists("rewind") && !journal_active()) {
+        rewind_init(&(rewind_desc_t){
+            .snapshot_size = sizeof(bombjack_snapshot_t),
+            .save_cb = save_rewind_snapshot,
+            .load_cb = load_rewind_snapshot,
+        });
+    }
     #ifdef CHIPS_USE_UI
         ui_init(ui_draw_cb);
         ui_bombjack_init(&state.ui, &(ui_bombjack_desc_t){
@@ -148,8 +190,9 @@ static void draw_status_bar(void);
 static void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = bombjack_exec(&state.sys, state.frame_time_us);
+    state.ticks = rewind_frame() ? 0 : bombjack_exec(&state.sys, state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
+    journal_frame_ticks(state.ticks);
     draw_status_bar();
     gfx_draw(bombjack_display_info(&state.sys));
     fs_dowork();
@@ -157,6 +200,9 @@ static void app_frame(void) {
 
 // input handling
 static void app_input(const sapp_event* event) {
+    if (rewind_input(event)) {
+        return;
+    }
     #ifdef CHIPS_USE_UI
     if (ui_input(event)) {
         // input was handled by UI
@@ -164,33 +210,25 @@ static void app_input(const sapp_event* event) {
     }
     #endif
     switch (event->type) {
+        int mask;
         case SAPP_EVENTTYPE_KEY_DOWN:
-            switch (event->key_code) {
-                // player 1 joystick
-                case SAPP_KEYCODE_RIGHT: state.sys.mainboard.p1 |= BOMBJACK_JOYSTICK_RIGHT; break;
-                case SAPP_KEYCODE_LEFT:  state.sys.mainboard.p1 |= BOMBJACK_JOYSTICK_LEFT; break;
-                case SAPP_KEYCODE_UP:    state.sys.mainboard.p1 |= BOMBJACK_JOYSTICK_UP; break;
-                case SAPP_KEYCODE_DOWN:  state.sys.mainboard.p1 |= BOMBJACK_JOYSTICK_DOWN; break;
-                case SAPP_KEYCODE_SPACE: state.sys.mainboard.p1 |= BOMBJACK_JOYSTICK_BUTTON; break;
-                // player 1 coin
-                case SAPP_KEYCODE_1:     state.sys.mainboard.sys |= BOMBJACK_SYS_P1_COIN; break;
-                // player 1 start (any other key
-                default:                 state.sys.mainboard.sys |= BOMBJACK_SYS_P1_START; break;
-            }
-            break;
-
         case SAPP_EVENTTYPE_KEY_UP:
             switch (event->key_code) {
                 // player 1 joystick
-                case SAPP_KEYCODE_RIGHT: state.sys.mainboard.p1 &= ~BOMBJACK_JOYSTICK_RIGHT; break;
-                case SAPP_KEYCODE_LEFT:  state.sys.mainboard.p1 &= ~BOMBJACK_JOYSTICK_LEFT; break;
-                case SAPP_KEYCODE_UP:    state.sys.mainboard.p1 &= ~BOMBJACK_JOYSTICK_UP; break;
-                case SAPP_KEYCODE_DOWN:  state.sys.mainboard.p1 &= ~BOMBJACK_JOYSTICK_DOWN; break;
-                case SAPP_KEYCODE_SPACE: state.sys.mainboard.p1 &= ~BOMBJACK_JOYSTICK_BUTTON; break;
+                case SAPP_KEYCODE_RIGHT: mask = BOMBJACK_JOYSTICK_RIGHT; break;
+                case SAPP_KEYCODE_LEFT:  mask = BOMBJACK_JOYSTICK_LEFT; break;
+                case SAPP_KEYCODE_UP:    mask = BOMBJACK_JOYSTICK_UP; break;
+                case SAPP_KEYCODE_DOWN:  mask = BOMBJACK_JOYSTICK_DOWN; break;
+                case SAPP_KEYCODE_SPACE: mask = BOMBJACK_JOYSTICK_BUTTON; break;
                 // player 1 coin
-                case SAPP_KEYCODE_1:     state.sys.mainboard.sys &= ~BOMBJACK_SYS_P1_COIN; break;
+                case SAPP_KEYCODE_1:     mask = BOMBJACK_SYS_P1_COIN << 8; break;
                 // player 1 start (any other key)
-                default:                 state.sys.mainboard.sys &= ~BOMBJACK_SYS_P1_START; break;
+                default:                 mask = BOMBJACK_SYS_P1_START << 8; break;
+            }
+            if (event->type == SAPP_EVENTTYPE_KEY_DOWN) {
+                journal_key_down(mask);
+            } else {
+                journal_key_up(mask);
             }
             break;
         default:
@@ -203,6 +241,9 @@ static void app_cleanup(void) {
     #ifdef CHIPS_USE_UI
         ui_bombjack_discard(&state.ui);
     #endif
+    journal_shutdown();
+    rewind_shutdown();
+    fs_shutdown();
     saudio_shutdown();
     gfx_shutdown();
 }
@@ -235,11 +276,17 @@ static void ui_update_snapshot_screenshot(size_t slot) {
     }
 }
 
+static void ui_save_snapshot_callback(const fs_snapshot_save_response_t* response) {
+    if (response->result != FS_RESULT_SUCCESS) {
+        gfx_flash_error();
+    }
+}
+
 static void ui_save_snapshot(size_t slot) {
     if (slot < UI_SNAPSHOT_MAX_SLOTS) {
         state.snapshots[slot].version = bombjack_save_snapshot(&state.sys, &state.snapshots[slot].sys);
         ui_update_snapshot_screenshot(slot);
-        fs_save_snapshot("bombjack", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(bombjack_snapshot_t) });
+        fs_save_snapshot("bombjack", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(bombjack_snapshot_t) }, ui_save_snapshot_callback);
     }
 }
 
@@ -247,6 +294,9 @@ static bool ui_load_snapshot(size_t slot) {
     bool success = false;
     if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.snapshot.slots[slot].valid)) {
         success = bombjack_load_snapshot(&state.sys, state.snapshots[slot].version, &state.snapshots[slot].sys);
+        if (success) {
+            rewind_reset();
+        }
     }
     return success;
 }
@@ -93,7 +93,10 @@ static void web_dbg_read_memory(uint16_t addr, int num_bytes, uint8_t* dst_ptr);
 // audio-streaming callback
 static void push_audio(const float* samples, int num_samples, void* user_data) {
     (void)user_data;
-    saudio_push(samples, num_samples);
+    // audio is dropped in warp mode
+    if (!clock_warp_active()) {
+        saudio_push(samples, num_samples);
+    }
 }
 
 // get c64_desc_t struct based on joystick type
@@ -121,6 +124,26 @@ c64_desc_t c64_desc(c64_joystick_type_t joy_type, bool c1530_enabled, bool c1541
     };
 }
 
+static void save_rewind_snapshot(void* dst) {
+    c64_snapshot_t* snapshot = dst;
+    snapshot->version = c64_save_snapshot(&state.c64, &snapshot->c64);
+}
+
+static bool load_rewind_snapshot(void* src) {
+    c64_snapshot_t* snapshot = src;
+    return c64_load_snapshot(&state.c64, snapshot->version, &snapshot->c64);
+}
+
+static void inject_key_down(int key_code, void* user_data) {
+    (void)user_data;
+    c64_key_down(&state.c64, key_code);
+}
+
+static void inject_key_up(int key_code, void* user_data) {
+    (void)user_data;
+    c64_key_up(&state.c64, key_code);
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
@@ -141,6 +164,7 @@ void app_init(void) {
     c64_init(&state.c64, &desc);
     gfx_init(&(gfx_desc_t){
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .skip_unchanged_frames = true,
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -154,8 +178,24 @@ void app_init(void) {
     });
     keybuf_init(&(keybuf_desc_t){ .key_delay_frames=5 });
     clock_init();
+    clock_set_warp_mode_from_string(sargs_value("warp"));
     prof_init();
-    fs_init();
+    fs_init(&(fs_desc_t){0});
+    journal_init(&(journal_desc_t){
+        .system_name = "c64",
+        .record_path = sargs_value("record"),
+        .replay_path = sargs_value("replay"),
+        .key_down_cb = inject_key_down,
+        .key_up_cb = inject_key_up,
+    });
+    // rewinding would go out of sync with a recorded or replayed input journal
+    if (sargs_exists("rewind") && !journal_active()) {
+        rewind_init(&(rewind_desc_t){
+            .snapshot_size = sizeof(c64_snapshot_t),
+            .save_cb = save_rewind_snapshot,
+            .load_cb = load_rewind_snapshot,
+        });
+    }
     #ifdef CHIPS_USE_UI
         ui_init(ui_draw_cb);
         ui_c64_init(&state.ui, &(ui_c64_desc_t){
@@ -229,11 +269,23 @@ static void handle_file_loading(void);
 static void send_keybuf_input(void);
 static void draw_status_bar(void);
 
+// the 1541 drive motor is controlled by VIA2 port B bit 2, the drive LED by bit 3
+static bool is_disk_drive_active(const c1541_t* c1541) {
+    if (!c1541->valid) {
+        return false;
+    }
+    const uint8_t pb = c1541->via_2.pb.outr & c1541->via_2.pb.ddr;
+    return 0 != (pb & ((1<<2)|(1<<3)));
+}
+
 void app_frame(void) {
+    // run in warp mode while the tape motor is on or the disk drive is busy
+    clock_set_auto_warp(c64_is_tape_motor_on(&state.c64) || is_disk_drive_active(&state.c64.c1541));
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = c64_exec(&state.c64, state.frame_time_us);
+    state.ticks = rewind_frame() ? 0 : c64_exec(&state.c64, state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
+    journal_frame_ticks(state.ticks);
     draw_status_bar();
     gfx_draw(c64_display_info(&state.c64));
     handle_file_loading();
@@ -245,6 +297,9 @@ void app_input(const sapp_event* event) {
     if (event->type == SAPP_EVENTTYPE_FILES_DROPPED) {
         fs_start_load_dropped_file(FS_SLOT_IMAGE);
     }
+    if (rewind_input(event)) {
+        return;
+    }
     #ifdef CHIPS_USE_UI
     if (ui_input(event)) {
         // input was handled by UI
@@ -263,8 +318,8 @@ void app_input(const sapp_event* event) {
                 } else if (islower(c)) {
                     c = toupper(c);
                 }
-                c64_key_down(&state.c64, c);
-                c64_key_up(&state.c64, c);
+                journal_key_down(c);
+                journal_key_up(c);
             }
             break;
         case SAPP_EVENTTYPE_KEY_DOWN:
@@ -290,9 +345,9 @@ void app_input(const sapp_event* event) {
             }
             if (c) {
                 if (event->type == SAPP_EVENTTYPE_KEY_DOWN) {
-                    c64_key_down(&state.c64, c);
+                    journal_key_down(c);
                 } else {
-                    c64_key_up(&state.c64, c);
+                    journal_key_up(c);
                 }
             }
             break;
@@ -307,6 +362,9 @@ void app_cleanup(void) {
         ui_c64_discard(&state.ui);
         ui_discard();
     #endif
+    journal_shutdown();
+    rewind_shutdown();
+    fs_shutdown();
     saudio_shutdown();
     gfx_shutdown();
     sargs_shutdown();
@@ -380,6 +438,7 @@ static void ui_boot_cb(c64_t* sys) {
     clock_init();
     c64_desc_t desc = c64_desc(sys->joystick_type, sys->c1530.valid, sys->c1541.valid);
     c64_init(sys, &desc);
+    rewind_reset();
 }
 
 static void ui_update_snapshot_screenshot(size_t slot) {
@@ -392,11 +451,17 @@ static void ui_update_snapshot_screenshot(size_t slot) {
     }
 }
 
+static void ui_save_snapshot_callback(const fs_snapshot_save_response_t* response) {
+    if (response->result != FS_RESULT_SUCCESS) {
+        gfx_flash_error();
+    }
+}
+
 static void ui_save_snapshot(size_t slot) {
     if (slot < UI_SNAPSHOT_MAX_SLOTS) {
         state.snapshots[slot].version = c64_save_snapshot(&state.c64, &state.snapshots[slot].c64);
         ui_update_snapshot_screenshot(slot);
-        fs_save_snapshot("c64", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(c64_snapshot_t) });
+        fs_save_snapshot("c64", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(c64_snapshot_t) }, ui_save_snapshot_callback);
     }
 }
 
@@ -404,6 +469,9 @@ static bool ui_load_snapshot(size_t slot) {
     bool success = false;
     if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.snapshot.slots[slot].valid)) {
         success = c64_load_snapshot(&state.c64, state.snapshots[slot].version, &state.snapshots[slot].c64);
+        if (success) {
+            rewind_reset();
+        }
     }
     return success;
 }
@@ -437,6 +505,7 @@ static void web_boot(void) {
     c64_desc_t desc = c64_desc(state.c64.joystick_type, state.c64.c1530.valid, state.c64.c1541.valid);
     c64_init(&state.c64, &desc);
     ui_dbg_reboot(&state.ui.dbg);
+    rewind_reset();
 }
 
 static void web_reset(void) {
@@ -102,7 +102,10 @@ static void web_dbg_read_memory(uint16_t addr, int num_bytes, uint8_t* dst_ptr);
 // audio-streaming callback
 static void push_audio(const float* samples, int num_samples, void* user_data) {
     (void)user_data;
-    saudio_push(samples, num_samples);
+    // audio is dropped in warp mode
+    if (!clock_warp_active()) {
+        saudio_push(samples, num_samples);
+    }
 }
 
 // get cpc_desc_t struct based on model and joystick type
@@ -135,6 +138,26 @@ cpc_desc_t cpc_desc(cpc_type_t type, cpc_joystick_type_t joy_type) {
     };
 }
 
+static void save_rewind_snapshot(void* dst) {
+    cpc_snapshot_t* snapshot = dst;
+    snapshot->version = cpc_save_snapshot(&state.cpc, &snapshot->cpc);
+}
+
+static bool load_rewind_snapshot(void* src) {
+    cpc_snapshot_t* snapshot = src;
+    return cpc_load_snapshot(&state.cpc, snapshot->version, &snapshot->cpc);
+}
+
+static void inject_key_down(int key_code, void* user_data) {
+    (void)user_data;
+    cpc_key_down(&state.cpc, key_code);
+}
+
+static void inject_key_up(int key_code, void* user_data) {
+    (void)user_data;
+    cpc_key_up(&state.cpc, key_code);
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
@@ -155,6 +178,7 @@ void app_init(void) {
     cpc_init(&state.cpc, &desc);
     gfx_init(&(gfx_desc_t){
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .skip_unchanged_frames = true,
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -172,8 +196,24 @@ void app_init(void) {
     });
     keybuf_init(&(keybuf_desc_t) { .key_delay_frames=7 });
     clock_init();
+    clock_set_warp_mode_from_string(sargs_value("warp"));
     prof_init();
-    fs_init();
+    fs_init(&(fs_desc_t){0});
+    journal_init(&(journal_desc_t){
+        .system_name = "cpc",
+        .record_path = sargs_value("record"),
+        .replay_path = sargs_value("replay"),
+        .key_down_cb = inject_key_down,
+        .key_up_cb = inject_key_up,
+    });
+    // rewinding would go out of sync with a recorded or replayed input journal
+    if (sargs_exists("rewind") && !journal_active()) {
+        rewind_init(&(rewind_desc_t){
+            .snapshot_size = sizeof(cpc_snapshot_t),
+            .save_cb = save_rewind_snapshot,
+            .load_cb = load_rewind_snapshot,
+        });
+    }
     #ifdef CHIPS_USE_UI
         ui_init(ui_draw_cb);
         ui_cpc_init(&state.ui, &(ui_cpc_desc_t){
@@ -249,10 +289,13 @@ static void send_keybuf_input(void);
 static void draw_status_bar(void);
 
 void app_frame(void) {
+    // run in warp mode while the floppy drive motor is on
+    clock_set_auto_warp(state.cpc.fdd.motor_on);
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = cpc_exec(&state.cpc, state.frame_time_us);
+    state.ticks = rewind_frame() ? 0 : cpc_exec(&state.cpc, state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
+    journal_frame_ticks(state.ticks);
     draw_status_bar();
     gfx_draw(cpc_display_info(&state.cpc));
     handle_file_loading();
@@ -264,6 +307,9 @@ void app_input(const sapp_event* event) {
     if (event->type == SAPP_EVENTTYPE_FILES_DROPPED) {
         fs_start_load_dropped_file(FS_SLOT_IMAGE);
     }
+    if (rewind_input(event)) {
+        return;
+    }
     #ifdef CHIPS_USE_UI
     if (ui_input(event)) {
         // input was handled by UI
@@ -276,8 +322,8 @@ void app_input(const sapp_event* event) {
             {
                 int c = (int) event->char_code;
                 if ((c > 0x20) && (c < 0x7F)) {
-                    cpc_key_down(&state.cpc, c);
-                    cpc_key_up(&state.cpc, c);
+                    journal_key_down(c);
+                    journal_key_up(c);
                 }
             }
             break;
@@ -315,12 +361,12 @@ void app_input(const sapp_event* event) {
                         if (shift_c == 0) {
                             shift_c = c;
                         }
-                        cpc_key_down(&state.cpc, shift ? shift_c : c);
+                        journal_key_down(shift ? shift_c : c);
                     } else {
                         // see: https://github.com/floooh/chips-test/issues/20
-                        cpc_key_up(&state.cpc, c);
+                        journal_key_up(c);
                         if (shift_c) {
-                            cpc_key_up(&state.cpc, shift_c);
+                            journal_key_up(shift_c);
                         }
                     }
                 }
@@ -337,6 +383,9 @@ void app_cleanup(void) {
         ui_cpc_discard(&state.ui);
         ui_discard();
     #endif
+    journal_shutdown();
+    rewind_shutdown();
+    fs_shutdown();
     saudio_shutdown();
     gfx_shutdown();
     sargs_shutdown();
@@ -446,6 +495,7 @@ static void ui_boot_cb(cpc_t* sys, cpc_type_t type) {
     clock_init();
     cpc_desc_t desc = cpc_desc(type, sys->joystick_type);
     cpc_init(sys, &desc);
+    rewind_reset();
 }
 
 static void ui_update_snapshot_screenshot(size_t slot) {
@@ -458,11 +508,17 @@ static void ui_update_snapshot_screenshot(size_t slot) {
     }
 }
 
+static void ui_save_snapshot_callback(const fs_snapshot_save_response_t* response) {
+    if (response->result != FS_RESULT_SUCCESS) {
+        gfx_flash_error();
+    }
+}
+
 static void ui_save_snapshot(size_t slot) {
     if (slot < UI_SNAPSHOT_MAX_SLOTS) {
         state.snapshots[slot].version = cpc_save_snapshot(&state.cpc, &state.snapshots[slot].cpc);
         ui_update_snapshot_screenshot(slot);
-        fs_save_snapshot("cpc", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(cpc_snapshot_t) });
+        fs_save_snapshot("cpc", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(cpc_snapshot_t) }, ui_save_snapshot_callback);
     }
 }
 
@@ -470,6 +526,9 @@ static bool ui_load_snapshot(size_t slot) {
     bool success = false;
     if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.snapshot.slots[slot].valid)) {
         success = cpc_load_snapshot(&state.cpc, state.snapshots[slot].version, &state.snapshots[slot].cpc);
+        if (success) {
+            rewind_reset();
+        }
     }
     return success;
 }
@@ -503,6 +562,7 @@ static void web_boot(void) {
     cpc_desc_t desc = cpc_desc(state.cpc.type, state.cpc.joystick_type);
     cpc_init(&state.cpc, &desc);
     ui_dbg_reboot(&state.ui.dbg);
+    rewind_reset();
 }
 
 static void web_reset(void) {
@@ -44,6 +44,7 @@ static struct {
     uint32_t ticks;
     double emu_time_ms;
     kc85_module_type_t delay_insert_module; // module to insert after ROM module image has been loaded
+    size_t module_slot;                     // loading slot of the ROM module image, 0 if none
     #ifdef CHIPS_USE_UI
         ui_kc85_t ui;
         struct {
@@ -104,7 +105,10 @@ static void web_dbg_read_memory(uint16_t addr, int num_bytes, uint8_t* dst_ptr);
 // audio-streaming callback
 static void push_audio(const float* samples, int num_samples, void* user_data) {
     (void)user_data;
-    saudio_push(samples, num_samples);
+    // audio is dropped in warp mode
+    if (!clock_warp_active()) {
+        saudio_push(samples, num_samples);
+    }
 }
 
 // a callback to patch some known problems in game snapshot files
@@ -155,12 +159,33 @@ kc85_desc_t kc85_desc(void) {
     };
 }
 
+static void save_rewind_snapshot(void* dst) {
+    kc85_snapshot_t* snapshot = dst;
+    snapshot->version = kc85_save_snapshot(&state.kc85, &snapshot->kc85);
+}
+
+static bool load_rewind_snapshot(void* src) {
+    kc85_snapshot_t* snapshot = src;
+    return kc85_load_snapshot(&state.kc85, snapshot->version, &snapshot->kc85);
+}
+
+static void inject_key_down(int key_code, void* user_data) {
+    (void)user_data;
+    kc85_key_down(&state.kc85, key_code);
+}
+
+static void inject_key_up(int key_code, void* user_data) {
+    (void)user_data;
+    kc85_key_up(&state.kc85, key_code);
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
     });
     gfx_init(&(gfx_desc_t) {
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .skip_unchanged_frames = true,
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -174,8 +199,24 @@ void app_init(void) {
     });
     keybuf_init(&(keybuf_desc_t){ .key_delay_frames = 10 });
     clock_init();
+    clock_set_warp_mode_from_string(sargs_value("warp"));
     prof_init();
-    fs_init();
+    fs_init(&(fs_desc_t){0});
+    journal_init(&(journal_desc_t){
+        .system_name = KC85_SYSTEM_NAME,
+        .record_path = sargs_value("record"),
+        .replay_path = sargs_value("replay"),
+        .key_down_cb = inject_key_down,
+        .key_up_cb = inject_key_up,
+    });
+    // rewinding would go out of sync with a recorded or replayed input journal
+    if (sargs_exists("rewind") && !journal_active()) {
+        rewind_init(&(rewind_desc_t){
+            .snapshot_size = sizeof(kc85_snapshot_t),
+            .save_cb = save_rewind_snapshot,
+            .load_cb = load_rewind_snapshot,
+        });
+    }
     const kc85_desc_t desc = kc85_desc();
     kc85_init(&state.kc85, &desc);
     #ifdef CHIPS_USE_UI
@@ -234,13 +275,14 @@ void app_init(void) {
     #endif
 
     bool delay_input = false;
-    // snapshot file or rom-module image
+    // snapshot file and rom-module image, both load concurrently in their own slots
     if (sargs_exists("file")) {
         delay_input=true;
         fs_start_load_file(FS_SLOT_IMAGE, sargs_value("file"));
     }
-    else if (sargs_exists("mod_image")) {
-        fs_start_load_file(FS_SLOT_IMAGE, sargs_value("mod_image"));
+    if (sargs_exists("mod_image")) {
+        state.module_slot = fs_alloc_slot();
+        fs_start_load_file(state.module_slot, sargs_value("mod_image"));
     }
     // check if any modules should be inserted
     if (sargs_exists("mod")) {
@@ -285,8 +327,9 @@ static void draw_status_bar(void);
 void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = kc85_exec(&state.kc85, state.frame_time_us);
+    state.ticks = rewind_frame() ? 0 : kc85_exec(&state.kc85, state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
+    journal_frame_ticks(state.ticks);
     draw_status_bar();
     gfx_draw(kc85_display_info(&state.kc85));
     send_keybuf_input();
@@ -298,6 +341,9 @@ void app_input(const sapp_event* event) {
     if (event->type == SAPP_EVENTTYPE_FILES_DROPPED) {
         fs_start_load_dropped_file(FS_SLOT_IMAGE);
     }
+    if (rewind_input(event)) {
+        return;
+    }
     #ifdef CHIPS_USE_UI
     if (ui_input(event)) {
         // input was handled by UI
@@ -317,8 +363,8 @@ void app_input(const sapp_event* event) {
                     else if (islower(c)) {
                         c = toupper(c);
                     }
-                    kc85_key_down(&state.kc85, c);
-                    kc85_key_up(&state.kc85, c);
+                    journal_key_down(c);
+                    journal_key_up(c);
                 }
             }
             break;
@@ -357,13 +403,13 @@ void app_input(const sapp_event* event) {
                         if (shift_c == 0) {
                             shift_c = c;
                         }
-                        kc85_key_down(&state.kc85, shift ? shift_c : c);
+                        journal_key_down(shift ? shift_c : c);
                     }
                     else {
                         // see: https://github.com/floooh/chips-test/issues/20
-                        kc85_key_up(&state.kc85, c);
+                        journal_key_up(c);
                         if (shift_c) {
-                            kc85_key_up(&state.kc85, shift_c);
+                            journal_key_up(shift_c);
                         }
                     }
                 }
@@ -380,6 +426,9 @@ void app_cleanup(void) {
         ui_kc85_discard(&state.ui);
         ui_discard();
     #endif
+    journal_shutdown();
+    rewind_shutdown();
+    fs_shutdown();
     saudio_shutdown();
     gfx_shutdown();
     sargs_shutdown();
@@ -396,16 +445,33 @@ static void send_keybuf_input(void) {
 static void handle_file_loading(void) {
     fs_dowork();
     const uint32_t load_delay_frames = LOAD_DELAY_FRAMES;
-    if (fs_success(FS_SLOT_IMAGE) && clock_frame_count_60hz() > load_delay_frames) {
-        const chips_range_t file_data = fs_data(FS_SLOT_IMAGE);
+    if (clock_frame_count_60hz() <= load_delay_frames) {
+        return;
+    }
+    // insert the rom module before the file is loaded, the file might depend on it
+    if ((state.module_slot != 0) && !fs_pending(state.module_slot)) {
         bool load_success = false;
-        if (sargs_exists("mod_image")) {
-            // insert the rom module
-            if (state.delay_insert_module != KC85_MODULE_NONE) {
-                load_success = kc85_insert_rom_module(&state.kc85, 0x08, state.delay_insert_module, file_data);
+        if (fs_success(state.module_slot) && (state.delay_insert_module != KC85_MODULE_NONE)) {
+            load_success = kc85_insert_rom_module(&state.kc85, 0x08, state.delay_insert_module, fs_data(state.module_slot));
+        }
+        if (load_success) {
+            if (clock_frame_count_60hz() > (load_delay_frames + 10)) {
+                gfx_flash_success();
             }
+            if (!sargs_exists("file") && sargs_exists("input")) {
+                keybuf_put(sargs_value("input"));
+            }
+        }
+        else {
+            gfx_flash_error();
         }
-        else if (fs_ext(FS_SLOT_IMAGE, "txt") || fs_ext(FS_SLOT_IMAGE, "bas")) {
+        fs_free_slot(state.module_slot);
+        state.module_slot = 0;
+    }
+    if ((state.module_slot == 0) && fs_success(FS_SLOT_IMAGE)) {
+        const chips_range_t file_data = fs_data(FS_SLOT_IMAGE);
+        bool load_success = false;
+        if (fs_ext(FS_SLOT_IMAGE, "txt") || fs_ext(FS_SLOT_IMAGE, "bas")) {
             load_success = true;
             keybuf_put((const char*)file_data.ptr);
         }
@@ -478,6 +544,7 @@ static void ui_boot_cb(kc85_t* sys) {
     clock_init();
     kc85_desc_t desc = kc85_desc();
     kc85_init(sys, &desc);
+    rewind_reset();
 }
 
 static void ui_update_snapshot_screenshot(size_t slot) {
@@ -490,11 +557,17 @@ static void ui_update_snapshot_screenshot(size_t slot) {
     }
 }
 
+static void ui_save_snapshot_callback(const fs_snapshot_save_response_t* response) {
+    if (response->result != FS_RESULT_SUCCESS) {
+        gfx_flash_error();
+    }
+}
+
 static void ui_save_snapshot(size_t slot) {
     if (slot < UI_SNAPSHOT_MAX_SLOTS) {
         state.snapshots[slot].version = kc85_save_snapshot(&state.kc85, &state.snapshots[slot].kc85);
         ui_update_snapshot_screenshot(slot);
-        fs_save_snapshot(KC85_SYSTEM_NAME, slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(kc85_snapshot_t) });
+        fs_save_snapshot(KC85_SYSTEM_NAME, slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(kc85_snapshot_t) }, ui_save_snapshot_callback);
     }
 }
 
@@ -502,6 +575,9 @@ static bool ui_load_snapshot(size_t slot) {
     bool success = false;
     if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.snapshot.slots[slot].valid)) {
         success = kc85_load_snapshot(&state.kc85, state.snapshots[slot].version, &state.snapshots[slot].kc85);
+        if (success) {
+            rewind_reset();
+        }
     }
     return success;
 }
@@ -535,6 +611,7 @@ static void web_boot(void) {
     kc85_desc_t desc = kc85_desc();
     kc85_init(&state.kc85, &desc);
     ui_dbg_reboot(&state.ui.dbg);
+    rewind_reset();
 }
 
 static void web_reset(void) {
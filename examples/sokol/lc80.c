@@ -56,7 +56,10 @@ static void ui_load_snapshots_from_storage(void);
 
 static void push_audio(const float* samples, int num_samples, void* user_data) {
     (void)user_data;
-    saudio_push(samples, num_samples);
+    // audio is dropped in warp mode
+    if (!clock_warp_active()) {
+        saudio_push(samples, num_samples);
+    }
 }
 
 static lc80_desc_t lc80_desc(void) {
@@ -70,6 +73,16 @@ static lc80_desc_t lc80_desc(void) {
     };
 }
 
+static void save_rewind_snapshot(void* dst) {
+    lc80_snapshot_t* snapshot = dst;
+    snapshot->version = lc80_save_snapshot(&state.lc80, &snapshot->lc80);
+}
+
+static bool load_rewind_snapshot(void* src) {
+    lc80_snapshot_t* snapshot = src;
+    return lc80_load_snapshot(&state.lc80, snapshot->version, &snapshot->lc80);
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
@@ -84,8 +97,16 @@ void app_init(void) {
         .logger.func = slog_func,
     });
     clock_init();
+    clock_set_warp_mode_from_string(sargs_value("warp"));
     prof_init();
-    fs_init();
+    fs_init(&(fs_desc_t){0});
+    if (sargs_exists("rewind")) {
+        rewind_init(&(rewind_desc_t){
+            .snapshot_size = sizeof(lc80_snapshot_t),
+            .save_cb = save_rewind_snapshot,
+            .load_cb = load_rewind_snapshot,
+        });
+    }
 
     lc80_desc_t desc = lc80_desc();
     lc80_init(&state.lc80, &desc);
@@ -120,7 +141,7 @@ static void draw_status_bar(void);
 void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = lc80_exec(&state.lc80, state.frame_time_us);
+    state.ticks = rewind_frame() ? 0 : lc80_exec(&state.lc80, state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
     draw_status_bar();
     sg_begin_pass(&(sg_pass){ .swapchain = sglue_swapchain() });
@@ -132,12 +153,17 @@ void app_frame(void) {
 }
 
 void app_input(const sapp_event* event) {
+    if (rewind_input(event)) {
+        return;
+    }
     ui_input(event);
 }
 
 void app_cleanup(void) {
     lc80_discard(&state.lc80);
     ui_lc80_discard(&state.ui);
+    rewind_shutdown();
+    fs_shutdown();
     saudio_shutdown();
     sdtx_shutdown();
     sg_shutdown();
@@ -158,6 +184,7 @@ static void draw_status_bar(void) {
 static void ui_boot_cb(lc80_t* sys) {
     lc80_desc_t desc = lc80_desc();
     lc80_init(sys, &desc);
+    rewind_reset();
 }
 
 static void ui_draw_cb(void) {
@@ -168,7 +195,7 @@ static void ui_save_snapshot(size_t slot) {
     if (slot < UI_SNAPSHOT_MAX_SLOTS) {
         state.snapshots[slot].version = lc80_save_snapshot(&state.lc80, &state.snapshots[slot].lc80);
         state.ui.win.snapshot.slots[slot].valid = true;
-        fs_save_snapshot("lc80", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(lc80_snapshot_t) });
+        fs_save_snapshot("lc80", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(lc80_snapshot_t) }, 0);
     }
 }
 
@@ -176,6 +203,9 @@ static bool ui_load_snapshot(size_t slot) {
     bool success = false;
     if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.win.snapshot.slots[slot].valid)) {
         success = lc80_load_snapshot(&state.lc80, state.snapshots[slot].version, &state.snapshots[slot].lc80);
+        if (success) {
+            rewind_reset();
+        }
     }
     return success;
 }
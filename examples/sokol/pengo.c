@@ -57,7 +57,31 @@ static void ui_load_snapshots_from_storage(void);
 
 static void push_audio(const float* samples, int num_samples, void* user_data) {
     (void)user_data;
-    saudio_push(samples, num_samples);
+    // audio is dropped in warp mode
+    if (!clock_warp_active()) {
+        saudio_push(samples, num_samples);
+    }
+}
+
+static void save_rewind_snapshot(void* dst) {
+    pengo_snapshot_t* snapshot = dst;
+    snapshot->version = namco_save_snapshot(&state.sys, &snapshot->sys);
+}
+
+static bool load_rewind_snapshot(void* src) {
+    pengo_snapshot_t* snapshot = src;
+    return namco_load_snapshot(&state.sys, snapshot->version, &snapshot->sys);
+}
+
+// the key codes are NAMCO_INPUT_* masks
+static void inject_key_down(int key_code, void* user_data) {
+    (void)user_data;
+    namco_input_set(&state.sys, (uint32_t)key_code);
+}
+
+static void inject_key_up(int key_code, void* user_data) {
+    (void)user_data;
+    namco_input_clear(&state.sys, (uint32_t)key_code);
 }
 
 static void app_init(void) {
@@ -111,8 +135,24 @@ static void app_init(void) {
         }
     });
     clock_init();
+    clock_set_warp_mode_from_string(sargs_value("warp"));
     prof_init();
-    fs_init();
+    fs_init(&(fs_desc_t){0});
+    journal_init(&(journal_desc_t){
+        .system_name = "pengo",
+        .record_path = sargs_value("record"),
+        .replay_path = sargs_value("replay"),
+        .key_down_cb = inject_key_down,
+        .key_up_cb = inject_key_up,
+    });
+    // rewinding would go out of sync with a recorded or replayed input journal
+    if (sargs_exists("rewind") && !journal_active()) {
+        rewind_init(&(rewind_desc_t){
+            .snapshot_size = sizeof(pengo_snapshot_t),
+            .save_cb = save_rewind_snapshot,
+            .load_cb = load_rewind_snapshot,
+        });
+    }
     #ifdef CHIPS_USE_UI
         ui_init(ui_draw_cb);
         ui_namco_init(&state.ui, &(ui_namco_desc_t){
@@ -148,14 +188,18 @@ static void draw_status_bar(void);
 static void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = namco_exec(&state.sys, state.frame_time_us);
+    state.ticks = rewind_frame() ? 0 : namco_exec(&state.sys, state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
+    journal_frame_ticks(state.ticks);
     draw_status_bar();
     gfx_draw(namco_display_info(&state.sys));
     fs_dowork();
 }
 
 static void app_input(const sapp_event* event) {
+    if (rewind_input(event)) {
+        return;
+    }
     #ifdef CHIPS_USE_UI
     if (ui_input(event)) {
         // input was handled by UI
@@ -163,28 +207,23 @@ static void app_input(const sapp_event* event) {
     }
     #endif
     switch (event->type) {
+        int mask;
         case SAPP_EVENTTYPE_KEY_DOWN:
-            switch (event->key_code) {
-                case SAPP_KEYCODE_RIGHT:    namco_input_set(&state.sys, NAMCO_INPUT_P1_RIGHT); break;
-                case SAPP_KEYCODE_LEFT:     namco_input_set(&state.sys, NAMCO_INPUT_P1_LEFT); break;
-                case SAPP_KEYCODE_UP:       namco_input_set(&state.sys, NAMCO_INPUT_P1_UP); break;
-                case SAPP_KEYCODE_DOWN:     namco_input_set(&state.sys, NAMCO_INPUT_P1_DOWN); break;
-                case SAPP_KEYCODE_1:        namco_input_set(&state.sys, NAMCO_INPUT_P1_COIN); break;
-                case SAPP_KEYCODE_2:        namco_input_set(&state.sys, NAMCO_INPUT_P2_COIN); break;
-                case SAPP_KEYCODE_SPACE:    namco_input_set(&state.sys, NAMCO_INPUT_P1_BUTTON); break;
-                default:                    namco_input_set(&state.sys, NAMCO_INPUT_P1_START); break;
-            }
-            break;
         case SAPP_EVENTTYPE_KEY_UP:
             switch (event->key_code) {
-                case SAPP_KEYCODE_RIGHT:    namco_input_clear(&state.sys, NAMCO_INPUT_P1_RIGHT); break;
-                case SAPP_KEYCODE_LEFT:     namco_input_clear(&state.sys, NAMCO_INPUT_P1_LEFT); break;
-                case SAPP_KEYCODE_UP:       namco_input_clear(&state.sys, NAMCO_INPUT_P1_UP); break;
-                case SAPP_KEYCODE_DOWN:     namco_input_clear(&state.sys, NAMCO_INPUT_P1_DOWN); break;
-                case SAPP_KEYCODE_1:        namco_input_clear(&state.sys, NAMCO_INPUT_P1_COIN); break;
-                case SAPP_KEYCODE_2:        namco_input_clear(&state.sys, NAMCO_INPUT_P2_COIN); break;
-                case SAPP_KEYCODE_SPACE:    namco_input_clear(&state.sys, NAMCO_INPUT_P1_BUTTON); break;
-                default:                    namco_input_clear(&state.sys, NAMCO_INPUT_P1_START); break;
+                case SAPP_KEYCODE_RIGHT:    mask = NAMCO_INPUT_P1_RIGHT; break;
+                case SAPP_KEYCODE_LEFT:     mask = NAMCO_INPUT_P1_LEFT; break;
+                case SAPP_KEYCODE_UP:       mask = NAMCO_INPUT_P1_UP; break;
+                case SAPP_KEYCODE_DOWN:     mask = NAMCO_INPUT_P1_DOWN; break;
+                case SAPP_KEYCODE_1:        mask = NAMCO_INPUT_P1_COIN; break;
+                case SAPP_KEYCODE_2:        mask = NAMCO_INPUT_P2_COIN; break;
+                case SAPP_KEYCODE_SPACE:    mask = NAMCO_INPUT_P1_BUTTON; break;
+                default:                    mask = NAMCO_INPUT_P1_START; break;
+            }
+            if (event->type == SAPP_EVENTTYPE_KEY_DOWN) {
+                journal_key_down(mask);
+            } else {
+                journal_key_up(mask);
             }
             break;
         default:
@@ -198,6 +237,9 @@ static void app_cleanup(void) {
         ui_namco_discard(&state.ui);
         ui_discard();
     #endif
+    journal_shutdown();
+    rewind_shutdown();
+    fs_shutdown();
     saudio_shutdown();
     gfx_shutdown();
 }
@@ -230,11 +272,17 @@ static void ui_update_snapshot_screenshot(size_t slot) {
     }
 }
 
+static void ui_save_snapshot_callback(const fs_snapshot_save_response_t* response) {
+    if (response->result != FS_RESULT_SUCCESS) {
+        gfx_flash_error();
+    }
+}
+
 static void ui_save_snapshot(size_t slot) {
     if (slot < UI_SNAPSHOT_MAX_SLOTS) {
         state.snapshots[slot].version = namco_save_snapshot(&state.sys, &state.snapshots[slot].sys);
         ui_update_snapshot_screenshot(slot);
-        fs_save_snapshot("pengo", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(pengo_snapshot_t) });
+        fs_save_snapshot("pengo", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(pengo_snapshot_t) }, ui_save_snapshot_callback);
     }
 }
 
@@ -242,6 +290,9 @@ static bool ui_load_snapshot(size_t slot) {
     bool success = false;
     if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.snapshot.slots[slot].valid)) {
         success = namco_load_snapshot(&state.sys, state.snapshots[slot].version, &state.snapshots[slot].sys);
+        if (success) {
+            rewind_reset();
+        }
     }
     return success;
 }
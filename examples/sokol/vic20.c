@@ -64,7 +64,10 @@ static void ui_load_snapshots_from_storage(void);
 // audio-streaming callback
 static void push_audio(const float* samples, int num_samples, void* user_data) {
     (void)user_data;
-    saudio_push(samples, num_samples);
+    // audio is dropped in warp mode
+    if (!clock_warp_active()) {
+        saudio_push(samples, num_samples);
+    }
 }
 
 // get vic20_desc_t struct based on joystick type
@@ -89,6 +92,26 @@ vic20_desc_t vic20_desc(vic20_joystick_type_t joy_type, vic20_memory_config_t me
     };
 }
 
+static void save_rewind_snapshot(void* dst) {
+    vic20_snapshot_t* snapshot = dst;
+    snapshot->version = vic20_save_snapshot(&state.vic20, &snapshot->vic20);
+}
+
+static bool load_rewind_snapshot(void* src) {
+    vic20_snapshot_t* snapshot = src;
+    return vic20_load_snapshot(&state.vic20, snapshot->version, &snapshot->vic20);
+}
+
+static void inject_key_down(int key_code, void* user_data) {
+    (void)user_data;
+    vic20_key_down(&state.vic20, key_code);
+}
+
+static void inject_key_up(int key_code, void* user_data) {
+    (void)user_data;
+    vic20_key_up(&state.vic20, key_code);
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
@@ -120,6 +143,7 @@ void app_init(void) {
     vic20_init(&state.vic20, &desc);
     gfx_init(&(gfx_desc_t){
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .skip_unchanged_frames = true,
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -137,8 +161,24 @@ void app_init(void) {
     });
     keybuf_init(&(keybuf_desc_t){ .key_delay_frames=5 });
     clock_init();
+    clock_set_warp_mode_from_string(sargs_value("warp"));
     prof_init();
-    fs_init();
+    fs_init(&(fs_desc_t){0});
+    journal_init(&(journal_desc_t){
+        .system_name = "vic20",
+        .record_path = sargs_value("record"),
+        .replay_path = sargs_value("replay"),
+        .key_down_cb = inject_key_down,
+        .key_up_cb = inject_key_up,
+    });
+    // rewinding would go out of sync with a recorded or replayed input journal
+    if (sargs_exists("rewind") && !journal_active()) {
+        rewind_init(&(rewind_desc_t){
+            .snapshot_size = sizeof(vic20_snapshot_t),
+            .save_cb = save_rewind_snapshot,
+            .load_cb = load_rewind_snapshot,
+        });
+    }
     #ifdef CHIPS_USE_UI
         ui_init(ui_draw_cb);
         ui_vic20_init(&state.ui, &(ui_vic20_desc_t){
@@ -193,10 +233,13 @@ static void draw_status_bar(void);
 
 // per frame stuff, tick the emulator, handle input, decode and draw emulator display
 void app_frame(void) {
+    // run in warp mode while the tape motor is on
+    clock_set_auto_warp(vic20_is_tape_motor_on(&state.vic20));
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = vic20_exec(&state.vic20, state.frame_time_us);
+    state.ticks = rewind_frame() ? 0 : vic20_exec(&state.vic20, state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
+    journal_frame_ticks(state.ticks);
     draw_status_bar();
     gfx_draw(vic20_display_info(&state.vic20));
     handle_file_loading();
@@ -208,6 +251,9 @@ void app_input(const sapp_event* event) {
     if (event->type == SAPP_EVENTTYPE_FILES_DROPPED) {
         fs_start_load_dropped_file(FS_SLOT_IMAGE);
     }
+    if (rewind_input(event)) {
+        return;
+    }
     #ifdef CHIPS_USE_UI
     if (ui_input(event)) {
         // input was handled by UI
@@ -227,8 +273,8 @@ void app_input(const sapp_event* event) {
                 else if (islower(c)) {
                     c = toupper(c);
                 }
-                vic20_key_down(&state.vic20, c);
-                vic20_key_up(&state.vic20, c);
+                journal_key_down(c);
+                journal_key_up(c);
             }
             break;
         case SAPP_EVENTTYPE_KEY_DOWN:
@@ -254,10 +300,10 @@ void app_input(const sapp_event* event) {
             }
             if (c) {
                 if (event->type == SAPP_EVENTTYPE_KEY_DOWN) {
-                    vic20_key_down(&state.vic20, c);
+                    journal_key_down(c);
                 }
                 else {
-                    vic20_key_up(&state.vic20, c);
+                    journal_key_up(c);
                 }
             }
             break;
@@ -272,6 +318,9 @@ void app_cleanup(void) {
         ui_vic20_discard(&state.ui);
         ui_discard();
     #endif
+    journal_shutdown();
+    rewind_shutdown();
+    fs_shutdown();
     saudio_shutdown();
     gfx_shutdown();
     sargs_shutdown();
@@ -354,6 +403,7 @@ static void ui_draw_cb(void) {
 static void ui_boot_cb(vic20_t* sys) {
     vic20_desc_t desc = vic20_desc(sys->joystick_type, sys->mem_config, sys->c1530.valid);
     vic20_init(sys, &desc);
+    rewind_reset();
 }
 
 static void ui_update_snapshot_screenshot(size_t slot) {
@@ -366,11 +416,17 @@ static void ui_update_snapshot_screenshot(size_t slot) {
     }
 }
 
+static void ui_save_snapshot_callback(const fs_snapshot_save_response_t* response) {
+    if (response->result != FS_RESULT_SUCCESS) {
+        gfx_flash_error();
+    }
+}
+
 static void ui_save_snapshot(size_t slot) {
     if (slot < UI_SNAPSHOT_MAX_SLOTS) {
         state.snapshots[slot].version = vic20_save_snapshot(&state.vic20, &state.snapshots[slot].vic20);
         ui_update_snapshot_screenshot(slot);
-        fs_save_snapshot("vic20", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(vic20_snapshot_t) });
+        fs_save_snapshot("vic20", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(vic20_snapshot_t) }, ui_save_snapshot_callback);
     }
 }
 
@@ -378,6 +434,9 @@ static bool ui_load_snapshot(size_t slot) {
     bool success = false;
     if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.snapshot.slots[slot].valid)) {
         success = vic20_load_snapshot(&state.vic20, state.snapshots[slot].version, &state.snapshots[slot].vic20);
+        if (success) {
+            rewind_reset();
+        }
     }
     return success;
 }
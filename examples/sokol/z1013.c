@@ -74,9 +74,30 @@ z1013_desc_t z1013_desc(z1013_type_t type) {
     };
 }
 
+static void save_rewind_snapshot(void* dst) {
+    z1013_snapshot_t* snapshot = dst;
+    snapshot->version = z1013_save_snapshot(&state.z1013, &snapshot->z1013);
+}
+
+static bool load_rewind_snapshot(void* src) {
+    z1013_snapshot_t* snapshot = src;
+    return z1013_load_snapshot(&state.z1013, snapshot->version, &snapshot->z1013);
+}
+
+static void inject_key_down(int key_code, void* user_data) {
+    (void)user_data;
+    z1013_key_down(&state.z1013, key_code);
+}
+
+static void inject_key_up(int key_code, void* user_data) {
+    (void)user_data;
+    z1013_key_up(&state.z1013, key_code);
+}
+
 void app_init(void) {
     gfx_init(&(gfx_desc_t){
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .skip_unchanged_frames = true,
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -90,8 +111,24 @@ void app_init(void) {
     });
     keybuf_init(&(keybuf_desc_t){ .key_delay_frames = 6 });
     clock_init();
+    clock_set_warp_mode_from_string(sargs_value("warp"));
     prof_init();
-    fs_init();
+    fs_init(&(fs_desc_t){0});
+    journal_init(&(journal_desc_t){
+        .system_name = "z1013",
+        .record_path = sargs_value("record"),
+        .replay_path = sargs_value("replay"),
+        .key_down_cb = inject_key_down,
+        .key_up_cb = inject_key_up,
+    });
+    // rewinding would go out of sync with a recorded or replayed input journal
+    if (sargs_exists("rewind") && !journal_active()) {
+        rewind_init(&(rewind_desc_t){
+            .snapshot_size = sizeof(z1013_snapshot_t),
+            .save_cb = save_rewind_snapshot,
+            .load_cb = load_rewind_snapshot,
+        });
+    }
     z1013_type_t type = Z1013_TYPE_64;
     if (sargs_exists("type")) {
         if (sargs_equals("type", "z1013_01")) {
@@ -150,8 +187,9 @@ static void draw_status_bar(void);
 void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = z1013_exec(&state.z1013, state.frame_time_us);
+    state.ticks = rewind_frame() ? 0 : z1013_exec(&state.z1013, state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
+    journal_frame_ticks(state.ticks);
     draw_status_bar();
     gfx_draw(z1013_display_info(&state.z1013));
     handle_file_loading();
@@ -163,6 +201,9 @@ void app_input(const sapp_event* event) {
     if (event->type == SAPP_EVENTTYPE_FILES_DROPPED) {
         fs_start_load_dropped_file(FS_SLOT_IMAGE);
     }
+    if (rewind_input(event)) {
+        return;
+    }
     #ifdef CHIPS_USE_UI
     if (ui_input(event)) {
         // input was handled by UI
@@ -181,8 +222,8 @@ void app_input(const sapp_event* event) {
                 else if (islower(c)) {
                     c = toupper(c);
                 }
-                z1013_key_down(&state.z1013, c);
-                z1013_key_up(&state.z1013, c);
+                journal_key_down(c);
+                journal_key_up(c);
             }
             break;
         case SAPP_EVENTTYPE_KEY_DOWN:
@@ -198,10 +239,10 @@ void app_input(const sapp_event* event) {
             }
             if (c) {
                 if (event->type == SAPP_EVENTTYPE_KEY_DOWN) {
-                    z1013_key_down(&state.z1013, c);
+                    journal_key_down(c);
                 }
                 else {
-                    z1013_key_up(&state.z1013, c);
+                    journal_key_up(c);
                 }
             }
             break;
@@ -216,6 +257,9 @@ void app_cleanup(void) {
         ui_z1013_discard(&state.ui);
         ui_discard();
     #endif
+    journal_shutdown();
+    rewind_shutdown();
+    fs_shutdown();
     gfx_shutdown();
     sargs_shutdown();
 }
@@ -275,6 +319,7 @@ static void ui_draw_cb(void) {
 static void ui_boot_cb(z1013_t* sys, z1013_type_t type) {
     z1013_desc_t desc = z1013_desc(type);
     z1013_init(sys, &desc);
+    rewind_reset();
 }
 
 static void ui_update_snapshot_screenshot(size_t slot) {
@@ -287,11 +332,17 @@ static void ui_update_snapshot_screenshot(size_t slot) {
     }
 }
 
+static void ui_save_snapshot_callback(const fs_snapshot_save_response_t* response) {
+    if (response->result != FS_RESULT_SUCCESS) {
+        gfx_flash_error();
+    }
+}
+
 static void ui_save_snapshot(size_t slot) {
     if (slot < UI_SNAPSHOT_MAX_SLOTS) {
         state.snapshots[slot].version = z1013_save_snapshot(&state.z1013, &state.snapshots[slot].z1013);
         ui_update_snapshot_screenshot(slot);
-        fs_save_snapshot("z1013", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(z1013_snapshot_t) });
+        fs_save_snapshot("z1013", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(z1013_snapshot_t) }, ui_save_snapshot_callback);
     }
 }
 
@@ -299,6 +350,9 @@ static bool ui_load_snapshot(size_t slot) {
     bool success = false;
     if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.snapshot.slots[slot].valid)) {
         success = z1013_load_snapshot(&state.z1013, state.snapshots[slot].version, &state.snapshots[slot].z1013);
+        if (success) {
+            rewind_reset();
+        }
     }
     return success;
 }
@@ -71,7 +71,10 @@ static void ui_load_snapshots_from_storage(void);
 // audio-streaming callback
 static void push_audio(const float* samples, int num_samples, void* user_data) {
     (void)user_data;
-    saudio_push(samples, num_samples);
+    // audio is dropped in warp mode
+    if (!clock_warp_active()) {
+        saudio_push(samples, num_samples);
+    }
 }
 
 // get a z9001_desc_t struct for given Z9001 model
@@ -101,12 +104,33 @@ z9001_desc_t z9001_desc(z9001_type_t type) {
     };
 }
 
+static void save_rewind_snapshot(void* dst) {
+    z9001_snapshot_t* snapshot = dst;
+    snapshot->version = z9001_save_snapshot(&state.z9001, &snapshot->z9001);
+}
+
+static bool load_rewind_snapshot(void* src) {
+    z9001_snapshot_t* snapshot = src;
+    return z9001_load_snapshot(&state.z9001, snapshot->version, &snapshot->z9001);
+}
+
+static void inject_key_down(int key_code, void* user_data) {
+    (void)user_data;
+    z9001_key_down(&state.z9001, key_code);
+}
+
+static void inject_key_up(int key_code, void* user_data) {
+    (void)user_data;
+    z9001_key_up(&state.z9001, key_code);
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
     });
     gfx_init(&(gfx_desc_t) {
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .skip_unchanged_frames = true,
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -120,8 +144,24 @@ void app_init(void) {
     });
     keybuf_init(&(keybuf_desc_t){ .key_delay_frames=12 });
     clock_init();
+    clock_set_warp_mode_from_string(sargs_value("warp"));
     prof_init();
-    fs_init();
+    fs_init(&(fs_desc_t){0});
+    journal_init(&(journal_desc_t){
+        .system_name = "z9001",
+        .record_path = sargs_value("record"),
+        .replay_path = sargs_value("replay"),
+        .key_down_cb = inject_key_down,
+        .key_up_cb = inject_key_up,
+    });
+    // rewinding would go out of sync with a recorded or replayed input journal
+    if (sargs_exists("rewind") && !journal_active()) {
+        rewind_init(&(rewind_desc_t){
+            .snapshot_size = sizeof(z9001_snapshot_t),
+            .save_cb = save_rewind_snapshot,
+            .load_cb = load_rewind_snapshot,
+        });
+    }
     z9001_type_t type = Z9001_TYPE_Z9001;
     if (sargs_exists("type")) {
         if (sargs_equals("type", "kc87")) {
@@ -177,8 +217,9 @@ static void draw_status_bar(void);
 void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = z9001_exec(&state.z9001, state.frame_time_us);
+    state.ticks = rewind_frame() ? 0 : z9001_exec(&state.z9001, state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
+    journal_frame_ticks(state.ticks);
     draw_status_bar();
     gfx_draw(z9001_display_info(&state.z9001));
     handle_file_loading();
@@ -191,6 +232,9 @@ void app_input(const sapp_event* event) {
     if (event->type == SAPP_EVENTTYPE_FILES_DROPPED) {
         fs_start_load_dropped_file(FS_SLOT_IMAGE);
     }
+    if (rewind_input(event)) {
+        return;
+    }
     #ifdef CHIPS_USE_UI
     if (ui_input(event)) {
         // input was handled by UI
@@ -209,8 +253,8 @@ void app_input(const sapp_event* event) {
                 else if (islower(c)) {
                     c = toupper(c);
                 }
-                z9001_key_down(&state.z9001, c);
-                z9001_key_up(&state.z9001, c);
+                journal_key_down(c);
+                journal_key_up(c);
             }
             break;
         case SAPP_EVENTTYPE_KEY_DOWN:
@@ -228,10 +272,10 @@ void app_input(const sapp_event* event) {
             }
             if (c) {
                 if (event->type == SAPP_EVENTTYPE_KEY_DOWN) {
-                    z9001_key_down(&state.z9001, c);
+                    journal_key_down(c);
                 }
                 else {
-                    z9001_key_up(&state.z9001, c);
+                    journal_key_up(c);
                 }
             }
             break;
@@ -247,6 +291,9 @@ void app_cleanup(void) {
         ui_z9001_discard(&state.ui);
         ui_discard();
     #endif
+    journal_shutdown();
+    rewind_shutdown();
+    fs_shutdown();
     saudio_shutdown();
     gfx_shutdown();
     sargs_shutdown();
@@ -304,6 +351,7 @@ static void ui_draw_cb(void) {
 static void ui_boot_cb(z9001_t* sys, z9001_type_t type) {
     z9001_desc_t desc = z9001_desc(type);
     z9001_init(sys, &desc);
+    rewind_reset();
 }
 
 static void ui_update_snapshot_screenshot(size_t slot) {
@@ -316,11 +364,17 @@ static void ui_update_snapshot_screenshot(size_t slot) {
     }
 }
 
+static void ui_save_snapshot_callback(const fs_snapshot_save_response_t* response) {
+    if (response->result != FS_RESULT_SUCCESS) {
+        gfx_flash_error();
+    }
+}
+
 static void ui_save_snapshot(size_t slot) {
     if (slot < UI_SNAPSHOT_MAX_SLOTS) {
         state.snapshots[slot].version = z9001_save_snapshot(&state.z9001, &state.snapshots[slot].z9001);
         ui_update_snapshot_screenshot(slot);
-        fs_save_snapshot("z9001", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(z9001_snapshot_t) });
+        fs_save_snapshot("z9001", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(z9001_snapshot_t) }, ui_save_snapshot_callback);
     }
 }
 
@@ -328,6 +382,9 @@ static bool ui_load_snapshot(size_t slot) {
     bool success = false;
     if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.snapshot.slots[slot].valid)) {
         success = z9001_load_snapshot(&state.z9001, state.snapshots[slot].version, &state.snapshots[slot].z9001);
+        if (success) {
+            rewind_reset();
+        }
     }
     return success;
 }
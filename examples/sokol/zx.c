@@ -65,7 +65,10 @@ static void ui_load_snapshots_from_storage(void);
 // audio-streaming callback
 static void push_audio(const float* samples, int num_samples, void* user_data) {
     (void)user_data;
-    saudio_push(samples, num_samples);
+    // audio is dropped in warp mode
+    if (!clock_warp_active()) {
+        saudio_push(samples, num_samples);
+    }
 }
 
 // get zx_desc_t struct for given ZX type and joystick type
@@ -88,12 +91,33 @@ zx_desc_t zx_desc(zx_type_t type, zx_joystick_type_t joy_type) {
     };
 }
 
+static void save_rewind_snapshot(void* dst) {
+    zx_snapshot_t* snapshot = dst;
+    snapshot->version = zx_save_snapshot(&state.zx, &snapshot->zx);
+}
+
+static bool load_rewind_snapshot(void* src) {
+    zx_snapshot_t* snapshot = src;
+    return zx_load_snapshot(&state.zx, snapshot->version, &snapshot->zx);
+}
+
+static void inject_key_down(int key_code, void* user_data) {
+    (void)user_data;
+    zx_key_down(&state.zx, key_code);
+}
+
+static void inject_key_up(int key_code, void* user_data) {
+    (void)user_data;
+    zx_key_up(&state.zx, key_code);
+}
+
 void app_init(void) {
     saudio_setup(&(saudio_desc){
         .logger.func = slog_func,
     });
     gfx_init(&(gfx_desc_t){
         .disable_speaker_icon = sargs_exists("disable-speaker-icon"),
+        .skip_unchanged_frames = true,
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
@@ -107,8 +131,24 @@ void app_init(void) {
     });
     keybuf_init(&(keybuf_desc_t){ .key_delay_frames=6 });
     clock_init();
+    clock_set_warp_mode_from_string(sargs_value("warp"));
     prof_init();
-    fs_init();
+    fs_init(&(fs_desc_t){0});
+    journal_init(&(journal_desc_t){
+        .system_name = "zx",
+        .record_path = sargs_value("record"),
+        .replay_path = sargs_value("replay"),
+        .key_down_cb = inject_key_down,
+        .key_up_cb = inject_key_up,
+    });
+    // rewinding would go out of sync with a recorded or replayed input journal
+    if (sargs_exists("rewind") && !journal_active()) {
+        rewind_init(&(rewind_desc_t){
+            .snapshot_size = sizeof(zx_snapshot_t),
+            .save_cb = save_rewind_snapshot,
+            .load_cb = load_rewind_snapshot,
+        });
+    }
     zx_type_t type = ZX_TYPE_128;
     if (sargs_exists("type")) {
         if (sargs_equals("type", "zx48k")) {
@@ -176,8 +216,9 @@ static void draw_status_bar(void);
 void app_frame(void) {
     state.frame_time_us = clock_frame_time();
     const uint64_t emu_start_time = stm_now();
-    state.ticks = zx_exec(&state.zx, state.frame_time_us);
+    state.ticks = rewind_frame() ? 0 : zx_exec(&state.zx, state.frame_time_us);
     state.emu_time_ms = stm_ms(stm_since(emu_start_time));
+    journal_frame_ticks(state.ticks);
     draw_status_bar();
     gfx_draw(zx_display_info(&state.zx));
     handle_file_loading();
@@ -189,6 +230,9 @@ void app_input(const sapp_event* event) {
     if (event->type == SAPP_EVENTTYPE_FILES_DROPPED) {
         fs_start_load_dropped_file(FS_SLOT_IMAGE);
     }
+    if (rewind_input(event)) {
+        return;
+    }
     #ifdef CHIPS_USE_UI
     if (ui_input(event)) {
         // input was handled by UI
@@ -200,8 +244,8 @@ void app_input(const sapp_event* event) {
         case SAPP_EVENTTYPE_CHAR:
             c = (int) event->char_code;
             if ((c > 0x20) && (c < 0x7F)) {
-                zx_key_down(&state.zx, c);
-                zx_key_up(&state.zx, c);
+                journal_key_down(c);
+                journal_key_up(c);
             }
             break;
         case SAPP_EVENTTYPE_KEY_DOWN:
@@ -220,10 +264,10 @@ void app_input(const sapp_event* event) {
             }
             if (c) {
                 if (event->type == SAPP_EVENTTYPE_KEY_DOWN) {
-                    zx_key_down(&state.zx, c);
+                    journal_key_down(c);
                 }
                 else {
-                    zx_key_up(&state.zx, c);
+                    journal_key_up(c);
                 }
             }
             break;
@@ -238,6 +282,9 @@ void app_cleanup(void) {
         ui_zx_discard(&state.ui);
         ui_discard();
     #endif
+    journal_shutdown();
+    rewind_shutdown();
+    fs_shutdown();
     saudio_shutdown();
     gfx_shutdown();
     sargs_shutdown();
@@ -299,6 +346,7 @@ void ui_draw_cb(void) {
 static void ui_boot_cb(zx_t* sys, zx_type_t type) {
     zx_desc_t desc = zx_desc(type, sys->joystick_type);
     zx_init(sys, &desc);
+    rewind_reset();
 }
 
 static void ui_update_snapshot_screenshot(size_t slot) {
@@ -311,11 +359,17 @@ static void ui_update_snapshot_screenshot(size_t slot) {
     }
 }
 
+static void ui_save_snapshot_callback(const fs_snapshot_save_response_t* response) {
+    if (response->result != FS_RESULT_SUCCESS) {
+        gfx_flash_error();
+    }
+}
+
 static void ui_save_snapshot(size_t slot) {
     if (slot < UI_SNAPSHOT_MAX_SLOTS) {
         state.snapshots[slot].version = zx_save_snapshot(&state.zx, &state.snapshots[slot].zx);
         ui_update_snapshot_screenshot(slot);
-        fs_save_snapshot("zx", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(zx_snapshot_t) });
+        fs_save_snapshot("zx", slot, (chips_range_t){ .ptr = &state.snapshots[slot], sizeof(zx_snapshot_t) }, ui_save_snapshot_callback);
     }
 }
 
@@ -323,6 +377,9 @@ static bool ui_load_snapshot(size_t slot) {
     bool success = false;
     if ((slot < UI_SNAPSHOT_MAX_SLOTS) && (state.ui.snapshot.slots[slot].valid)) {
         success = zx_load_snapshot(&state.zx, state.snapshots[slot].version, &state.snapshots[slot].zx);
+        if (success) {
+            rewind_reset();
+        }
     }
     return success;
 }
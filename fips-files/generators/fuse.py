@@ -1,15 +1,103 @@
 #-------------------------------------------------------------------------------
 #   fuse.py
 #
-#   Convert FUSE test files into C header.
+#   Convert FUSE test files into a C header with one packed byte array
+#   per test file (read by z80-fuse.c).
+#
+#   All values are little endian, a test file blob looks like this:
+#
+#       u32 num_tests
+#       u32 offsets[num_tests]      byte offset of each test in the blob
+#       tests...
+#
+#   And each test:
+#
+#       desc                        zero-terminated string
+#       u16 af, bc, de, hl, af_, bc_, de_, hl_, ix, iy, sp, pc
+#       u8 i, r, iff1, iff2, im, halted
+#       u16 ticks
+#       u8 num_events
+#       events:                     u16 tick, u8 type, u16 addr, u8 data
+#       u8 num_chunks
+#       chunks:                     u16 addr, u8 num_bytes, u8 bytes[num_bytes]
+#
+#   The event types are 1=MR, 2=MW, 3=PR, 4=PW.
 #-------------------------------------------------------------------------------
 
-Version = 2
+Version = 3
 
 import os.path
+import struct
 import yaml
 import genutil
 
+EventTypes = { 'MR': 1, 'MW': 2, 'PR': 3, 'PW': 4 }
+
+#-------------------------------------------------------------------------------
+def pack_test(inp, line):
+    data = bytearray()
+    # desc
+    name = line.split()[0]
+    data += name.encode('ascii') + b'\0'
+    # optional events start with spaces
+    events = bytearray()
+    num_events = 0
+    line = inp.readline()
+    while line[0] == ' ':
+        tok = line.split()
+        if len(tok) == 4:
+            events += struct.pack('<HBHB', int(tok[0]), EventTypes[tok[1]], int(tok[2], 16), int(tok[3], 16))
+            num_events += 1
+        line = inp.readline()
+    # 16-bit registers
+    tok = line.split()
+    regs = [int(t, 16) for t in tok] if len(tok) == 12 else [0] * 12
+    data += struct.pack('<12H', *regs)
+    # additional registers and flags
+    tok = inp.readline().split()
+    if len(tok) == 7:
+        data += struct.pack('<6BH',
+            int(tok[0], 16), int(tok[1], 16), int(tok[2]), int(tok[3]), int(tok[4]), int(tok[5]), int(tok[6]))
+    else:
+        data += struct.pack('<6BH', 0, 0, 0, 0, 0, 0, 0)
+    if num_events > 255:
+        raise Exception('too many events in test {}'.format(name))
+    data += struct.pack('<B', num_events) + events
+    # optional memory chunks
+    chunks = bytearray()
+    num_chunks = 0
+    tok = inp.readline().split()
+    if len(tok) > 1:
+        while len(tok) > 0:
+            if tok[0] != '-1':
+                i = 1
+                chunk = bytearray()
+                while tok[i] != '-1':
+                    chunk.append(int(tok[i], 16))
+                    i += 1
+                chunks += struct.pack('<HB', int(tok[0], 16), len(chunk)) + chunk
+                num_chunks += 1
+            tok = inp.readline().split()
+    data += struct.pack('<B', num_chunks) + chunks
+    return data
+
+#-------------------------------------------------------------------------------
+def pack_file(inp_path):
+    tests = []
+    with open(inp_path, 'r') as inp:
+        line = inp.readline()
+        while line:
+            tests.append(pack_test(inp, line))
+            line = inp.readline()
+    offset = 4 + 4 * len(tests)
+    blob = bytearray(struct.pack('<I', len(tests)))
+    for test in tests:
+        blob += struct.pack('<I', offset)
+        offset += len(test)
+    for test in tests:
+        blob += test
+    return blob
+
 #-------------------------------------------------------------------------------
 def gen_header(desc, out_hdr):
     with open(out_hdr, 'w') as outp:
@@ -17,73 +105,15 @@ def gen_header(desc, out_hdr):
         outp.write('// machine generated, do not edit!\n')
         for item in desc['files']:
             inp_path = os.path.dirname(out_hdr) + '/' + item['file']
-            inp_name = item['name']
-            outp.write('fuse_test_t {}[] = {{\n'.format(inp_name))
-            with open(inp_path, 'r') as inp:
-                line = inp.readline()
-                num_tests = 0
-                while line:
-                    outp.write('  {\n')
-                    num_tests += 1
-                    # desc (1 byte)
-                    val = line.split()[0]
-                    outp.write('    .desc = "{}",\n'.format(val))
-                    # optional events start with spaces
-                    line = inp.readline()
-                    if line[0] == ' ':
-                        num_events = 0
-                        outp.write('    .events = {\n')
-                        while line[0] == ' ':
-                            tok = line.split()
-                            if len(tok)==4:
-                                outp.write('      {{ .tick={}, .type=EVENT_{}, .addr=0x{}, .data=0x{} }},\n'.format(
-                                    tok[0], tok[1], tok[2], tok[3]
-                                ))
-                                num_events += 1
-                            line = inp.readline()
-                        outp.write('    },\n')
-                        outp.write('    .num_events = {},\n'.format(num_events));
-                    # 16-bit registers
-                    tok = line.split()
-                    outp.write('    .state = {\n')
-                    if len(tok) == 12:
-                        outp.write('      .af=0x{}, .bc=0x{}, .de=0x{}, .hl=0x{},\n'.format(tok[0], tok[1], tok[2], tok[3]))
-                        outp.write('      .af_=0x{}, .bc_=0x{}, .de_=0x{}, .hl_=0x{},\n'.format(tok[4], tok[5], tok[6], tok[7]))
-                        outp.write('      .ix=0x{}, .iy=0x{}, .sp=0x{}, .pc=0x{},\n'.format(tok[8], tok[9], tok[10], tok[11]))
-                    # additional registers and flags
-                    tok = inp.readline().split()
-                    if len(tok) == 7:
-                        outp.write('      .i=0x{}, .r=0x{}, .iff1={}, .iff2={}, .im={}, .halted={}, .ticks={}\n'.format(
-                            tok[0], tok[1], tok[2], tok[3], tok[4], tok[5], tok[6]
-                        ))
-                    outp.write('    },\n')
-                    # optional memory chunks
-                    num_chunks = 0
-                    tok = inp.readline().split()
-                    if len(tok) > 1:
-                        outp.write('    .chunks = {\n')
-                        while len(tok) > 0:
-                            if tok[0] != '-1':
-                                outp.write('      { ')
-                                outp.write('.addr=0x{}, .bytes = {{ '.format(tok[0]))
-                                i = 1
-                                while tok[i] != '-1':
-                                    outp.write('0x{},'.format(tok[i]))
-                                    i += 1
-                                outp.write('}}, .num_bytes={}, '.format(i-1))
-                                outp.write('},\n')
-                                num_chunks += 1
-                            tok = inp.readline().split()
-                        outp.write('    },\n')
-                    outp.write('    .num_chunks = {},\n'.format(num_chunks))
-                    outp.write('  },\n')
-                    line = inp.readline()
+            blob = pack_file(inp_path)
+            outp.write('static const uint8_t {}[{}] = {{\n'.format(item['name'], len(blob)))
+            for i in range(0, len(blob), 16):
+                outp.write('  ' + ''.join('0x{:02x},'.format(b) for b in blob[i:i+16]) + '\n')
             outp.write('};\n')
-            outp.write('const int {}_num = {};\n'.format(inp_name, num_tests))
 
 #-------------------------------------------------------------------------------
 def generate(input, out_src, out_hdr) :
     if genutil.isDirty(Version, [input], [out_hdr]) :
         with open(input, 'r') as f:
-            desc = yaml.load(f)
+            desc = yaml.safe_load(f)
         gen_header(desc, out_hdr)
@@ -0,0 +1,18 @@
+import os
+
+from mod import log, util, project, config
+
+#-------------------------------------------------------------------------------
+def run(fips_dir, proj_dir, args) :
+    cfg = config.get_default_config();
+    project.run(fips_dir, proj_dir, cfg, 'vice-testbench', args, None)
+
+#-------------------------------------------------------------------------------
+def help() :
+    log.info(log.YELLOW +
+        'fips vice-testbench\n' +
+        'fips vice-testbench via1 cia1 ...\n' +
+        'fips vice-testbench --junit report.xml\n' +
+        log.DEF +
+        '    run all or selected C64 and VIC-20 tests from the VICE test bench\n' +
+        '    and the Wolfgang Lorenz test suite headless (see tests/vice-testbench.txt)')
@@ -0,0 +1,642 @@
+//------------------------------------------------------------------------------
+//  chips-batch.c
+//
+//  Runs many independent headless emulator instances in parallel on all
+//  CPU cores (for regression corpora, automated screenshots, fuzzing...).
+//
+//  Each job creates its own system instance (see chips-bench-systems.h),
+//  optionally loads a file through the same loader path as the sokol
+//  frontends, runs for a fixed emulated duration, and optionally writes
+//  the final framebuffer as PPM image. The jobs are distributed over a
+//  work-stealing pool of worker threads (see jobpool.h).
+//
+//  Jobs are either read from a job file with one job per line:
+//
+//      system config file usecs [output.ppm]
+//
+//  ...where config and file can be '-' (first config of the system, no
+//  file), and lines starting with '#' are ignored, or a number of
+//  identical jobs is created from the command line with --system and
+//  --count.
+//
+//  Loaded files are read only once and shared by all jobs which load the
+//  same file (see imgcache.h), --cache-mb limits the memory used for files
+//  which are currently not in use.
+//
+//  Text files, keyboard input and keyboard-typed autostart commands
+//  (--input in chips-bench) are not supported since the keybuf helper
+//  isn't thread-safe, loaded programs are only started on systems which
+//  have a direct autostart function (e.g. the C64).
+//
+//  With --branches n, each job forks n copy-on-write clones of its system
+//  at the end of its run (see emufork.h, not available on Windows). Every
+//  branch runs for --branch-secs with a different key pressed each frame
+//  (branch 0 without input), and the number of distinct outcomes (by
+//  framebuffer hash) is reported per job.
+//
+//  Usage:
+//
+//  fips run chips-batch -- --jobs jobs.txt [--threads n] [--output results.csv]
+//  fips run chips-batch -- --system c64 --count 1000 [--file path] [--secs secs]
+//  fips run chips-batch -- --system c64 --count 1 --branches 64 [--branch-secs secs]
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>   // PRIu64
+#include <assert.h>
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#include "getopt.h"
+#include "jobpool.h"
+#include "emufork.h"
+#include "imgcache.h"
+#include "chips-bench-systems.h"
+// max number of jobs
+#define BATCH_MAX_JOBS (1<<20)
+// default emulated duration per job
+#define BATCH_DEFAULT_SECS (1.0)
+// max number of forked branches per job
+#define BATCH_MAX_BRANCHES (4096)
+// default emulated duration per branch
+#define BATCH_DEFAULT_BRANCH_SECS (1.0)
+
+typedef struct {
+    const bench_system_t* sys;
+    const char* path;                       // file to load, or 0
+    const char* output;                     // PPM screenshot path, or 0
+    uint32_t usec;                          // emulated duration after loading
+    // results
+    bool success;
+    int worker;
+    uint64_t ticks;
+    double host_secs;
+    int num_failed_branches;
+    int num_outcomes;                       // distinct branch outcomes
+} batch_job_t;
+
+// the result of a forked branch, returned from the child process
+typedef struct {
+    bool done;                              // false if the branch failed
+    uint32_t fb_hash;
+    uint64_t ticks;
+} batch_branch_result_t;
+
+// the running system a job's branches are forked from
+typedef struct {
+    const bench_system_t* sys;
+    void* sys_ptr;
+} batch_branch_context_t;
+
+// per-worker statistics, only written by the owning worker thread
+typedef struct {
+    uint64_t ticks;
+    double emu_secs;
+    double busy_secs;
+} batch_worker_t;
+
+static struct {
+    batch_job_t* jobs;
+    int num_jobs;
+    int max_jobs;
+    batch_worker_t workers[JOBPOOL_MAX_THREADS];
+    int num_workers;
+    int num_branches;
+    uint32_t branch_usec;
+    int branch_procs;                       // concurrent branches per job
+} state;
+
+// the keys pressed by the branches (cursor keys, space, return and digits),
+// branch 0 runs without input
+static const int batch_branch_keys[] = {
+    0x08, 0x09, 0x0A, 0x0B, 0x20, 0x0D, '0', '1', '2', '3', '4', '5', '6', '7', '8', '9'
+};
+#define BATCH_NUM_BRANCH_KEYS ((int)(sizeof(batch_branch_keys) / sizeof(int)))
+
+static char* batch_strdup(const char* str) {
+    const size_t len = strlen(str);
+    char* res = malloc(len + 1);
+    assert(res);
+    memcpy(res, str, len + 1);
+    return res;
+}
+
+// append a zero-initialized job, the job array grows as needed
+static batch_job_t* batch_add_job(void) {
+    assert(state.num_jobs < BATCH_MAX_JOBS);
+    if (state.num_jobs == state.max_jobs) {
+        state.max_jobs = state.max_jobs ? (state.max_jobs * 2) : 256;
+        state.jobs = realloc(state.jobs, (size_t)state.max_jobs * sizeof(batch_job_t));
+        assert(state.jobs);
+    }
+    batch_job_t* job = &state.jobs[state.num_jobs++];
+    memset(job, 0, sizeof(batch_job_t));
+    return job;
+}
+
+static const bench_system_t* batch_find_system(const char* name, const char* config) {
+    for (size_t i = 0; i < BENCH_NUM_SYSTEMS; i++) {
+        const bench_system_t* bs = &bench_systems[i];
+        if ((0 == strcmp(name, bs->name)) && (!config || (0 == strcmp(config, bs->config)))) {
+            return bs;
+        }
+    }
+    return 0;
+}
+
+static uint64_t batch_exec(const bench_system_t* bs, void* sys, uint32_t num_usec) {
+    uint64_t ticks = 0;
+    uint32_t usec = 0;
+    while (usec < num_usec) {
+        uint32_t slice = num_usec - usec;
+        if (slice > BENCH_FRAME_USEC) {
+            slice = BENCH_FRAME_USEC;
+        }
+        ticks += bs->exec(sys, slice);
+        usec += slice;
+    }
+    return ticks;
+}
+
+// write the visible area of the framebuffer as binary PPM image
+static bool batch_write_ppm(const char* path, chips_display_info_t info) {
+    const bool paletted = 0 != info.palette.ptr;
+    const size_t bytes_per_pixel = paletted ? 1 : 4;
+    if (!info.frame.buffer.ptr || (info.screen.width <= 0) || (info.screen.height <= 0)) {
+        return false;
+    }
+    if (((size_t)(info.screen.y + info.screen.height) * info.frame.dim.width * bytes_per_pixel) > info.frame.buffer.size) {
+        return false;
+    }
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        return false;
+    }
+    fprintf(fp, "P6\n%d %d\n255\n", info.screen.width, info.screen.height);
+    const uint8_t* pixels = (const uint8_t*) info.frame.buffer.ptr;
+    const uint32_t* palette = (const uint32_t*) info.palette.ptr;
+    const size_t num_colors = info.palette.size / sizeof(uint32_t);
+    for (int y = info.screen.y; y < (info.screen.y + info.screen.height); y++) {
+        for (int x = info.screen.x; x < (info.screen.x + info.screen.width); x++) {
+            const size_t offset = ((size_t)y * info.frame.dim.width + x) * bytes_per_pixel;
+            uint8_t rgb[3];
+            if (paletted) {
+                const uint8_t index = pixels[offset];
+                // palette entries are RGBA8 (0xAABBGGRR)
+                const uint32_t c = (index < num_colors) ? palette[index] : 0;
+                rgb[0] = (uint8_t)c;
+                rgb[1] = (uint8_t)(c >> 8);
+                rgb[2] = (uint8_t)(c >> 16);
+            }
+            else {
+                memcpy(rgb, &pixels[offset], 3);
+            }
+            fwrite(rgb, 1, 3, fp);
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+// FNV-1a hash of the framebuffer, or 0 if the system has no framebuffer
+static uint32_t batch_fb_hash(const bench_system_t* bs, void* sys) {
+    if (!bs->display_info) {
+        return 0;
+    }
+    const chips_display_info_t info = bs->display_info(sys);
+    const uint8_t* ptr = (const uint8_t*) info.frame.buffer.ptr;
+    uint32_t hash = 0x811C9DC5;
+    for (size_t i = 0; ptr && (i < info.frame.buffer.size); i++) {
+        hash = (hash ^ ptr[i]) * 0x01000193;
+    }
+    return hash;
+}
+
+// runs in a forked child process, see emufork.h for the restrictions
+static void batch_branch_func(int branch_index, void* result, void* user_data) {
+    const batch_branch_context_t* ctx = (const batch_branch_context_t*) user_data;
+    const bench_system_t* bs = ctx->sys;
+    const int key_code = (branch_index > 0) ? batch_branch_keys[(branch_index - 1) % BATCH_NUM_BRANCH_KEYS] : 0;
+    batch_branch_result_t* res = (batch_branch_result_t*) result;
+    uint32_t usec = 0;
+    while (usec < state.branch_usec) {
+        uint32_t slice = state.branch_usec - usec;
+        if (slice > BENCH_FRAME_USEC) {
+            slice = BENCH_FRAME_USEC;
+        }
+        if (key_code && bs->key) {
+            bs->key(ctx->sys_ptr, key_code);
+        }
+        res->ticks += bs->exec(ctx->sys_ptr, slice);
+        usec += slice;
+    }
+    res->fb_hash = batch_fb_hash(bs, ctx->sys_ptr);
+    res->done = true;
+}
+
+// fork the job's branches from its current system state
+static void batch_run_branches(batch_job_t* job, void* sys) {
+    batch_branch_result_t* results = calloc((size_t)state.num_branches, sizeof(batch_branch_result_t));
+    assert(results);
+    batch_branch_context_t ctx = { .sys = job->sys, .sys_ptr = sys };
+    const int num_ok = emufork_run(&(emufork_desc_t){
+        .num_branches = state.num_branches,
+        .max_procs = state.branch_procs,
+        .result_size = sizeof(batch_branch_result_t),
+        .results = results,
+        .func = batch_branch_func,
+        .user_data = &ctx,
+    });
+    job->num_failed_branches = state.num_branches - num_ok;
+    job->num_outcomes = 0;
+    for (int i = 0; i < state.num_branches; i++) {
+        const batch_branch_result_t* res = &results[i];
+        if (!res->done) {
+            continue;
+        }
+        job->ticks += res->ticks;
+        bool is_new = true;
+        for (int j = 0; j < i; j++) {
+            if (results[j].done && (results[j].fb_hash == res->fb_hash)) {
+                is_new = false;
+                break;
+            }
+        }
+        if (is_new) {
+            job->num_outcomes++;
+        }
+    }
+    free(results);
+}
+
+static bool batch_run_job(batch_job_t* job) {
+    const bench_system_t* bs = job->sys;
+    void* sys = calloc(1, bs->size);
+    if (!sys) {
+        fprintf(stderr, "failed to allocate %zu bytes for system '%s'\n", bs->size, bs->name);
+        return false;
+    }
+    bs->init(sys);
+    bool success = true;
+    if (job->path) {
+        job->ticks += batch_exec(bs, sys, bs->load_delay_frames * BENCH_FRAME_USEC);
+        char ext[16];
+        bench_file_ext(job->path, ext, sizeof(ext));
+        const imgcache_file_t* file = imgcache_acquire(job->path);
+        if (file && bs->load(sys, ext, file->data)) {
+            if (bs->autostart) {
+                bs->autostart(sys, ext);
+            }
+        }
+        else {
+            fprintf(stderr, "failed to load '%s' into system '%s'\n", job->path, bs->name);
+            success = false;
+        }
+        imgcache_release(file);
+    }
+    if (success) {
+        job->ticks += batch_exec(bs, sys, job->usec);
+        if (job->output && !batch_write_ppm(job->output, bs->display_info(sys))) {
+            fprintf(stderr, "failed to write screenshot '%s'\n", job->output);
+            success = false;
+        }
+    }
+    if (success && (state.num_branches > 0)) {
+        batch_run_branches(job, sys);
+        if (job->num_failed_branches > 0) {
+            fprintf(stderr, "%d branch(es) of system '%s' failed\n", job->num_failed_branches, bs->name);
+            success = false;
+        }
+    }
+    bs->discard(sys);
+    free(sys);
+    return success;
+}
+
+static void batch_job_func(int job_index, int worker_index, void* user_data) {
+    (void)user_data;
+    batch_job_t* job = &state.jobs[job_index];
+    batch_worker_t* w = &state.workers[worker_index];
+    const uint64_t start = stm_now();
+    job->success = batch_run_job(job);
+    job->host_secs = stm_sec(stm_since(start));
+    job->worker = worker_index;
+    w->ticks += job->ticks;
+    w->emu_secs += (job->path ? (job->sys->load_delay_frames * BENCH_FRAME_USEC) : 0) / 1000000.0;
+    w->emu_secs += job->usec / 1000000.0;
+    w->emu_secs += ((double)state.num_branches * state.branch_usec) / 1000000.0;
+    w->busy_secs += job->host_secs;
+}
+
+// parse a job file, see header comment for the format
+static bool batch_load_jobs(const char* path) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "failed to open job file '%s'\n", path);
+        return false;
+    }
+    char line[1024];
+    int line_nr = 0;
+    bool success = true;
+    while (success && fgets(line, sizeof(line), fp)) {
+        line_nr++;
+        char name[32], config[32], file[512], output[512];
+        double usec;
+        int res = sscanf(line, "%31s %31s %511s %lf %511s", name, config, file, &usec, output);
+        if ((res <= 0) || (name[0] == '#')) {
+            continue;
+        }
+        if (res < 4) {
+            fprintf(stderr, "%s:%d: expected 'system config file usecs [output]'\n", path, line_nr);
+            success = false;
+        }
+        else if (state.num_jobs >= BATCH_MAX_JOBS) {
+            fprintf(stderr, "%s:%d: too many jobs (max %d)\n", path, line_nr, BATCH_MAX_JOBS);
+            success = false;
+        }
+        else if ((usec < 0.0) || (usec > 3600000000.0)) {
+            fprintf(stderr, "%s:%d: emulated usecs out of range\n", path, line_nr);
+            success = false;
+        }
+        else {
+            const char* cfg = (0 == strcmp(config, "-")) ? 0 : config;
+            const bench_system_t* bs = batch_find_system(name, cfg);
+            if (!bs) {
+                fprintf(stderr, "%s:%d: unknown system '%s' (%s)\n", path, line_nr, name, config);
+                success = false;
+            }
+            else if ((0 != strcmp(file, "-")) && !bs->load) {
+                fprintf(stderr, "%s:%d: system '%s' can't load files\n", path, line_nr, name);
+                success = false;
+            }
+            else if ((res == 5) && !bs->display_info) {
+                fprintf(stderr, "%s:%d: system '%s' has no framebuffer\n", path, line_nr, name);
+                success = false;
+            }
+            else {
+                batch_job_t* job = batch_add_job();
+                job->sys = bs;
+                job->path = (0 == strcmp(file, "-")) ? 0 : batch_strdup(file);
+                job->output = (res == 5) ? batch_strdup(output) : 0;
+                job->usec = (uint32_t)usec;
+            }
+        }
+    }
+    fclose(fp);
+    return success;
+}
+
+static void batch_write_csv(FILE* fp) {
+    fprintf(fp, "job,system,config,file,usecs,worker,success,ticks,host_secs,branches,failed_branches,outcomes\n");
+    for (int i = 0; i < state.num_jobs; i++) {
+        const batch_job_t* job = &state.jobs[i];
+        fprintf(fp, "%d,%s,%s,%s,%u,%d,%d,%"PRIu64",%.6f,%d,%d,%d\n",
+            i,
+            job->sys->name,
+            job->sys->config,
+            job->path ? job->path : "-",
+            job->usec,
+            job->worker,
+            job->success ? 1 : 0,
+            job->ticks,
+            job->host_secs,
+            state.num_branches,
+            job->num_failed_branches,
+            job->num_outcomes);
+    }
+}
+
+static const getopt_option_t option_list[] = {
+    { "help", 'h', GETOPT_OPTION_TYPE_NO_ARG, 0, 'h', "print this help text", 0 },
+    { "jobs", 'j', GETOPT_OPTION_TYPE_REQUIRED, 0, 'j', "read jobs from file", "file" },
+    { "system", 's', GETOPT_OPTION_TYPE_REQUIRED, 0, 's', "system for --count jobs", "name" },
+    { "config", 'c', GETOPT_OPTION_TYPE_REQUIRED, 0, 'c', "system config for --count jobs", "config" },
+    { "count", 'n', GETOPT_OPTION_TYPE_REQUIRED, 0, 'n', "number of identical jobs", "n" },
+    { "file", 'F', GETOPT_OPTION_TYPE_REQUIRED, 0, 'F', "file to load for --count jobs", "path" },
+    { "secs", 't', GETOPT_OPTION_TYPE_REQUIRED, 0, 't', "emulated seconds for --count jobs (default: 1)", "secs" },
+    { "threads", 'p', GETOPT_OPTION_TYPE_REQUIRED, 0, 'p', "number of worker threads (default: number of cores)", "n" },
+    { "output", 'o', GETOPT_OPTION_TYPE_REQUIRED, 0, 'o', "write per-job results as CSV", "file" },
+    { "branches", 'b', GETOPT_OPTION_TYPE_REQUIRED, 0, 'b', "fork n branches per job at the end of its run", "n" },
+    { "branch-secs", 'B', GETOPT_OPTION_TYPE_REQUIRED, 0, 'B', "emulated seconds per branch (default: 1)", "secs" },
+    { "cache-mb", 'm', GETOPT_OPTION_TYPE_REQUIRED, 0, 'm', "memory budget for cached files not in use (default: 256)", "mbytes" },
+    GETOPT_OPTIONS_END
+};
+
+static char help_buf[2048];
+
+int main(int argc, const char** argv) {
+    const char* jobs_path = 0;
+    const char* system_name = 0;
+    const char* config = 0;
+    const char* file_path = 0;
+    const char* output_path = 0;
+    int count = 0;
+    double secs = BATCH_DEFAULT_SECS;
+    double branch_secs = BATCH_DEFAULT_BRANCH_SECS;
+    int cache_mb = IMGCACHE_DEFAULT_MAX_BYTES / (1024 * 1024);
+    int num_threads = jobpool_num_cores();
+    getopt_context_t ctx;
+    if (getopt_create_context(&ctx, argc, argv, option_list) < 0) {
+        fprintf(stderr, "getopt_create_context() failed!\n");
+        return 10;
+    }
+    int opt;
+    while ((opt = getopt_next(&ctx)) != -1) {
+        switch (opt) {
+            case '+':
+                fprintf(stderr, "got argument without flag: %s\n", ctx.current_opt_arg);
+                return 10;
+            case '?':
+                fprintf(stderr, "unknown flag %s\n", ctx.current_opt_arg);
+                return 10;
+            case '!':
+                fprintf(stderr, "invalid use of flag %s\n", ctx.current_opt_arg);
+                return 10;
+            case 'h':
+                fprintf(stderr, "chips-batch -- run headless emulator jobs on all cores\n\n");
+                fprintf(stderr, "%s", getopt_create_help_string(&ctx, help_buf, sizeof(help_buf)));
+                return 0;
+            case 'j':
+                jobs_path = ctx.current_opt_arg;
+                break;
+            case 's':
+                system_name = ctx.current_opt_arg;
+                break;
+            case 'c':
+                config = ctx.current_opt_arg;
+                break;
+            case 'n':
+                count = atoi(ctx.current_opt_arg);
+                break;
+            case 'F':
+                file_path = ctx.current_opt_arg;
+                break;
+            case 't':
+                secs = atof(ctx.current_opt_arg);
+                break;
+            case 'p':
+                num_threads = atoi(ctx.current_opt_arg);
+                break;
+            case 'o':
+                output_path = ctx.current_opt_arg;
+                break;
+            case 'b':
+                state.num_branches = atoi(ctx.current_opt_arg);
+                break;
+            case 'B':
+                branch_secs = atof(ctx.current_opt_arg);
+                break;
+            case 'm':
+                cache_mb = atoi(ctx.current_opt_arg);
+                break;
+            default:
+                break;
+        }
+    }
+    if ((num_threads < 1) || (num_threads > JOBPOOL_MAX_THREADS)) {
+        fprintf(stderr, "number of threads must be in range [1, %d]\n", JOBPOOL_MAX_THREADS);
+        return 10;
+    }
+    if ((state.num_branches < 0) || (state.num_branches > BATCH_MAX_BRANCHES)) {
+        fprintf(stderr, "number of branches must be in range [0, %d]\n", BATCH_MAX_BRANCHES);
+        return 10;
+    }
+    if ((state.num_branches > 0) && !emufork_supported()) {
+        fprintf(stderr, "--branches is not supported on this platform\n");
+        return 10;
+    }
+    if ((branch_secs <= 0.0) || (branch_secs > 3600.0)) {
+        fprintf(stderr, "emulated seconds per branch must be in range (0, 3600]\n");
+        return 10;
+    }
+    state.branch_usec = (uint32_t)(branch_secs * 1000000.0);
+    if ((cache_mb < 1) || (cache_mb > (1 << 20))) {
+        fprintf(stderr, "file cache size must be in range [1, %d] mbytes\n", 1 << 20);
+        return 10;
+    }
+    if (!jobs_path == !system_name) {
+        fprintf(stderr, "either --jobs or --system is required\n");
+        return 10;
+    }
+    if (jobs_path) {
+        if (!batch_load_jobs(jobs_path)) {
+            return 10;
+        }
+    }
+    else {
+        if ((count < 1) || (count > BATCH_MAX_JOBS)) {
+            fprintf(stderr, "job count must be in range [1, %d]\n", BATCH_MAX_JOBS);
+            return 10;
+        }
+        if ((secs <= 0.0) || (secs > 3600.0)) {
+            fprintf(stderr, "emulated seconds must be in range (0, 3600]\n");
+            return 10;
+        }
+        const bench_system_t* bs = batch_find_system(system_name, config);
+        if (!bs) {
+            fprintf(stderr, "unknown system '%s'\n", system_name);
+            return 10;
+        }
+        if (file_path && !bs->load) {
+            fprintf(stderr, "system '%s' can't load files\n", system_name);
+            return 10;
+        }
+        for (int i = 0; i < count; i++) {
+            batch_job_t* job = batch_add_job();
+            job->sys = bs;
+            job->path = file_path;
+            job->usec = (uint32_t)(secs * 1000000.0);
+        }
+    }
+    if (0 == state.num_jobs) {
+        fprintf(stderr, "no jobs to run\n");
+        return 10;
+    }
+
+    stm_setup();
+    const int num_used_threads = (num_threads < state.num_jobs) ? num_threads : state.num_jobs;
+    // cores not used by a worker thread run forked branches instead
+    state.branch_procs = jobpool_num_cores() / num_used_threads;
+    if (state.branch_procs < 1) {
+        state.branch_procs = 1;
+    }
+    printf("== running %d job(s) on %d thread(s)\n\n", state.num_jobs, num_used_threads);
+    imgcache_init(&(imgcache_desc_t){
+        .max_bytes = (size_t)cache_mb * 1024 * 1024,
+        .read_file = bench_read_file,
+    });
+    const uint64_t start = stm_now();
+    state.num_workers = jobpool_run(&(jobpool_desc_t){
+        .num_jobs = state.num_jobs,
+        .num_threads = num_threads,
+        .func = batch_job_func,
+    });
+    const double wall_secs = stm_sec(stm_since(start));
+    const imgcache_stats_t cache_stats = imgcache_stats();
+    imgcache_shutdown();
+
+    // per-worker throughput, 'speedup' is emulated seconds per busy host second
+    printf("%-6s %8s %8s %10s %10s %10s %10s\n", "worker", "jobs", "steals", "busy", "emu secs", "emu MHz", "speedup");
+    int num_failed = 0;
+    uint64_t total_ticks = 0;
+    double total_emu_secs = 0.0;
+    for (int i = 0; i < state.num_workers; i++) {
+        const batch_worker_t* w = &state.workers[i];
+        printf("%-6d %8d %8d %10.3f %10.3f %10.2f %9.2fx\n",
+            i,
+            jobpool_num_jobs(i),
+            jobpool_num_steals(i),
+            w->busy_secs,
+            w->emu_secs,
+            (w->busy_secs > 0.0) ? (w->ticks / w->busy_secs / 1000000.0) : 0.0,
+            (w->busy_secs > 0.0) ? (w->emu_secs / w->busy_secs) : 0.0);
+        total_ticks += w->ticks;
+        total_emu_secs += w->emu_secs;
+    }
+    for (int i = 0; i < state.num_jobs; i++) {
+        if (!state.jobs[i].success) {
+            num_failed++;
+        }
+    }
+    printf("\n%d job(s) in %.3f secs (%.1f jobs/sec), %.2f emulated secs per host sec (%.2f per thread), %.2f emulated MHz total\n",
+        state.num_jobs,
+        wall_secs,
+        state.num_jobs / wall_secs,
+        total_emu_secs / wall_secs,
+        total_emu_secs / wall_secs / state.num_workers,
+        total_ticks / wall_secs / 1000000.0);
+    if (state.num_branches > 0) {
+        int total_outcomes = 0;
+        for (int i = 0; i < state.num_jobs; i++) {
+            total_outcomes += state.jobs[i].num_outcomes;
+        }
+        printf("%d branch(es) per job, %.1f distinct outcomes per job on average\n",
+            state.num_branches,
+            (double)total_outcomes / state.num_jobs);
+    }
+    if ((cache_stats.num_hits + cache_stats.num_reads) > 0) {
+        printf("%" PRIu64 " file load(s) from cache, %" PRIu64 " file(s) read (%.2f MBytes), %" PRIu64 " shared by content, %" PRIu64 " evicted\n",
+            cache_stats.num_hits,
+            cache_stats.num_reads,
+            cache_stats.bytes_read / (1024.0 * 1024.0),
+            cache_stats.num_shared,
+            cache_stats.num_evicted);
+    }
+
+    if (output_path) {
+        FILE* fp = fopen(output_path, "w");
+        if (!fp) {
+            fprintf(stderr, "failed to open output file '%s'\n", output_path);
+            return 10;
+        }
+        batch_write_csv(fp);
+        fclose(fp);
+    }
+    if (num_failed > 0) {
+        printf("%d job(s) FAILED\n", num_failed);
+        return 10;
+    }
+    return 0;
+}
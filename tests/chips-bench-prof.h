@@ -0,0 +1,165 @@
+#pragma once
+//------------------------------------------------------------------------------
+//  chips-bench-prof.h
+//
+//  Per-chip host time attribution for chips-bench (only used when
+//  compiled with CHIPS_BENCH_PROF, see the chips-bench-prof target).
+//
+//  This header must be included after the chips/*.h implementations and
+//  before the systems/*.h implementations. It redefines the chip tick
+//  functions as macros which wrap each call in a sampling scoped timer,
+//  so that the per-tick calls made by the system emulators are
+//  attributed to a chip category. A function-like macro isn't expanded
+//  again inside its own expansion, so the wrapped call still goes to the
+//  original function.
+//
+//  Timing each call would cost more than most of the chip tick functions
+//  themselves, so only a pseudo-random subset of calls (1 in
+//  BENCH_PROF_SAMPLE_INTERVAL on average, randomized to avoid aliasing
+//  with periodic emulator activity like video scanlines) is timed, and
+//  the sampled time is extrapolated to all calls. The timer overhead
+//  is measured in bench_prof_setup() and subtracted from each sample.
+//
+//  The c1541 floppy drive is attributed as a whole (CPU and VIAs),
+//  systems/c1541.h must be included before this header so that the
+//  drive's internal chip calls are not wrapped.
+//------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BENCH_PROF_RDTSC
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define BENCH_PROF_RDTSC
+#endif
+
+typedef enum {
+    BENCH_PROF_CPU,
+    BENCH_PROF_VIDEO,
+    BENCH_PROF_AUDIO,
+    BENCH_PROF_IO,
+    BENCH_PROF_DRIVE,
+    BENCH_PROF_NUM,
+} bench_prof_cat_t;
+
+static const char* bench_prof_names[BENCH_PROF_NUM] = {
+    "cpu", "video", "audio", "io", "c1541"
+};
+
+// average number of calls between two timed calls
+#define BENCH_PROF_SAMPLE_INTERVAL (16)
+
+static struct {
+    uint32_t rand;
+    double overhead;                        // timer overhead per sample in counter units
+    uint32_t countdown[BENCH_PROF_NUM];
+    bool sampling[BENCH_PROF_NUM];
+    uint64_t start[BENCH_PROF_NUM];
+    uint64_t calls[BENCH_PROF_NUM];
+    uint64_t samples[BENCH_PROF_NUM];
+    uint64_t sample_time[BENCH_PROF_NUM];
+} bench_prof;
+
+// a cheap high-resolution counter, the unit doesn't matter since
+// the results are reported relative to the total measured counter time
+static inline uint64_t bench_prof_counter(void) {
+    #if defined(BENCH_PROF_RDTSC)
+    return __rdtsc();
+    #else
+    return stm_now();
+    #endif
+}
+
+// xorshift32, returns a countdown in range [1, 2*BENCH_PROF_SAMPLE_INTERVAL-1]
+static inline uint32_t bench_prof_next_countdown(void) {
+    uint32_t x = bench_prof.rand;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bench_prof.rand = x;
+    return 1 + (x % (2 * BENCH_PROF_SAMPLE_INTERVAL - 1));
+}
+
+static inline void bench_prof_begin(bench_prof_cat_t cat) {
+    bench_prof.calls[cat]++;
+    if (--bench_prof.countdown[cat] == 0) {
+        bench_prof.countdown[cat] = bench_prof_next_countdown();
+        bench_prof.sampling[cat] = true;
+        bench_prof.start[cat] = bench_prof_counter();
+    }
+}
+
+static inline void bench_prof_end(bench_prof_cat_t cat) {
+    if (bench_prof.sampling[cat]) {
+        bench_prof.sample_time[cat] += bench_prof_counter() - bench_prof.start[cat];
+        bench_prof.samples[cat]++;
+        bench_prof.sampling[cat] = false;
+    }
+}
+
+static inline uint64_t bench_prof_end_pins(bench_prof_cat_t cat, uint64_t pins) {
+    bench_prof_end(cat);
+    return pins;
+}
+
+static inline bool bench_prof_end_bool(bench_prof_cat_t cat, bool res) {
+    bench_prof_end(cat);
+    return res;
+}
+
+// reset the accumulated call and sample counters
+static void bench_prof_reset(void) {
+    for (int i = 0; i < BENCH_PROF_NUM; i++) {
+        bench_prof.countdown[i] = bench_prof_next_countdown();
+        bench_prof.sampling[i] = false;
+        bench_prof.calls[i] = 0;
+        bench_prof.samples[i] = 0;
+        bench_prof.sample_time[i] = 0;
+    }
+}
+
+// measure the overhead of an empty sampled scope
+static void bench_prof_setup(void) {
+    bench_prof.rand = 0x12345678;
+    bench_prof_reset();
+    for (int i = 0; i < 1000000; i++) {
+        bench_prof_begin(BENCH_PROF_CPU);
+        bench_prof_end(BENCH_PROF_CPU);
+    }
+    bench_prof.overhead = (double)bench_prof.sample_time[BENCH_PROF_CPU] / (double)bench_prof.samples[BENCH_PROF_CPU];
+    bench_prof_reset();
+}
+
+// estimated time spent in a category (in counter units), extrapolated from the samples
+static double bench_prof_estimate(bench_prof_cat_t cat) {
+    if (0 == bench_prof.samples[cat]) {
+        return 0.0;
+    }
+    double t = (double)bench_prof.sample_time[cat] - (bench_prof.overhead * (double)bench_prof.samples[cat]);
+    if (t < 0.0) {
+        t = 0.0;
+    }
+    return t * ((double)bench_prof.calls[cat] / (double)bench_prof.samples[cat]);
+}
+
+#define BENCH_PROF_WRAP_PINS(cat, call) (bench_prof_begin(cat), bench_prof_end_pins(cat, call))
+#define BENCH_PROF_WRAP_BOOL(cat, call) (bench_prof_begin(cat), bench_prof_end_bool(cat, call))
+#define BENCH_PROF_WRAP_VOID(cat, call) (bench_prof_begin(cat), call, bench_prof_end(cat))
+
+#define m6502_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_CPU, m6502_tick(__VA_ARGS__))
+#define z80_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_CPU, z80_tick(__VA_ARGS__))
+#define m6569_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_VIDEO, m6569_tick(__VA_ARGS__))
+#define m6561_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_VIDEO, m6561_tick(__VA_ARGS__))
+#define mc6845_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_VIDEO, mc6845_tick(__VA_ARGS__))
+#define mc6847_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_VIDEO, mc6847_tick(__VA_ARGS__))
+#define am40010_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_VIDEO, am40010_tick(__VA_ARGS__))
+#define m6581_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_AUDIO, m6581_tick(__VA_ARGS__))
+#define ay38910_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_AUDIO, ay38910_tick(__VA_ARGS__))
+#define beeper_tick(...) BENCH_PROF_WRAP_BOOL(BENCH_PROF_AUDIO, beeper_tick(__VA_ARGS__))
+#define m6526_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_IO, m6526_tick(__VA_ARGS__))
+#define m6522_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_IO, m6522_tick(__VA_ARGS__))
+#define i8255_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_IO, i8255_tick(__VA_ARGS__))
+#define z80pio_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_IO, z80pio_tick(__VA_ARGS__))
+#define z80ctc_tick(...) BENCH_PROF_WRAP_PINS(BENCH_PROF_IO, z80ctc_tick(__VA_ARGS__))
+#define c1541_tick(...) BENCH_PROF_WRAP_VOID(BENCH_PROF_DRIVE, c1541_tick(__VA_ARGS__))
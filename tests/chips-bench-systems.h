@@ -0,0 +1,864 @@
+#pragma once
+//------------------------------------------------------------------------------
+//  chips-bench-systems.h
+//
+//  The emulated systems used by chips-bench and chips-batch, each behind a
+//  small set of type-erased callbacks. Each system is initialized with
+//  its embedded ROMs and a throw-away audio callback (so that video and
+//  audio generation isn't skipped).
+//
+//  This header contains the chips implementations (CHIPS_IMPL) and must
+//  only be included once per executable.
+//
+//  The KC85 models and the Namco arcade machines are compile-time variants
+//  of the same emulator code, so only one of each can live in the same
+//  executable. By default the KC85/4 and Pacman are included, with
+//  CHIPS_BENCH_VARIANT defined only the configured variant system is
+//  included.
+//------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+
+#if defined(CHIPS_BENCH_VARIANT)
+    // variant builds only contain the compile-time configured systems
+    #if defined(CHIPS_KC85_TYPE_2) || defined(CHIPS_KC85_TYPE_3) || defined(CHIPS_KC85_TYPE_4)
+        #define BENCH_USE_KC85
+    #endif
+    #if defined(NAMCO_PACMAN) || defined(NAMCO_PENGO)
+        #define BENCH_USE_NAMCO
+    #endif
+#else
+    #define BENCH_USE_C64
+    #define BENCH_USE_VIC20
+    #define BENCH_USE_CPC
+    #define BENCH_USE_ZX
+    #define BENCH_USE_KC85
+    #define BENCH_USE_ATOM
+    #define BENCH_USE_Z1013
+    #define BENCH_USE_Z9001
+    #define BENCH_USE_BOMBJACK
+    #define BENCH_USE_NAMCO
+    #define BENCH_USE_LC80
+    #if !defined(CHIPS_KC85_TYPE_2) && !defined(CHIPS_KC85_TYPE_3) && !defined(CHIPS_KC85_TYPE_4)
+        #define CHIPS_KC85_TYPE_4
+    #endif
+    #if !defined(NAMCO_PACMAN) && !defined(NAMCO_PENGO)
+        #define NAMCO_PACMAN
+    #endif
+#endif
+
+#define CHIPS_IMPL
+#include "chips/chips_common.h"
+#include "chips/m6502.h"
+#include "chips/m6522.h"
+#include "chips/m6526.h"
+#include "chips/m6561.h"
+#include "chips/m6569.h"
+#include "chips/m6581.h"
+#include "chips/mc6847.h"
+#include "chips/z80.h"
+#include "chips/z80ctc.h"
+#include "chips/z80pio.h"
+#include "chips/ay38910.h"
+#include "chips/i8255.h"
+#include "chips/mc6845.h"
+#include "chips/am40010.h"
+#include "chips/upd765.h"
+#include "chips/beeper.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/clk.h"
+#include "chips/fdd.h"
+#include "chips/fdd_cpc.h"
+#if defined(BENCH_USE_C64) || defined(BENCH_USE_VIC20)
+#include "systems/c1530.h"
+#endif
+#if defined(BENCH_USE_C64)
+#include "systems/c1541.h"
+#endif
+#if defined(CHIPS_BENCH_PROF)
+#include "chips-bench-prof.h"
+#endif
+#if defined(BENCH_USE_C64)
+#include "systems/c64.h"
+#include "c64-roms.h"
+#include "c1541-roms.h"
+#endif
+#if defined(BENCH_USE_VIC20)
+#include "systems/vic20.h"
+#include "vic20-roms.h"
+#endif
+#if defined(BENCH_USE_CPC)
+#include "systems/cpc.h"
+#include "cpc-roms.h"
+#endif
+#if defined(BENCH_USE_ZX)
+#include "systems/zx.h"
+#include "zx-roms.h"
+#endif
+#if defined(BENCH_USE_KC85)
+#include "systems/kc85.h"
+#include "kc85-roms.h"
+#endif
+#if defined(BENCH_USE_ATOM)
+#include "systems/atom.h"
+#include "atom-roms.h"
+#endif
+#if defined(BENCH_USE_Z1013)
+#include "systems/z1013.h"
+#include "z1013-roms.h"
+#endif
+#if defined(BENCH_USE_Z9001)
+#include "systems/z9001.h"
+#include "z9001-roms.h"
+#endif
+#if defined(BENCH_USE_BOMBJACK)
+#include "systems/bombjack.h"
+#include "bombjack-roms.h"
+#endif
+#if defined(BENCH_USE_NAMCO)
+#include "systems/namco.h"
+#if defined(NAMCO_PACMAN)
+#include "pacman-roms.h"
+#else
+#include "pengo-roms.h"
+#endif
+#endif
+#if defined(BENCH_USE_LC80)
+#include "systems/lc80.h"
+#include "lc80-roms.h"
+#endif
+
+// run the emulators in 60Hz frame slices, like the sokol frontends
+#define BENCH_FRAME_USEC (16667)
+
+// a system is benchmarked through a small set of type-erased callbacks
+typedef struct {
+    const char* name;
+    const char* config;
+    size_t size;                            // size of the system struct
+    void (*init)(void* sys);
+    uint32_t (*exec)(void* sys, uint32_t micro_seconds);
+    void (*discard)(void* sys);
+    // optional, load a file through the same path as the sokol frontends
+    bool (*load)(void* sys, const char* ext, chips_range_t data);
+    // optional, start a loaded program if no keyboard input was provided
+    void (*autostart)(void* sys, const char* ext);
+    // optional, keyboard input to type for starting a loaded program
+    const char* (*autostart_input)(const char* ext);
+    // optional, send a key press and release
+    void (*key)(void* sys, int key_code);
+    // optional, send a separate key press or release (same key codes as the sokol frontends)
+    void (*key_down)(void* sys, int key_code);
+    void (*key_up)(void* sys, int key_code);
+    // optional, get the current framebuffer
+    chips_display_info_t (*display_info)(void* sys);
+    uint32_t load_delay_frames;             // frames to run before loading a file
+    int key_delay_frames;                   // keybuf delay between key presses
+} bench_system_t;
+
+static void dummy_audio_callback(const float* samples, int num_samples, void* user_data) {
+    (void)samples;
+    (void)num_samples;
+    (void)user_data;
+}
+
+#define BENCH_AUDIO { .callback = { .func = dummy_audio_callback } }
+
+#if defined(BENCH_USE_C64)
+static c64_desc_t c64_bench_desc(bool c1541_enabled) {
+    return (c64_desc_t){
+        .c1541_enabled = c1541_enabled,
+        .audio = BENCH_AUDIO,
+        .roms = {
+            .chars = { .ptr=dump_c64_char_bin, .size=sizeof(dump_c64_char_bin) },
+            .basic = { .ptr=dump_c64_basic_bin, .size=sizeof(dump_c64_basic_bin) },
+            .kernal = { .ptr=dump_c64_kernalv3_bin, .size=sizeof(dump_c64_kernalv3_bin) },
+            .c1541 = {
+                .c000_dfff = { .ptr=dump_1541_c000_325302_01_bin, .size=sizeof(dump_1541_c000_325302_01_bin) },
+                .e000_ffff = { .ptr=dump_1541_e000_901229_06aa_bin, .size=sizeof(dump_1541_e000_901229_06aa_bin) },
+            }
+        }
+    };
+}
+static void c64_bench_init(void* sys) {
+    c64_desc_t desc = c64_bench_desc(false);
+    c64_init(sys, &desc);
+}
+static void c64_c1541_bench_init(void* sys) {
+    c64_desc_t desc = c64_bench_desc(true);
+    c64_init(sys, &desc);
+}
+static uint32_t c64_bench_exec(void* sys, uint32_t micro_seconds) {
+    return c64_exec(sys, micro_seconds);
+}
+static void c64_bench_discard(void* sys) {
+    c64_discard(sys);
+}
+static chips_display_info_t c64_bench_display_info(void* sys) {
+    return c64_display_info(sys);
+}
+static bool c64_bench_load(void* sys, const char* ext, chips_range_t data) {
+    if (0 == strcmp(ext, "tap")) {
+        if (c64_insert_tape(sys, data)) {
+            c64_tape_play(sys);
+            return true;
+        }
+        return false;
+    }
+    return c64_quickload(sys, data);
+}
+static void c64_bench_autostart(void* sys, const char* ext) {
+    if (0 == strcmp(ext, "tap")) {
+        c64_basic_load(sys);
+    }
+    else if (0 == strcmp(ext, "prg")) {
+        c64_basic_run(sys);
+    }
+}
+static void c64_bench_key(void* sys, int key_code) {
+    c64_key_down(sys, key_code);
+    c64_key_up(sys, key_code);
+}
+static void c64_bench_key_down(void* sys, int key_code) {
+    c64_key_down(sys, key_code);
+}
+static void c64_bench_key_up(void* sys, int key_code) {
+    c64_key_up(sys, key_code);
+}
+#endif
+
+#if defined(BENCH_USE_VIC20)
+static void vic20_bench_init(void* sys) {
+    vic20_init(sys, &(vic20_desc_t){
+        .mem_config = VIC20_MEMCONFIG_STANDARD,
+        .audio = BENCH_AUDIO,
+        .roms = {
+            .chars = { .ptr=dump_vic20_characters_901460_03_bin, .size=sizeof(dump_vic20_characters_901460_03_bin) },
+            .basic = { .ptr=dump_vic20_basic_901486_01_bin, .size=sizeof(dump_vic20_basic_901486_01_bin) },
+            .kernal = { .ptr=dump_vic20_kernal_901486_07_bin, .size=sizeof(dump_vic20_kernal_901486_07_bin) },
+        }
+    });
+}
+static uint32_t vic20_bench_exec(void* sys, uint32_t micro_seconds) {
+    return vic20_exec(sys, micro_seconds);
+}
+static void vic20_bench_discard(void* sys) {
+    vic20_discard(sys);
+}
+static chips_display_info_t vic20_bench_display_info(void* sys) {
+    return vic20_display_info(sys);
+}
+static bool vic20_bench_load(void* sys, const char* ext, chips_range_t data) {
+    if (0 == strcmp(ext, "tap")) {
+        if (vic20_insert_tape(sys, data)) {
+            vic20_tape_play(sys);
+            return true;
+        }
+        return false;
+    }
+    return vic20_quickload(sys, data);
+}
+static const char* vic20_bench_autostart_input(const char* ext) {
+    if (0 == strcmp(ext, "tap")) {
+        return "LOAD\n";
+    }
+    else if (0 == strcmp(ext, "prg")) {
+        return "RUN\n";
+    }
+    return 0;
+}
+static void vic20_bench_key(void* sys, int key_code) {
+    vic20_key_down(sys, key_code);
+    vic20_key_up(sys, key_code);
+}
+static void vic20_bench_key_down(void* sys, int key_code) {
+    vic20_key_down(sys, key_code);
+}
+static void vic20_bench_key_up(void* sys, int key_code) {
+    vic20_key_up(sys, key_code);
+}
+#endif
+
+#if defined(BENCH_USE_CPC)
+static void cpc_bench_init_type(void* sys, cpc_type_t type) {
+    cpc_init(sys, &(cpc_desc_t){
+        .type = type,
+        .audio = BENCH_AUDIO,
+        .roms = {
+            .cpc464 = {
+                .os = { .ptr=dump_cpc464_os_bin, .size=sizeof(dump_cpc464_os_bin) },
+                .basic = { .ptr=dump_cpc464_basic_bin, .size=sizeof(dump_cpc464_basic_bin) },
+            },
+            .cpc6128 = {
+                .os = { .ptr=dump_cpc6128_os_bin, .size=sizeof(dump_cpc6128_os_bin) },
+                .basic = { .ptr=dump_cpc6128_basic_bin, .size= sizeof(dump_cpc6128_basic_bin) },
+                .amsdos = { .ptr=dump_cpc6128_amsdos_bin, .size=sizeof(dump_cpc6128_amsdos_bin) }
+            },
+            .kcc = {
+                .os = { .ptr=dump_kcc_os_bin, .size=sizeof(dump_kcc_os_bin) },
+                .basic = { .ptr=dump_kcc_bas_bin, .size=sizeof(dump_kcc_bas_bin) }
+            },
+        }
+    });
+}
+static void cpc464_bench_init(void* sys) {
+    cpc_bench_init_type(sys, CPC_TYPE_464);
+}
+static void cpc6128_bench_init(void* sys) {
+    cpc_bench_init_type(sys, CPC_TYPE_6128);
+}
+static uint32_t cpc_bench_exec(void* sys, uint32_t micro_seconds) {
+    return cpc_exec(sys, micro_seconds);
+}
+static void cpc_bench_discard(void* sys) {
+    cpc_discard(sys);
+}
+static chips_display_info_t cpc_bench_display_info(void* sys) {
+    return cpc_display_info(sys);
+}
+static bool cpc_bench_load(void* sys, const char* ext, chips_range_t data) {
+    if (0 == strcmp(ext, "dsk")) {
+        return cpc_insert_disc(sys, data);
+    }
+    return cpc_quickload(sys, data, true);
+}
+static void cpc_bench_key(void* sys, int key_code) {
+    cpc_key_down(sys, key_code);
+    cpc_key_up(sys, key_code);
+}
+static void cpc_bench_key_down(void* sys, int key_code) {
+    cpc_key_down(sys, key_code);
+}
+static void cpc_bench_key_up(void* sys, int key_code) {
+    cpc_key_up(sys, key_code);
+}
+#endif
+
+#if defined(BENCH_USE_ZX)
+static void zx_bench_init_type(void* sys, zx_type_t type) {
+    zx_init(sys, &(zx_desc_t){
+        .type = type,
+        .audio = BENCH_AUDIO,
+        .roms = {
+            .zx48k = { .ptr=dump_amstrad_zx48k_bin, .size=sizeof(dump_amstrad_zx48k_bin) },
+            .zx128_0 = { .ptr=dump_amstrad_zx128k_0_bin, .size=sizeof(dump_amstrad_zx128k_0_bin) },
+            .zx128_1 = { .ptr=dump_amstrad_zx128k_1_bin, .size=sizeof(dump_amstrad_zx128k_1_bin) },
+        }
+    });
+}
+static void zx48k_bench_init(void* sys) {
+    zx_bench_init_type(sys, ZX_TYPE_48K);
+}
+static void zx128_bench_init(void* sys) {
+    zx_bench_init_type(sys, ZX_TYPE_128);
+}
+static uint32_t zx_bench_exec(void* sys, uint32_t micro_seconds) {
+    return zx_exec(sys, micro_seconds);
+}
+static void zx_bench_discard(void* sys) {
+    zx_discard(sys);
+}
+static chips_display_info_t zx_bench_display_info(void* sys) {
+    return zx_display_info(sys);
+}
+static bool zx_bench_load(void* sys, const char* ext, chips_range_t data) {
+    (void)ext;
+    return zx_quickload(sys, data);
+}
+static void zx_bench_key(void* sys, int key_code) {
+    zx_key_down(sys, key_code);
+    zx_key_up(sys, key_code);
+}
+static void zx_bench_key_down(void* sys, int key_code) {
+    zx_key_down(sys, key_code);
+}
+static void zx_bench_key_up(void* sys, int key_code) {
+    zx_key_up(sys, key_code);
+}
+#endif
+
+#if defined(BENCH_USE_KC85)
+#if defined(CHIPS_KC85_TYPE_2)
+#define BENCH_KC85_NAME "kc852"
+#define BENCH_KC85_LOAD_DELAY_FRAMES (480)
+#elif defined(CHIPS_KC85_TYPE_3)
+#define BENCH_KC85_NAME "kc853"
+#define BENCH_KC85_LOAD_DELAY_FRAMES (480)
+#else
+#define BENCH_KC85_NAME "kc854"
+#define BENCH_KC85_LOAD_DELAY_FRAMES (180)
+#endif
+static void kc85_bench_init(void* sys) {
+    kc85_init(sys, &(kc85_desc_t){
+        .audio = BENCH_AUDIO,
+        .roms = {
+            #if defined(CHIPS_KC85_TYPE_2)
+                .caos22 = { .ptr = dump_caos22_852, .size = sizeof(dump_caos22_852) },
+            #elif defined(CHIPS_KC85_TYPE_3)
+                .caos31 = { .ptr = dump_caos31_853, .size = sizeof(dump_caos31_853) },
+            #elif defined(CHIPS_KC85_TYPE_4)
+                .caos42c = { .ptr = dump_caos42c_854, .size = sizeof(dump_caos42c_854) },
+                .caos42e = { .ptr = dump_caos42e_854, .size = sizeof(dump_caos42e_854) },
+            #endif
+            #if !defined(CHIPS_KC85_TYPE_2)
+                .kcbasic = { .ptr = dump_basic_c0_853, .size = sizeof(dump_basic_c0_853) }
+            #endif
+        }
+    });
+}
+static uint32_t kc85_bench_exec(void* sys, uint32_t micro_seconds) {
+    return kc85_exec(sys, micro_seconds);
+}
+static void kc85_bench_discard(void* sys) {
+    kc85_discard(sys);
+}
+static chips_display_info_t kc85_bench_display_info(void* sys) {
+    return kc85_display_info(sys);
+}
+static bool kc85_bench_load(void* sys, const char* ext, chips_range_t data) {
+    (void)ext;
+    return kc85_quickload(sys, data, true);
+}
+static void kc85_bench_key(void* sys, int key_code) {
+    kc85_key_down(sys, key_code);
+    kc85_key_up(sys, key_code);
+}
+static void kc85_bench_key_down(void* sys, int key_code) {
+    kc85_key_down(sys, key_code);
+}
+static void kc85_bench_key_up(void* sys, int key_code) {
+    kc85_key_up(sys, key_code);
+}
+#endif
+
+#if defined(BENCH_USE_ATOM)
+static void atom_bench_init(void* sys) {
+    atom_init(sys, &(atom_desc_t){
+        .audio = BENCH_AUDIO,
+        .roms = {
+            .abasic = { .ptr=dump_abasic_ic20, .size = sizeof(dump_abasic_ic20) },
+            .afloat = { .ptr=dump_afloat_ic21, .size = sizeof(dump_afloat_ic21) },
+            .dosrom = { .ptr=dump_dosrom_u15, .size = sizeof(dump_dosrom_u15) }
+        }
+    });
+}
+static uint32_t atom_bench_exec(void* sys, uint32_t micro_seconds) {
+    return atom_exec(sys, micro_seconds);
+}
+static void atom_bench_discard(void* sys) {
+    atom_discard(sys);
+}
+static chips_display_info_t atom_bench_display_info(void* sys) {
+    return atom_display_info(sys);
+}
+static bool atom_bench_load(void* sys, const char* ext, chips_range_t data) {
+    if (0 == strcmp(ext, "tap")) {
+        return atom_insert_tape(sys, data);
+    }
+    return false;
+}
+static void atom_bench_key(void* sys, int key_code) {
+    atom_key_down(sys, key_code);
+    atom_key_up(sys, key_code);
+}
+static void atom_bench_key_down(void* sys, int key_code) {
+    atom_key_down(sys, key_code);
+}
+static void atom_bench_key_up(void* sys, int key_code) {
+    atom_key_up(sys, key_code);
+}
+#endif
+
+#if defined(BENCH_USE_Z1013)
+static void z1013_bench_init(void* sys) {
+    z1013_init(sys, &(z1013_desc_t){
+        .type = Z1013_TYPE_64,
+        .roms = {
+            .mon_a2 = { .ptr=dump_z1013_mon_a2_bin, .size=sizeof(dump_z1013_mon_a2_bin) },
+            .mon202 = { .ptr=dump_z1013_mon202_bin, .size=sizeof(dump_z1013_mon202_bin) },
+            .font = { .ptr=dump_z1013_font_bin, .size=sizeof(dump_z1013_font_bin) }
+        }
+    });
+}
+static uint32_t z1013_bench_exec(void* sys, uint32_t micro_seconds) {
+    return z1013_exec(sys, micro_seconds);
+}
+static void z1013_bench_discard(void* sys) {
+    z1013_discard(sys);
+}
+static chips_display_info_t z1013_bench_display_info(void* sys) {
+    return z1013_display_info(sys);
+}
+static bool z1013_bench_load(void* sys, const char* ext, chips_range_t data) {
+    (void)ext;
+    return z1013_quickload(sys, data);
+}
+static void z1013_bench_key(void* sys, int key_code) {
+    z1013_key_down(sys, key_code);
+    z1013_key_up(sys, key_code);
+}
+static void z1013_bench_key_down(void* sys, int key_code) {
+    z1013_key_down(sys, key_code);
+}
+static void z1013_bench_key_up(void* sys, int key_code) {
+    z1013_key_up(sys, key_code);
+}
+#endif
+
+#if defined(BENCH_USE_Z9001)
+static void z9001_bench_init(void* sys) {
+    z9001_init(sys, &(z9001_desc_t){
+        .type = Z9001_TYPE_Z9001,
+        .audio = BENCH_AUDIO,
+        .roms = {
+            .z9001 = {
+                .os_1  = { .ptr=dump_z9001_os12_1_bin, .size=sizeof(dump_z9001_os12_1_bin) },
+                .os_2  = { .ptr=dump_z9001_os12_2_bin, .size=sizeof(dump_z9001_os12_2_bin) },
+                .basic = { .ptr=dump_z9001_basic_507_511_bin, .size=sizeof(dump_z9001_basic_507_511_bin) },
+                .font  = { .ptr=dump_z9001_font_bin, .size=sizeof(dump_z9001_font_bin) },
+            },
+            .kc87 = {
+                .os    = { .ptr=dump_kc87_os_2_bin, .size=sizeof(dump_kc87_os_2_bin) },
+                .basic = { .ptr=dump_z9001_basic_bin, .size=sizeof(dump_z9001_basic_bin) },
+                .font  = { .ptr=dump_kc87_font_2_bin, .size=sizeof(dump_kc87_font_2_bin) }
+            },
+        }
+    });
+}
+static uint32_t z9001_bench_exec(void* sys, uint32_t micro_seconds) {
+    return z9001_exec(sys, micro_seconds);
+}
+static void z9001_bench_discard(void* sys) {
+    z9001_discard(sys);
+}
+static chips_display_info_t z9001_bench_display_info(void* sys) {
+    return z9001_display_info(sys);
+}
+static bool z9001_bench_load(void* sys, const char* ext, chips_range_t data) {
+    (void)ext;
+    return z9001_quickload(sys, data);
+}
+static void z9001_bench_key(void* sys, int key_code) {
+    z9001_key_down(sys, key_code);
+    z9001_key_up(sys, key_code);
+}
+static void z9001_bench_key_down(void* sys, int key_code) {
+    z9001_key_down(sys, key_code);
+}
+static void z9001_bench_key_up(void* sys, int key_code) {
+    z9001_key_up(sys, key_code);
+}
+#endif
+
+#if defined(BENCH_USE_BOMBJACK)
+static void bombjack_bench_init(void* sys) {
+    bombjack_init(sys, &(bombjack_desc_t){
+        .audio = BENCH_AUDIO,
+        .roms = {
+            .main_0000_1FFF = { .ptr=dump_09_j01b_bin, .size=sizeof(dump_09_j01b_bin) },
+            .main_2000_3FFF = { .ptr=dump_10_l01b_bin, .size=sizeof(dump_10_l01b_bin) },
+            .main_4000_5FFF = { .ptr=dump_11_m01b_bin, .size=sizeof(dump_11_m01b_bin) },
+            .main_6000_7FFF = { .ptr=dump_12_n01b_bin, .size=sizeof(dump_12_n01b_bin) },
+            .main_C000_DFFF = { .ptr=dump_13_1r, .size=sizeof(dump_13_1r) },
+            .sound_0000_1FFF = { .ptr=dump_01_h03t_bin, .size=sizeof(dump_01_h03t_bin) },
+            .chars_0000_0FFF = { .ptr=dump_03_e08t_bin, .size=sizeof(dump_03_e08t_bin) },
+            .chars_1000_1FFF = { .ptr=dump_04_h08t_bin, .size=sizeof(dump_04_h08t_bin) },
+            .chars_2000_2FFF = { .ptr=dump_05_k08t_bin, .size=sizeof(dump_05_k08t_bin) },
+            .tiles_0000_1FFF = { .ptr=dump_06_l08t_bin, .size=sizeof(dump_06_l08t_bin) },
+            .tiles_2000_3FFF = { .ptr=dump_07_n08t_bin, .size=sizeof(dump_07_n08t_bin) },
+            .tiles_4000_5FFF = { .ptr=dump_08_r08t_bin, .size=sizeof(dump_08_r08t_bin) },
+            .sprites_0000_1FFF = { .ptr=dump_16_m07b_bin, .size=sizeof(dump_16_m07b_bin) },
+            .sprites_2000_3FFF = { .ptr=dump_15_l07b_bin, .size=sizeof(dump_15_l07b_bin) },
+            .sprites_4000_5FFF = { .ptr=dump_14_j07b_bin, .size=sizeof(dump_14_j07b_bin) },
+            .maps_0000_0FFF = { .ptr=dump_02_p04t_bin, .size=sizeof(dump_02_p04t_bin) }
+        }
+    });
+}
+static uint32_t bombjack_bench_exec(void* sys, uint32_t micro_seconds) {
+    return bombjack_exec(sys, micro_seconds);
+}
+static void bombjack_bench_discard(void* sys) {
+    bombjack_discard(sys);
+}
+static chips_display_info_t bombjack_bench_display_info(void* sys) {
+    return bombjack_display_info(sys);
+}
+// joystick bits in the low byte, system bits in the high byte (like the sokol frontend)
+static void bombjack_bench_key_down(void* sys, int key_code) {
+    bombjack_t* bj = sys;
+    bj->mainboard.p1 |= key_code & 0xFF;
+    bj->mainboard.sys |= (key_code >> 8) & 0xFF;
+}
+static void bombjack_bench_key_up(void* sys, int key_code) {
+    bombjack_t* bj = sys;
+    bj->mainboard.p1 &= ~(key_code & 0xFF);
+    bj->mainboard.sys &= ~((key_code >> 8) & 0xFF);
+}
+#endif
+
+#if defined(BENCH_USE_NAMCO)
+#if defined(NAMCO_PACMAN)
+#define BENCH_NAMCO_NAME "pacman"
+#else
+#define BENCH_NAMCO_NAME "pengo"
+#endif
+static void namco_bench_init(void* sys) {
+    namco_init(sys, &(namco_desc_t){
+        .audio = BENCH_AUDIO,
+        .roms = {
+            #if defined(NAMCO_PACMAN)
+            .common = {
+                .cpu_0000_0FFF = { .ptr=dump_pacman_6e, .size = sizeof(dump_pacman_6e) },
+                .cpu_1000_1FFF = { .ptr=dump_pacman_6f, .size = sizeof(dump_pacman_6f) },
+                .cpu_2000_2FFF = { .ptr=dump_pacman_6h, .size = sizeof(dump_pacman_6h) },
+                .cpu_3000_3FFF = { .ptr=dump_pacman_6j, .size = sizeof(dump_pacman_6j) },
+                .prom_0000_001F = { .ptr=dump_82s123_7f, .size = sizeof(dump_82s123_7f) },
+                .sound_0000_00FF = { .ptr=dump_82s126_1m, .size = sizeof(dump_82s126_1m) },
+                .sound_0100_01FF = { .ptr=dump_82s126_3m, .size = sizeof(dump_82s126_3m) },
+            },
+            .pacman = {
+                .gfx_0000_0FFF = { .ptr=dump_pacman_5e, .size = sizeof(dump_pacman_5e) },
+                .gfx_1000_1FFF = { .ptr=dump_pacman_5f, .size = sizeof(dump_pacman_5f) },
+                .prom_0020_011F = { .ptr=dump_82s126_4a, .size = sizeof(dump_82s126_4a) },
+            }
+            #else
+            .common = {
+                .cpu_0000_0FFF = { .ptr=dump_ep5120_8, .size=sizeof(dump_ep5120_8) },
+                .cpu_1000_1FFF = { .ptr=dump_ep5121_7, .size=sizeof(dump_ep5121_7) },
+                .cpu_2000_2FFF = { .ptr=dump_ep5122_15, .size=sizeof(dump_ep5122_15) },
+                .cpu_3000_3FFF = { .ptr=dump_ep5123_14, .size=sizeof(dump_ep5123_14) },
+                .prom_0000_001F = { .ptr=dump_pr1633_78, .size=sizeof(dump_pr1633_78) },
+                .sound_0000_00FF = { .ptr=dump_pr1635_51, .size=sizeof(dump_pr1635_51) },
+                .sound_0100_01FF = { .ptr=dump_pr1636_70, .size=sizeof(dump_pr1636_70) }
+            },
+            .pengo = {
+                .cpu_4000_4FFF = { .ptr=dump_ep5124_21, .size=sizeof(dump_ep5124_21) },
+                .cpu_5000_5FFF = { .ptr=dump_ep5125_20, .size=sizeof(dump_ep5125_20) },
+                .cpu_6000_6FFF = { .ptr=dump_ep5126_32, .size=sizeof(dump_ep5126_32) },
+                .cpu_7000_7FFF = { .ptr=dump_ep5127_31, .size=sizeof(dump_ep5127_31) },
+                .gfx_0000_1FFF = { .ptr=dump_ep1640_92, .size=sizeof(dump_ep1640_92) },
+                .gfx_2000_3FFF = { .ptr=dump_ep1695_105, .size=sizeof(dump_ep1695_105) },
+                .prom_0020_041F = { .ptr=dump_pr1634_88, .size=sizeof(dump_pr1634_88) }
+            }
+            #endif
+        }
+    });
+}
+static uint32_t namco_bench_exec(void* sys, uint32_t micro_seconds) {
+    return namco_exec(sys, micro_seconds);
+}
+static void namco_bench_discard(void* sys) {
+    namco_discard(sys);
+}
+static chips_display_info_t namco_bench_display_info(void* sys) {
+    return namco_display_info(sys);
+}
+// the key codes are NAMCO_INPUT_* masks (like the sokol frontends)
+static void namco_bench_key_down(void* sys, int key_code) {
+    namco_input_set(sys, (uint32_t)key_code);
+}
+static void namco_bench_key_up(void* sys, int key_code) {
+    namco_input_clear(sys, (uint32_t)key_code);
+}
+#endif
+
+#if defined(BENCH_USE_LC80)
+static void lc80_bench_init(void* sys) {
+    lc80_init(sys, &(lc80_desc_t){
+        .audio = BENCH_AUDIO,
+        .rom = { .ptr = dump_lc80_2k_bin, .size = sizeof(dump_lc80_2k_bin) },
+    });
+}
+static uint32_t lc80_bench_exec(void* sys, uint32_t micro_seconds) {
+    return lc80_exec(sys, micro_seconds);
+}
+static void lc80_bench_discard(void* sys) {
+    lc80_discard(sys);
+}
+#endif
+
+// load delays and key delays are the same as in the sokol frontends
+static const bench_system_t bench_systems[] = {
+    #if defined(BENCH_USE_C64)
+    {
+        .name = "c64", .config = "default", .size = sizeof(c64_t),
+        .init = c64_bench_init, .exec = c64_bench_exec, .discard = c64_bench_discard,
+        .display_info = c64_bench_display_info,
+        .load = c64_bench_load, .autostart = c64_bench_autostart, .key = c64_bench_key,
+        .key_down = c64_bench_key_down, .key_up = c64_bench_key_up,
+        .load_delay_frames = 180, .key_delay_frames = 5,
+    },
+    {
+        .name = "c64", .config = "c1541", .size = sizeof(c64_t),
+        .init = c64_c1541_bench_init, .exec = c64_bench_exec, .discard = c64_bench_discard,
+        .display_info = c64_bench_display_info,
+        .load = c64_bench_load, .autostart = c64_bench_autostart, .key = c64_bench_key,
+        .key_down = c64_bench_key_down, .key_up = c64_bench_key_up,
+        .load_delay_frames = 180, .key_delay_frames = 5,
+    },
+    #endif
+    #if defined(BENCH_USE_VIC20)
+    {
+        .name = "vic20", .config = "default", .size = sizeof(vic20_t),
+        .init = vic20_bench_init, .exec = vic20_bench_exec, .discard = vic20_bench_discard,
+        .display_info = vic20_bench_display_info,
+        .load = vic20_bench_load, .autostart_input = vic20_bench_autostart_input, .key = vic20_bench_key,
+        .key_down = vic20_bench_key_down, .key_up = vic20_bench_key_up,
+        .load_delay_frames = 180, .key_delay_frames = 5,
+    },
+    #endif
+    #if defined(BENCH_USE_CPC)
+    {
+        .name = "cpc", .config = "cpc464", .size = sizeof(cpc_t),
+        .init = cpc464_bench_init, .exec = cpc_bench_exec, .discard = cpc_bench_discard,
+        .display_info = cpc_bench_display_info,
+        .load = cpc_bench_load, .key = cpc_bench_key,
+        .key_down = cpc_bench_key_down, .key_up = cpc_bench_key_up,
+        .load_delay_frames = 120, .key_delay_frames = 7,
+    },
+    {
+        .name = "cpc", .config = "cpc6128", .size = sizeof(cpc_t),
+        .init = cpc6128_bench_init, .exec = cpc_bench_exec, .discard = cpc_bench_discard,
+        .display_info = cpc_bench_display_info,
+        .load = cpc_bench_load, .key = cpc_bench_key,
+        .key_down = cpc_bench_key_down, .key_up = cpc_bench_key_up,
+        .load_delay_frames = 120, .key_delay_frames = 7,
+    },
+    #endif
+    #if defined(BENCH_USE_ZX)
+    {
+        .name = "zx", .config = "zx48k", .size = sizeof(zx_t),
+        .init = zx48k_bench_init, .exec = zx_bench_exec, .discard = zx_bench_discard,
+        .display_info = zx_bench_display_info,
+        .load = zx_bench_load, .key = zx_bench_key,
+        .key_down = zx_bench_key_down, .key_up = zx_bench_key_up,
+        .load_delay_frames = 120, .key_delay_frames = 6,
+    },
+    {
+        .name = "zx", .config = "zx128", .size = sizeof(zx_t),
+        .init = zx128_bench_init, .exec = zx_bench_exec, .discard = zx_bench_discard,
+        .display_info = zx_bench_display_info,
+        .load = zx_bench_load, .key = zx_bench_key,
+        .key_down = zx_bench_key_down, .key_up = zx_bench_key_up,
+        .load_delay_frames = 120, .key_delay_frames = 6,
+    },
+    #endif
+    #if defined(BENCH_USE_KC85)
+    {
+        .name = BENCH_KC85_NAME, .config = "default", .size = sizeof(kc85_t),
+        .init = kc85_bench_init, .exec = kc85_bench_exec, .discard = kc85_bench_discard,
+        .display_info = kc85_bench_display_info,
+        .load = kc85_bench_load, .key = kc85_bench_key,
+        .key_down = kc85_bench_key_down, .key_up = kc85_bench_key_up,
+        .load_delay_frames = BENCH_KC85_LOAD_DELAY_FRAMES, .key_delay_frames = 10,
+    },
+    #endif
+    #if defined(BENCH_USE_ATOM)
+    {
+        .name = "atom", .config = "default", .size = sizeof(atom_t),
+        .init = atom_bench_init, .exec = atom_bench_exec, .discard = atom_bench_discard,
+        .display_info = atom_bench_display_info,
+        .load = atom_bench_load, .key = atom_bench_key,
+        .key_down = atom_bench_key_down, .key_up = atom_bench_key_up,
+        .load_delay_frames = 48, .key_delay_frames = 10,
+    },
+    #endif
+    #if defined(BENCH_USE_Z1013)
+    {
+        .name = "z1013", .config = "default", .size = sizeof(z1013_t),
+        .init = z1013_bench_init, .exec = z1013_bench_exec, .discard = z1013_bench_discard,
+        .display_info = z1013_bench_display_info,
+        .load = z1013_bench_load, .key = z1013_bench_key,
+        .key_down = z1013_bench_key_down, .key_up = z1013_bench_key_up,
+        .load_delay_frames = 20, .key_delay_frames = 6,
+    },
+    #endif
+    #if defined(BENCH_USE_Z9001)
+    {
+        .name = "z9001", .config = "default", .size = sizeof(z9001_t),
+        .init = z9001_bench_init, .exec = z9001_bench_exec, .discard = z9001_bench_discard,
+        .display_info = z9001_bench_display_info,
+        .load = z9001_bench_load, .key = z9001_bench_key,
+        .key_down = z9001_bench_key_down, .key_up = z9001_bench_key_up,
+        .load_delay_frames = 20, .key_delay_frames = 12,
+    },
+    #endif
+    #if defined(BENCH_USE_BOMBJACK)
+    {
+        .name = "bombjack", .config = "default", .size = sizeof(bombjack_t),
+        .init = bombjack_bench_init, .exec = bombjack_bench_exec, .discard = bombjack_bench_discard,
+        .display_info = bombjack_bench_display_info,
+        .key_down = bombjack_bench_key_down, .key_up = bombjack_bench_key_up,
+    },
+    #endif
+    #if defined(BENCH_USE_NAMCO)
+    {
+        .name = BENCH_NAMCO_NAME, .config = "default", .size = sizeof(namco_t),
+        .init = namco_bench_init, .exec = namco_bench_exec, .discard = namco_bench_discard,
+        .display_info = namco_bench_display_info,
+        .key_down = namco_bench_key_down, .key_up = namco_bench_key_up,
+    },
+    #endif
+    #if defined(BENCH_USE_LC80)
+    {
+        .name = "lc80", .config = "default", .size = sizeof(lc80_t),
+        .init = lc80_bench_init, .exec = lc80_bench_exec, .discard = lc80_bench_discard,
+    },
+    #endif
+};
+#define BENCH_NUM_SYSTEMS (sizeof(bench_systems) / sizeof(bench_system_t))
+
+// extract the lower-case file extension from a path (empty string if none)
+static void bench_file_ext(const char* path, char* buf, size_t buf_size) {
+    const char* name = path;
+    for (const char* p = path; *p; p++) {
+        if ((*p == '/') || (*p == '\\')) {
+            name = p + 1;
+        }
+    }
+    size_t i = 0;
+    const char* dot = strrchr(name, '.');
+    if (dot) {
+        for (dot++; *dot && (i < (buf_size - 1)); dot++, i++) {
+            buf[i] = (char)tolower((unsigned char)*dot);
+        }
+    }
+    buf[i] = 0;
+}
+
+// load a file into a zero-terminated heap buffer (text files are fed into keybuf),
+// returns a zero range on failure, the caller must free() the returned pointer
+static chips_range_t bench_read_file(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "failed to open file '%s'\n", path);
+        return (chips_range_t){0};
+    }
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size <= 0) {
+        fprintf(stderr, "file '%s' is empty\n", path);
+        fclose(fp);
+        return (chips_range_t){0};
+    }
+    uint8_t* ptr = calloc(1, (size_t)size + 1);
+    if (!ptr) {
+        fprintf(stderr, "failed to allocate %ld bytes for file '%s'\n", size, path);
+        fclose(fp);
+        return (chips_range_t){0};
+    }
+    const size_t num_read = fread(ptr, 1, (size_t)size, fp);
+    fclose(fp);
+    if (num_read != (size_t)size) {
+        fprintf(stderr, "failed to read file '%s'\n", path);
+        free(ptr);
+        return (chips_range_t){0};
+    }
+    return (chips_range_t){ .ptr = ptr, .size = (size_t)size };
+}
@@ -0,0 +1,716 @@
+//------------------------------------------------------------------------------
+//  chips-bench.c
+//
+//  Unthrottled headless benchmark for all emulated systems (see
+//  chips-bench-systems.h). Each system runs through its *_exec() function
+//  for a fixed emulated duration in frame-sized time slices.
+//
+//  The KC85 models and the Namco arcade machines are compile-time variants
+//  of the same emulator code, so only one of each can live in the same
+//  executable. The default build contains the KC85/4 and Pacman, the
+//  remaining variants are built as separate chips-bench-* targets
+//  (with CHIPS_BENCH_VARIANT defined, which only includes the variant
+//  system).
+//
+//  Each system can be run several times (--reps), the result is reported
+//  as min/median/max host time. Results can be written as CSV or JSON
+//  (--format, --output), and a CSV result file can be used as baseline
+//  for a later run (--baseline). If the median throughput of any system
+//  drops by more than the regression threshold (--threshold, in percent)
+//  below its baseline, chips-bench exits with a non-zero exit code.
+//
+//  The chips-bench-prof target is compiled with CHIPS_BENCH_PROF and
+//  additionally prints the host time spent per chip category (CPU,
+//  video, audio, I/O chips and the c1541 drive), see chips-bench-prof.h.
+//  The instrumentation has a small overhead of its own, so the
+//  throughput numbers of chips-bench-prof are not comparable with
+//  chips-bench.
+//
+//  Instead of benchmarking the idle system (which mostly runs the
+//  ROM's keyboard polling loop), a workload file (for instance from the
+//  webpage/ directory) can be loaded with --file. The file is loaded the
+//  same way as in the sokol frontends (after the same startup delay,
+//  text files are typed via keybuf), started via --input or the system's
+//  default autostart, and the measurement begins after an emulated warmup
+//  period (--warmup). The workload name is part of the CSV/JSON output
+//  and is matched against the baseline.
+//
+//  An input journal recorded in a sokol frontend (record=path, see
+//  examples/common/journal.h) can be replayed with --journal. The
+//  recorded frame durations and input events are fed into the emulator
+//  in the same order as in the frontend, so the benchmark runs exactly
+//  the same emulated session as the recording (--file must then point
+//  to the same file as the frontend's file= argument). The measurement
+//  covers the whole replay, --secs and --warmup are ignored. If the
+//  replay goes out of sync with the recording, chips-bench exits with a
+//  non-zero exit code.
+//
+//  Usage:
+//
+//  fips run chips-bench -- [--system name] [--secs emulated_seconds]
+//      [--reps n] [--format table|csv|json] [--output file]
+//      [--baseline file.csv] [--threshold percent]
+//      [--file path [--input text] [--warmup secs]] [--journal path]
+//
+//  Example:
+//
+//  fips run chips-bench -- --system c64 --file ../webpage/c64/boulderdash_c64.prg --reps 3
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>   // PRIu64, SCNu64
+#include <assert.h>
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#include "getopt.h"
+#include "keybuf.h"
+#include "journal.h"
+#include "chips-bench-systems.h"
+
+// default emulated duration per system
+#define BENCH_DEFAULT_SECS (5)
+// max number of repetitions per system
+#define BENCH_MAX_REPS (100)
+// max number of entries in a baseline file
+#define BENCH_MAX_BASELINE (64)
+// default regression threshold in percent
+#define BENCH_DEFAULT_THRESHOLD (5.0)
+// default emulated warmup duration after loading a workload file
+#define BENCH_DEFAULT_WARMUP_SECS (10)
+
+// an optional workload file which is loaded and started before measuring
+typedef struct {
+    const char* path;
+    const char* name;                       // file name without directory
+    char ext[16];                           // lower-case file extension
+    chips_range_t data;                     // file content, zero-terminated
+    const char* input;                      // optional keyboard input (--input)
+    uint32_t warmup_usec;                   // emulated time between load and measurement
+} bench_workload_t;
+
+// result of a single benchmark run
+typedef struct {
+    uint64_t ticks;
+    double emu_secs;
+    double host_secs;
+    #if defined(CHIPS_BENCH_PROF)
+    double prof[BENCH_PROF_NUM];            // fraction of host time per chip category
+    #endif
+} bench_result_t;
+
+// min/median/max over all repetitions of a system benchmark
+typedef struct {
+    const bench_system_t* sys;
+    const char* workload;                   // workload file name, or "idle"
+    int num_reps;
+    uint64_t ticks;
+    double emu_secs;
+    double host_secs_min;
+    double host_secs_median;
+    double host_secs_max;
+    #if defined(CHIPS_BENCH_PROF)
+    double prof[BENCH_PROF_NUM];            // average over all repetitions
+    #endif
+} bench_stats_t;
+
+// a baseline entry loaded from a CSV file written with '--format csv'
+typedef struct {
+    char name[32];
+    char config[32];
+    char workload[64];
+    double ticks_per_sec;
+} bench_baseline_t;
+
+typedef enum {
+    BENCH_FORMAT_TABLE,
+    BENCH_FORMAT_CSV,
+    BENCH_FORMAT_JSON,
+} bench_format_t;
+
+
+// run the emulator for a number of frame slices, feeding keyboard input from keybuf
+static uint64_t bench_exec_frames(const bench_system_t* bs, void* sys, uint32_t num_usec) {
+    uint64_t ticks = 0;
+    uint32_t usec = 0;
+    while (usec < num_usec) {
+        uint32_t slice = num_usec - usec;
+        if (slice > BENCH_FRAME_USEC) {
+            slice = BENCH_FRAME_USEC;
+        }
+        if (bs->key) {
+            uint8_t key_code;
+            if (0 != (key_code = keybuf_get(slice))) {
+                bs->key(sys, key_code);
+            }
+        }
+        ticks += bs->exec(sys, slice);
+        usec += slice;
+    }
+    return ticks;
+}
+
+// load and start a workload the same way as the sokol frontends
+static void bench_load_workload_into(const bench_system_t* bs, void* sys, const bench_workload_t* wl) {
+    if ((0 == strcmp(wl->ext, "txt")) || (0 == strcmp(wl->ext, "bas"))) {
+        keybuf_put((const char*)wl->data.ptr);
+    }
+    else if (!bs->load(sys, wl->ext, wl->data)) {
+        fprintf(stderr, "failed to load '%s' into system '%s'\n", wl->path, bs->name);
+        exit(10);
+    }
+    if (wl->input) {
+        keybuf_put(wl->input);
+    }
+    else if (bs->autostart_input) {
+        keybuf_put(bs->autostart_input(wl->ext));
+    }
+    else if (bs->autostart) {
+        bs->autostart(sys, wl->ext);
+    }
+}
+
+// load and start a workload after the startup delay, and run the
+// emulator until the warmup time has passed
+static void bench_start_workload(const bench_system_t* bs, void* sys, const bench_workload_t* wl) {
+    bench_exec_frames(bs, sys, bs->load_delay_frames * BENCH_FRAME_USEC);
+    bench_load_workload_into(bs, sys, wl);
+    bench_exec_frames(bs, sys, wl->warmup_usec);
+}
+
+typedef struct {
+    const bench_system_t* bs;
+    void* sys;
+} bench_journal_target_t;
+
+static void bench_journal_key_down(int key_code, void* user_data) {
+    const bench_journal_target_t* target = user_data;
+    target->bs->key_down(target->sys, key_code);
+}
+
+static void bench_journal_key_up(int key_code, void* user_data) {
+    const bench_journal_target_t* target = user_data;
+    target->bs->key_up(target->sys, key_code);
+}
+
+// replay an input journal, each frame does the same as the sokol frontend's
+// app_frame(): inject the recorded input, run the emulator for the recorded
+// frame duration, load the workload file after the startup delay and feed
+// keybuf input, returns the number of executed ticks
+static uint64_t bench_replay_journal(const bench_system_t* bs, void* sys, const bench_workload_t* wl, const char* journal_path, uint64_t* out_usec) {
+    bench_journal_target_t target = { .bs = bs, .sys = sys };
+    journal_init(&(journal_desc_t){
+        .system_name = bs->name,
+        .replay_path = journal_path,
+        .key_down_cb = bench_journal_key_down,
+        .key_up_cb = bench_journal_key_up,
+        .user_data = &target,
+    });
+    if (!journal_replaying()) {
+        exit(10);
+    }
+    bool load_pending = 0 != wl;
+    uint64_t ticks = 0;
+    uint64_t usec = 0;
+    for (;;) {
+        const uint32_t frame_time_us = journal_frame_time(BENCH_FRAME_USEC);
+        if (!journal_replaying()) {
+            break;
+        }
+        const uint32_t frame_ticks = bs->exec(sys, frame_time_us);
+        journal_frame_ticks(frame_ticks);
+        ticks += frame_ticks;
+        usec += frame_time_us;
+        if (load_pending && ((usec / BENCH_FRAME_USEC) > bs->load_delay_frames)) {
+            load_pending = false;
+            bench_load_workload_into(bs, sys, wl);
+        }
+        if (bs->key) {
+            uint8_t key_code;
+            if (0 != (key_code = keybuf_get(frame_time_us))) {
+                bs->key(sys, key_code);
+            }
+        }
+    }
+    if (journal_desync_count() > 0) {
+        fprintf(stderr, "replay of '%s' on system '%s' (%s) went out of sync\n", journal_path, bs->name, bs->config);
+        exit(10);
+    }
+    journal_shutdown();
+    *out_usec = usec;
+    return ticks;
+}
+
+static bench_result_t bench_run(const bench_system_t* bs, const bench_workload_t* wl, const char* journal_path, uint32_t num_usec) {
+    void* sys = calloc(1, bs->size);
+    if (!sys) {
+        fprintf(stderr, "failed to allocate %zu bytes for system '%s'\n", bs->size, bs->name);
+        exit(10);
+    }
+    bs->init(sys);
+    // an empty keybuf is also used for idle runs, so that all runs have the same per-frame overhead
+    keybuf_init(&(keybuf_desc_t){ .key_delay_frames = bs->key_delay_frames });
+    if (wl && !journal_path) {
+        bench_start_workload(bs, sys, wl);
+    }
+    bench_result_t res = { .emu_secs = num_usec / 1000000.0 };
+    #if defined(CHIPS_BENCH_PROF)
+    bench_prof_reset();
+    const uint64_t prof_start = bench_prof_counter();
+    #endif
+    const uint64_t start = stm_now();
+    if (journal_path) {
+        uint64_t usec = 0;
+        res.ticks = bench_replay_journal(bs, sys, wl, journal_path, &usec);
+        res.emu_secs = usec / 1000000.0;
+    }
+    else {
+        res.ticks = bench_exec_frames(bs, sys, num_usec);
+    }
+    res.host_secs = stm_sec(stm_since(start));
+    #if defined(CHIPS_BENCH_PROF)
+    const double prof_total = (double)(bench_prof_counter() - prof_start);
+    for (int i = 0; i < BENCH_PROF_NUM; i++) {
+        res.prof[i] = (prof_total > 0.0) ? (bench_prof_estimate((bench_prof_cat_t)i) / prof_total) : 0.0;
+    }
+    #endif
+    bs->discard(sys);
+    free(sys);
+    return res;
+}
+
+static int bench_cmp_double(const void* a, const void* b) {
+    const double da = *(const double*)a;
+    const double db = *(const double*)b;
+    return (da < db) ? -1 : ((da > db) ? 1 : 0);
+}
+
+// the file name part of a path
+static const char* bench_file_name(const char* path) {
+    const char* name = path;
+    for (const char* p = path; *p; p++) {
+        if ((*p == '/') || (*p == '\\')) {
+            name = p + 1;
+        }
+    }
+    return name;
+}
+
+static bench_stats_t bench_run_reps(const bench_system_t* bs, const bench_workload_t* wl, const char* journal_path, uint32_t num_usec, int num_reps) {
+    assert((num_reps > 0) && (num_reps <= BENCH_MAX_REPS));
+    double host_secs[BENCH_MAX_REPS];
+    // a journal replay is reported under the journal's name
+    const char* workload = journal_path ? bench_file_name(journal_path) : (wl ? wl->name : "idle");
+    bench_stats_t stats = { .sys = bs, .workload = workload, .num_reps = num_reps };
+    for (int i = 0; i < num_reps; i++) {
+        const bench_result_t res = bench_run(bs, wl, journal_path, num_usec);
+        // the emulation is deterministic, so all runs execute the same number of ticks
+        stats.ticks = res.ticks;
+        stats.emu_secs = res.emu_secs;
+        host_secs[i] = res.host_secs;
+        #if defined(CHIPS_BENCH_PROF)
+        for (int cat = 0; cat < BENCH_PROF_NUM; cat++) {
+            stats.prof[cat] += res.prof[cat] / num_reps;
+        }
+        #endif
+    }
+    qsort(host_secs, (size_t)num_reps, sizeof(double), bench_cmp_double);
+    stats.host_secs_min = host_secs[0];
+    stats.host_secs_max = host_secs[num_reps - 1];
+    if (num_reps & 1) {
+        stats.host_secs_median = host_secs[num_reps / 2];
+    }
+    else {
+        stats.host_secs_median = (host_secs[num_reps/2 - 1] + host_secs[num_reps/2]) * 0.5;
+    }
+    return stats;
+}
+
+// throughput in emulated ticks per host second
+static double bench_ticks_per_sec(const bench_stats_t* stats, double host_secs) {
+    return (host_secs > 0.0) ? ((double)stats->ticks / host_secs) : 0.0;
+}
+
+static void bench_print_table_header(FILE* fp) {
+    fprintf(fp, "%-10s %-10s %-16s %12s %10s %10s %10s %10s %10s\n",
+        "system", "config", "workload", "ticks", "host min", "host med", "emu MHz", "speedup", "ns/tick");
+}
+
+static void bench_print_table_row(FILE* fp, const bench_stats_t* stats) {
+    fprintf(fp, "%-10s %-10s %-16s %12"PRIu64" %10.3f %10.3f %10.2f %9.2fx %10.2f\n",
+        stats->sys->name,
+        stats->sys->config,
+        stats->workload,
+        stats->ticks,
+        stats->host_secs_min,
+        stats->host_secs_median,
+        bench_ticks_per_sec(stats, stats->host_secs_median) / 1000000.0,
+        stats->emu_secs / stats->host_secs_median,
+        (stats->host_secs_median * 1000000000.0) / (double)stats->ticks);
+}
+
+#if defined(CHIPS_BENCH_PROF)
+// per-chip host time breakdown in percent, 'other' is the system glue code
+// (memory access, bus decoding, the tick loop itself, ...)
+static void bench_print_prof_table(FILE* fp, const bench_stats_t* stats, int num_stats) {
+    fprintf(fp, "%-10s %-10s %-16s", "system", "config", "workload");
+    for (int cat = 0; cat < BENCH_PROF_NUM; cat++) {
+        fprintf(fp, " %7s", bench_prof_names[cat]);
+    }
+    fprintf(fp, " %7s\n", "other");
+    for (int i = 0; i < num_stats; i++) {
+        const bench_stats_t* s = &stats[i];
+        fprintf(fp, "%-10s %-10s %-16s", s->sys->name, s->sys->config, s->workload);
+        double other = 1.0;
+        for (int cat = 0; cat < BENCH_PROF_NUM; cat++) {
+            if (s->prof[cat] > 0.0) {
+                fprintf(fp, " %6.1f%%", s->prof[cat] * 100.0);
+            }
+            else {
+                fprintf(fp, " %7s", "-");
+            }
+            other -= s->prof[cat];
+        }
+        fprintf(fp, " %6.1f%%\n", (other > 0.0) ? (other * 100.0) : 0.0);
+    }
+}
+#endif
+
+static void bench_write_csv(FILE* fp, const bench_stats_t* stats, int num_stats) {
+    fprintf(fp, "system,config,workload,reps,emu_secs,ticks,host_secs_min,host_secs_median,host_secs_max,ticks_per_sec_min,ticks_per_sec_median,ticks_per_sec_max\n");
+    for (int i = 0; i < num_stats; i++) {
+        const bench_stats_t* s = &stats[i];
+        fprintf(fp, "%s,%s,%s,%d,%.6f,%"PRIu64",%.6f,%.6f,%.6f,%.1f,%.1f,%.1f\n",
+            s->sys->name,
+            s->sys->config,
+            s->workload,
+            s->num_reps,
+            s->emu_secs,
+            s->ticks,
+            s->host_secs_min,
+            s->host_secs_median,
+            s->host_secs_max,
+            // slowest run has the lowest throughput
+            bench_ticks_per_sec(s, s->host_secs_max),
+            bench_ticks_per_sec(s, s->host_secs_median),
+            bench_ticks_per_sec(s, s->host_secs_min));
+    }
+}
+
+static void bench_write_json(FILE* fp, const bench_stats_t* stats, int num_stats) {
+    fprintf(fp, "[\n");
+    for (int i = 0; i < num_stats; i++) {
+        const bench_stats_t* s = &stats[i];
+        fprintf(fp, "  {\n");
+        fprintf(fp, "    \"system\": \"%s\",\n", s->sys->name);
+        fprintf(fp, "    \"config\": \"%s\",\n", s->sys->config);
+        fprintf(fp, "    \"workload\": \"%s\",\n", s->workload);
+        fprintf(fp, "    \"reps\": %d,\n", s->num_reps);
+        fprintf(fp, "    \"emu_secs\": %.6f,\n", s->emu_secs);
+        fprintf(fp, "    \"ticks\": %"PRIu64",\n", s->ticks);
+        fprintf(fp, "    \"host_secs\": { \"min\": %.6f, \"median\": %.6f, \"max\": %.6f },\n",
+            s->host_secs_min, s->host_secs_median, s->host_secs_max);
+        fprintf(fp, "    \"ticks_per_sec\": { \"min\": %.1f, \"median\": %.1f, \"max\": %.1f }\n",
+            bench_ticks_per_sec(s, s->host_secs_max),
+            bench_ticks_per_sec(s, s->host_secs_median),
+            bench_ticks_per_sec(s, s->host_secs_min));
+        fprintf(fp, "  }%s\n", (i < (num_stats - 1)) ? "," : "");
+    }
+    fprintf(fp, "]\n");
+}
+
+// load a baseline CSV file, only the system, config, workload and median throughput columns are used
+static int bench_load_baseline(const char* path, bench_baseline_t* items, int max_items) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "failed to open baseline file '%s'\n", path);
+        return -1;
+    }
+    char line[512];
+    int num_items = 0;
+    bool header = true;
+    while (fgets(line, sizeof(line), fp) && (num_items < max_items)) {
+        if (header) {
+            header = false;
+            continue;
+        }
+        bench_baseline_t* item = &items[num_items];
+        int reps;
+        double emu_secs, host_min, host_med, host_max, tps_min;
+        uint64_t ticks;
+        int res = sscanf(line, "%31[^,],%31[^,],%63[^,],%d,%lf,%"SCNu64",%lf,%lf,%lf,%lf,%lf",
+            item->name, item->config, item->workload, &reps, &emu_secs, &ticks,
+            &host_min, &host_med, &host_max, &tps_min, &item->ticks_per_sec);
+        if (res == 11) {
+            num_items++;
+        }
+    }
+    fclose(fp);
+    return num_items;
+}
+
+static const bench_baseline_t* bench_find_baseline(const bench_baseline_t* items, int num_items, const bench_stats_t* stats) {
+    for (int i = 0; i < num_items; i++) {
+        if ((0 == strcmp(items[i].name, stats->sys->name)) &&
+            (0 == strcmp(items[i].config, stats->sys->config)) &&
+            (0 == strcmp(items[i].workload, stats->workload)))
+        {
+            return &items[i];
+        }
+    }
+    return 0;
+}
+
+// load a workload file into memory, the file extension selects the loader
+static bool bench_load_workload(const char* path, bench_workload_t* wl) {
+    wl->path = path;
+    wl->name = bench_file_name(path);
+    bench_file_ext(path, wl->ext, sizeof(wl->ext));
+    wl->data = bench_read_file(path);
+    return 0 != wl->data.ptr;
+}
+
+static const getopt_option_t option_list[] = {
+    { "help", 'h', GETOPT_OPTION_TYPE_NO_ARG, 0, 'h', "print this help text", 0 },
+    { "system", 's', GETOPT_OPTION_TYPE_REQUIRED, 0, 's', "only run systems with this name", "name" },
+    { "secs", 't', GETOPT_OPTION_TYPE_REQUIRED, 0, 't', "emulated seconds per system (default: 5)", "secs" },
+    { "reps", 'n', GETOPT_OPTION_TYPE_REQUIRED, 0, 'n', "repetitions per system (default: 1)", "n" },
+    { "format", 'f', GETOPT_OPTION_TYPE_REQUIRED, 0, 'f', "output format (default: table)", "table|csv|json" },
+    { "output", 'o', GETOPT_OPTION_TYPE_REQUIRED, 0, 'o', "write results to file instead of stdout", "file" },
+    { "baseline", 'b', GETOPT_OPTION_TYPE_REQUIRED, 0, 'b', "compare against a CSV baseline file", "file.csv" },
+    { "threshold", 'r', GETOPT_OPTION_TYPE_REQUIRED, 0, 'r', "max throughput regression in percent (default: 5)", "percent" },
+    { "file", 'F', GETOPT_OPTION_TYPE_REQUIRED, 0, 'F', "load and start a workload file before measuring (requires --system)", "path" },
+    { "input", 'i', GETOPT_OPTION_TYPE_REQUIRED, 0, 'i', "keyboard input to type after loading the workload", "text" },
+    { "warmup", 'w', GETOPT_OPTION_TYPE_REQUIRED, 0, 'w', "emulated warmup seconds after loading the workload (default: 10)", "secs" },
+    { "journal", 'j', GETOPT_OPTION_TYPE_REQUIRED, 0, 'j', "replay an input journal recorded in a sokol frontend (requires --system)", "path" },
+    { "list", 'l', GETOPT_OPTION_TYPE_NO_ARG, 0, 'l', "list available systems", 0 },
+    GETOPT_OPTIONS_END
+};
+
+static char help_buf[2048];
+
+int main(int argc, const char** argv) {
+    const char* system_filter = 0;
+    const char* output_path = 0;
+    const char* baseline_path = 0;
+    const char* workload_path = 0;
+    const char* input = 0;
+    const char* journal_path = 0;
+    double secs = BENCH_DEFAULT_SECS;
+    double warmup_secs = BENCH_DEFAULT_WARMUP_SECS;
+    double threshold = BENCH_DEFAULT_THRESHOLD;
+    int num_reps = 1;
+    bench_format_t format = BENCH_FORMAT_TABLE;
+    getopt_context_t ctx;
+    if (getopt_create_context(&ctx, argc, argv, option_list) < 0) {
+        fprintf(stderr, "getopt_create_context() failed!\n");
+        return 10;
+    }
+    int opt;
+    while ((opt = getopt_next(&ctx)) != -1) {
+        switch (opt) {
+            case '+':
+                fprintf(stderr, "got argument without flag: %s\n", ctx.current_opt_arg);
+                return 10;
+            case '?':
+                fprintf(stderr, "unknown flag %s\n", ctx.current_opt_arg);
+                return 10;
+            case '!':
+                fprintf(stderr, "invalid use of flag %s\n", ctx.current_opt_arg);
+                return 10;
+            case 'h':
+                fprintf(stderr, "chips-bench -- headless emulator benchmark\n\n");
+                fprintf(stderr, "%s", getopt_create_help_string(&ctx, help_buf, sizeof(help_buf)));
+                return 0;
+            case 's':
+                system_filter = ctx.current_opt_arg;
+                break;
+            case 't':
+                secs = atof(ctx.current_opt_arg);
+                break;
+            case 'n':
+                num_reps = atoi(ctx.current_opt_arg);
+                break;
+            case 'f':
+                if (0 == strcmp(ctx.current_opt_arg, "table")) {
+                    format = BENCH_FORMAT_TABLE;
+                }
+                else if (0 == strcmp(ctx.current_opt_arg, "csv")) {
+                    format = BENCH_FORMAT_CSV;
+                }
+                else if (0 == strcmp(ctx.current_opt_arg, "json")) {
+                    format = BENCH_FORMAT_JSON;
+                }
+                else {
+                    fprintf(stderr, "unknown output format '%s'\n", ctx.current_opt_arg);
+                    return 10;
+                }
+                break;
+            case 'o':
+                output_path = ctx.current_opt_arg;
+                break;
+            case 'b':
+                baseline_path = ctx.current_opt_arg;
+                break;
+            case 'r':
+                threshold = atof(ctx.current_opt_arg);
+                break;
+            case 'F':
+                workload_path = ctx.current_opt_arg;
+                break;
+            case 'i':
+                input = ctx.current_opt_arg;
+                break;
+            case 'w':
+                warmup_secs = atof(ctx.current_opt_arg);
+                break;
+            case 'j':
+                journal_path = ctx.current_opt_arg;
+                break;
+            case 'l':
+                for (size_t i = 0; i < BENCH_NUM_SYSTEMS; i++) {
+                    printf("%s (%s)\n", bench_systems[i].name, bench_systems[i].config);
+                }
+                return 0;
+            default:
+                break;
+        }
+    }
+    if ((secs <= 0.0) || (secs > 3600.0)) {
+        fprintf(stderr, "emulated seconds must be in range (0, 3600]\n");
+        return 10;
+    }
+    if ((num_reps < 1) || (num_reps > BENCH_MAX_REPS)) {
+        fprintf(stderr, "repetitions must be in range [1, %d]\n", BENCH_MAX_REPS);
+        return 10;
+    }
+    if ((threshold < 0.0) || (threshold >= 100.0)) {
+        fprintf(stderr, "regression threshold must be in range [0, 100)\n");
+        return 10;
+    }
+    if ((warmup_secs < 0.0) || (warmup_secs > 3600.0)) {
+        fprintf(stderr, "warmup seconds must be in range [0, 3600]\n");
+        return 10;
+    }
+    if (input && !workload_path) {
+        fprintf(stderr, "--input requires --file\n");
+        return 10;
+    }
+    if (journal_path && !system_filter) {
+        fprintf(stderr, "--journal requires --system\n");
+        return 10;
+    }
+    bench_workload_t workload = { 0 };
+    if (workload_path) {
+        if (!system_filter) {
+            fprintf(stderr, "--file requires --system\n");
+            return 10;
+        }
+        if (!bench_load_workload(workload_path, &workload)) {
+            return 10;
+        }
+        workload.input = input;
+        workload.warmup_usec = (uint32_t)(warmup_secs * 1000000.0);
+    }
+    static bench_baseline_t baseline[BENCH_MAX_BASELINE];
+    int num_baseline = 0;
+    if (baseline_path) {
+        num_baseline = bench_load_baseline(baseline_path, baseline, BENCH_MAX_BASELINE);
+        if (num_baseline < 0) {
+            return 10;
+        }
+    }
+    const uint32_t num_usec = (uint32_t)(secs * 1000000.0);
+
+    // the human-readable progress table goes to stderr if machine-readable
+    // output is written to stdout
+    FILE* log_fp = ((format != BENCH_FORMAT_TABLE) && !output_path) ? stderr : stdout;
+
+    stm_setup();
+    #if defined(CHIPS_BENCH_PROF)
+    bench_prof_setup();
+    #endif
+    if (journal_path) {
+        fprintf(log_fp, "== replaying journal '%s' %d time(s)\n\n", journal_path, num_reps);
+    }
+    else {
+        fprintf(log_fp, "== running each system %d time(s) for %.2f emulated secs\n\n", num_reps, num_usec / 1000000.0);
+    }
+    bench_print_table_header(log_fp);
+    static bench_stats_t stats[BENCH_NUM_SYSTEMS];
+    int num_stats = 0;
+    for (size_t i = 0; i < BENCH_NUM_SYSTEMS; i++) {
+        const bench_system_t* bs = &bench_systems[i];
+        if (system_filter && (0 != strcmp(system_filter, bs->name))) {
+            continue;
+        }
+        if (workload_path && !bs->load) {
+            fprintf(stderr, "system '%s' can't load workload files\n", bs->name);
+            return 10;
+        }
+        if (journal_path && !(bs->key_down && bs->key_up)) {
+            fprintf(stderr, "system '%s' can't replay input journals\n", bs->name);
+            return 10;
+        }
+        stats[num_stats] = bench_run_reps(bs, workload_path ? &workload : 0, journal_path, num_usec, num_reps);
+        bench_print_table_row(log_fp, &stats[num_stats]);
+        fflush(log_fp);
+        num_stats++;
+    }
+    if (0 == num_stats) {
+        fprintf(stderr, "no system matches '%s'\n", system_filter);
+        return 10;
+    }
+
+    #if defined(CHIPS_BENCH_PROF)
+    fprintf(log_fp, "\n== host time per chip (sampled, 1 in ~%d calls)\n\n", BENCH_PROF_SAMPLE_INTERVAL);
+    bench_print_prof_table(log_fp, stats, num_stats);
+    #endif
+
+    if (format != BENCH_FORMAT_TABLE) {
+        FILE* out_fp = stdout;
+        if (output_path) {
+            out_fp = fopen(output_path, "w");
+            if (!out_fp) {
+                fprintf(stderr, "failed to open output file '%s'\n", output_path);
+                return 10;
+            }
+        }
+        if (format == BENCH_FORMAT_CSV) {
+            bench_write_csv(out_fp, stats, num_stats);
+        }
+        else {
+            bench_write_json(out_fp, stats, num_stats);
+        }
+        if (output_path) {
+            fclose(out_fp);
+        }
+    }
+
+    // compare median throughput against the baseline
+    int num_regressions = 0;
+    if (baseline_path) {
+        fprintf(log_fp, "\n== comparing against baseline '%s' (threshold: %.1f%%)\n\n", baseline_path, threshold);
+        for (int i = 0; i < num_stats; i++) {
+            const bench_stats_t* s = &stats[i];
+            const bench_baseline_t* base = bench_find_baseline(baseline, num_baseline, s);
+            if (!base || (base->ticks_per_sec <= 0.0)) {
+                fprintf(log_fp, "%-10s %-10s %-16s no baseline\n", s->sys->name, s->sys->config, s->workload);
+                continue;
+            }
+            const double cur = bench_ticks_per_sec(s, s->host_secs_median);
+            const double change = ((cur / base->ticks_per_sec) - 1.0) * 100.0;
+            const bool regressed = change < -threshold;
+            if (regressed) {
+                num_regressions++;
+            }
+            fprintf(log_fp, "%-10s %-10s %-16s %+8.2f%% %s\n", s->sys->name, s->sys->config, s->workload, change, regressed ? "*** REGRESSION" : "ok");
+        }
+        if (num_regressions > 0) {
+            fprintf(log_fp, "\n%d system(s) regressed by more than %.1f%%\n", num_regressions, threshold);
+        }
+    }
+    return (num_regressions > 0) ? 10 : 0;
+}
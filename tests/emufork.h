@@ -0,0 +1,179 @@
+#pragma once
+/*
+    Copy-on-write clones of a running headless emulator for speculative
+    execution (e.g. trying every input for the next N frames).
+
+    emufork_run() forks one child process per branch. Each child starts
+    with the exact state of the caller's emulator instance and runs it
+    independently. The system struct, the RAM banks the mem_t page tables
+    point into and the ROMs are shared with the parent through the
+    kernel's page-granular copy-on-write, so a branch only pays for the
+    pages it actually writes to instead of a full copy of the system. And
+    since a clone is a copy of the whole address space, the pointers
+    inside the system struct (mem_t pages, callbacks) stay valid without
+    any fixups.
+
+    The branch callback runs in the child process and returns a small
+    fixed-size result to the parent through a pipe. The child is a forked
+    copy of a possibly multithreaded process, so the callback must not
+    allocate memory, use stdio or take locks (the chips emulators don't
+    do any of this in their exec functions).
+
+    Only available on POSIX systems, emufork_supported() returns false
+    on Windows.
+
+    Include this header only once per executable.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#if !defined(_WIN32)
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+/* max size of a branch result in bytes */
+#define EMUFORK_MAX_RESULT_SIZE (256)
+/* max number of concurrently running branches per emufork_run() call */
+#define EMUFORK_MAX_PROCS (64)
+
+typedef struct {
+    int num_branches;
+    int max_procs;      /* max number of concurrent child processes, 0 for 1 */
+    size_t result_size; /* size of a branch result in bytes */
+    void* results;      /* num_branches * result_size bytes, zeroed for failed branches */
+    void (*func)(int branch_index, void* result, void* user_data);
+    void* user_data;
+} emufork_desc_t;
+
+bool emufork_supported(void) {
+    #if defined(_WIN32)
+    return false;
+    #else
+    return true;
+    #endif
+}
+
+#if !defined(_WIN32)
+typedef struct {
+    pid_t pid;
+    int fd;
+    int branch_index;
+} _emufork_proc_t;
+
+static bool _emufork_write(int fd, const uint8_t* ptr, size_t size) {
+    while (size > 0) {
+        ssize_t res = write(fd, ptr, size);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        ptr += res;
+        size -= (size_t)res;
+    }
+    return true;
+}
+
+static size_t _emufork_read(int fd, uint8_t* ptr, size_t size) {
+    size_t num_read = 0;
+    while (num_read < size) {
+        ssize_t res = read(fd, ptr + num_read, size - num_read);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        else if (res == 0) {
+            break;
+        }
+        num_read += (size_t)res;
+    }
+    return num_read;
+}
+
+/* fork a branch, returns false if the child process couldn't be created */
+static bool _emufork_start(const emufork_desc_t* desc, int branch_index, _emufork_proc_t* proc) {
+    int fds[2];
+    if (0 != pipe(fds)) {
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        /* in the child process */
+        close(fds[0]);
+        uint8_t result[EMUFORK_MAX_RESULT_SIZE];
+        memset(result, 0, sizeof(result));
+        desc->func(branch_index, result, desc->user_data);
+        const bool ok = _emufork_write(fds[1], result, desc->result_size);
+        close(fds[1]);
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    proc->pid = pid;
+    proc->fd = fds[0];
+    proc->branch_index = branch_index;
+    return true;
+}
+
+/* wait for a branch to finish and fetch its result, returns true on success */
+static bool _emufork_finish(const emufork_desc_t* desc, const _emufork_proc_t* proc) {
+    uint8_t* result = (uint8_t*)desc->results + (size_t)proc->branch_index * desc->result_size;
+    const size_t num_read = _emufork_read(proc->fd, result, desc->result_size);
+    close(proc->fd);
+    int status = 0;
+    while ((waitpid(proc->pid, &status, 0) < 0) && (errno == EINTR));
+    const bool ok = (num_read == desc->result_size) && WIFEXITED(status) && (0 == WEXITSTATUS(status));
+    if (!ok) {
+        memset(result, 0, desc->result_size);
+    }
+    return ok;
+}
+#endif
+
+/* run all branches and wait for completion, returns the number of successful branches */
+int emufork_run(const emufork_desc_t* desc) {
+    assert(desc && desc->func && desc->results && (desc->num_branches >= 0));
+    assert((desc->result_size > 0) && (desc->result_size <= EMUFORK_MAX_RESULT_SIZE));
+    memset(desc->results, 0, (size_t)desc->num_branches * desc->result_size);
+    #if defined(_WIN32)
+    return 0;
+    #else
+    int max_procs = (desc->max_procs > 0) ? desc->max_procs : 1;
+    if (max_procs > EMUFORK_MAX_PROCS) {
+        max_procs = EMUFORK_MAX_PROCS;
+    }
+    /* running branches are finished in the order they were started */
+    _emufork_proc_t procs[EMUFORK_MAX_PROCS];
+    int head = 0;
+    int num_running = 0;
+    int next_branch = 0;
+    int num_ok = 0;
+    while ((next_branch < desc->num_branches) || (num_running > 0)) {
+        while ((next_branch < desc->num_branches) && (num_running < max_procs)) {
+            if (_emufork_start(desc, next_branch, &procs[(head + num_running) % max_procs])) {
+                num_running++;
+            }
+            next_branch++;
+        }
+        if (num_running > 0) {
+            if (_emufork_finish(desc, &procs[head])) {
+                num_ok++;
+            }
+            head = (head + 1) % max_procs;
+            num_running--;
+        }
+    }
+    return num_ok;
+    #endif
+}
@@ -0,0 +1,221 @@
+#pragma once
+//------------------------------------------------------------------------------
+//  golden.h
+//
+//  Golden reference comparison helpers for vice-testbench: a vectorized
+//  byte compare which produces a bitmap of the differing bytes, reading and
+//  writing of binary PPM images, and printing of text mismatch maps.
+//
+//  The compare works on 16 bytes at a time with SSE2 when available, and
+//  on 64-bit words otherwise. The difference bitmap has one bit per
+//  compared byte (LSB first), so that mismatch maps can be built for any
+//  element size afterwards.
+//------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <assert.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define GOLDEN_SSE2
+#endif
+
+// max number of text lines in a mismatch map
+#define GOLDEN_MAX_MAP_LINES (64)
+// max number of individually listed mismatches
+#define GOLDEN_MAX_LISTED (16)
+
+// a growable, zero-terminated text buffer
+typedef struct {
+    char* buf;
+    size_t len;
+    size_t cap;
+} golden_text_t;
+
+// an RGB image, 3 bytes per pixel
+typedef struct {
+    int width;
+    int height;
+    uint8_t* pixels;
+} golden_image_t;
+
+static inline bool golden_bit(const uint8_t* bits, size_t i) {
+    return 0 != (bits[i >> 3] & (1 << (i & 7)));
+}
+
+static inline int golden_popcount8(uint8_t x) {
+    int n = 0;
+    for (; x; x &= x - 1) {
+        n++;
+    }
+    return n;
+}
+
+// compare num bytes, set a bit in diff_bits (which must have room for
+// (num+7)/8 bytes) for each differing byte, returns the number of differing bytes
+static size_t golden_compare(const uint8_t* a, const uint8_t* b, size_t num, uint8_t* diff_bits) {
+    memset(diff_bits, 0, (num + 7) / 8);
+    size_t num_diffs = 0;
+    size_t i = 0;
+    #if defined(GOLDEN_SSE2)
+    for (; (i + 16) <= num; i += 16) {
+        const __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        const __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        const unsigned mask = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) & 0xFFFF;
+        if (mask) {
+            diff_bits[i >> 3] = (uint8_t)mask;
+            diff_bits[(i >> 3) + 1] = (uint8_t)(mask >> 8);
+            num_diffs += golden_popcount8((uint8_t)mask) + golden_popcount8((uint8_t)(mask >> 8));
+        }
+    }
+    #endif
+    for (; (i + 8) <= num; i += 8) {
+        uint64_t va, vb;
+        memcpy(&va, a + i, 8);
+        memcpy(&vb, b + i, 8);
+        const uint64_t x = va ^ vb;
+        if (x) {
+            // mismatches are rare, so differing words are resolved bytewise
+            uint8_t mask = 0;
+            for (int k = 0; k < 8; k++) {
+                if (a[i + k] != b[i + k]) {
+                    mask |= 1 << k;
+                }
+            }
+            diff_bits[i >> 3] = mask;
+            num_diffs += golden_popcount8(mask);
+        }
+    }
+    for (; i < num; i++) {
+        if (a[i] != b[i]) {
+            diff_bits[i >> 3] |= 1 << (i & 7);
+            num_diffs++;
+        }
+    }
+    return num_diffs;
+}
+
+static void golden_printf(golden_text_t* txt, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    const int len = vsnprintf(0, 0, fmt, args);
+    va_end(args);
+    if (len <= 0) {
+        return;
+    }
+    if ((txt->len + (size_t)len + 1) > txt->cap) {
+        txt->cap = (txt->cap * 2) > (txt->len + len + 1) ? (txt->cap * 2) : (txt->len + len + 1);
+        txt->buf = realloc(txt->buf, txt->cap);
+        assert(txt->buf);
+    }
+    va_start(args, fmt);
+    vsnprintf(txt->buf + txt->len, txt->cap - txt->len, fmt, args);
+    va_end(args);
+    txt->len += (size_t)len;
+}
+
+// map of differing bytes with cols bytes per line, followed by a list
+// of the first differing bytes, addr is the address of the first byte
+static void golden_memory_map(golden_text_t* txt, uint16_t addr, const uint8_t* expected, const uint8_t* actual, size_t num, const uint8_t* diff_bits, int cols) {
+    const size_t num_rows = (num + cols - 1) / cols;
+    int num_lines = 0;
+    for (size_t row = 0; row < num_rows; row++) {
+        const size_t start = row * cols;
+        const size_t end = (start + cols) < num ? (start + cols) : num;
+        bool row_differs = false;
+        for (size_t i = start; i < end; i++) {
+            row_differs |= golden_bit(diff_bits, i);
+        }
+        // small maps are printed completely, large maps only the differing lines
+        if (!row_differs && (num_rows > GOLDEN_MAX_MAP_LINES)) {
+            continue;
+        }
+        if (num_lines++ == GOLDEN_MAX_MAP_LINES) {
+            golden_printf(txt, "...\n");
+            break;
+        }
+        golden_printf(txt, "$%04X ", (uint16_t)(addr + start));
+        for (size_t i = start; i < end; i++) {
+            golden_printf(txt, "%c", golden_bit(diff_bits, i) ? 'X' : '.');
+        }
+        golden_printf(txt, "\n");
+    }
+    int num_listed = 0;
+    for (size_t i = 0; (i < num) && (num_listed < GOLDEN_MAX_LISTED); i++) {
+        if (golden_bit(diff_bits, i)) {
+            golden_printf(txt, "$%04X: expected $%02X, got $%02X\n", (uint16_t)(addr + i), expected[i], actual[i]);
+            num_listed++;
+        }
+    }
+}
+
+// map of differing pixels with one character per cell_size * cell_size
+// pixels, returns the number of differing pixels
+static size_t golden_image_map(golden_text_t* txt, const golden_image_t* img, const uint8_t* diff_bits, int cell_size) {
+    size_t num_pixels = 0;
+    const int cols = (img->width + cell_size - 1) / cell_size;
+    const int rows = (img->height + cell_size - 1) / cell_size;
+    for (int row = 0; row < rows; row++) {
+        golden_printf(txt, "%4d ", row * cell_size);
+        for (int col = 0; col < cols; col++) {
+            int num_cell_pixels = 0;
+            for (int y = row * cell_size; (y < (row + 1) * cell_size) && (y < img->height); y++) {
+                for (int x = col * cell_size; (x < (col + 1) * cell_size) && (x < img->width); x++) {
+                    const size_t i = ((size_t)y * img->width + x) * 3;
+                    if (golden_bit(diff_bits, i) || golden_bit(diff_bits, i + 1) || golden_bit(diff_bits, i + 2)) {
+                        num_cell_pixels++;
+                    }
+                }
+            }
+            golden_printf(txt, "%c", num_cell_pixels ? 'X' : '.');
+            num_pixels += num_cell_pixels;
+        }
+        golden_printf(txt, "\n");
+    }
+    return num_pixels;
+}
+
+static void golden_image_free(golden_image_t* img) {
+    free(img->pixels);
+    memset(img, 0, sizeof(golden_image_t));
+}
+
+// read a binary PPM (P6) image with 8-bit channels
+static bool golden_read_ppm(const char* path, golden_image_t* img) {
+    memset(img, 0, sizeof(golden_image_t));
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        return false;
+    }
+    int max_val = 0;
+    bool success = false;
+    if ((3 == fscanf(fp, "P6 %d %d %d", &img->width, &img->height, &max_val)) &&
+        (max_val == 255) && (img->width > 0) && (img->height > 0) &&
+        (img->width <= 4096) && (img->height <= 4096) && (fgetc(fp) != EOF))
+    {
+        const size_t size = (size_t)img->width * img->height * 3;
+        img->pixels = malloc(size);
+        assert(img->pixels);
+        success = (size == fread(img->pixels, 1, size, fp));
+    }
+    fclose(fp);
+    if (!success) {
+        golden_image_free(img);
+    }
+    return success;
+}
+
+static bool golden_write_ppm(const char* path, const golden_image_t* img) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        return false;
+    }
+    fprintf(fp, "P6\n%d %d\n255\n", img->width, img->height);
+    const size_t size = (size_t)img->width * img->height * 3;
+    const bool success = size == fwrite(img->pixels, 1, size, fp);
+    fclose(fp);
+    return success;
+}
@@ -0,0 +1,358 @@
+#pragma once
+/*
+    A content-addressed cache for the files loaded by many jobs, shared by
+    all worker threads of chips-batch.
+
+    A file is only read from disk the first time a job asks for it. The
+    file content is identified by its hash, so identical files under
+    different paths are only kept once. Jobs get the shared, immutable
+    file content and must release it when done.
+
+    Released files are kept around up to a memory budget, beyond that the
+    least recently used files which are not in use by any job are evicted.
+    While a file is being read, other threads asking for the same path
+    wait for it instead of reading it again.
+
+    Include this header only once per executable.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include "chips/chips_common.h"
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* number of hash buckets for paths and file contents */
+#define IMGCACHE_NUM_BUCKETS (1024)
+/* default memory budget for files not in use */
+#define IMGCACHE_DEFAULT_MAX_BYTES (256 * 1024 * 1024)
+
+typedef struct {
+    size_t max_bytes;   /* memory budget for files not in use, 0 for default */
+    /* read a file into malloc'ed memory, returns an empty range on error */
+    chips_range_t (*read_file)(const char* path);
+} imgcache_desc_t;
+
+typedef struct {
+    chips_range_t data;
+} imgcache_file_t;
+
+typedef struct {
+    uint64_t num_hits;      /* requests served without reading a file */
+    uint64_t num_reads;     /* files read from disk */
+    uint64_t num_shared;    /* files read which had the same content as another path */
+    uint64_t num_evicted;   /* files dropped to stay within the memory budget */
+    uint64_t bytes_read;
+} imgcache_stats_t;
+
+/* a cached file content */
+typedef struct _imgcache_blob_t {
+    imgcache_file_t file;               /* must be first, handed out to the jobs */
+    struct _imgcache_blob_t* next;      /* next in hash bucket */
+    struct _imgcache_blob_t* lru_prev;  /* only unused blobs are in the LRU list */
+    struct _imgcache_blob_t* lru_next;
+    uint32_t hash;
+    int num_refs;
+} _imgcache_blob_t;
+
+/* a path which has been asked for, the path string follows the header */
+typedef struct _imgcache_path_t {
+    struct _imgcache_path_t* next;      /* next in hash bucket */
+    _imgcache_blob_t* blob;             /* 0 if not loaded or evicted */
+    uint32_t hash;
+    bool loading;                       /* a thread is reading the file */
+} _imgcache_path_t;
+
+static struct {
+    bool valid;
+    imgcache_desc_t desc;
+    size_t lru_bytes;
+    _imgcache_blob_t* lru_head;         /* least recently used */
+    _imgcache_blob_t* lru_tail;
+    _imgcache_blob_t* blobs[IMGCACHE_NUM_BUCKETS];
+    _imgcache_path_t* paths[IMGCACHE_NUM_BUCKETS];
+    imgcache_stats_t stats;
+    #if defined(_WIN32)
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE cond;
+    #else
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    #endif
+} _imgcache;
+
+static void _imgcache_lock(void) {
+    #if defined(_WIN32)
+    EnterCriticalSection(&_imgcache.lock);
+    #else
+    pthread_mutex_lock(&_imgcache.lock);
+    #endif
+}
+
+static void _imgcache_unlock(void) {
+    #if defined(_WIN32)
+    LeaveCriticalSection(&_imgcache.lock);
+    #else
+    pthread_mutex_unlock(&_imgcache.lock);
+    #endif
+}
+
+static void _imgcache_wait(void) {
+    #if defined(_WIN32)
+    SleepConditionVariableCS(&_imgcache.cond, &_imgcache.lock, INFINITE);
+    #else
+    pthread_cond_wait(&_imgcache.cond, &_imgcache.lock);
+    #endif
+}
+
+static void _imgcache_signal(void) {
+    #if defined(_WIN32)
+    WakeAllConditionVariable(&_imgcache.cond);
+    #else
+    pthread_cond_broadcast(&_imgcache.cond);
+    #endif
+}
+
+/* FNV-1a */
+static uint32_t _imgcache_hash(const uint8_t* ptr, size_t size) {
+    uint32_t hash = 0x811C9DC5;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ ptr[i]) * 0x01000193;
+    }
+    return hash;
+}
+
+static const char* _imgcache_path_str(_imgcache_path_t* path) {
+    return (const char*)(path + 1);
+}
+
+/* read a file into a new blob, called without the lock held */
+static _imgcache_blob_t* _imgcache_read(const char* path) {
+    const chips_range_t data = _imgcache.desc.read_file(path);
+    if (!data.ptr) {
+        return 0;
+    }
+    _imgcache_blob_t* blob = calloc(1, sizeof(_imgcache_blob_t));
+    assert(blob);
+    blob->file.data = data;
+    blob->hash = _imgcache_hash(data.ptr, data.size);
+    return blob;
+}
+
+static void _imgcache_free_blob(_imgcache_blob_t* blob) {
+    free(blob->file.data.ptr);
+    free(blob);
+}
+
+static size_t _imgcache_size(const _imgcache_blob_t* blob) {
+    return blob->file.data.size;
+}
+
+/* find or create the entry for a path */
+static _imgcache_path_t* _imgcache_find_path(const char* str) {
+    const size_t len = strlen(str);
+    const uint32_t hash = _imgcache_hash((const uint8_t*)str, len);
+    _imgcache_path_t** bucket = &_imgcache.paths[hash % IMGCACHE_NUM_BUCKETS];
+    for (_imgcache_path_t* path = *bucket; path; path = path->next) {
+        if ((path->hash == hash) && (0 == strcmp(_imgcache_path_str(path), str))) {
+            return path;
+        }
+    }
+    _imgcache_path_t* path = calloc(1, sizeof(_imgcache_path_t) + len + 1);
+    assert(path);
+    memcpy(path + 1, str, len + 1);
+    path->hash = hash;
+    path->next = *bucket;
+    *bucket = path;
+    return path;
+}
+
+/* find a blob with the same content */
+static _imgcache_blob_t* _imgcache_find_blob(_imgcache_blob_t* blob) {
+    for (_imgcache_blob_t* cur = _imgcache.blobs[blob->hash % IMGCACHE_NUM_BUCKETS]; cur; cur = cur->next) {
+        const chips_range_t a = cur->file.data;
+        const chips_range_t b = blob->file.data;
+        if ((cur->hash == blob->hash) && (a.size == b.size) && (0 == memcmp(a.ptr, b.ptr, a.size))) {
+            return cur;
+        }
+    }
+    return 0;
+}
+
+static void _imgcache_lru_remove(_imgcache_blob_t* blob) {
+    if (blob->lru_prev) {
+        blob->lru_prev->lru_next = blob->lru_next;
+    }
+    else {
+        _imgcache.lru_head = blob->lru_next;
+    }
+    if (blob->lru_next) {
+        blob->lru_next->lru_prev = blob->lru_prev;
+    }
+    else {
+        _imgcache.lru_tail = blob->lru_prev;
+    }
+    blob->lru_prev = blob->lru_next = 0;
+    _imgcache.lru_bytes -= _imgcache_size(blob);
+}
+
+static void _imgcache_lru_append(_imgcache_blob_t* blob) {
+    blob->lru_prev = _imgcache.lru_tail;
+    blob->lru_next = 0;
+    if (_imgcache.lru_tail) {
+        _imgcache.lru_tail->lru_next = blob;
+    }
+    else {
+        _imgcache.lru_head = blob;
+    }
+    _imgcache.lru_tail = blob;
+    _imgcache.lru_bytes += _imgcache_size(blob);
+}
+
+/* take a reference, an unused blob leaves the LRU list */
+static void _imgcache_ref(_imgcache_blob_t* blob) {
+    if (0 == blob->num_refs++) {
+        _imgcache_lru_remove(blob);
+    }
+}
+
+/* drop unused blobs until the budget is met, evicted paths are read again on the next request */
+static void _imgcache_evict(void) {
+    while ((_imgcache.lru_bytes > _imgcache.desc.max_bytes) && _imgcache.lru_head) {
+        _imgcache_blob_t* blob = _imgcache.lru_head;
+        _imgcache_lru_remove(blob);
+        _imgcache_blob_t** link = &_imgcache.blobs[blob->hash % IMGCACHE_NUM_BUCKETS];
+        while (*link != blob) {
+            link = &(*link)->next;
+        }
+        *link = blob->next;
+        /* evictions are rare, so a scan over all paths is ok */
+        for (int i = 0; i < IMGCACHE_NUM_BUCKETS; i++) {
+            for (_imgcache_path_t* path = _imgcache.paths[i]; path; path = path->next) {
+                if (path->blob == blob) {
+                    path->blob = 0;
+                }
+            }
+        }
+        _imgcache_free_blob(blob);
+        _imgcache.stats.num_evicted++;
+    }
+}
+
+void imgcache_init(const imgcache_desc_t* desc) {
+    assert(desc && desc->read_file);
+    memset(&_imgcache, 0, sizeof(_imgcache));
+    _imgcache.desc = *desc;
+    if (0 == _imgcache.desc.max_bytes) {
+        _imgcache.desc.max_bytes = IMGCACHE_DEFAULT_MAX_BYTES;
+    }
+    #if defined(_WIN32)
+    InitializeCriticalSection(&_imgcache.lock);
+    InitializeConditionVariable(&_imgcache.cond);
+    #else
+    pthread_mutex_init(&_imgcache.lock, 0);
+    pthread_cond_init(&_imgcache.cond, 0);
+    #endif
+    _imgcache.valid = true;
+}
+
+/* all files must have been released */
+void imgcache_shutdown(void) {
+    assert(_imgcache.valid);
+    for (int i = 0; i < IMGCACHE_NUM_BUCKETS; i++) {
+        _imgcache_blob_t* blob = _imgcache.blobs[i];
+        while (blob) {
+            _imgcache_blob_t* next = blob->next;
+            assert(0 == blob->num_refs);
+            _imgcache_free_blob(blob);
+            blob = next;
+        }
+        _imgcache_path_t* path = _imgcache.paths[i];
+        while (path) {
+            _imgcache_path_t* next = path->next;
+            free(path);
+            path = next;
+        }
+    }
+    #if defined(_WIN32)
+    DeleteCriticalSection(&_imgcache.lock);
+    #else
+    pthread_cond_destroy(&_imgcache.cond);
+    pthread_mutex_destroy(&_imgcache.lock);
+    #endif
+    _imgcache.valid = false;
+}
+
+/* get the content of a file, returns 0 on error */
+const imgcache_file_t* imgcache_acquire(const char* path_str) {
+    assert(_imgcache.valid && path_str);
+    _imgcache_lock();
+    _imgcache_path_t* path = _imgcache_find_path(path_str);
+    while (path->loading) {
+        _imgcache_wait();
+    }
+    _imgcache_blob_t* blob = path->blob;
+    if (blob) {
+        _imgcache_ref(blob);
+        _imgcache.stats.num_hits++;
+    }
+    else {
+        path->loading = true;
+        _imgcache_unlock();
+        blob = _imgcache_read(path_str);
+        _imgcache_lock();
+        path->loading = false;
+        if (blob) {
+            _imgcache.stats.num_reads++;
+            _imgcache.stats.bytes_read += _imgcache_size(blob);
+            _imgcache_blob_t* shared = _imgcache_find_blob(blob);
+            if (shared) {
+                _imgcache_free_blob(blob);
+                blob = shared;
+                _imgcache_ref(blob);
+                _imgcache.stats.num_shared++;
+            }
+            else {
+                _imgcache_blob_t** bucket = &_imgcache.blobs[blob->hash % IMGCACHE_NUM_BUCKETS];
+                blob->next = *bucket;
+                *bucket = blob;
+                blob->num_refs = 1;
+            }
+            path->blob = blob;
+        }
+        _imgcache_signal();
+    }
+    _imgcache_unlock();
+    return blob ? &blob->file : 0;
+}
+
+/* release a file returned by imgcache_acquire() */
+void imgcache_release(const imgcache_file_t* file) {
+    assert(_imgcache.valid);
+    if (!file) {
+        return;
+    }
+    _imgcache_blob_t* blob = (_imgcache_blob_t*)file;
+    _imgcache_lock();
+    assert(blob->num_refs > 0);
+    if (0 == --blob->num_refs) {
+        _imgcache_lru_append(blob);
+        _imgcache_evict();
+    }
+    _imgcache_unlock();
+}
+
+imgcache_stats_t imgcache_stats(void) {
+    assert(_imgcache.valid);
+    _imgcache_lock();
+    const imgcache_stats_t stats = _imgcache.stats;
+    _imgcache_unlock();
+    return stats;
+}
@@ -0,0 +1,193 @@
+#pragma once
+/*
+    A minimal work-stealing thread pool for running many independent jobs
+    on all CPU cores (pthreads, or Win32 threads on Windows).
+
+    Jobs are identified by their index. Each worker starts with a
+    contiguous range of job indices and takes jobs from the front of its
+    own range, when it runs out of work it steals jobs from the back of
+    other workers' ranges. The job callback is called on the worker
+    threads and must only touch data owned by the job.
+
+    Include this header only once per executable.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/* max number of worker threads */
+#define JOBPOOL_MAX_THREADS (256)
+
+typedef struct {
+    int num_jobs;
+    int num_threads;    /* 0 for number of cores */
+    void (*func)(int job_index, int worker_index, void* user_data);
+    void* user_data;
+} jobpool_desc_t;
+
+/* each worker owns a range of job indices [head, tail) */
+typedef struct {
+    #if defined(_WIN32)
+    CRITICAL_SECTION lock;
+    HANDLE thread;
+    #else
+    pthread_mutex_t lock;
+    pthread_t thread;
+    #endif
+    int index;
+    int head;
+    int tail;
+    int num_jobs;
+    int num_steals;
+} _jobpool_worker_t;
+
+static struct {
+    jobpool_desc_t desc;
+    _jobpool_worker_t workers[JOBPOOL_MAX_THREADS];
+    int num_workers;
+} _jobpool;
+
+static void _jobpool_lock(_jobpool_worker_t* w) {
+    #if defined(_WIN32)
+    EnterCriticalSection(&w->lock);
+    #else
+    pthread_mutex_lock(&w->lock);
+    #endif
+}
+
+static void _jobpool_unlock(_jobpool_worker_t* w) {
+    #if defined(_WIN32)
+    LeaveCriticalSection(&w->lock);
+    #else
+    pthread_mutex_unlock(&w->lock);
+    #endif
+}
+
+/* number of logical CPU cores */
+int jobpool_num_cores(void) {
+    #if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+    #else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+    #endif
+}
+
+/* take the next job from the own range, or steal one from another worker */
+static int _jobpool_next_job(_jobpool_worker_t* w) {
+    int job_index = -1;
+    _jobpool_lock(w);
+    if (w->head < w->tail) {
+        job_index = w->head++;
+    }
+    _jobpool_unlock(w);
+    if (job_index >= 0) {
+        return job_index;
+    }
+    for (int i = 1; i < _jobpool.num_workers; i++) {
+        _jobpool_worker_t* victim = &_jobpool.workers[(w->index + i) % _jobpool.num_workers];
+        _jobpool_lock(victim);
+        if (victim->head < victim->tail) {
+            job_index = --victim->tail;
+        }
+        _jobpool_unlock(victim);
+        if (job_index >= 0) {
+            w->num_steals++;
+            return job_index;
+        }
+    }
+    return -1;
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI _jobpool_worker_func(LPVOID arg) {
+#else
+static void* _jobpool_worker_func(void* arg) {
+#endif
+    _jobpool_worker_t* w = (_jobpool_worker_t*) arg;
+    int job_index;
+    while ((job_index = _jobpool_next_job(w)) >= 0) {
+        _jobpool.desc.func(job_index, w->index, _jobpool.desc.user_data);
+        w->num_jobs++;
+    }
+    return 0;
+}
+
+/* run all jobs and wait for completion, returns the number of workers used */
+int jobpool_run(const jobpool_desc_t* desc) {
+    assert(desc && desc->func && (desc->num_jobs >= 0));
+    assert((desc->num_threads >= 0) && (desc->num_threads <= JOBPOOL_MAX_THREADS));
+    _jobpool.desc = *desc;
+    int num_workers = desc->num_threads ? desc->num_threads : jobpool_num_cores();
+    if (num_workers > JOBPOOL_MAX_THREADS) {
+        num_workers = JOBPOOL_MAX_THREADS;
+    }
+    if (num_workers > desc->num_jobs) {
+        num_workers = desc->num_jobs;
+    }
+    _jobpool.num_workers = num_workers;
+    for (int i = 0; i < num_workers; i++) {
+        _jobpool_worker_t* w = &_jobpool.workers[i];
+        w->index = i;
+        w->head = (int)(((int64_t)desc->num_jobs * i) / num_workers);
+        w->tail = (int)(((int64_t)desc->num_jobs * (i + 1)) / num_workers);
+        w->num_jobs = 0;
+        w->num_steals = 0;
+        #if defined(_WIN32)
+        InitializeCriticalSection(&w->lock);
+        #else
+        pthread_mutex_init(&w->lock, 0);
+        #endif
+    }
+    /* all ranges must be set up before the first worker starts stealing */
+    for (int i = 0; i < num_workers; i++) {
+        _jobpool_worker_t* w = &_jobpool.workers[i];
+        #if defined(_WIN32)
+        w->thread = CreateThread(0, 0, _jobpool_worker_func, w, 0, 0);
+        assert(w->thread);
+        #else
+        int res = pthread_create(&w->thread, 0, _jobpool_worker_func, w);
+        assert(0 == res); (void)res;
+        #endif
+    }
+    for (int i = 0; i < num_workers; i++) {
+        _jobpool_worker_t* w = &_jobpool.workers[i];
+        #if defined(_WIN32)
+        WaitForSingleObject(w->thread, INFINITE);
+        CloseHandle(w->thread);
+        #else
+        pthread_join(w->thread, 0);
+        #endif
+    }
+    /* a finished worker's lock may still be used by thieves until all workers are done */
+    for (int i = 0; i < num_workers; i++) {
+        _jobpool_worker_t* w = &_jobpool.workers[i];
+        #if defined(_WIN32)
+        DeleteCriticalSection(&w->lock);
+        #else
+        pthread_mutex_destroy(&w->lock);
+        #endif
+    }
+    return num_workers;
+}
+
+/* number of jobs run by a worker in the last jobpool_run() */
+int jobpool_num_jobs(int worker_index) {
+    assert((worker_index >= 0) && (worker_index < _jobpool.num_workers));
+    return _jobpool.workers[worker_index].num_jobs;
+}
+
+/* number of jobs a worker stole from other workers in the last jobpool_run() */
+int jobpool_num_steals(int worker_index) {
+    assert((worker_index >= 0) && (worker_index < _jobpool.num_workers));
+    return _jobpool.workers[worker_index].num_steals;
+}
@@ -0,0 +1,1045 @@
+//------------------------------------------------------------------------------
+//  m6502-fuzz.c
+//
+//  Coverage-guided differential fuzzer between the cycle-stepped m6502
+//  emulator and the transistor-level perfect6502 simulation.
+//
+//  Each fuzz case is a short random instruction stream (which loops back
+//  to its start), randomly filled memory and optional IRQ and NMI
+//  activity on given ticks. Both emulators run the case in lockstep like
+//  in m6502-perfect.c: the pins are compared after each tick (two
+//  half-cycles of perfect6502), and the registers and flags at each
+//  instruction boundary.
+//
+//  Since the netlist simulation is thousands of times slower than m6502,
+//  new cases are first run through m6502 alone to collect coverage
+//  features (opcode, number of ticks, interrupt lines, decimal mode and
+//  result flags), and only the cases which reach new features are kept
+//  in the corpus and run through the expensive lockstep comparison, in
+//  batches spread over all CPU cores (see jobpool.h). Diverging cases are
+//  minimized into a reproducer which can be replayed with --replay.
+//
+//  The cases on one core run together in a bit-sliced perfect6502 batch
+//  (up to 64 chips in one pass over the netlist, see --lanes). Each chip in
+//  a batch goes through the same steps as a scalar perfect6502, which
+//  --check-batch verifies node by node, including IRQ and NMI activity.
+//
+//  The JAM opcodes end a case, and so do the 'unstable' undocumented
+//  opcodes (ANE, LXA, SHA, SHX, SHY and TAS) unless --unstable is given.
+//------------------------------------------------------------------------------
+#include "perfect6502/types.h"
+#include "perfect6502/netlist_sim.h"
+#include "perfect6502/perfect6502.h"
+#define CHIPS_IMPL
+#include "chips/m6502.h"
+#define CHIPS_UTIL_IMPL
+#include "util/m6502dasm.h"
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#include "jobpool.h"
+#include "getopt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PROG_ADDR (0x0200)
+#define HANDLER_ADDR (0x0300)
+#define MAX_PROG_SIZE (64)
+// LDA #p, PHA, PLP, LDA #a, LDX #x, LDY #y to start with defined registers and flags
+#define PROLOGUE_SIZE (10)
+#define MAX_TICKS (4096)
+#define MAX_CORPUS (1<<14)
+#define MAX_BATCH (1024)
+#define MAX_FAILURES (64)
+// candidates generated per batch slot before a round gives up on new coverage
+#define CANDIDATES_PER_SLOT (256)
+#define NUM_FEATURES (1<<18)
+
+// perfect6502 node numbers
+#define NODE_IRQ (103)
+#define NODE_NMI (1297)
+#define NODE_SYNC (539)
+#define NUM_NODES (1725)
+
+typedef struct {
+    uint32_t data_seed;     // seed for random memory content, 0 for all zeros
+    int num_ticks;
+    int irq_start, irq_end; // IRQ is active in ticks [start, end)
+    int nmi_start, nmi_end; // NMI is active in ticks [start, end)
+    int prog_size;
+    uint8_t prog[MAX_PROG_SIZE];
+} fuzz_case_t;
+
+typedef struct {
+    bool diverged;
+    int num_ticks;          // number of ticks run
+    int tick;               // tick of the first divergence
+    uint16_t op_addr;       // address and opcode of the instruction at the divergence
+    uint8_t opcode;
+    char what[128];
+} fuzz_result_t;
+
+typedef struct {
+    fuzz_case_t fcase;
+    fuzz_result_t result;
+} fuzz_job_t;
+
+// the m6502 side of a fuzz case
+typedef struct {
+    m6502_t cpu;
+    uint64_t pins;
+    uint8_t mem[1<<16];
+} fuzz_cpu_t;
+
+static struct {
+    uint64_t rng;
+    bool unstable;
+    int max_ticks;
+    int num_features;
+    uint8_t features[NUM_FEATURES / 8];
+    int corpus_size;
+    fuzz_case_t corpus[MAX_CORPUS];
+    int num_jobs;
+    fuzz_job_t jobs[MAX_BATCH];
+    int num_failures;
+    fuzz_job_t failures[MAX_FAILURES];
+    bool failed_opcodes[256];
+} state;
+
+static uint32_t xorshift32(uint32_t x) {
+    x ^= x<<13;
+    x ^= x>>17;
+    x ^= x<<5;
+    return x;
+}
+
+static uint32_t rnd(void) {
+    // splitmix64
+    uint64_t z = (state.rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z>>30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z>>27)) * 0x94D049BB133111EBULL;
+    return (uint32_t)((z ^ (z>>31)) >> 32);
+}
+
+static bool is_jam(uint8_t op) {
+    return ((op & 0x0F) == 0x02) && ((op & 0x10) || (op < 0x80));
+}
+
+// the undocumented opcodes which depend on analog effects in a real 6502
+static bool is_unstable(uint8_t op) {
+    switch (op) {
+        case 0x8B: case 0xAB: case 0x93: case 0x9F: case 0x9B: case 0x9C: case 0x9E:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool is_excluded(uint8_t op) {
+    return is_jam(op) || (!state.unstable && is_unstable(op));
+}
+
+// instruction size in bytes (BRK counts with its signature byte)
+static int op_size(uint8_t op) {
+    const bool odd_row = 0 != (op & 0x10);
+    switch (op & 0x0F) {
+        case 0x0:
+            if (odd_row) {
+                return 2;
+            }
+            return (op == 0x20) ? 3 : (((op == 0x40) || (op == 0x60)) ? 1 : 2);
+        case 0x2:
+            return (odd_row || (op < 0x80)) ? 1 : 2;
+        case 0x8: case 0xA:
+            return 1;
+        case 0x9: case 0xB:
+            return odd_row ? 3 : 2;
+        case 0xC: case 0xD: case 0xE: case 0xF:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+// fill the memory of a fuzz case
+static void build_memory(const fuzz_case_t* c, uint8_t* mem) {
+    uint32_t x = c->data_seed;
+    for (int i = 0; i < (1<<16); i++) {
+        x = xorshift32(x);
+        mem[i] = (uint8_t)x;
+    }
+    memcpy(&mem[PROG_ADDR], c->prog, (size_t)c->prog_size);
+    // loop back to the start of the program
+    mem[PROG_ADDR + c->prog_size + 0] = 0x4C;
+    mem[PROG_ADDR + c->prog_size + 1] = PROG_ADDR & 0xFF;
+    mem[PROG_ADDR + c->prog_size + 2] = PROG_ADDR >> 8;
+    // interrupts go to an RTI
+    mem[HANDLER_ADDR] = 0x40;
+    mem[0xFFFA] = HANDLER_ADDR & 0xFF; mem[0xFFFB] = HANDLER_ADDR >> 8;
+    mem[0xFFFC] = PROG_ADDR & 0xFF; mem[0xFFFD] = PROG_ADDR >> 8;
+    mem[0xFFFE] = HANDLER_ADDR & 0xFF; mem[0xFFFF] = HANDLER_ADDR >> 8;
+}
+
+static bool irq_active(const fuzz_case_t* c, int tick) {
+    return (tick >= c->irq_start) && (tick < c->irq_end);
+}
+
+static bool nmi_active(const fuzz_case_t* c, int tick) {
+    return (tick >= c->nmi_start) && (tick < c->nmi_end);
+}
+
+static void cpu_tick(fuzz_cpu_t* m) {
+    m->pins = m6502_tick(&m->cpu, m->pins);
+    const uint16_t addr = M6502_GET_ADDR(m->pins);
+    if (m->pins & M6502_RW) {
+        M6502_SET_DATA(m->pins, m->mem[addr]);
+    }
+    else {
+        m->mem[addr] = M6502_GET_DATA(m->pins);
+    }
+}
+
+// reset the m6502 into the first opcode fetch of the program
+static void cpu_start(fuzz_cpu_t* m, const fuzz_case_t* c) {
+    build_memory(c, m->mem);
+    m->pins = m6502_init(&m->cpu, &(m6502_desc_t){0});
+    m->cpu.S = 0xC0;
+    for (int i = 0; i < 7; i++) {
+        cpu_tick(m);
+    }
+}
+
+static void cpu_set_interrupts(fuzz_cpu_t* m, const fuzz_case_t* c, int tick) {
+    m->pins &= ~(M6502_IRQ|M6502_NMI);
+    if (irq_active(c, tick)) {
+        m->pins |= M6502_IRQ;
+    }
+    if (nmi_active(c, tick)) {
+        m->pins |= M6502_NMI;
+    }
+}
+
+static void add_feature(uint32_t* features, int* num, uint8_t opcode, int ticks, bool irq, bool nmi, uint8_t p) {
+    uint32_t f = opcode;
+    f |= (uint32_t)((ticks > 8 ? 8 : ticks) - 1) << 8;
+    f |= (irq ? 1U : 0U) << 11;
+    f |= (nmi ? 1U : 0U) << 12;
+    f |= ((p & M6502_DF) ? 1U : 0U) << 13;
+    f |= (uint32_t)(((p & (M6502_NF|M6502_VF)) >> 4) | ((p & (M6502_ZF|M6502_CF)))) << 14;
+    features[(*num)++] = f;
+}
+
+// run a fuzz case through m6502 alone and collect its coverage features,
+// returns the number of features
+static int run_coverage(const fuzz_case_t* c, fuzz_cpu_t* m, uint32_t* features) {
+    int num = 0;
+    cpu_start(m, c);
+    uint8_t opcode = m->mem[PROG_ADDR];
+    int op_ticks = 1;
+    bool op_irq = false;
+    bool op_nmi = false;
+    for (int tick = 0; tick < c->num_ticks; tick++) {
+        cpu_set_interrupts(m, c, tick);
+        op_irq |= irq_active(c, tick);
+        op_nmi |= nmi_active(c, tick);
+        cpu_tick(m);
+        if (m->pins & M6502_SYNC) {
+            add_feature(features, &num, opcode, op_ticks, op_irq, op_nmi, m->cpu.P);
+            opcode = M6502_GET_DATA(m->pins);
+            op_ticks = 1;
+            op_irq = op_nmi = false;
+            if (is_excluded(opcode)) {
+                break;
+            }
+        }
+        else {
+            op_ticks++;
+        }
+    }
+    return num;
+}
+
+static void diverged(fuzz_result_t* res, int tick, uint16_t op_addr, uint8_t opcode, const char* what, unsigned m6502_val, unsigned p6502_val) {
+    res->diverged = true;
+    res->tick = tick;
+    res->op_addr = op_addr;
+    res->opcode = opcode;
+    snprintf(res->what, sizeof(res->what), "%s: m6502 $%02X, perfect6502 $%02X", what, m6502_val, p6502_val);
+}
+
+// compare the registers at an instruction boundary, returns true on divergence
+static bool compare_regs(fuzz_result_t* res, const fuzz_cpu_t* m, int tick, uint16_t op_addr, uint8_t opcode, uint8_t a, uint8_t x, uint8_t y, uint8_t s, uint8_t p) {
+    const uint8_t mask = ~(M6502_XF|M6502_IF|M6502_BF);
+    if (m->cpu.A != a) {
+        diverged(res, tick, op_addr, opcode, "A", m->cpu.A, a);
+    }
+    else if (m->cpu.X != x) {
+        diverged(res, tick, op_addr, opcode, "X", m->cpu.X, x);
+    }
+    else if (m->cpu.Y != y) {
+        diverged(res, tick, op_addr, opcode, "Y", m->cpu.Y, y);
+    }
+    else if (m->cpu.S != s) {
+        diverged(res, tick, op_addr, opcode, "S", m->cpu.S, s);
+    }
+    else if ((m->cpu.P & mask) != (p & mask)) {
+        diverged(res, tick, op_addr, opcode, "P", m->cpu.P & mask, p & mask);
+    }
+    return res->diverged;
+}
+
+// compare the pins after a tick, returns true on divergence
+static bool compare_pins(fuzz_result_t* res, const fuzz_cpu_t* m, int tick, uint16_t op_addr, uint8_t opcode, uint16_t addr, uint8_t data, bool rw, bool sync) {
+    const uint64_t pins = m->pins;
+    if (M6502_GET_ADDR(pins) != addr) {
+        res->diverged = true;
+        res->tick = tick;
+        res->op_addr = op_addr;
+        res->opcode = opcode;
+        snprintf(res->what, sizeof(res->what), "address bus: m6502 $%04X, perfect6502 $%04X", M6502_GET_ADDR(pins), addr);
+    }
+    else if (M6502_GET_DATA(pins) != data) {
+        diverged(res, tick, op_addr, opcode, "data bus", M6502_GET_DATA(pins), data);
+    }
+    else if (((pins & M6502_RW) != 0) != rw) {
+        diverged(res, tick, op_addr, opcode, "RW pin", (pins & M6502_RW) ? 1 : 0, rw ? 1 : 0);
+    }
+    else if (((pins & M6502_SYNC) != 0) != sync) {
+        diverged(res, tick, op_addr, opcode, "SYNC pin", (pins & M6502_SYNC) ? 1 : 0, sync ? 1 : 0);
+    }
+    return res->diverged;
+}
+
+// run a fuzz case through both emulators in lockstep, stops at the first divergence
+static void run_lockstep(const fuzz_case_t* c, fuzz_cpu_t* m, uint8_t* p_mem, bool log, fuzz_result_t* res) {
+    memset(res, 0, sizeof(fuzz_result_t));
+    cpu_start(m, c);
+    build_memory(c, p_mem);
+    void* p = initAndResetChipWithMemory(p_mem);
+    // run through perfect6502's 9-cycle reset sequence
+    for (int i = 0; i < 18; i++) {
+        stepWithMemory(p, p_mem);
+    }
+    uint16_t op_addr = PROG_ADDR;
+    uint8_t opcode = m->mem[PROG_ADDR];
+    bool irq = false;
+    bool nmi = false;
+    bool check_regs = false;
+    int tick = 0;
+    for (; tick < c->num_ticks; tick++) {
+        // interrupt pin changes, and the first half-cycle which finishes
+        // the previous instruction's overlapped operations
+        cpu_set_interrupts(m, c, tick);
+        if (irq != irq_active(c, tick)) {
+            irq = !irq;
+            setNode(p, NODE_IRQ, !irq);
+        }
+        if (nmi != nmi_active(c, tick)) {
+            nmi = !nmi;
+            setNode(p, NODE_NMI, !nmi);
+        }
+        stepWithMemory(p, p_mem);
+        if (check_regs && compare_regs(res, m, tick, op_addr, opcode, readA(p), readX(p), readY(p), readSP(p), readP(p))) {
+            break;
+        }
+        cpu_tick(m);
+        stepWithMemory(p, p_mem);
+        const uint64_t pins = m->pins;
+        if (log) {
+            printf("%5d  m6502: AB:%04X D:%02X RnW:%d SYN:%d  perfect6502: AB:%04X D:%02X RnW:%d SYN:%d  IRQ:%d NMI:%d\n",
+                tick,
+                M6502_GET_ADDR(pins), M6502_GET_DATA(pins), (pins & M6502_RW) ? 1 : 0, (pins & M6502_SYNC) ? 1 : 0,
+                readAddressBus(p), readDataBus(p), readRW(p) ? 1 : 0, isNodeHigh(p, NODE_SYNC) ? 1 : 0,
+                irq, nmi);
+        }
+        if (compare_pins(res, m, tick, op_addr, opcode, readAddressBus(p), readDataBus(p), readRW(p), isNodeHigh(p, NODE_SYNC))) {
+            break;
+        }
+        check_regs = 0 != (pins & M6502_SYNC);
+        if (check_regs) {
+            op_addr = M6502_GET_ADDR(pins);
+            opcode = M6502_GET_DATA(pins);
+            if (is_excluded(opcode)) {
+                tick++;
+                break;
+            }
+        }
+    }
+    res->num_ticks = res->diverged ? (tick + 1) : tick;
+    destroyChip(p);
+}
+
+// the per-case state of a lockstep batch
+typedef struct {
+    fuzz_cpu_t m;
+    uint8_t p_mem[1<<16];
+    uint16_t op_addr;
+    uint8_t opcode;
+    bool irq, nmi;
+    bool check_regs;
+} lockstep_lane_t;
+
+// run up to MAX_BATCH_CHIPS fuzz cases in lockstep against one bit-sliced
+// perfect6502 batch, same as run_lockstep() for each case
+static void run_lockstep_batch(fuzz_job_t* jobs, int num) {
+    lockstep_lane_t* lanes = malloc((size_t)num * sizeof(lockstep_lane_t));
+    uint8_t* p_mems[MAX_BATCH_CHIPS];
+    int max_ticks = 0;
+    for (int i = 0; i < num; i++) {
+        lockstep_lane_t* l = &lanes[i];
+        const fuzz_case_t* c = &jobs[i].fcase;
+        memset(&jobs[i].result, 0, sizeof(fuzz_result_t));
+        cpu_start(&l->m, c);
+        build_memory(c, l->p_mem);
+        p_mems[i] = l->p_mem;
+        l->op_addr = PROG_ADDR;
+        l->opcode = l->m.mem[PROG_ADDR];
+        l->irq = l->nmi = l->check_regs = false;
+        if (c->num_ticks > max_ticks) {
+            max_ticks = c->num_ticks;
+        }
+    }
+    void* p = initAndResetChips(num, p_mems);
+    for (int i = 0; i < 18; i++) {
+        stepChips(p, p_mems);
+    }
+    // cases which finished keep running in the batch, but are ignored
+    lanes_t active = (num >= MAX_BATCH_CHIPS) ? ~(lanes_t)0 : (((lanes_t)1 << num) - 1);
+    int tick = 0;
+    for (; (tick < max_ticks) && active; tick++) {
+        lanes_t irq_mask = 0, irq_values = 0;
+        lanes_t nmi_mask = 0, nmi_values = 0;
+        for (int i = 0; i < num; i++) {
+            const lanes_t bit = (lanes_t)1 << i;
+            if (0 == (active & bit)) {
+                continue;
+            }
+            lockstep_lane_t* l = &lanes[i];
+            const fuzz_case_t* c = &jobs[i].fcase;
+            if (tick >= c->num_ticks) {
+                jobs[i].result.num_ticks = tick;
+                active &= ~bit;
+                continue;
+            }
+            cpu_set_interrupts(&l->m, c, tick);
+            if (l->irq != irq_active(c, tick)) {
+                l->irq = !l->irq;
+                irq_mask |= bit;
+                irq_values |= l->irq ? 0 : bit;
+            }
+            if (l->nmi != nmi_active(c, tick)) {
+                l->nmi = !l->nmi;
+                nmi_mask |= bit;
+                nmi_values |= l->nmi ? 0 : bit;
+            }
+        }
+        if (irq_mask) {
+            setNodeChips(p, NODE_IRQ, irq_mask, irq_values);
+        }
+        if (nmi_mask) {
+            setNodeChips(p, NODE_NMI, nmi_mask, nmi_values);
+        }
+        stepChips(p, p_mems);
+        for (int i = 0; i < num; i++) {
+            const lanes_t bit = (lanes_t)1 << i;
+            lockstep_lane_t* l = &lanes[i];
+            if ((active & bit) && l->check_regs) {
+                if (compare_regs(&jobs[i].result, &l->m, tick, l->op_addr, l->opcode,
+                    readAChip(p, i), readXChip(p, i), readYChip(p, i), readSPChip(p, i), readPChip(p, i)))
+                {
+                    jobs[i].result.num_ticks = tick + 1;
+                    active &= ~bit;
+                }
+            }
+            if (active & bit) {
+                cpu_tick(&l->m);
+            }
+        }
+        stepChips(p, p_mems);
+        for (int i = 0; i < num; i++) {
+            const lanes_t bit = (lanes_t)1 << i;
+            if (0 == (active & bit)) {
+                continue;
+            }
+            lockstep_lane_t* l = &lanes[i];
+            fuzz_result_t* res = &jobs[i].result;
+            if (compare_pins(res, &l->m, tick, l->op_addr, l->opcode,
+                readAddressBusChip(p, i), readDataBusChip(p, i), readRWChip(p, i), isNodeHighChip(p, i, NODE_SYNC)))
+            {
+                res->num_ticks = tick + 1;
+                active &= ~bit;
+                continue;
+            }
+            const uint64_t pins = l->m.pins;
+            l->check_regs = 0 != (pins & M6502_SYNC);
+            if (l->check_regs) {
+                l->op_addr = M6502_GET_ADDR(pins);
+                l->opcode = M6502_GET_DATA(pins);
+                if (is_excluded(l->opcode)) {
+                    res->num_ticks = tick + 1;
+                    active &= ~bit;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < num; i++) {
+        if (active & ((lanes_t)1 << i)) {
+            jobs[i].result.num_ticks = tick;
+        }
+    }
+    destroyChips(p);
+    free(lanes);
+}
+
+static void gen_instruction(uint8_t* dst, int pos, int prog_size) {
+    uint8_t op;
+    do {
+        op = (uint8_t)rnd();
+    } while (is_excluded(op));
+    dst[0] = op;
+    const int size = op_size(op);
+    for (int i = 1; i < size; i++) {
+        dst[i] = (uint8_t)rnd();
+    }
+    if ((op & 0x1F) == 0x10) {
+        // short branches, mostly staying inside the program
+        dst[1] = (uint8_t)((int)(rnd() % 32) - 16);
+    }
+    else if ((op == 0x4C) || (op == 0x20)) {
+        // JMP and JSR targets inside the program
+        const uint16_t target = PROG_ADDR + (uint16_t)(rnd() % (uint32_t)(prog_size > pos ? prog_size : pos + 1));
+        dst[1] = target & 0xFF;
+        dst[2] = target >> 8;
+    }
+}
+
+static void gen_interrupts(fuzz_case_t* c) {
+    c->irq_start = c->irq_end = 0;
+    c->nmi_start = c->nmi_end = 0;
+    if (rnd() & 1) {
+        c->irq_start = (int)(rnd() % (uint32_t)c->num_ticks);
+        c->irq_end = c->irq_start + 1 + (int)(rnd() % (uint32_t)c->num_ticks);
+    }
+    if (0 == (rnd() & 3)) {
+        c->nmi_start = (int)(rnd() % (uint32_t)c->num_ticks);
+        c->nmi_end = c->nmi_start + 1 + (int)(rnd() % 8);
+    }
+}
+
+static void gen_case(fuzz_case_t* c) {
+    memset(c, 0, sizeof(fuzz_case_t));
+    c->data_seed = rnd() | 1;
+    c->num_ticks = state.max_ticks;
+    const uint8_t prologue[PROLOGUE_SIZE] = {
+        0xA9, (uint8_t)rnd(), 0x48, 0x28, 0xA9, (uint8_t)rnd(), 0xA2, (uint8_t)rnd(), 0xA0, (uint8_t)rnd()
+    };
+    memcpy(c->prog, prologue, sizeof(prologue));
+    c->prog_size = PROLOGUE_SIZE;
+    const int target_size = PROLOGUE_SIZE + 1 + (int)(rnd() % (MAX_PROG_SIZE - PROLOGUE_SIZE - 3));
+    while (c->prog_size < target_size) {
+        uint8_t ins[3];
+        gen_instruction(ins, c->prog_size, target_size);
+        const int size = op_size(ins[0]);
+        if ((c->prog_size + size) > MAX_PROG_SIZE) {
+            break;
+        }
+        memcpy(&c->prog[c->prog_size], ins, (size_t)size);
+        c->prog_size += size;
+    }
+    gen_interrupts(c);
+}
+
+static void mutate_case(fuzz_case_t* c) {
+    const int num_mutations = 1 + (int)(rnd() % 3);
+    for (int i = 0; i < num_mutations; i++) {
+        switch (rnd() % 6) {
+            case 0:
+                // random byte after the prologue
+                if (c->prog_size > PROLOGUE_SIZE) {
+                    c->prog[PROLOGUE_SIZE + rnd() % (uint32_t)(c->prog_size - PROLOGUE_SIZE)] = (uint8_t)rnd();
+                }
+                break;
+            case 1:
+                {
+                    // initial flags or register values
+                    static const int imm_pos[4] = { 1, 5, 7, 9 };
+                    c->prog[imm_pos[rnd() & 3]] = (uint8_t)rnd();
+                }
+                break;
+            case 2:
+                c->data_seed = rnd() | 1;
+                break;
+            case 3:
+                gen_interrupts(c);
+                break;
+            case 4:
+                {
+                    // insert an instruction
+                    uint8_t ins[3];
+                    const int pos = PROLOGUE_SIZE + (int)(rnd() % (uint32_t)(c->prog_size - PROLOGUE_SIZE + 1));
+                    gen_instruction(ins, pos, c->prog_size);
+                    const int size = op_size(ins[0]);
+                    if ((c->prog_size + size) <= MAX_PROG_SIZE) {
+                        memmove(&c->prog[pos + size], &c->prog[pos], (size_t)(c->prog_size - pos));
+                        memcpy(&c->prog[pos], ins, (size_t)size);
+                        c->prog_size += size;
+                    }
+                }
+                break;
+            default:
+                {
+                    // splice in the tail of another corpus case
+                    const fuzz_case_t* other = &state.corpus[rnd() % (uint32_t)state.corpus_size];
+                    const int pos = PROLOGUE_SIZE + (int)(rnd() % (uint32_t)(c->prog_size - PROLOGUE_SIZE + 1));
+                    const int other_pos = PROLOGUE_SIZE + (int)(rnd() % (uint32_t)(other->prog_size - PROLOGUE_SIZE + 1));
+                    int num = other->prog_size - other_pos;
+                    if ((pos + num) > MAX_PROG_SIZE) {
+                        num = MAX_PROG_SIZE - pos;
+                    }
+                    memcpy(&c->prog[pos], &other->prog[other_pos], (size_t)num);
+                    c->prog_size = pos + num;
+                }
+                break;
+        }
+    }
+}
+
+// try to simplify a diverging case while it keeps diverging
+static void minimize(fuzz_case_t* c, fuzz_result_t* res, fuzz_cpu_t* m, uint8_t* p_mem) {
+    fuzz_case_t t;
+    fuzz_result_t r;
+    #define MIN_TRY(mutation) { t = *c; mutation; run_lockstep(&t, m, p_mem, false, &r); if (r.diverged) { *c = t; *res = r; c->num_ticks = r.tick + 1; } }
+    c->num_ticks = res->tick + 1;
+    MIN_TRY(t.irq_start = t.irq_end = 0);
+    MIN_TRY(t.nmi_start = t.nmi_end = 0);
+    MIN_TRY(t.data_seed = 0);
+    for (int size = PROLOGUE_SIZE; size < c->prog_size; size++) {
+        MIN_TRY(t.prog_size = size);
+        if (c->prog_size == size) {
+            break;
+        }
+    }
+    for (int i = PROLOGUE_SIZE; i < c->prog_size; i++) {
+        if (c->prog[i] != 0xEA) {
+            MIN_TRY(t.prog[i] = 0xEA);
+        }
+    }
+    // shrink the interrupt activity
+    while (c->irq_end > (c->irq_start + 1)) {
+        const int end = c->irq_end;
+        MIN_TRY(t.irq_end--);
+        if (c->irq_end == end) {
+            break;
+        }
+    }
+    #undef MIN_TRY
+}
+
+static void lockstep_job_func(int job_index, int worker_index, void* user_data) {
+    (void)worker_index;
+    (void)user_data;
+    fuzz_job_t* job = &state.jobs[job_index];
+    fuzz_cpu_t* m = malloc(sizeof(fuzz_cpu_t));
+    uint8_t* p_mem = malloc(1<<16);
+    run_lockstep(&job->fcase, m, p_mem, false, &job->result);
+    free(p_mem);
+    free(m);
+}
+
+// user_data points to the number of cases per bit-sliced batch
+static void lockstep_batch_job_func(int job_index, int worker_index, void* user_data) {
+    (void)worker_index;
+    const int num_lanes = *(const int*)user_data;
+    const int first = job_index * num_lanes;
+    const int num = (state.num_jobs - first) < num_lanes ? (state.num_jobs - first) : num_lanes;
+    run_lockstep_batch(&state.jobs[first], num);
+}
+
+// user_data points to the index of the first failure to minimize
+static void minimize_job_func(int job_index, int worker_index, void* user_data) {
+    (void)worker_index;
+    fuzz_job_t* job = &state.failures[*(const int*)user_data + job_index];
+    fuzz_cpu_t* m = malloc(sizeof(fuzz_cpu_t));
+    uint8_t* p_mem = malloc(1<<16);
+    minimize(&job->fcase, &job->result, m, p_mem);
+    free(p_mem);
+    free(m);
+}
+
+typedef struct {
+    const uint8_t* mem;
+    uint16_t pc;
+    char* str;
+} dasm_ctx_t;
+
+static uint8_t dasm_in(void* user_data) {
+    dasm_ctx_t* ctx = (dasm_ctx_t*) user_data;
+    return ctx->mem[ctx->pc++];
+}
+
+static void dasm_out(char c, void* user_data) {
+    dasm_ctx_t* ctx = (dasm_ctx_t*) user_data;
+    *ctx->str++ = c;
+}
+
+static void print_case(const fuzz_case_t* c, const fuzz_result_t* res) {
+    printf("    tick %d, instruction $%04X (opcode $%02X): %s\n", res->tick, res->op_addr, res->opcode, res->what);
+    printf("    replay with: m6502-fuzz --replay %08X:%d:%d-%d:%d-%d:", c->data_seed, c->num_ticks, c->irq_start, c->irq_end, c->nmi_start, c->nmi_end);
+    for (int i = 0; i < c->prog_size; i++) {
+        printf("%02X", c->prog[i]);
+    }
+    printf("\n");
+    uint8_t* mem = malloc(1<<16);
+    build_memory(c, mem);
+    dasm_ctx_t ctx = { .mem = mem, .pc = PROG_ADDR };
+    while (ctx.pc < (PROG_ADDR + c->prog_size + 3)) {
+        const uint16_t pc = ctx.pc;
+        char str[32] = { 0 };
+        ctx.str = str;
+        m6502dasm_op(pc, dasm_in, dasm_out, &ctx);
+        printf("    %04X: ", pc);
+        for (uint16_t i = pc; i < (pc + 3); i++) {
+            if (i < ctx.pc) {
+                printf("%02X ", mem[i]);
+            }
+            else {
+                printf("   ");
+            }
+        }
+        printf(" %s\n", str);
+    }
+    free(mem);
+}
+
+// parse a reproducer: data_seed:ticks:irq_start-irq_end:nmi_start-nmi_end:program
+static bool parse_case(const char* str, fuzz_case_t* c) {
+    memset(c, 0, sizeof(fuzz_case_t));
+    int pos = 0;
+    if (6 != sscanf(str, "%x:%d:%d-%d:%d-%d:%n", &c->data_seed, &c->num_ticks, &c->irq_start, &c->irq_end, &c->nmi_start, &c->nmi_end, &pos)) {
+        return false;
+    }
+    if ((c->num_ticks < 1) || (c->num_ticks > MAX_TICKS)) {
+        return false;
+    }
+    for (const char* p = &str[pos]; p[0] && p[1]; p += 2) {
+        unsigned val;
+        if ((c->prog_size >= MAX_PROG_SIZE) || (1 != sscanf(p, "%2x", &val))) {
+            return false;
+        }
+        c->prog[c->prog_size++] = (uint8_t)val;
+    }
+    return c->prog_size >= PROLOGUE_SIZE;
+}
+
+static int replay(const char* str) {
+    fuzz_case_t c;
+    if (!parse_case(str, &c)) {
+        fprintf(stderr, "invalid reproducer '%s'\n", str);
+        return 10;
+    }
+    fuzz_cpu_t* m = malloc(sizeof(fuzz_cpu_t));
+    uint8_t* p_mem = malloc(1<<16);
+    fuzz_result_t res;
+    run_lockstep(&c, m, p_mem, true, &res);
+    free(p_mem);
+    free(m);
+    if (res.diverged) {
+        printf("\nDIVERGED:\n");
+        print_case(&c, &res);
+        return 10;
+    }
+    printf("\nno divergence in %d ticks\n", res.num_ticks);
+    return 0;
+}
+
+// run a batch of random cases with IRQ and NMI activity through a bit-sliced
+// perfect6502 batch and through one scalar perfect6502 per case, and compare
+// all nodes after each half-cycle
+static int check_batch(void) {
+    const int num = MAX_BATCH_CHIPS;
+    fuzz_case_t* cases = malloc((size_t)num * sizeof(fuzz_case_t));
+    uint8_t* s_mems = malloc((size_t)num << 16);
+    uint8_t* b_mems = malloc((size_t)num << 16);
+    uint8_t* p_mems[MAX_BATCH_CHIPS];
+    void* s[MAX_BATCH_CHIPS];
+    bool irq[MAX_BATCH_CHIPS] = { false };
+    bool nmi[MAX_BATCH_CHIPS] = { false };
+    for (int i = 0; i < num; i++) {
+        fuzz_case_t* c = &cases[i];
+        gen_case(c);
+        while ((c->irq_start == c->irq_end) || (c->nmi_start == c->nmi_end)) {
+            gen_interrupts(c);
+        }
+        build_memory(c, &s_mems[i << 16]);
+        build_memory(c, &b_mems[i << 16]);
+        p_mems[i] = &b_mems[i << 16];
+        s[i] = initAndResetChipWithMemory(&s_mems[i << 16]);
+    }
+    void* p = initAndResetChips(num, p_mems);
+    int num_diffs = 0;
+    for (int half = 0; half < (18 + 2 * state.max_ticks); half++) {
+        // same interrupt pin changes as run_lockstep() after the reset sequence
+        const int tick = (half - 18) / 2;
+        if ((half >= 18) && (0 == (half & 1))) {
+            lanes_t irq_mask = 0, irq_values = 0;
+            lanes_t nmi_mask = 0, nmi_values = 0;
+            for (int i = 0; i < num; i++) {
+                const lanes_t bit = (lanes_t)1 << i;
+                if (irq[i] != irq_active(&cases[i], tick)) {
+                    irq[i] = !irq[i];
+                    setNode(s[i], NODE_IRQ, !irq[i]);
+                    irq_mask |= bit;
+                    irq_values |= irq[i] ? 0 : bit;
+                }
+                if (nmi[i] != nmi_active(&cases[i], tick)) {
+                    nmi[i] = !nmi[i];
+                    setNode(s[i], NODE_NMI, !nmi[i]);
+                    nmi_mask |= bit;
+                    nmi_values |= nmi[i] ? 0 : bit;
+                }
+            }
+            if (irq_mask) {
+                setNodeChips(p, NODE_IRQ, irq_mask, irq_values);
+            }
+            if (nmi_mask) {
+                setNodeChips(p, NODE_NMI, nmi_mask, nmi_values);
+            }
+        }
+        stepChips(p, p_mems);
+        for (int i = 0; i < num; i++) {
+            stepWithMemory(s[i], &s_mems[i << 16]);
+            for (nodenum_t n = 0; n < NUM_NODES; n++) {
+                if (isNodeHigh(s[i], n) != isNodeHighChip(p, i, n)) {
+                    if (num_diffs++ < 16) {
+                        printf("case %d, half-cycle %d: node %d is %d in the batch, %d in the scalar chip\n",
+                            i, half, n, isNodeHighChip(p, i, n) ? 1 : 0, isNodeHigh(s[i], n) ? 1 : 0);
+                    }
+                }
+            }
+        }
+    }
+    for (int i = 0; i < num; i++) {
+        destroyChip(s[i]);
+    }
+    destroyChips(p);
+    free(b_mems);
+    free(s_mems);
+    free(cases);
+    if (num_diffs > 0) {
+        printf("\nBATCH CHECK FAILED: %d node difference(s)\n", num_diffs);
+        return 10;
+    }
+    printf("batch matches scalar perfect6502 in %d case(s) of %d ticks\n", num, state.max_ticks);
+    return 0;
+}
+
+// generate the next batch of cases which reach new coverage features
+static void next_batch(int batch_size, fuzz_cpu_t* m, uint32_t* features) {
+    state.num_jobs = 0;
+    for (int i = 0; (i < (batch_size * CANDIDATES_PER_SLOT)) && (state.num_jobs < batch_size); i++) {
+        fuzz_job_t* job = &state.jobs[state.num_jobs];
+        if ((0 == state.corpus_size) || (0 == (rnd() & 7))) {
+            gen_case(&job->fcase);
+        }
+        else {
+            job->fcase = state.corpus[rnd() % (uint32_t)state.corpus_size];
+            mutate_case(&job->fcase);
+        }
+        const int num = run_coverage(&job->fcase, m, features);
+        int num_new = 0;
+        for (int f = 0; f < num; f++) {
+            const uint32_t bit = features[f];
+            if (0 == (state.features[bit>>3] & (1<<(bit & 7)))) {
+                state.features[bit>>3] |= 1<<(bit & 7);
+                num_new++;
+            }
+        }
+        if (num_new > 0) {
+            state.num_features += num_new;
+            if (state.corpus_size < MAX_CORPUS) {
+                state.corpus[state.corpus_size++] = job->fcase;
+            }
+            state.num_jobs++;
+        }
+    }
+}
+
+static const getopt_option_t option_list[] = {
+    { "help", 'h', GETOPT_OPTION_TYPE_NO_ARG, 0, 'h', "print this help text", 0 },
+    { "seed", 's', GETOPT_OPTION_TYPE_REQUIRED, 0, 's', "random seed (default: time)", "n" },
+    { "rounds", 'r', GETOPT_OPTION_TYPE_REQUIRED, 0, 'r', "number of rounds (default: 16)", "n" },
+    { "batch", 'b', GETOPT_OPTION_TYPE_REQUIRED, 0, 'b', "max number of lockstep cases per round (default: 64)", "n" },
+    { "ticks", 't', GETOPT_OPTION_TYPE_REQUIRED, 0, 't', "ticks per case (default: 192)", "n" },
+    { "lanes", 'l', GETOPT_OPTION_TYPE_REQUIRED, 0, 'l', "max number of cases per bit-sliced perfect6502 batch, 1 for scalar (default: 64)", "n" },
+    { "threads", 'p', GETOPT_OPTION_TYPE_REQUIRED, 0, 'p', "number of worker threads (default: number of cores)", "n" },
+    { "unstable", 'u', GETOPT_OPTION_TYPE_NO_ARG, 0, 'u', "also fuzz the unstable undocumented opcodes", 0 },
+    { "check-batch", 'c', GETOPT_OPTION_TYPE_NO_ARG, 0, 'c', "compare the bit-sliced perfect6502 batch against scalar runs", 0 },
+    { "replay", 'x', GETOPT_OPTION_TYPE_REQUIRED, 0, 'x', "replay a reproducer with a tick log", "case" },
+    GETOPT_OPTIONS_END
+};
+
+static char help_buf[2048];
+
+int main(int argc, const char** argv) {
+    uint64_t seed = (uint64_t)time(0);
+    int num_rounds = 16;
+    int batch_size = 64;
+    int num_threads = jobpool_num_cores();
+    int max_lanes = MAX_BATCH_CHIPS;
+    bool batch_check = false;
+    const char* replay_case = 0;
+    state.max_ticks = 192;
+    getopt_context_t ctx;
+    if (getopt_create_context(&ctx, argc, argv, option_list) < 0) {
+        fprintf(stderr, "getopt_create_context() failed!\n");
+        return 10;
+    }
+    int opt;
+    while ((opt = getopt_next(&ctx)) != -1) {
+        switch (opt) {
+            case '+':
+            case '?':
+                fprintf(stderr, "unknown flag %s\n", ctx.current_opt_arg);
+                return 10;
+            case '!':
+                fprintf(stderr, "invalid use of flag %s\n", ctx.current_opt_arg);
+                return 10;
+            case 'h':
+                fprintf(stderr, "m6502-fuzz -- differential fuzzing of m6502 against perfect6502\n\n");
+                fprintf(stderr, "%s", getopt_create_help_string(&ctx, help_buf, sizeof(help_buf)));
+                return 0;
+            case 's':
+                seed = strtoull(ctx.current_opt_arg, 0, 0);
+                break;
+            case 'r':
+                num_rounds = atoi(ctx.current_opt_arg);
+                break;
+            case 'b':
+                batch_size = atoi(ctx.current_opt_arg);
+                break;
+            case 't':
+                state.max_ticks = atoi(ctx.current_opt_arg);
+                break;
+            case 'l':
+                max_lanes = atoi(ctx.current_opt_arg);
+                break;
+            case 'p':
+                num_threads = atoi(ctx.current_opt_arg);
+                break;
+            case 'u':
+                state.unstable = true;
+                break;
+            case 'c':
+                batch_check = true;
+                break;
+            case 'x':
+                replay_case = ctx.current_opt_arg;
+                break;
+            default:
+                break;
+        }
+    }
+    if ((num_threads < 1) || (num_threads > JOBPOOL_MAX_THREADS)) {
+        fprintf(stderr, "number of threads must be in range [1, %d]\n", JOBPOOL_MAX_THREADS);
+        return 10;
+    }
+    if ((batch_size < 1) || (batch_size > MAX_BATCH)) {
+        fprintf(stderr, "batch size must be in range [1, %d]\n", MAX_BATCH);
+        return 10;
+    }
+    if ((max_lanes < 1) || (max_lanes > MAX_BATCH_CHIPS)) {
+        fprintf(stderr, "number of lanes must be in range [1, %d]\n", MAX_BATCH_CHIPS);
+        return 10;
+    }
+    if ((state.max_ticks < 1) || (state.max_ticks > MAX_TICKS)) {
+        fprintf(stderr, "ticks per case must be in range [1, %d]\n", MAX_TICKS);
+        return 10;
+    }
+    if (replay_case) {
+        return replay(replay_case);
+    }
+    if (batch_check) {
+        state.rng = seed;
+        printf(">>> checking the perfect6502 batch with seed %llu...\n\n", (unsigned long long)seed);
+        return check_batch();
+    }
+
+    stm_setup();
+    state.rng = seed;
+    printf(">>> fuzzing with seed %llu, %d round(s) of up to %d case(s) on %d thread(s)...\n\n",
+        (unsigned long long)seed, num_rounds, batch_size, num_threads);
+    fuzz_cpu_t* m = malloc(sizeof(fuzz_cpu_t));
+    uint32_t* features = malloc(MAX_TICKS * sizeof(uint32_t));
+    uint64_t total_ticks = 0;
+    int total_cases = 0;
+    const uint64_t start = stm_now();
+    for (int round = 0; round < num_rounds; round++) {
+        const uint64_t round_start = stm_now();
+        next_batch(batch_size, m, features);
+        if (0 == state.num_jobs) {
+            printf("round %2d: no new coverage\n", round);
+            continue;
+        }
+        // spread the cases evenly over the threads in bit-sliced batches
+        int num_lanes = (state.num_jobs + num_threads - 1) / num_threads;
+        if (num_lanes > max_lanes) {
+            num_lanes = max_lanes;
+        }
+        if (num_lanes > 1) {
+            jobpool_run(&(jobpool_desc_t){
+                .num_jobs = (state.num_jobs + num_lanes - 1) / num_lanes,
+                .num_threads = num_threads,
+                .func = lockstep_batch_job_func,
+                .user_data = (void*)&num_lanes,
+            });
+        }
+        else {
+            jobpool_run(&(jobpool_desc_t){
+                .num_jobs = state.num_jobs,
+                .num_threads = num_threads,
+                .func = lockstep_job_func,
+            });
+        }
+        // collect the divergences, one per opcode
+        const int first_failure = state.num_failures;
+        uint64_t ticks = 0;
+        for (int i = 0; i < state.num_jobs; i++) {
+            const fuzz_job_t* job = &state.jobs[i];
+            ticks += (uint64_t)job->result.num_ticks;
+            if (job->result.diverged && !state.failed_opcodes[job->result.opcode] && (state.num_failures < MAX_FAILURES)) {
+                state.failed_opcodes[job->result.opcode] = true;
+                state.failures[state.num_failures++] = *job;
+            }
+        }
+        total_ticks += ticks;
+        total_cases += state.num_jobs;
+        if (state.num_failures > first_failure) {
+            jobpool_run(&(jobpool_desc_t){
+                .num_jobs = state.num_failures - first_failure,
+                .num_threads = num_threads,
+                .func = minimize_job_func,
+                .user_data = (void*)&first_failure,
+            });
+        }
+        printf("round %2d: %4d case(s), %7llu ticks, %6d features, %2d new divergence(s) (%.3fsecs)\n",
+            round, state.num_jobs, (unsigned long long)ticks, state.num_features,
+            state.num_failures - first_failure, stm_sec(stm_since(round_start)));
+    }
+    const double secs = stm_sec(stm_since(start));
+    free(features);
+    free(m);
+    printf("\n%d lockstep case(s), %llu ticks in %.3fsecs (%.0f ticks/sec), %d coverage features\n",
+        total_cases, (unsigned long long)total_ticks, secs, total_ticks / secs, state.num_features);
+    if (0 == state.num_failures) {
+        printf("\nNO DIVERGENCES\n\n");
+        return 0;
+    }
+    printf("\n%d DIVERGENCE(S):\n\n", state.num_failures);
+    for (int i = 0; i < state.num_failures; i++) {
+        printf("  #%d:\n", i + 1);
+        print_case(&state.failures[i].fcase, &state.failures[i].result);
+        printf("\n");
+    }
+    return 10;
+}
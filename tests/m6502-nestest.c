@@ -2,14 +2,61 @@
 //  m6502-nestest.c
 //
 //  Tests CPU state after documented instructions, no BCD mode.
+//
+//  The expected state is streamed from the original nestest.log.txt which
+//  is memory-mapped and parsed one line at a time while the CPU runs.
+//  Besides the registers this also checks the CYC column, which is the
+//  PPU dot within the scanline at the start of the instruction (3 dots
+//  per CPU cycle and 341 dots per scanline), so the number of cycles of
+//  each instruction is validated too.
+//
+//  The log path can be passed on the command line, the default is the
+//  nestest directory in the source tree.
 //------------------------------------------------------------------------------
 #define CHIPS_IMPL
 #include "chips/m6502.h"
 #include "chips/mem.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "nestest/dump.h"
-#include "nestest/nestestlog.h"
 #include "test.h"
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if !defined(NESTEST_LOG_PATH)
+#define NESTEST_LOG_PATH "nestest/nestest.log.txt"
+#endif
+
+// PPU dots per scanline, and per CPU cycle
+#define PPU_DOTS_PER_LINE (341)
+#define PPU_DOTS_PER_CYCLE (3)
+
+// expected CPU state parsed from a line in the log
+typedef struct {
+    char desc[33];
+    uint16_t PC;
+    uint8_t A, X, Y, P, S;
+    int cyc;
+} cpu_state;
+
+// the memory-mapped log file
+static struct {
+    const char* ptr;
+    size_t size;
+    size_t pos;
+    #if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+    #endif
+} log_file;
 
 m6502_t cpu;
 mem_t mem;
@@ -35,7 +82,125 @@ uint64_t tick(uint64_t pins) {
     return pins;
 }
 
-int main() {
+static bool log_open(const char* path) {
+    #if defined(_WIN32)
+    log_file.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (INVALID_HANDLE_VALUE == log_file.file) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(log_file.file, &size) || (0 == size.QuadPart)) {
+        CloseHandle(log_file.file);
+        return false;
+    }
+    log_file.mapping = CreateFileMappingA(log_file.file, 0, PAGE_READONLY, 0, 0, 0);
+    if (0 == log_file.mapping) {
+        CloseHandle(log_file.file);
+        return false;
+    }
+    log_file.ptr = (const char*) MapViewOfFile(log_file.mapping, FILE_MAP_READ, 0, 0, 0);
+    log_file.size = (size_t) size.QuadPart;
+    #else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if ((fstat(fd, &st) < 0) || (0 == st.st_size)) {
+        close(fd);
+        return false;
+    }
+    void* ptr = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after closing the file
+    close(fd);
+    log_file.ptr = (ptr == MAP_FAILED) ? 0 : (const char*) ptr;
+    log_file.size = (size_t) st.st_size;
+    #endif
+    log_file.pos = 0;
+    return 0 != log_file.ptr;
+}
+
+static void log_close(void) {
+    #if defined(_WIN32)
+    UnmapViewOfFile(log_file.ptr);
+    CloseHandle(log_file.mapping);
+    CloseHandle(log_file.file);
+    #else
+    munmap((void*)log_file.ptr, log_file.size);
+    #endif
+    log_file.ptr = 0;
+}
+
+static int hex_val(const char* str, int num_digits) {
+    int val = 0;
+    for (int i = 0; i < num_digits; i++) {
+        const char c = str[i];
+        val <<= 4;
+        if ((c >= '0') && (c <= '9')) {
+            val |= c - '0';
+        }
+        else if ((c >= 'A') && (c <= 'F')) {
+            val |= c - 'A' + 10;
+        }
+        else if ((c >= 'a') && (c <= 'f')) {
+            val |= c - 'a' + 10;
+        }
+        else {
+            return -1;
+        }
+    }
+    return val;
+}
+
+// parse the next line of the log, the columns look like this:
+//
+//  C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD CYC:  0
+//
+// returns false at the end of the log or on a malformed line
+static bool log_next(cpu_state* state, bool* malformed) {
+    *malformed = false;
+    if (log_file.pos >= log_file.size) {
+        return false;
+    }
+    const char* line = &log_file.ptr[log_file.pos];
+    const size_t max_len = log_file.size - log_file.pos;
+    const char* end = memchr(line, '\n', max_len);
+    const size_t len = end ? (size_t)(end - line) : max_len;
+    log_file.pos += end ? (len + 1) : len;
+    if ((len < 81) || (0 != memcmp(&line[74], "CYC:", 4))) {
+        *malformed = true;
+        return false;
+    }
+    memcpy(state->desc, &line[16], 32);
+    state->desc[32] = 0;
+    const int pc = hex_val(&line[0], 4);
+    const int a = hex_val(&line[50], 2);
+    const int x = hex_val(&line[55], 2);
+    const int y = hex_val(&line[60], 2);
+    const int p = hex_val(&line[65], 2);
+    const int s = hex_val(&line[71], 2);
+    char cyc_str[4] = { line[78], line[79], line[80], 0 };
+    char* cyc_end = 0;
+    state->cyc = (int) strtol(cyc_str, &cyc_end, 10);
+    if ((pc < 0) || (a < 0) || (x < 0) || (y < 0) || (p < 0) || (s < 0) || (*cyc_end != 0)) {
+        *malformed = true;
+        return false;
+    }
+    state->PC = (uint16_t)pc;
+    state->A = (uint8_t)a;
+    state->X = (uint8_t)x;
+    state->Y = (uint8_t)y;
+    state->P = (uint8_t)p;
+    state->S = (uint8_t)s;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    const char* log_path = (argc > 1) ? argv[1] : NESTEST_LOG_PATH;
+    if (!log_open(log_path)) {
+        printf("### NESTEST failed to open '%s'\n", log_path);
+        return 10;
+    }
     test_begin("NES TEST (m6502)");
     test_no_verbose();
 
@@ -71,10 +236,16 @@ int main() {
     }
     cpu.P &= ~M6502_ZF;
 
-    /* run the test */
-    int num_tests = sizeof(state_table) / sizeof(cpu_state);
-    for (int i = 0; i < num_tests; i++) {
-        cpu_state* state = &state_table[i];
+    /* run the test, the log starts with CYC 0 at the first instruction */
+    /* test() keeps a pointer to the description until the next test() call
+       reports its result, so alternate between two buffers for the parsed lines */
+    cpu_state states[2];
+    bool malformed = false;
+    uint64_t cycles = 0;
+    int i = 0;
+    for (; log_next(&states[i & 1], &malformed); i++) {
+        const cpu_state* state = &states[i & 1];
+        const int cyc = (int)((cycles * PPU_DOTS_PER_CYCLE) % PPU_DOTS_PER_LINE);
         test(state->desc);
         T(cpu.PC == state->PC);
         T(cpu.A  == state->A);
@@ -82,12 +253,19 @@ int main() {
         T(cpu.Y  == state->Y);
         T((cpu.P & ~(M6502_XF|M6502_BF)) == (state->P & ~(M6502_XF|M6502_BF)));
         T(cpu.S == state->S);
+        T(cyc == state->cyc);
         if (test_failed()) {
-            printf("### NESTEST failed at pos %d, PC=0x%04X: %s\n", i, cpu.PC, state->desc);
+            printf("### NESTEST failed at pos %d, PC=0x%04X, CYC=%d (expected %d): %s\n", i, cpu.PC, cyc, state->cyc, state->desc);
         }
         do {
             pins = tick(pins);
+            cycles++;
         } while (0 == (pins & M6502_SYNC));
     }
+    log_close();
+    if (malformed || (0 == i)) {
+        printf("### NESTEST malformed log line %d in '%s'\n", i + 1, log_path);
+        return 10;
+    }
     return test_end();
 }
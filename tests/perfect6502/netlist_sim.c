@@ -34,6 +34,8 @@
 /* the smallest types to fit the numbers */
 typedef uint16_t transnum_t;
 typedef uint16_t count_t;
+/* index into the CSR arrays (sum of the per-node counts) */
+typedef unsigned int offset_t;
 /* nodenum_t is declared in types.h, because it's API */
 
 /************************************************************
@@ -42,7 +44,7 @@ typedef uint16_t count_t;
  *
  ************************************************************/
 
-#if 0 /* faster on 64 bit CPUs */
+#if defined(__LP64__) || defined(_WIN64) /* faster on 64 bit CPUs */
 typedef unsigned long long bitmap_t;
 #define BITMAP_SHIFT 6
 #define BITMAP_MASK 63
@@ -60,6 +62,13 @@ typedef struct {
 	count_t count;
 } list_t;
 
+/* a transistor connected to a node by c1 or c2, its gate, and the node on its other side */
+typedef struct {
+	transnum_t transistor;
+	nodenum_t gate;
+	nodenum_t other;
+} c1c2_t;
+
 typedef struct {
 	nodenum_t nodes;
 	nodenum_t transistors;
@@ -70,14 +79,23 @@ typedef struct {
 	bitmap_t *nodes_pullup;
 	bitmap_t *nodes_pulldown;
 	bitmap_t *nodes_value;
-	nodenum_t **nodes_gates;
-	nodenum_t **nodes_c1c2s;
+
+	/*
+	 * the per-node lists are stored in CSR layout: the entries of
+	 * node n are nodes_xxx[nodes_xxx_start[n] .. nodes_xxx_start[n] + count)
+	 */
+	offset_t *nodes_gates_start;
+	transnum_t *nodes_gates;
+	offset_t *nodes_c1c2s_start;
+	c1c2_t *nodes_c1c2s;
 	count_t *nodes_gatecount;
 	count_t *nodes_c1c2count;
-	nodenum_t *nodes_dependants;
-	nodenum_t *nodes_left_dependants;
-	nodenum_t **nodes_dependant;
-	nodenum_t **nodes_left_dependant;
+	count_t *nodes_dependants;
+	count_t *nodes_left_dependants;
+	offset_t *nodes_dependant_start;
+	nodenum_t *nodes_dependant;
+	offset_t *nodes_left_dependant_start;
+	nodenum_t *nodes_left_dependant;
 
 	/* everything that describes a transistor */
 	nodenum_t *transistors_gate;
@@ -115,6 +133,9 @@ typedef struct {
  *
  ************************************************************/
 
+/* state of a bit-sliced batch of chips, see below */
+typedef struct batch_state batch_t;
+
 #define INCLUDED_FROM_NETLIST_SIM_C
 #include "netlist_sim.h"
 #undef INCLUDED_FROM_NETLIST_SIM_C
@@ -127,12 +148,6 @@ typedef struct {
 
 #define WORDS_FOR_BITS(a) (a / (sizeof(bitmap_t) * 8) + 1)
 
-static inline void
-bitmap_clear(bitmap_t *bitmap, count_t count)
-{
-	memset(bitmap, 0, WORDS_FOR_BITS(count)*sizeof(bitmap_t));
-}
-
 static inline void
 set_bitmap(bitmap_t *bitmap, int index, BOOL state)
 {
@@ -148,6 +163,14 @@ get_bitmap(bitmap_t *bitmap, int index)
 	return (bitmap[index>>BITMAP_SHIFT] >> (index & BITMAP_MASK)) & 1;
 }
 
+/* clear only the bits of the listed indices, cheaper than clearing the whole bitmap */
+static inline void
+bitmap_clear_list(bitmap_t *bitmap, nodenum_t *list, count_t count)
+{
+	for (count_t i = 0; i < count; i++)
+		bitmap[list[i]>>BITMAP_SHIFT] &= ~(ONE << (list[i] & BITMAP_MASK));
+}
+
 /************************************************************
  *
  * Algorithms for Nodes
@@ -239,11 +262,21 @@ lists_switch(state_t *state)
 	state->listout = tmp;
 }
 
+/*
+ * the listout bitmap only has the bits of the nodes in listout set,
+ * after lists_switch() these are the nodes in listin
+ */
+static inline void
+listin_unmark(state_t *state)
+{
+	bitmap_clear_list(state->listout_bitmap, state->listin.list, state->listin.count);
+}
+
 static inline void
 listout_clear(state_t *state)
 {
+	bitmap_clear_list(state->listout_bitmap, state->listout.list, state->listout.count);
 	state->listout.count = 0;
-	bitmap_clear(state->listout_bitmap, state->nodes);
 }
 
 static inline void
@@ -272,8 +305,8 @@ listout_add(state_t *state, nodenum_t i)
 static inline void
 group_clear(state_t *state)
 {
+	bitmap_clear_list(state->groupbitmap, state->group, state->groupcount);
 	state->groupcount = 0;
-	bitmap_clear(state->groupbitmap, state->nodes);
 }
 
 static inline void
@@ -307,8 +340,12 @@ group_count(state_t *state)
  *
  ************************************************************/
 
-static inline void
-addNodeToGroup(state_t *state, nodenum_t n)
+/*
+ * add a single node to the group, returns YES if the node is new
+ * and the search has to continue with its transistors
+ */
+static inline BOOL
+groupAddNode(state_t *state, nodenum_t n)
 {
 	/*
 	 * We need to stop at vss and vcc, otherwise we'll revisit other groups
@@ -317,16 +354,16 @@ addNodeToGroup(state_t *state, nodenum_t n)
 	 */
 	if (n == state->vss) {
 		state->group_contains_value = contains_vss;
-		return;
+		return NO;
 	}
 	if (n == state->vcc) {
 		if (state->group_contains_value != contains_vss)
 			state->group_contains_value = contains_vcc;
-		return;
+		return NO;
 	}
 
 	if (group_contains(state, n))
-		return;
+		return NO;
 
 	group_add(state, n);
 
@@ -339,18 +376,21 @@ addNodeToGroup(state_t *state, nodenum_t n)
 	if (state->group_contains_value < contains_hi && get_nodes_value(state, n)) {
 		state->group_contains_value = contains_hi;
 	}
+	return YES;
+}
 
+static void
+addNodeToGroup(state_t *state, nodenum_t n)
+{
 	/* revisit all transistors that control this node */
+	const c1c2_t *c1c2s = &state->nodes_c1c2s[state->nodes_c1c2s_start[n]];
 	for (count_t t = 0; t < state->nodes_c1c2count[n]; t++) {
-		transnum_t tn = state->nodes_c1c2s[n][t];
-		/* if the transistor connects c1 and c2... */
-		if (get_transistors_on(state, tn)) {
-			/* if original node was connected to c1, continue with c2 */
-			if (state->transistors_c1[tn] == n)
-				addNodeToGroup(state, state->transistors_c2[tn]);
-			else
-				addNodeToGroup(state, state->transistors_c1[tn]);
-		}
+		/*
+		 * if the transistor connects c1 and c2, continue with the other
+		 * side (checked before the call, most nodes are already known)
+		 */
+		if (get_transistors_on(state, c1c2s[t].transistor) && groupAddNode(state, c1c2s[t].other))
+			addNodeToGroup(state, c1c2s[t].other);
 	}
 }
 
@@ -361,7 +401,8 @@ addAllNodesToGroup(state_t *state, nodenum_t node)
 
 	state->group_contains_value = contains_nothing;
 
-	addNodeToGroup(state, node);
+	if (groupAddNode(state, node))
+		addNodeToGroup(state, node);
 }
 
 static inline BOOL
@@ -402,18 +443,20 @@ recalcNode(state_t *state, nodenum_t node)
 		nodenum_t nn = group_get(state, i);
 		if (get_nodes_value(state, nn) != newv) {
 			set_nodes_value(state, nn, newv);
+			const transnum_t *gates = &state->nodes_gates[state->nodes_gates_start[nn]];
 			for (count_t t = 0; t < state->nodes_gatecount[nn]; t++) {
-				transnum_t tn = state->nodes_gates[nn][t];
-				set_transistors_on(state, tn, newv);
+				set_transistors_on(state, gates[t], newv);
 			}
 
 			if (newv) {
+				const nodenum_t *dep = &state->nodes_left_dependant[state->nodes_left_dependant_start[nn]];
 				for (count_t g = 0; g < state->nodes_left_dependants[nn]; g++) {
-					listout_add(state, state->nodes_left_dependant[nn][g]);
+					listout_add(state, dep[g]);
 				}
 			} else {
+				const nodenum_t *dep = &state->nodes_dependant[state->nodes_dependant_start[nn]];
 				for (count_t g = 0; g < state->nodes_dependants[nn]; g++) {
-					listout_add(state, state->nodes_dependant[nn][g]);
+					listout_add(state, dep[g]);
 				}
 			}
 		}
@@ -434,7 +477,8 @@ recalcNodeList(state_t *state)
 		if (!listin_count(state))
 			break;
 
-		listout_clear(state);
+		listin_unmark(state);
+		state->listout.count = 0;
 
 		/*
 		 * for all nodes, follow their paths through
@@ -460,21 +504,43 @@ recalcNodeList(state_t *state)
 static inline void
 add_nodes_dependant(state_t *state, nodenum_t a, nodenum_t b)
 {
+	nodenum_t *dep = &state->nodes_dependant[state->nodes_dependant_start[a]];
 	for (count_t g = 0; g < state->nodes_dependants[a]; g++)
-	if (state->nodes_dependant[a][g] == b)
+	if (dep[g] == b)
 	return;
 
-	state->nodes_dependant[a][state->nodes_dependants[a]++] = b;
+	dep[state->nodes_dependants[a]++] = b;
 }
 
 static inline void
 add_nodes_left_dependant(state_t *state, nodenum_t a, nodenum_t b)
 {
+	nodenum_t *dep = &state->nodes_left_dependant[state->nodes_left_dependant_start[a]];
 	for (count_t g = 0; g < state->nodes_left_dependants[a]; g++)
-	if (state->nodes_left_dependant[a][g] == b)
+	if (dep[g] == b)
 	return;
 
-	state->nodes_left_dependant[a][state->nodes_left_dependants[a]++] = b;
+	dep[state->nodes_left_dependants[a]++] = b;
+}
+
+/* prefix sums of the per-node counts, with a final entry for the total */
+static offset_t *
+csr_starts(const count_t *counts, count_t nodes)
+{
+	offset_t *start = malloc((nodes + 1) * sizeof(*start));
+	start[0] = 0;
+	for (count_t i = 0; i < nodes; i++)
+		start[i + 1] = start[i] + counts[i];
+	return start;
+}
+
+static inline unsigned int
+transistor_hash(nodenum_t gate, nodenum_t c1, nodenum_t c2)
+{
+	/* c1 and c2 are interchangeable */
+	nodenum_t lo = c1 < c2 ? c1 : c2;
+	nodenum_t hi = c1 < c2 ? c2 : c1;
+	return ((unsigned int)gate * 73856093u) ^ ((unsigned int)lo * 19349663u) ^ ((unsigned int)hi * 83492791u);
 }
 
 state_t *
@@ -489,26 +555,10 @@ setupNodesAndTransistors(netlist_transdefs *transdefs, BOOL *node_is_pullup, nod
 	state->nodes_pullup = calloc(WORDS_FOR_BITS(state->nodes), sizeof(*state->nodes_pullup));
 	state->nodes_pulldown = calloc(WORDS_FOR_BITS(state->nodes), sizeof(*state->nodes_pulldown));
 	state->nodes_value = calloc(WORDS_FOR_BITS(state->nodes), sizeof(*state->nodes_value));
-	state->nodes_gates = malloc(state->nodes * sizeof(*state->nodes_gates));
-	for (count_t i = 0; i < state->nodes; i++) {
-		state->nodes_gates[i] = calloc(state->nodes, sizeof(**state->nodes_gates));
-	}
-	state->nodes_c1c2s = malloc(state->nodes * sizeof(*state->nodes_c1c2s));
-	for (count_t i = 0; i < state->nodes; i++) {
-		state->nodes_c1c2s[i] = calloc(2 * state->nodes, sizeof(**state->nodes_c1c2s));
-	}
 	state->nodes_gatecount = calloc(state->nodes, sizeof(*state->nodes_gatecount));
 	state->nodes_c1c2count = calloc(state->nodes, sizeof(*state->nodes_c1c2count));
 	state->nodes_dependants = calloc(state->nodes, sizeof(*state->nodes_dependants));
 	state->nodes_left_dependants = calloc(state->nodes, sizeof(*state->nodes_left_dependants));
-	state->nodes_dependant = malloc(state->nodes * sizeof(*state->nodes_dependant));
-	for (count_t i = 0; i < state->nodes; i++) {
-		state->nodes_dependant[i] = calloc(state->nodes, sizeof(**state->nodes_dependant));
-	}
-	state->nodes_left_dependant = malloc(state->nodes * sizeof(*state->nodes_left_dependant));
-	for (count_t i = 0; i < state->nodes; i++) {
-		state->nodes_left_dependant[i] = calloc(state->nodes, sizeof(**state->nodes_left_dependant));
-	}
 	state->transistors_gate = calloc(state->transistors, sizeof(*state->transistors_gate));
 	state->transistors_c1 = calloc(state->transistors, sizeof(*state->transistors_c1));
 	state->transistors_c2 = calloc(state->transistors, sizeof(*state->transistors_c2));
@@ -518,6 +568,7 @@ setupNodesAndTransistors(netlist_transdefs *transdefs, BOOL *node_is_pullup, nod
 	state->listout_bitmap = calloc(WORDS_FOR_BITS(state->nodes), sizeof(*state->listout_bitmap));
 	state->group = malloc(state->nodes * sizeof(*state->group));
 	state->groupbitmap = calloc(WORDS_FOR_BITS(state->nodes), sizeof(*state->groupbitmap));
+	state->groupcount = 0;
 	state->listin.list = state->list1;
         state->listin.count = 0;
 	state->listout.list = state->list2;
@@ -527,24 +578,32 @@ setupNodesAndTransistors(netlist_transdefs *transdefs, BOOL *node_is_pullup, nod
 	/* copy nodes into r/w data structure */
 	for (i = 0; i < state->nodes; i++) {
 		set_nodes_pullup(state, i, node_is_pullup[i]);
-		state->nodes_gatecount[i] = 0;
-		state->nodes_c1c2count[i] = 0;
 	}
-	/* copy transistors into r/w data structure */
+	/*
+	 * copy transistors into r/w data structure, skipping duplicate
+	 * transistors (found through an open-addressing hash table of the
+	 * indices + 1 of the transistors kept so far)
+	 */
+	unsigned int hash_size = 1;
+	while (hash_size < 2 * (unsigned int)transistors)
+		hash_size <<= 1;
+	unsigned int *hash = calloc(hash_size, sizeof(*hash));
 	count_t j = 0;
 	for (i = 0; i < state->transistors; i++) {
 		nodenum_t gate = transdefs[i].gate;
 		nodenum_t c1 = transdefs[i].c1;
 		nodenum_t c2 = transdefs[i].c2;
-		/* skip duplicate transistors */
 		BOOL found = NO;
-		for (count_t j2 = 0; j2 < j; j2++) {
+		unsigned int h = transistor_hash(gate, c1, c2) & (hash_size - 1);
+		for (; hash[h]; h = (h + 1) & (hash_size - 1)) {
+			count_t j2 = hash[h] - 1;
 			if (state->transistors_gate[j2] == gate &&
 				((state->transistors_c1[j2] == c1 &&
 				  state->transistors_c2[j2] == c2) ||
 				 (state->transistors_c1[j2] == c2 &&
 				  state->transistors_c2[j2] == c1))) {
 					 found = YES;
+					 break;
 				 }
 		}
 		if (!found) {
@@ -552,25 +611,49 @@ setupNodesAndTransistors(netlist_transdefs *transdefs, BOOL *node_is_pullup, nod
 			state->transistors_c1[j] = c1;
 			state->transistors_c2[j] = c2;
 			j++;
+			hash[h] = j;
 		}
 	}
+	free(hash);
 	state->transistors = j;
 
-	/* cross reference transistors in nodes data structures */
+	/* cross reference transistors in nodes data structures, first count, then fill */
+	for (i = 0; i < state->transistors; i++) {
+		state->nodes_gatecount[state->transistors_gate[i]]++;
+		state->nodes_c1c2count[state->transistors_c1[i]]++;
+		state->nodes_c1c2count[state->transistors_c2[i]]++;
+	}
+	state->nodes_gates_start = csr_starts(state->nodes_gatecount, state->nodes);
+	state->nodes_c1c2s_start = csr_starts(state->nodes_c1c2count, state->nodes);
+	state->nodes_gates = malloc((state->nodes_gates_start[state->nodes] + 1) * sizeof(*state->nodes_gates));
+	state->nodes_c1c2s = malloc((state->nodes_c1c2s_start[state->nodes] + 1) * sizeof(*state->nodes_c1c2s));
+	memset(state->nodes_gatecount, 0, state->nodes * sizeof(*state->nodes_gatecount));
+	memset(state->nodes_c1c2count, 0, state->nodes * sizeof(*state->nodes_c1c2count));
 	for (i = 0; i < state->transistors; i++) {
 		nodenum_t gate = state->transistors_gate[i];
 		nodenum_t c1 = state->transistors_c1[i];
 		nodenum_t c2 = state->transistors_c2[i];
-		state->nodes_gates[gate][state->nodes_gatecount[gate]++] = i;
-		state->nodes_c1c2s[c1][state->nodes_c1c2count[c1]++] = i;
-		state->nodes_c1c2s[c2][state->nodes_c1c2count[c2]++] = i;
+		state->nodes_gates[state->nodes_gates_start[gate] + state->nodes_gatecount[gate]++] = i;
+		state->nodes_c1c2s[state->nodes_c1c2s_start[c1] + state->nodes_c1c2count[c1]++] = (c1c2_t){ i, gate, c2 };
+		state->nodes_c1c2s[state->nodes_c1c2s_start[c2] + state->nodes_c1c2count[c2]++] = (c1c2_t){ i, gate, c1 };
 	}
 
+	/* each gate adds at most two dependants and one left dependant */
+	count_t *max_dependants = malloc(state->nodes * sizeof(*max_dependants));
+	for (i = 0; i < state->nodes; i++)
+		max_dependants[i] = 2 * state->nodes_gatecount[i];
+	state->nodes_dependant_start = csr_starts(max_dependants, state->nodes);
+	state->nodes_left_dependant_start = csr_starts(state->nodes_gatecount, state->nodes);
+	free(max_dependants);
+	state->nodes_dependant = malloc((state->nodes_dependant_start[state->nodes] + 1) * sizeof(*state->nodes_dependant));
+	state->nodes_left_dependant = malloc((state->nodes_left_dependant_start[state->nodes] + 1) * sizeof(*state->nodes_left_dependant));
+
 	for (i = 0; i < state->nodes; i++) {
 		state->nodes_dependants[i] = 0;
 		state->nodes_left_dependants[i] = 0;
+		const transnum_t *gates = &state->nodes_gates[state->nodes_gates_start[i]];
 		for (count_t g = 0; g < state->nodes_gatecount[i]; g++) {
-			transnum_t t = state->nodes_gates[i][g];
+			transnum_t t = gates[g];
 			nodenum_t c1 = state->transistors_c1[t];
 			if (c1 != vss && c1 != vcc) {
 				add_nodes_dependant(state, i, c1);
@@ -606,25 +689,17 @@ destroyNodesAndTransistors(state_t *state)
     free(state->nodes_pullup);
     free(state->nodes_pulldown);
     free(state->nodes_value);
-    for (count_t i = 0; i < state->nodes; i++) {
-        free(state->nodes_gates[i]);
-    }
+    free(state->nodes_gates_start);
     free(state->nodes_gates);
-    for (count_t i = 0; i < state->nodes; i++) {
-        free(state->nodes_c1c2s[i]);
-    }
+    free(state->nodes_c1c2s_start);
     free(state->nodes_c1c2s);
     free(state->nodes_gatecount);
     free(state->nodes_c1c2count);
     free(state->nodes_dependants);
     free(state->nodes_left_dependants);
-    for (count_t i = 0; i < state->nodes; i++) {
-        free(state->nodes_dependant[i]);
-    }
+    free(state->nodes_dependant_start);
     free(state->nodes_dependant);
-    for (count_t i = 0; i < state->nodes; i++) {
-        free(state->nodes_left_dependant[i]);
-    }
+    free(state->nodes_left_dependant_start);
     free(state->nodes_left_dependant);
     free(state->transistors_gate);
     free(state->transistors_c1);
@@ -693,3 +768,264 @@ writeNodes(state_t *state, int count, nodenum_t *nodelist, int v)
 	for (int i = 0; i < 8; i++, v >>= 1)
 	setNode(state, nodelist[i], v & 1);
 }
+
+/************************************************************
+ *
+ * Bit-Sliced Batches
+ *
+ ************************************************************/
+
+/*
+ * A batch simulates up to 64 chips with the same netlist at once. Each
+ * node has one word per property with one bit per chip, so one pass
+ * over the netlist advances all chips.
+ *
+ * Every operation is masked with the chips it applies to, and the chips
+ * never affect each other's bits, so each chip goes through exactly the
+ * same steps as the scalar code above: the worklists and groups hold
+ * (node, chips) entries in the order the scalar code would visit them in
+ * each chip. The entries of one node are merged as long as the chips
+ * agree on its position, where they don't, the node gets another entry
+ * for the remaining chips, so a node can be listed more than once with
+ * disjoint chips.
+ */
+
+typedef struct {
+	nodenum_t node;
+	lanes_t chips;
+} batch_entry_t;
+
+struct batch_state {
+	/* the netlist, only the transistors and node connections are used */
+	state_t *netlist;
+	lanes_t chips;
+
+	lanes_t *nodes_pullup;
+	lanes_t *nodes_pulldown;
+	lanes_t *nodes_value;
+
+	/* the worklists, at most one entry per node and chip */
+	batch_entry_t *listin;
+	batch_entry_t *listout;
+	offset_t listin_count;
+	offset_t listout_count;
+	/* per node, the chips in which it is in listout */
+	lanes_t *listout_chips;
+
+	/* the current group in the order of the scalar search, like the worklists */
+	batch_entry_t *group;
+	offset_t groupcount;
+	/* per node, the chips in which it belongs to the current group */
+	lanes_t *group_chips;
+	/* the chips in which the current group is connected to vss or vcc */
+	lanes_t group_vss;
+	lanes_t group_vcc;
+};
+
+batch_t *
+setupBatch(netlist_transdefs *transdefs, BOOL *node_is_pullup, nodenum_t nodes, nodenum_t transistors, nodenum_t vss, nodenum_t vcc, int num_chips)
+{
+	/* a node has at most one worklist or group entry per chip */
+	size_t max_entries = (size_t)nodes * (size_t)((num_chips < MAX_BATCH_CHIPS) ? num_chips : MAX_BATCH_CHIPS);
+	batch_t *batch = malloc(sizeof(batch_t));
+	batch->netlist = setupNodesAndTransistors(transdefs, node_is_pullup, nodes, transistors, vss, vcc);
+	batch->chips = (num_chips >= MAX_BATCH_CHIPS) ? ~(lanes_t)0 : (((lanes_t)1 << num_chips) - 1);
+	batch->nodes_pullup = calloc(nodes, sizeof(lanes_t));
+	batch->nodes_pulldown = calloc(nodes, sizeof(lanes_t));
+	batch->nodes_value = calloc(nodes, sizeof(lanes_t));
+	batch->listin = calloc(max_entries, sizeof(batch_entry_t));
+	batch->listout = calloc(max_entries, sizeof(batch_entry_t));
+	batch->listin_count = 0;
+	batch->listout_count = 0;
+	batch->listout_chips = calloc(nodes, sizeof(lanes_t));
+	batch->group = calloc(max_entries, sizeof(batch_entry_t));
+	batch->groupcount = 0;
+	batch->group_chips = calloc(nodes, sizeof(lanes_t));
+	batch->group_vss = 0;
+	batch->group_vcc = 0;
+	for (count_t i = 0; i < nodes; i++) {
+		if (node_is_pullup[i])
+			batch->nodes_pullup[i] = batch->chips;
+	}
+	return batch;
+}
+
+void
+destroyBatch(batch_t *batch)
+{
+    destroyNodesAndTransistors(batch->netlist);
+    free(batch->nodes_pullup);
+    free(batch->nodes_pulldown);
+    free(batch->nodes_value);
+    free(batch->listin);
+    free(batch->listout);
+    free(batch->listout_chips);
+    free(batch->group);
+    free(batch->group_chips);
+    free(batch);
+}
+
+/*
+ * append an entry for the chips in which the node isn't listed yet,
+ * merged into the last entry if that's the same node
+ */
+static inline void
+batch_listout_add(batch_t *batch, nodenum_t n, lanes_t chips)
+{
+	chips &= ~batch->listout_chips[n];
+	if (!chips)
+		return;
+	batch->listout_chips[n] |= chips;
+	if (batch->listout_count && batch->listout[batch->listout_count - 1].node == n)
+		batch->listout[batch->listout_count - 1].chips |= chips;
+	else
+		batch->listout[batch->listout_count++] = (batch_entry_t){ n, chips };
+}
+
+static inline void
+batch_group_add(batch_t *batch, nodenum_t n, lanes_t chips)
+{
+	batch->group_chips[n] |= chips;
+	batch->group[batch->groupcount++] = (batch_entry_t){ n, chips };
+}
+
+/* same as addNodeToGroup() in the given chips, the node is in the group in all of them */
+static void
+batchAddNodeToGroup(batch_t *batch, nodenum_t n, lanes_t chips)
+{
+	state_t *netlist = batch->netlist;
+	const c1c2_t *c1c2s = &netlist->nodes_c1c2s[netlist->nodes_c1c2s_start[n]];
+	for (count_t t = 0; t < netlist->nodes_c1c2count[n]; t++) {
+		/* the chips in which the transistor connects c1 and c2 */
+		lanes_t on = chips & batch->nodes_value[c1c2s[t].gate];
+		if (!on)
+			continue;
+		nodenum_t other = c1c2s[t].other;
+		if (other == netlist->vss) {
+			batch->group_vss |= on;
+			continue;
+		}
+		if (other == netlist->vcc) {
+			batch->group_vcc |= on;
+			continue;
+		}
+		on &= ~batch->group_chips[other];
+		if (on) {
+			batch_group_add(batch, other, on);
+			batchAddNodeToGroup(batch, other, on);
+		}
+	}
+}
+
+/* same as recalcNode() in the given chips */
+static inline void
+recalcNodeBatch(batch_t *batch, nodenum_t node, lanes_t chips)
+{
+	state_t *netlist = batch->netlist;
+	if (node == netlist->vss || node == netlist->vcc)
+		return;
+
+	batch->group_vss = 0;
+	batch->group_vcc = 0;
+	batch_group_add(batch, node, chips);
+	batchAddNodeToGroup(batch, node, chips);
+
+	/* the group value, with the same priorities as getGroupValue() */
+	lanes_t pulldown = 0;
+	lanes_t pullup = 0;
+	lanes_t hi = 0;
+	for (offset_t i = 0; i < batch->groupcount; i++) {
+		nodenum_t nn = batch->group[i].node;
+		lanes_t in_group = batch->group[i].chips;
+		pulldown |= in_group & batch->nodes_pulldown[nn];
+		pullup |= in_group & batch->nodes_pullup[nn];
+		hi |= in_group & batch->nodes_value[nn];
+	}
+	lanes_t newv = ~batch->group_vss & (batch->group_vcc | (~pulldown & (pullup | hi)));
+
+	/* set all nodes to the group value, and collect the dependants of the changed nodes */
+	for (offset_t i = 0; i < batch->groupcount; i++) {
+		nodenum_t nn = batch->group[i].node;
+		lanes_t changed = batch->group[i].chips & (batch->nodes_value[nn] ^ newv);
+		batch->group_chips[nn] = 0;
+		if (!changed)
+			continue;
+		batch->nodes_value[nn] ^= changed;
+		lanes_t up = changed & newv;
+		lanes_t down = changed & ~newv;
+		if (up) {
+			const nodenum_t *dep = &netlist->nodes_left_dependant[netlist->nodes_left_dependant_start[nn]];
+			for (count_t g = 0; g < netlist->nodes_left_dependants[nn]; g++)
+				batch_listout_add(batch, dep[g], up);
+		}
+		if (down) {
+			const nodenum_t *dep = &netlist->nodes_dependant[netlist->nodes_dependant_start[nn]];
+			for (count_t g = 0; g < netlist->nodes_dependants[nn]; g++)
+				batch_listout_add(batch, dep[g], down);
+		}
+	}
+	batch->groupcount = 0;
+}
+
+void
+recalcNodeListBatch(batch_t *batch)
+{
+	for (int j = 0; j < 100; j++) {	/* loop limiter */
+		batch_entry_t *list = batch->listin;
+		batch->listin = batch->listout;
+		batch->listout = list;
+		batch->listin_count = batch->listout_count;
+		batch->listout_count = 0;
+
+		if (!batch->listin_count)
+			break;
+
+		for (offset_t i = 0; i < batch->listin_count; i++)
+			batch->listout_chips[batch->listin[i].node] = 0;
+
+		for (offset_t i = 0; i < batch->listin_count; i++)
+			recalcNodeBatch(batch, batch->listin[i].node, batch->listin[i].chips);
+	}
+	for (offset_t i = 0; i < batch->listout_count; i++)
+		batch->listout_chips[batch->listout[i].node] = 0;
+	batch->listout_count = 0;
+}
+
+void
+stabilizeBatch(batch_t *batch)
+{
+	for (count_t i = 0; i < batch->netlist->nodes; i++)
+	batch_listout_add(batch, i, batch->chips);
+
+	recalcNodeListBatch(batch);
+}
+
+void
+setNodeBatch(batch_t *batch, nodenum_t nn, lanes_t chips, lanes_t s)
+{
+	chips &= batch->chips;
+	if (!chips)
+		return;
+	batch->nodes_pullup[nn] = (batch->nodes_pullup[nn] & ~chips) | (s & chips);
+	batch->nodes_pulldown[nn] = (batch->nodes_pulldown[nn] & ~chips) | (~s & chips);
+	batch_listout_add(batch, nn, chips);
+
+	recalcNodeListBatch(batch);
+}
+
+lanes_t
+isNodeHighBatch(batch_t *batch, nodenum_t nn)
+{
+	return batch->nodes_value[nn] & batch->chips;
+}
+
+unsigned int
+readNodesChip(batch_t *batch, int chip, int count, nodenum_t *nodelist)
+{
+	unsigned int result = 0;
+	for (int i = count - 1; i >= 0; i--) {
+		result <<= 1;
+		result |= (batch->nodes_value[nodelist[i]] >> chip) & 1;
+	}
+	return result;
+}
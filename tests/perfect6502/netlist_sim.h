@@ -1,5 +1,6 @@
 #ifndef INCLUDED_FROM_NETLIST_SIM_C
 #define state_t void
+#define batch_t void
 #endif
 
 state_t *setupNodesAndTransistors(netlist_transdefs *transdefs, BOOL *node_is_pullup, nodenum_t nodes, nodenum_t transistors, nodenum_t vss, nodenum_t vcc);
@@ -11,3 +12,16 @@ void writeNodes(state_t *state, int count, nodenum_t *nodelist, int v);
 
 void recalcNodeList(state_t *state);
 void stabilizeChip(state_t *state);
+
+/* bit-sliced batches of up to 64 chips, with one bit per chip in a lanes_t */
+typedef unsigned long long lanes_t;
+#define MAX_BATCH_CHIPS 64
+
+batch_t *setupBatch(netlist_transdefs *transdefs, BOOL *node_is_pullup, nodenum_t nodes, nodenum_t transistors, nodenum_t vss, nodenum_t vcc, int num_chips);
+void destroyBatch(batch_t *batch);
+void setNodeBatch(batch_t *batch, nodenum_t nn, lanes_t chips, lanes_t s);
+lanes_t isNodeHighBatch(batch_t *batch, nodenum_t nn);
+unsigned int readNodesChip(batch_t *batch, int chip, int count, nodenum_t *nodelist);
+
+void recalcNodeListBatch(batch_t *batch);
+void stabilizeBatch(batch_t *batch);
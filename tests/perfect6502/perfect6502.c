@@ -21,6 +21,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "types.h"
 #include "netlist_sim.h"
 /* nodes & transistors */
@@ -139,6 +140,16 @@ handleMemory(void *state)
 		mWrite(readAddressBus(state), readDataBus(state));
 }
 
+/* same with caller-provided memory, for running several chips in parallel */
+static inline void
+handleMemoryWith(void *state, uint8_t *mem)
+{
+	if (isNodeHigh(state, rw))
+		writeDataBus(state, mem[readAddressBus(state)]);
+	else
+		mem[readAddressBus(state)] = readDataBus(state);
+}
+
 /************************************************************
  *
  * Main Clock Loop
@@ -163,8 +174,23 @@ step(void *state)
 	cycle++;
 }
 
+/* thread-safe step: uses the caller's memory and doesn't count cycles */
+void
+stepWithMemory(void *state, uint8_t *mem)
+{
+	BOOL clk = isNodeHigh(state, clk0);
+
+	/* invert clock */
+	setNode(state, clk0, !clk);
+	recalcNodeList(state);
+
+	/* handle memory reads and writes */
+	if (!clk)
+		handleMemoryWith(state, mem);
+}
+
 void *
-initAndResetChip()
+initAndResetChipWithMemory(uint8_t *mem)
 {
 	/* set up data structures for efficient emulation */
 	nodenum_t nodes = sizeof(netlist_6502_node_is_pullup)/sizeof(*netlist_6502_node_is_pullup);
@@ -187,12 +213,20 @@ initAndResetChip()
 
 	/* hold RESET for 8 cycles */
 	for (int i = 0; i < 16; i++)
-		step(state);
+		stepWithMemory(state, mem);
 
 	/* release RESET */
 	setNode(state, res, 1);
 	recalcNodeList(state);
 
+	return state;
+}
+
+void *
+initAndResetChip()
+{
+	void *state = initAndResetChipWithMemory(memory);
+
 	cycle = 0;
 
 	return state;
@@ -204,6 +238,169 @@ destroyChip(void *state)
     destroyNodesAndTransistors(state);
 }
 
+/************************************************************
+ *
+ * Batches of Chips
+ *
+ ************************************************************/
+
+/*
+ * up to MAX_BATCH_CHIPS chips simulated at once by a bit-sliced
+ * netlist batch, each chip with its own memory
+ */
+
+typedef struct {
+	void *batch;
+	int num_chips;
+	lanes_t all;
+} chips_t;
+
+static nodenum_t ab_nodes[16] = { ab0, ab1, ab2, ab3, ab4, ab5, ab6, ab7, ab8, ab9, ab10, ab11, ab12, ab13, ab14, ab15 };
+static nodenum_t db_nodes[8] = { db0, db1, db2, db3, db4, db5, db6, db7 };
+
+uint16_t
+readAddressBusChip(void *chips, int chip)
+{
+	return readNodesChip(((chips_t *)chips)->batch, chip, 16, ab_nodes);
+}
+
+uint8_t
+readDataBusChip(void *chips, int chip)
+{
+	return readNodesChip(((chips_t *)chips)->batch, chip, 8, db_nodes);
+}
+
+BOOL
+readRWChip(void *chips, int chip)
+{
+	return (isNodeHighBatch(((chips_t *)chips)->batch, rw) >> chip) & 1;
+}
+
+uint8_t
+readAChip(void *chips, int chip)
+{
+	return readNodesChip(((chips_t *)chips)->batch, chip, 8, (nodenum_t[]){ a0,a1,a2,a3,a4,a5,a6,a7 });
+}
+
+uint8_t
+readXChip(void *chips, int chip)
+{
+	return readNodesChip(((chips_t *)chips)->batch, chip, 8, (nodenum_t[]){ x0,x1,x2,x3,x4,x5,x6,x7 });
+}
+
+uint8_t
+readYChip(void *chips, int chip)
+{
+	return readNodesChip(((chips_t *)chips)->batch, chip, 8, (nodenum_t[]){ y0,y1,y2,y3,y4,y5,y6,y7 });
+}
+
+uint8_t
+readPChip(void *chips, int chip)
+{
+	return readNodesChip(((chips_t *)chips)->batch, chip, 8, (nodenum_t[]){ p0,p1,p2,p3,p4,p5,p6,p7 });
+}
+
+uint8_t
+readSPChip(void *chips, int chip)
+{
+	return readNodesChip(((chips_t *)chips)->batch, chip, 8, (nodenum_t[]){ s0,s1,s2,s3,s4,s5,s6,s7 });
+}
+
+BOOL
+isNodeHighChip(void *chips, int chip, nodenum_t nn)
+{
+	return (isNodeHighBatch(((chips_t *)chips)->batch, nn) >> chip) & 1;
+}
+
+/* set a node in the chips with a bit in mask to the chip's bit in values */
+void
+setNodeChips(void *chips, nodenum_t nn, lanes_t mask, lanes_t values)
+{
+	setNodeBatch(((chips_t *)chips)->batch, nn, mask, values);
+}
+
+static void
+handleMemoryChips(chips_t *chips, uint8_t **mems, lanes_t mask)
+{
+	lanes_t reading = isNodeHighBatch(chips->batch, rw) & mask;
+	lanes_t data[8] = { 0 };
+	for (int i = 0; i < chips->num_chips; i++) {
+		if (!((mask >> i) & 1))
+			continue;
+		uint16_t a = readAddressBusChip(chips, i);
+		if ((reading >> i) & 1) {
+			uint8_t d = mems[i][a];
+			for (int b = 0; b < 8; b++)
+				data[b] |= (lanes_t)((d >> b) & 1) << i;
+		} else {
+			mems[i][a] = readDataBusChip(chips, i);
+		}
+	}
+	/* one data bus node after the other, like writeDataBus() */
+	if (reading) {
+		for (int b = 0; b < 8; b++)
+			setNodeBatch(chips->batch, db_nodes[b], reading, data[b]);
+	}
+}
+
+void
+stepChips(void *chips_, uint8_t **mems)
+{
+	chips_t *chips = chips_;
+	lanes_t clk = isNodeHighBatch(chips->batch, clk0);
+
+	/* invert clock */
+	setNodeBatch(chips->batch, clk0, chips->all, ~clk);
+	recalcNodeListBatch(chips->batch);
+
+	/* handle memory reads and writes */
+	handleMemoryChips(chips, mems, ~clk & chips->all);
+}
+
+void *
+initAndResetChips(int num_chips, uint8_t **mems)
+{
+	/* set up data structures for efficient emulation */
+	nodenum_t nodes = sizeof(netlist_6502_node_is_pullup)/sizeof(*netlist_6502_node_is_pullup);
+	nodenum_t transistors = sizeof(netlist_6502_transdefs)/sizeof(*netlist_6502_transdefs);
+	chips_t *chips = malloc(sizeof(chips_t));
+	chips->num_chips = num_chips;
+	chips->all = (num_chips >= MAX_BATCH_CHIPS) ? ~(lanes_t)0 : (((lanes_t)1 << num_chips) - 1);
+	chips->batch = setupBatch(netlist_6502_transdefs,
+							  netlist_6502_node_is_pullup,
+							  nodes,
+							  transistors,
+							  vss,
+							  vcc,
+							  num_chips);
+
+	setNodeBatch(chips->batch, res, chips->all, 0);
+	setNodeBatch(chips->batch, clk0, chips->all, chips->all);
+	setNodeBatch(chips->batch, rdy, chips->all, chips->all);
+	setNodeBatch(chips->batch, so, chips->all, 0);
+	setNodeBatch(chips->batch, irq, chips->all, chips->all);
+	setNodeBatch(chips->batch, nmi, chips->all, chips->all);
+
+	stabilizeBatch(chips->batch);
+
+	/* hold RESET for 8 cycles */
+	for (int i = 0; i < 16; i++)
+		stepChips(chips, mems);
+
+	/* release RESET */
+	setNodeBatch(chips->batch, res, chips->all, chips->all);
+	recalcNodeListBatch(chips->batch);
+
+	return chips;
+}
+
+void
+destroyChips(void *chips)
+{
+	destroyBatch(((chips_t *)chips)->batch);
+	free(chips);
+}
+
 /************************************************************
  *
  * Tracing/Debugging
@@ -3,8 +3,10 @@
 #endif
 
 extern state_t *initAndResetChip();
+extern state_t *initAndResetChipWithMemory(unsigned char *mem);
 extern void destroyChip(state_t *state);
 extern void step(state_t *state);
+extern void stepWithMemory(state_t *state, unsigned char *mem);
 extern void chipStatus(state_t *state);
 extern unsigned short readPC(state_t *state);
 extern unsigned char readA(state_t *state);
@@ -21,3 +23,18 @@ extern unsigned char readIR(state_t *state);
 extern unsigned char memory[65536];
 extern unsigned int cycle;
 extern unsigned int transistors;
+
+/* batches of up to MAX_BATCH_CHIPS chips, each with its own memory (see netlist_sim.h) */
+extern void *initAndResetChips(int num_chips, unsigned char **mems);
+extern void destroyChips(void *chips);
+extern void stepChips(void *chips, unsigned char **mems);
+extern unsigned short readAddressBusChip(void *chips, int chip);
+extern unsigned char readDataBusChip(void *chips, int chip);
+extern BOOL readRWChip(void *chips, int chip);
+extern unsigned char readAChip(void *chips, int chip);
+extern unsigned char readXChip(void *chips, int chip);
+extern unsigned char readYChip(void *chips, int chip);
+extern unsigned char readPChip(void *chips, int chip);
+extern unsigned char readSPChip(void *chips, int chip);
+extern BOOL isNodeHighChip(void *chips, int chip, nodenum_t nn);
+extern void setNodeChips(void *chips, nodenum_t nn, lanes_t mask, lanes_t values);
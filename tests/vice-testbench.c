@@ -0,0 +1,929 @@
+//------------------------------------------------------------------------------
+//  vice-testbench.c
+//
+//  Headless runner for the self-checking C64 and VIC-20 test programs in
+//  tests/vice-tests (a subset of the VICE test bench) and the Wolfgang
+//  Lorenz test suite in tests/testsuite-2.15/bin.
+//
+//  The tests are listed in vice-testbench.txt (see there for the format).
+//  Each test runs in its own unthrottled emulator instance, and all tests
+//  are run in parallel on all CPU cores (see jobpool.h). Pass/fail is
+//  detected through a debug callback on the CPU pins:
+//
+//  - VICE tests write their exit code to the debug cartridge register
+//    ($D7FF on the C64, $910F on the VIC-20, 0 means success), if a test
+//    doesn't finish in time, the last written border colour decides
+//    (green: success, red: failure)
+//  - Wolfgang Lorenz tests jump into the BASIC LOAD routine at $E16F to
+//    load the next test on success, or call GETIN ($FFE4) to wait for a
+//    key press after printing an error
+//
+//  Tests which ship reference data from real machines instead of (or in
+//  addition to) checking themselves are run as golden reference tests:
+//  a memory region or the visible framebuffer is captured when the test
+//  writes to the debug cartridge register or when its time is up, and
+//  compared against the reference file (see golden.h). Mismatches are
+//  reported as text maps of the differing bytes or 8x8 pixel cells.
+//
+//  The screen content of failed tests is added to the report, results are
+//  printed as table and can be written as JUnit XML report.
+//
+//  Usage:
+//
+//  fips run vice-testbench -- [--list file] [--dir tests_dir]
+//      [--threads n] [--junit report.xml] [--update] [filter...]
+//
+//  Only tests which contain one of the filter strings in their path are run.
+//  With --update, the reference images of framebuffer tests are written
+//  instead of compared (memory references are real machine dumps and are
+//  never overwritten).
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#define CHIPS_IMPL
+#include "chips/chips_common.h"
+#include "chips/m6502.h"
+#include "chips/m6522.h"
+#include "chips/m6526.h"
+#include "chips/m6561.h"
+#include "chips/m6569.h"
+#include "chips/m6581.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/clk.h"
+#include "systems/c1530.h"
+#include "systems/c1541.h"
+#include "systems/c64.h"
+#include "systems/vic20.h"
+#include "c64-roms.h"
+#include "c1541-roms.h"
+#include "vic20-roms.h"
+#include "getopt.h"
+#include "jobpool.h"
+#include "golden.h"
+
+#if !defined(VICE_TESTBENCH_DIR)
+#define VICE_TESTBENCH_DIR "."
+#endif
+
+// default timeout in emulated seconds
+#define VTB_DEFAULT_TIMEOUT (20)
+// frames to wait for the KERNAL to boot before loading the test
+#define VTB_LOAD_DELAY_FRAMES (180)
+// frames between typed keys
+#define VTB_KEY_DELAY_FRAMES (5)
+#define VTB_FRAME_USEC (16667)
+#define VTB_MAX_PATH (512)
+#define VTB_MAX_SCREEN (40*25)
+// default number of bytes per line in memory mismatch maps
+#define VTB_DEFAULT_MAP_COLS (32)
+// size of a framebuffer mismatch map cell in pixels
+#define VTB_MAP_CELL_SIZE (8)
+
+typedef enum {
+    VTB_SYSTEM_NONE,        // test program couldn't be loaded
+    VTB_SYSTEM_C64,
+    VTB_SYSTEM_VIC20,
+    VTB_SYSTEM_VIC20_8K,
+} vtb_system_t;
+
+typedef enum {
+    VTB_MODE_DEBUGCART,
+    VTB_MODE_LORENZ,
+    VTB_MODE_MEMORY,
+    VTB_MODE_FRAME,
+} vtb_mode_t;
+
+typedef enum {
+    VTB_RESULT_NONE,
+    VTB_RESULT_PASS,
+    VTB_RESULT_FAIL,
+    VTB_RESULT_TIMEOUT,
+    VTB_RESULT_ERROR,       // failed to load or start the test
+} vtb_result_t;
+
+typedef struct {
+    char path[VTB_MAX_PATH];
+    vtb_mode_t mode;
+    double timeout_secs;
+    // golden reference (memory and frame modes)
+    char ref_path[VTB_MAX_PATH];
+    int ref_addr;           // address of the first compared byte, or -1 for the reference load address
+    int ref_skip;           // number of bytes to skip at the start of the reference file
+    int ref_size;           // number of bytes to compare, or 0 for the rest of the reference file
+    int map_cols;           // bytes per line in the memory mismatch map
+    // set by the worker thread
+    vtb_system_t system;
+    vtb_result_t result;
+    bool armed;             // true after the test program was started
+    bool stopped;           // set by debug callback to stop the emulation
+    int exit_code;          // debug cart exit code, or -1
+    int border_color;       // last written border colour, or -1
+    double emu_secs;
+    double host_secs;
+    char message[VTB_MAX_PATH + 64];
+    char screen[VTB_MAX_SCREEN + 25 + 1];
+    golden_text_t diff;     // mismatch map of a failed reference comparison
+} vtb_test_t;
+
+static struct {
+    const char* dir;
+    bool update;
+    vtb_test_t* tests;
+    int num_tests;
+    int max_tests;
+} state;
+
+static void dummy_audio_callback(const float* samples, int num_samples, void* user_data) {
+    (void)samples;
+    (void)num_samples;
+    (void)user_data;
+}
+
+static const char* vtb_system_name(vtb_system_t sys) {
+    switch (sys) {
+        case VTB_SYSTEM_C64: return "c64";
+        case VTB_SYSTEM_VIC20: return "vic20";
+        case VTB_SYSTEM_VIC20_8K: return "vic20-8k";
+        default: return "none";
+    }
+}
+
+static const char* vtb_result_name(vtb_result_t res) {
+    switch (res) {
+        case VTB_RESULT_PASS: return "PASS";
+        case VTB_RESULT_FAIL: return "FAIL";
+        case VTB_RESULT_TIMEOUT: return "TIMEOUT";
+        case VTB_RESULT_ERROR: return "ERROR";
+        default: return "NONE";
+    }
+}
+
+// called after each system tick with the CPU pins
+static void vtb_debug_callback(void* user_data, uint64_t pins) {
+    vtb_test_t* test = (vtb_test_t*) user_data;
+    if (!test->armed) {
+        return;
+    }
+    const uint16_t addr = M6502_GET_ADDR(pins);
+    if (pins & M6502_RW) {
+        if ((test->mode == VTB_MODE_LORENZ) && (pins & M6502_SYNC)) {
+            if (addr == 0xE16F) {
+                test->result = VTB_RESULT_PASS;
+                test->stopped = true;
+            }
+            else if (addr == 0xFFE4) {
+                test->result = VTB_RESULT_FAIL;
+                snprintf(test->message, sizeof(test->message), "test waits for key press after error");
+                test->stopped = true;
+            }
+        }
+    }
+    else if (test->mode != VTB_MODE_LORENZ) {
+        const uint8_t data = M6502_GET_DATA(pins);
+        if (test->system == VTB_SYSTEM_C64) {
+            if (addr == 0xD7FF) {
+                test->exit_code = data;
+                test->stopped = true;
+            }
+            else if ((addr & 0xFC3F) == 0xD020) {
+                test->border_color = data & 0x0F;
+            }
+        }
+        else {
+            if (addr == 0x910F) {
+                test->exit_code = data;
+                test->stopped = true;
+            }
+            else if ((addr & 0xFF0F) == 0x900F) {
+                test->border_color = data & 0x07;
+            }
+        }
+    }
+}
+
+// hacky screen code to ASCII conversion
+static char vtb_screen2ascii(uint8_t c) {
+    c &= 0x7F;
+    if (c == 0) {
+        return '@';
+    }
+    else if (c <= 0x1A) {
+        return 'a' + (c - 1);
+    }
+    else if ((c >= 0x20) && (c < 0x40)) {
+        return (char)c;
+    }
+    else if ((c >= 0x41) && (c <= 0x5A)) {
+        return 'A' + (c - 0x41);
+    }
+    else {
+        return '.';
+    }
+}
+
+// copy the text screen into the test result, the KERNAL keeps the
+// screen memory page at $0288 on the C64 and VIC-20
+static void vtb_scrape_screen(vtb_test_t* test, mem_t* mem) {
+    const bool c64 = test->system == VTB_SYSTEM_C64;
+    const int width = c64 ? 40 : 22;
+    const int height = c64 ? 25 : 23;
+    const uint16_t base = mem_rd(mem, 0x0288) << 8;
+    int pos = 0;
+    for (int y = 0; y < height; y++) {
+        int len = 0;
+        for (int x = 0; x < width; x++) {
+            const char c = vtb_screen2ascii(mem_rd(mem, (uint16_t)(base + y * width + x)));
+            test->screen[pos + x] = c;
+            if (c != ' ') {
+                len = x + 1;
+            }
+        }
+        // strip trailing spaces
+        pos += len;
+        test->screen[pos++] = '\n';
+    }
+    // strip trailing empty lines
+    while ((pos > 0) && (test->screen[pos - 1] == '\n')) {
+        pos--;
+    }
+    test->screen[pos] = 0;
+}
+
+// read a whole file into a malloc'ed buffer, returns a zero range on failure
+static chips_range_t vtb_read_file(const char* path) {
+    chips_range_t res = { 0 };
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        return res;
+    }
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size > 0) {
+        res.ptr = malloc((size_t)size);
+        assert(res.ptr);
+        res.size = fread(res.ptr, 1, (size_t)size, fp);
+        if (res.size != (size_t)size) {
+            free(res.ptr);
+            res.ptr = 0;
+            res.size = 0;
+        }
+    }
+    fclose(fp);
+    return res;
+}
+
+static void vtb_error(vtb_test_t* test, const char* msg, const char* path) {
+    test->result = VTB_RESULT_ERROR;
+    snprintf(test->message, sizeof(test->message), "%s '%s'", msg, path);
+}
+
+// compare a memory region as seen by the CPU against the reference file
+static void vtb_compare_memory(vtb_test_t* test, mem_t* mem) {
+    char path[2 * VTB_MAX_PATH];
+    snprintf(path, sizeof(path), "%s/%s", state.dir, test->ref_path);
+    chips_range_t ref = vtb_read_file(path);
+    if (!ref.ptr) {
+        vtb_error(test, "failed to read reference", test->ref_path);
+        return;
+    }
+    const uint8_t* ref_data = (const uint8_t*) ref.ptr;
+    int addr = test->ref_addr;
+    size_t skip = (size_t)test->ref_skip;
+    if (addr < 0) {
+        // a PRG style dump, the first two bytes are the load address
+        addr = (ref.size >= 2) ? (ref_data[0] | (ref_data[1] << 8)) : 0;
+        skip = 2;
+    }
+    size_t num = (ref.size > skip) ? (ref.size - skip) : 0;
+    if ((test->ref_size > 0) && ((size_t)test->ref_size <= num)) {
+        num = (size_t)test->ref_size;
+    }
+    else if (test->ref_size > 0) {
+        num = 0;
+    }
+    if ((0 == num) || (((size_t)addr + num) > 0x10000)) {
+        vtb_error(test, "invalid reference range in", test->ref_path);
+        free(ref.ptr);
+        return;
+    }
+    uint8_t* actual = malloc(num);
+    uint8_t* diff_bits = malloc((num + 7) / 8);
+    assert(actual && diff_bits);
+    for (size_t i = 0; i < num; i++) {
+        actual[i] = mem_rd(mem, (uint16_t)(addr + i));
+    }
+    const size_t num_diffs = golden_compare(ref_data + skip, actual, num, diff_bits);
+    if (0 == num_diffs) {
+        test->result = VTB_RESULT_PASS;
+    }
+    else {
+        test->result = VTB_RESULT_FAIL;
+        snprintf(test->message, sizeof(test->message), "%zu of %zu bytes at $%04X differ from reference", num_diffs, num, addr);
+        golden_memory_map(&test->diff, (uint16_t)addr, ref_data + skip, actual, num, diff_bits, test->map_cols);
+    }
+    free(diff_bits);
+    free(actual);
+    free(ref.ptr);
+}
+
+// convert the visible area of the framebuffer to an RGB image
+static bool vtb_capture_frame(chips_display_info_t info, golden_image_t* img) {
+    memset(img, 0, sizeof(golden_image_t));
+    const bool paletted = 0 != info.palette.ptr;
+    const size_t bytes_per_pixel = paletted ? 1 : 4;
+    if (!info.frame.buffer.ptr || (info.screen.width <= 0) || (info.screen.height <= 0)) {
+        return false;
+    }
+    if (((size_t)(info.screen.y + info.screen.height) * info.frame.dim.width * bytes_per_pixel) > info.frame.buffer.size) {
+        return false;
+    }
+    img->width = info.screen.width;
+    img->height = info.screen.height;
+    img->pixels = malloc((size_t)img->width * img->height * 3);
+    assert(img->pixels);
+    const uint8_t* pixels = (const uint8_t*) info.frame.buffer.ptr;
+    const uint32_t* palette = (const uint32_t*) info.palette.ptr;
+    const size_t num_colors = info.palette.size / sizeof(uint32_t);
+    uint8_t* dst = img->pixels;
+    for (int y = info.screen.y; y < (info.screen.y + info.screen.height); y++) {
+        for (int x = info.screen.x; x < (info.screen.x + info.screen.width); x++, dst += 3) {
+            const size_t offset = ((size_t)y * info.frame.dim.width + x) * bytes_per_pixel;
+            if (paletted) {
+                const uint8_t index = pixels[offset];
+                // palette entries are RGBA8 (0xAABBGGRR)
+                const uint32_t c = (index < num_colors) ? palette[index] : 0;
+                dst[0] = (uint8_t)c;
+                dst[1] = (uint8_t)(c >> 8);
+                dst[2] = (uint8_t)(c >> 16);
+            }
+            else {
+                memcpy(dst, &pixels[offset], 3);
+            }
+        }
+    }
+    return true;
+}
+
+// compare the visible framebuffer against the reference PPM image
+static void vtb_compare_frame(vtb_test_t* test, chips_display_info_t info) {
+    char path[2 * VTB_MAX_PATH];
+    snprintf(path, sizeof(path), "%s/%s", state.dir, test->ref_path);
+    golden_image_t actual;
+    if (!vtb_capture_frame(info, &actual)) {
+        vtb_error(test, "failed to capture framebuffer for", test->ref_path);
+        return;
+    }
+    if (state.update) {
+        if (golden_write_ppm(path, &actual)) {
+            test->result = VTB_RESULT_PASS;
+            snprintf(test->message, sizeof(test->message), "reference image updated");
+        }
+        else {
+            vtb_error(test, "failed to write reference", test->ref_path);
+        }
+        golden_image_free(&actual);
+        return;
+    }
+    golden_image_t expected;
+    if (!golden_read_ppm(path, &expected)) {
+        vtb_error(test, "failed to read reference", test->ref_path);
+        golden_image_free(&actual);
+        return;
+    }
+    if ((expected.width != actual.width) || (expected.height != actual.height)) {
+        test->result = VTB_RESULT_FAIL;
+        snprintf(test->message, sizeof(test->message), "framebuffer size %dx%d differs from reference size %dx%d",
+            actual.width, actual.height, expected.width, expected.height);
+    }
+    else {
+        const size_t num = (size_t)actual.width * actual.height * 3;
+        uint8_t* diff_bits = malloc((num + 7) / 8);
+        assert(diff_bits);
+        if (0 == golden_compare(expected.pixels, actual.pixels, num, diff_bits)) {
+            test->result = VTB_RESULT_PASS;
+        }
+        else {
+            test->result = VTB_RESULT_FAIL;
+            const size_t num_pixels = golden_image_map(&test->diff, &actual, diff_bits, VTB_MAP_CELL_SIZE);
+            snprintf(test->message, sizeof(test->message), "%zu of %d pixels differ from reference",
+                num_pixels, actual.width * actual.height);
+        }
+        free(diff_bits);
+    }
+    golden_image_free(&expected);
+    golden_image_free(&actual);
+}
+
+// run the emulator in frame slices until the test stopped it or the time is up,
+// optionally feeding keyboard input, returns the emulated time in usec
+static uint64_t vtb_run(vtb_test_t* test, void* sys, uint64_t num_usec, const char* input) {
+    uint64_t usec = 0;
+    int frame = 0;
+    while (!test->stopped && (usec < num_usec)) {
+        if (input && *input && (0 == (++frame % VTB_KEY_DELAY_FRAMES))) {
+            if (test->system == VTB_SYSTEM_C64) {
+                c64_key_down(sys, *input);
+                c64_key_up(sys, *input);
+            }
+            else {
+                vic20_key_down(sys, *input);
+                vic20_key_up(sys, *input);
+            }
+            input++;
+        }
+        if (test->system == VTB_SYSTEM_C64) {
+            c64_exec(sys, VTB_FRAME_USEC);
+        }
+        else {
+            vic20_exec(sys, VTB_FRAME_USEC);
+        }
+        usec += VTB_FRAME_USEC;
+    }
+    return usec;
+}
+
+static void vtb_run_test(vtb_test_t* test) {
+    char path[2 * VTB_MAX_PATH];
+    snprintf(path, sizeof(path), "%s/%s", state.dir, test->path);
+    test->exit_code = -1;
+    test->border_color = -1;
+
+    // load the PRG file, the load address selects the system
+    const chips_range_t prg = vtb_read_file(path);
+    if (!prg.ptr) {
+        vtb_error(test, "failed to open", test->path);
+        return;
+    }
+    const uint8_t* data = (const uint8_t*) prg.ptr;
+    const uint16_t load_addr = (prg.size > 2) ? (data[0] | (data[1] << 8)) : 0;
+    switch (load_addr) {
+        case 0x0801: test->system = VTB_SYSTEM_C64; break;
+        case 0x1001: test->system = VTB_SYSTEM_VIC20; break;
+        case 0x1201: test->system = VTB_SYSTEM_VIC20_8K; break;
+        default:
+            test->result = VTB_RESULT_ERROR;
+            snprintf(test->message, sizeof(test->message), "unsupported load address $%04X", load_addr);
+            free(prg.ptr);
+            return;
+    }
+    const chips_debug_t debug = {
+        .callback = { .func = vtb_debug_callback, .user_data = test },
+        .stopped = &test->stopped,
+    };
+    const chips_audio_desc_t audio = { .callback = { .func = dummy_audio_callback } };
+
+    void* sys = 0;
+    mem_t* mem = 0;
+    if (test->system == VTB_SYSTEM_C64) {
+        c64_t* c64 = calloc(1, sizeof(c64_t));
+        assert(c64);
+        c64_init(c64, &(c64_desc_t){
+            .audio = audio,
+            .debug = debug,
+            .roms = {
+                .chars = { .ptr=dump_c64_char_bin, .size=sizeof(dump_c64_char_bin) },
+                .basic = { .ptr=dump_c64_basic_bin, .size=sizeof(dump_c64_basic_bin) },
+                .kernal = { .ptr=dump_c64_kernalv3_bin, .size=sizeof(dump_c64_kernalv3_bin) },
+                .c1541 = {
+                    .c000_dfff = { .ptr=dump_1541_c000_325302_01_bin, .size=sizeof(dump_1541_c000_325302_01_bin) },
+                    .e000_ffff = { .ptr=dump_1541_e000_901229_06aa_bin, .size=sizeof(dump_1541_e000_901229_06aa_bin) },
+                }
+            }
+        });
+        sys = c64;
+        mem = &c64->mem_cpu;
+    }
+    else {
+        vic20_t* vic20 = calloc(1, sizeof(vic20_t));
+        assert(vic20);
+        vic20_init(vic20, &(vic20_desc_t){
+            .mem_config = (test->system == VTB_SYSTEM_VIC20_8K) ? VIC20_MEMCONFIG_8K : VIC20_MEMCONFIG_STANDARD,
+            .audio = audio,
+            .debug = debug,
+            .roms = {
+                .chars = { .ptr=dump_vic20_characters_901460_03_bin, .size=sizeof(dump_vic20_characters_901460_03_bin) },
+                .basic = { .ptr=dump_vic20_basic_901486_01_bin, .size=sizeof(dump_vic20_basic_901486_01_bin) },
+                .kernal = { .ptr=dump_vic20_kernal_901486_07_bin, .size=sizeof(dump_vic20_kernal_901486_07_bin) },
+            }
+        });
+        sys = vic20;
+        mem = &vic20->mem_cpu;
+    }
+
+    // boot, load and start the test program, same as the sokol frontends
+    uint64_t usec = vtb_run(test, sys, VTB_LOAD_DELAY_FRAMES * VTB_FRAME_USEC, 0);
+    const char* input = 0;
+    bool loaded;
+    if (test->system == VTB_SYSTEM_C64) {
+        loaded = c64_quickload(sys, prg);
+        if (loaded) {
+            c64_basic_run(sys);
+        }
+    }
+    else {
+        loaded = vic20_quickload(sys, prg);
+        input = "RUN\r";
+    }
+    if (loaded) {
+        test->armed = true;
+        usec += vtb_run(test, sys, (uint64_t)(test->timeout_secs * 1000000.0), input);
+        // reference tests capture on the debug cart write or when the time is up
+        if (test->mode == VTB_MODE_MEMORY) {
+            vtb_compare_memory(test, mem);
+        }
+        else if (test->mode == VTB_MODE_FRAME) {
+            if (test->system == VTB_SYSTEM_C64) {
+                vtb_compare_frame(test, c64_display_info(sys));
+            }
+            else {
+                vtb_compare_frame(test, vic20_display_info(sys));
+            }
+        }
+        else if (test->result == VTB_RESULT_NONE) {
+            if (test->exit_code >= 0) {
+                test->result = (test->exit_code == 0) ? VTB_RESULT_PASS : VTB_RESULT_FAIL;
+                if (test->exit_code != 0) {
+                    snprintf(test->message, sizeof(test->message), "debug cart exit code $%02X", test->exit_code);
+                }
+            }
+            else if (test->border_color == 5) {
+                test->result = VTB_RESULT_PASS;
+            }
+            else if ((test->border_color == 2) || (test->border_color == 10)) {
+                test->result = VTB_RESULT_FAIL;
+                snprintf(test->message, sizeof(test->message), "red border colour");
+            }
+            else {
+                test->result = VTB_RESULT_TIMEOUT;
+                snprintf(test->message, sizeof(test->message), "no result after %.1f emulated secs", test->timeout_secs);
+            }
+        }
+        if (test->result != VTB_RESULT_PASS) {
+            vtb_scrape_screen(test, mem);
+        }
+    }
+    else {
+        vtb_error(test, "failed to load", test->path);
+    }
+    test->emu_secs = usec / 1000000.0;
+    if (test->system == VTB_SYSTEM_C64) {
+        c64_discard(sys);
+    }
+    else {
+        vic20_discard(sys);
+    }
+    free(sys);
+    free(prg.ptr);
+}
+
+static void vtb_job_func(int job_index, int worker_index, void* user_data) {
+    (void)worker_index;
+    (void)user_data;
+    vtb_test_t* test = &state.tests[job_index];
+    const uint64_t start = stm_now();
+    vtb_run_test(test);
+    test->host_secs = stm_sec(stm_since(start));
+}
+
+static bool vtb_match_filter(const char* path, const char** filters, int num_filters) {
+    if (0 == num_filters) {
+        return true;
+    }
+    for (int i = 0; i < num_filters; i++) {
+        if (strstr(path, filters[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// parse a decimal, 0x or $ prefixed hex number
+static bool vtb_parse_int(const char* str, int* out) {
+    char* end = 0;
+    const long val = (str[0] == '$') ? strtol(str + 1, &end, 16) : strtol(str, &end, 0);
+    if ((end == str) || (*end != 0) || (val < 0) || (val > 0x7FFFFFFF)) {
+        return false;
+    }
+    *out = (int)val;
+    return true;
+}
+
+// parse the optional arguments after the mode, returns false on error
+static bool vtb_parse_args(vtb_test_t* test, const char* list_path, int line_nr) {
+    const char* tok;
+    while ((tok = strtok(0, " \t\r\n"))) {
+        const char* val = strchr(tok, '=');
+        bool valid = true;
+        if (!val) {
+            char* end = 0;
+            test->timeout_secs = strtod(tok, &end);
+            valid = (*end == 0) && (test->timeout_secs > 0.0) && (test->timeout_secs <= 3600.0);
+        }
+        else if (0 == strncmp(tok, "ref=", 4)) {
+            valid = strlen(val + 1) < VTB_MAX_PATH;
+            if (valid) {
+                strcpy(test->ref_path, val + 1);
+            }
+        }
+        else if (0 == strncmp(tok, "addr=", 5)) {
+            valid = vtb_parse_int(val + 1, &test->ref_addr) && (test->ref_addr <= 0xFFFF);
+        }
+        else if (0 == strncmp(tok, "skip=", 5)) {
+            valid = vtb_parse_int(val + 1, &test->ref_skip);
+        }
+        else if (0 == strncmp(tok, "size=", 5)) {
+            valid = vtb_parse_int(val + 1, &test->ref_size) && (test->ref_size <= 0x10000);
+        }
+        else if (0 == strncmp(tok, "cols=", 5)) {
+            valid = vtb_parse_int(val + 1, &test->map_cols) && (test->map_cols >= 1) && (test->map_cols <= 256);
+        }
+        else {
+            fprintf(stderr, "%s:%d: unknown argument '%s'\n", list_path, line_nr, tok);
+            return false;
+        }
+        if (!valid) {
+            fprintf(stderr, "%s:%d: invalid argument '%s'\n", list_path, line_nr, tok);
+            return false;
+        }
+    }
+    const bool golden = (test->mode == VTB_MODE_MEMORY) || (test->mode == VTB_MODE_FRAME);
+    if (golden != (0 != test->ref_path[0])) {
+        fprintf(stderr, "%s:%d: a ref=file argument is required for (and only allowed in) memory and frame mode\n", list_path, line_nr);
+        return false;
+    }
+    if ((test->ref_skip > 0) && (test->ref_addr < 0)) {
+        fprintf(stderr, "%s:%d: skip= requires addr=\n", list_path, line_nr);
+        return false;
+    }
+    return true;
+}
+
+static bool vtb_load_list(const char* list_path, const char** filters, int num_filters) {
+    FILE* fp = fopen(list_path, "r");
+    if (!fp) {
+        fprintf(stderr, "failed to open test list '%s'\n", list_path);
+        return false;
+    }
+    char line[1024];
+    int line_nr = 0;
+    bool success = true;
+    while (success && fgets(line, sizeof(line), fp)) {
+        line_nr++;
+        const char* path = strtok(line, " \t\r\n");
+        if (!path || (path[0] == '#')) {
+            continue;
+        }
+        const char* mode = strtok(0, " \t\r\n");
+        if (!mode || (strlen(path) >= VTB_MAX_PATH)) {
+            fprintf(stderr, "%s:%d: expected 'path mode [timeout_secs] [key=value...]'\n", list_path, line_nr);
+            success = false;
+            break;
+        }
+        vtb_test_t test = {
+            .timeout_secs = VTB_DEFAULT_TIMEOUT,
+            .ref_addr = -1,
+            .map_cols = VTB_DEFAULT_MAP_COLS,
+        };
+        strcpy(test.path, path);
+        if (0 == strcmp(mode, "debugcart")) {
+            test.mode = VTB_MODE_DEBUGCART;
+        }
+        else if (0 == strcmp(mode, "lorenz")) {
+            test.mode = VTB_MODE_LORENZ;
+        }
+        else if (0 == strcmp(mode, "memory")) {
+            test.mode = VTB_MODE_MEMORY;
+        }
+        else if (0 == strcmp(mode, "frame")) {
+            test.mode = VTB_MODE_FRAME;
+        }
+        else {
+            fprintf(stderr, "%s:%d: unknown mode '%s'\n", list_path, line_nr, mode);
+            success = false;
+            break;
+        }
+        if (!vtb_parse_args(&test, list_path, line_nr)) {
+            success = false;
+            break;
+        }
+        if (!vtb_match_filter(test.path, filters, num_filters)) {
+            continue;
+        }
+        if (state.num_tests == state.max_tests) {
+            state.max_tests = state.max_tests ? (state.max_tests * 2) : 256;
+            state.tests = realloc(state.tests, (size_t)state.max_tests * sizeof(vtb_test_t));
+            assert(state.tests);
+        }
+        state.tests[state.num_tests++] = test;
+    }
+    fclose(fp);
+    return success;
+}
+
+static void vtb_write_xml_escaped(FILE* fp, const char* str) {
+    for (; *str; str++) {
+        switch (*str) {
+            case '<': fputs("&lt;", fp); break;
+            case '>': fputs("&gt;", fp); break;
+            case '&': fputs("&amp;", fp); break;
+            case '"': fputs("&quot;", fp); break;
+            default: fputc(*str, fp); break;
+        }
+    }
+}
+
+// JUnit XML report with one testsuite per emulated system
+static void vtb_write_junit(FILE* fp, double wall_secs) {
+    int num_failures = 0;
+    int num_errors = 0;
+    for (int i = 0; i < state.num_tests; i++) {
+        const vtb_result_t res = state.tests[i].result;
+        num_failures += (res == VTB_RESULT_FAIL) || (res == VTB_RESULT_TIMEOUT);
+        num_errors += res == VTB_RESULT_ERROR;
+    }
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(fp, "<testsuites name=\"vice-testbench\" tests=\"%d\" failures=\"%d\" errors=\"%d\" time=\"%.3f\">\n",
+        state.num_tests, num_failures, num_errors, wall_secs);
+    for (int sys = VTB_SYSTEM_NONE; sys <= VTB_SYSTEM_VIC20_8K; sys++) {
+        int num_tests = 0;
+        num_failures = 0;
+        num_errors = 0;
+        double secs = 0.0;
+        for (int i = 0; i < state.num_tests; i++) {
+            const vtb_test_t* test = &state.tests[i];
+            if ((int)test->system == sys) {
+                num_tests++;
+                num_failures += (test->result == VTB_RESULT_FAIL) || (test->result == VTB_RESULT_TIMEOUT);
+                num_errors += test->result == VTB_RESULT_ERROR;
+                secs += test->host_secs;
+            }
+        }
+        if (0 == num_tests) {
+            continue;
+        }
+        fprintf(fp, "  <testsuite name=\"%s\" tests=\"%d\" failures=\"%d\" errors=\"%d\" time=\"%.3f\">\n",
+            vtb_system_name((vtb_system_t)sys), num_tests, num_failures, num_errors, secs);
+        for (int i = 0; i < state.num_tests; i++) {
+            const vtb_test_t* test = &state.tests[i];
+            if ((int)test->system != sys) {
+                continue;
+            }
+            fprintf(fp, "    <testcase classname=\"%s\" name=\"", vtb_system_name(test->system));
+            vtb_write_xml_escaped(fp, test->path);
+            fprintf(fp, "\" time=\"%.3f\">\n", test->host_secs);
+            fprintf(fp, "      <properties><property name=\"emulated_secs\" value=\"%.3f\"/></properties>\n", test->emu_secs);
+            if (test->result != VTB_RESULT_PASS) {
+                const char* tag = (test->result == VTB_RESULT_ERROR) ? "error" : "failure";
+                fprintf(fp, "      <%s type=\"%s\" message=\"", tag, vtb_result_name(test->result));
+                vtb_write_xml_escaped(fp, test->message);
+                fprintf(fp, "\"/>\n");
+                if (test->screen[0] || test->diff.buf) {
+                    fprintf(fp, "      <system-out>");
+                    if (test->diff.buf) {
+                        vtb_write_xml_escaped(fp, test->diff.buf);
+                        fprintf(fp, "\n");
+                    }
+                    vtb_write_xml_escaped(fp, test->screen);
+                    fprintf(fp, "</system-out>\n");
+                }
+            }
+            fprintf(fp, "    </testcase>\n");
+        }
+        fprintf(fp, "  </testsuite>\n");
+    }
+    fprintf(fp, "</testsuites>\n");
+}
+
+static const getopt_option_t option_list[] = {
+    { "help", 'h', GETOPT_OPTION_TYPE_NO_ARG, 0, 'h', "print this help text", 0 },
+    { "list", 'l', GETOPT_OPTION_TYPE_REQUIRED, 0, 'l', "test list file (default: vice-testbench.txt in tests dir)", "file" },
+    { "dir", 'd', GETOPT_OPTION_TYPE_REQUIRED, 0, 'd', "tests directory", "dir" },
+    { "threads", 'p', GETOPT_OPTION_TYPE_REQUIRED, 0, 'p', "number of worker threads (default: number of cores)", "n" },
+    { "junit", 'j', GETOPT_OPTION_TYPE_REQUIRED, 0, 'j', "write JUnit XML report", "file" },
+    { "update", 'u', GETOPT_OPTION_TYPE_NO_ARG, 0, 'u', "write framebuffer reference images instead of comparing", 0 },
+    GETOPT_OPTIONS_END
+};
+
+static char help_buf[2048];
+
+int main(int argc, const char** argv) {
+    const char* list_path = 0;
+    const char* junit_path = 0;
+    int num_threads = jobpool_num_cores();
+    static const char* filters[64];
+    int num_filters = 0;
+    state.dir = VICE_TESTBENCH_DIR;
+    getopt_context_t ctx;
+    if (getopt_create_context(&ctx, argc, argv, option_list) < 0) {
+        fprintf(stderr, "getopt_create_context() failed!\n");
+        return 10;
+    }
+    int opt;
+    while ((opt = getopt_next(&ctx)) != -1) {
+        switch (opt) {
+            case '+':
+                if (num_filters >= (int)(sizeof(filters) / sizeof(filters[0]))) {
+                    fprintf(stderr, "too many filters\n");
+                    return 10;
+                }
+                filters[num_filters++] = ctx.current_opt_arg;
+                break;
+            case '?':
+                fprintf(stderr, "unknown flag %s\n", ctx.current_opt_arg);
+                return 10;
+            case '!':
+                fprintf(stderr, "invalid use of flag %s\n", ctx.current_opt_arg);
+                return 10;
+            case 'h':
+                fprintf(stderr, "vice-testbench -- run the VICE and Lorenz C64/VIC-20 tests headless\n\n");
+                fprintf(stderr, "%s", getopt_create_help_string(&ctx, help_buf, sizeof(help_buf)));
+                return 0;
+            case 'l':
+                list_path = ctx.current_opt_arg;
+                break;
+            case 'd':
+                state.dir = ctx.current_opt_arg;
+                break;
+            case 'p':
+                num_threads = atoi(ctx.current_opt_arg);
+                break;
+            case 'j':
+                junit_path = ctx.current_opt_arg;
+                break;
+            case 'u':
+                state.update = true;
+                break;
+            default:
+                break;
+        }
+    }
+    if ((num_threads < 1) || (num_threads > JOBPOOL_MAX_THREADS)) {
+        fprintf(stderr, "number of threads must be in range [1, %d]\n", JOBPOOL_MAX_THREADS);
+        return 10;
+    }
+    char default_list_path[VTB_MAX_PATH];
+    if (!list_path) {
+        snprintf(default_list_path, sizeof(default_list_path), "%s/vice-testbench.txt", state.dir);
+        list_path = default_list_path;
+    }
+    if (!vtb_load_list(list_path, filters, num_filters)) {
+        return 10;
+    }
+    if (0 == state.num_tests) {
+        fprintf(stderr, "no tests to run\n");
+        return 10;
+    }
+
+    stm_setup();
+    printf(">>> running %d test(s)...\n\n", state.num_tests);
+    const uint64_t start = stm_now();
+    const int num_workers = jobpool_run(&(jobpool_desc_t){
+        .num_jobs = state.num_tests,
+        .num_threads = num_threads,
+        .func = vtb_job_func,
+    });
+    const double wall_secs = stm_sec(stm_since(start));
+
+    int num_passed = 0;
+    double emu_secs = 0.0;
+    for (int i = 0; i < state.num_tests; i++) {
+        const vtb_test_t* test = &state.tests[i];
+        printf("%-8s %-9s %8.2f %8.3f  %s", vtb_result_name(test->result), vtb_system_name(test->system), test->emu_secs, test->host_secs, test->path);
+        if (test->message[0]) {
+            printf(" (%s)", test->message);
+        }
+        printf("\n");
+        if (test->result == VTB_RESULT_PASS) {
+            num_passed++;
+        }
+        emu_secs += test->emu_secs;
+    }
+    // mismatch maps of failed reference tests
+    for (int i = 0; i < state.num_tests; i++) {
+        const vtb_test_t* test = &state.tests[i];
+        if (test->diff.buf) {
+            printf("\n%s (%s):\n%s", test->path, test->ref_path, test->diff.buf);
+        }
+    }
+    printf("\n%d of %d test(s) passed, %.2f emulated secs in %.3f secs on %d thread(s)\n",
+        num_passed, state.num_tests, emu_secs, wall_secs, num_workers);
+
+    if (junit_path) {
+        FILE* fp = fopen(junit_path, "w");
+        if (!fp) {
+            fprintf(stderr, "failed to open JUnit report file '%s'\n", junit_path);
+            return 10;
+        }
+        vtb_write_junit(fp, wall_secs);
+        fclose(fp);
+    }
+    return (num_passed == state.num_tests) ? 0 : 10;
+}
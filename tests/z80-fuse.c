@@ -4,6 +4,9 @@
 //  Run the FUSE ZX Spectrum emulator CPU test:
 //  https://github.com/tom-seddon/fuse-emulator-code/tree/master/fuse/z80/tests
 //
+//  The tests are independent and run as separate jobs on all CPU cores
+//  (see jobpool.h), the output is merged in the original test order.
+//
 //  NOTE: FUSE doesn't always agree with ZEXALL about the state of the 
 //  undocumented XF and YF flag bits, maybe the two tests are based
 //  on different Z80 revisions. This test ignores the XF and YF flags
@@ -11,9 +14,15 @@
 //------------------------------------------------------------------------------
 #define CHIPS_IMPL
 #include "chips/z80.h"
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#include "jobpool.h"
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
 
 // CPU state
 typedef struct {
@@ -25,14 +34,6 @@ typedef struct {
     int ticks;
 } fuse_state_t;
 
-// memory chunk
-#define FUSE_MAX_BYTES (32)
-typedef struct {
-    int num_bytes;
-    uint16_t addr;
-    uint8_t bytes[FUSE_MAX_BYTES];
-} fuse_mem_t;
-
 // a result event
 typedef enum {
     EVENT_NONE,
@@ -42,28 +43,83 @@ typedef enum {
     EVENT_PW,     /* port write */
 } fuse_eventtype_t;
 
-typedef struct {
-    int tick;
-    fuse_eventtype_t type;
-    uint16_t addr;
-    uint8_t data;
-} fuse_event_t;
+/* a complete test (used for input, output, expected), this is a view into
+    the packed test data generated by fips-files/generators/fuse.py, events
+    and memory chunks are read directly from there:
 
-// a complete test (used for input, output, expected)
-#define FUSE_MAX_EVENTS (128)
-#define FUSE_MAX_MEMCHUNKS (8)
+    events: u16 tick, u8 type, u16 addr, u8 data
+    chunks: u16 addr, u8 num_bytes, u8 bytes[num_bytes]
+*/
+#define FUSE_EVENT_SIZE (6)
 typedef struct {
     const char* desc;
-    uint8_t num_events;
-    uint8_t num_chunks;
+    int num_events;
+    int num_chunks;
     fuse_state_t state;
-    fuse_event_t events[FUSE_MAX_EVENTS];
-    fuse_mem_t chunks[FUSE_MAX_MEMCHUNKS];
+    const uint8_t* events;
+    const uint8_t* chunks;
 } fuse_test_t;
 
 #include "fuse/fuse.h"
 
-static uint8_t mem[1<<16];
+static uint16_t rd16(const uint8_t* ptr) {
+    return ptr[0] | (ptr[1]<<8);
+}
+
+static uint32_t rd32(const uint8_t* ptr) {
+    return ptr[0] | (ptr[1]<<8) | (ptr[2]<<16) | ((uint32_t)ptr[3]<<24);
+}
+
+static int fuse_num_tests(const uint8_t* blob) {
+    return (int)rd32(blob);
+}
+
+// get a test from the packed test data, the blob starts with the number
+// of tests and the offsets of all tests
+static void fuse_get_test(const uint8_t* blob, int index, fuse_test_t* test) {
+    const uint8_t* ptr = blob + rd32(blob + 4 + 4 * index);
+    test->desc = (const char*) ptr;
+    ptr += strlen(test->desc) + 1;
+    fuse_state_t* st = &test->state;
+    st->af = rd16(ptr+0); st->bc = rd16(ptr+2); st->de = rd16(ptr+4); st->hl = rd16(ptr+6);
+    st->af_ = rd16(ptr+8); st->bc_ = rd16(ptr+10); st->de_ = rd16(ptr+12); st->hl_ = rd16(ptr+14);
+    st->ix = rd16(ptr+16); st->iy = rd16(ptr+18); st->sp = rd16(ptr+20); st->pc = rd16(ptr+22);
+    ptr += 24;
+    st->i = ptr[0]; st->r = ptr[1]; st->iff1 = ptr[2]; st->iff2 = ptr[3]; st->im = ptr[4]; st->halted = ptr[5];
+    st->ticks = rd16(ptr+6);
+    ptr += 8;
+    test->num_events = *ptr++;
+    test->events = ptr;
+    ptr += test->num_events * FUSE_EVENT_SIZE;
+    test->num_chunks = *ptr++;
+    test->chunks = ptr;
+}
+
+// the per-test output, merged in test order after all tests ran
+#define OUTPUT_SIZE (2048)
+typedef struct {
+    bool ok;
+    int out_pos;
+    char output[OUTPUT_SIZE];
+} fuse_result_t;
+
+static struct {
+    int num_tests;
+    fuse_result_t* results;
+    uint8_t* mem[JOBPOOL_MAX_THREADS];
+} state;
+
+static void out(fuse_result_t* res, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    const int max_len = OUTPUT_SIZE - res->out_pos;
+    const int len = vsnprintf(&res->output[res->out_pos], (size_t)max_len, fmt, args);
+    va_end(args);
+    if (len > 0) {
+        res->out_pos += (len < max_len) ? len : (max_len - 1);
+    }
+}
+
 
 /* don't test the XF/YF flags in the indirect BIT test instructions,
     since FUSE handles those wrong
@@ -91,7 +147,7 @@ static bool test_xfyf(const char* name) {
     return true;
 }
 
-static uint64_t tick(z80_t* cpu, uint64_t pins) {
+static uint64_t tick(z80_t* cpu, uint8_t* mem, uint64_t pins) {
     pins = z80_tick(cpu, pins);
     if (pins & Z80_MREQ) {
         uint16_t addr = Z80_GET_ADDR(pins);
@@ -111,7 +167,7 @@ static uint64_t tick(z80_t* cpu, uint64_t pins) {
     return pins;
 }
 
-static bool run_test(fuse_test_t* inp, fuse_test_t* exp) {
+static bool run_test(const fuse_test_t* inp, const fuse_test_t* exp, uint8_t* mem, fuse_result_t* res) {
 
     // prepare CPU and memory with test input data (same initial state as coretest.c in FUSE
     for (int i = 0; i < 0x10000; i += 4) {
@@ -137,20 +193,22 @@ static bool run_test(fuse_test_t* inp, fuse_test_t* exp) {
     cpu.iff1 = 0 != inp->state.iff1;
     cpu.iff2 = 0 != inp->state.iff2;
     cpu.im = inp->state.im;
+    const uint8_t* chunk = inp->chunks;
     for (int i = 0; i < inp->num_chunks; i++) {
-        uint16_t addr = inp->chunks[i].addr;
-        int num_bytes = inp->chunks[i].num_bytes;
+        uint16_t addr = rd16(chunk);
+        int num_bytes = chunk[2];
         for (int bi = 0; bi < num_bytes; bi++) {
-            mem[addr++ & 0xFFFF] = inp->chunks[i].bytes[bi];
+            mem[addr++ & 0xFFFF] = chunk[3 + bi];
         }
+        chunk += 3 + num_bytes;
     }
 
     // run CPU for at least N ticks or instruction completion
     uint64_t pins = z80_prefetch(&cpu, cpu.pc);
-    pins = tick(&cpu, pins);
+    pins = tick(&cpu, mem, pins);
     int num_ticks = 0;
     do {
-       pins = tick(&cpu, pins);
+       pins = tick(&cpu, mem, pins);
        num_ticks++;
     } while ((num_ticks < (inp->state.ticks)) || !z80_opdone(&cpu));
 
@@ -161,108 +219,140 @@ static bool run_test(fuse_test_t* inp, fuse_test_t* exp) {
         af_mask &= ~(Z80_XF|Z80_YF);
     }
     if (num_ticks != exp->state.ticks) {
-        printf("\n  %s: TICKS: %d (expected %d)", inp->desc, num_ticks, exp->state.ticks);
+        out(res, "\n  %s: TICKS: %d (expected %d)", inp->desc, num_ticks, exp->state.ticks);
         ok = false;
     }
     if ((exp->state.af & af_mask) != (cpu.af & af_mask)) {
-        printf("\n  %s: AF: 0x%04X (expected 0x%04X)", inp->desc, cpu.af&af_mask, exp->state.af&af_mask);
+        out(res, "\n  %s: AF: 0x%04X (expected 0x%04X)", inp->desc, cpu.af&af_mask, exp->state.af&af_mask);
         ok = false;
     }
     if (exp->state.bc != cpu.bc) {
-        printf("\n  %s: BC: 0x%04X (expected 0x%04X)", inp->desc, cpu.bc, exp->state.bc);
+        out(res, "\n  %s: BC: 0x%04X (expected 0x%04X)", inp->desc, cpu.bc, exp->state.bc);
         ok = false;
     }
     if (exp->state.de != cpu.de) {
-        printf("\n  %s: DE: 0x%04X (expected 0x%04X)", inp->desc, cpu.de, exp->state.de);
+        out(res, "\n  %s: DE: 0x%04X (expected 0x%04X)", inp->desc, cpu.de, exp->state.de);
         ok = false;
     }
     if (exp->state.hl != cpu.hl) {
-        printf("\n  %s: HL: 0x%04X (expected 0x%04X)", inp->desc, cpu.hl, exp->state.hl);
+        out(res, "\n  %s: HL: 0x%04X (expected 0x%04X)", inp->desc, cpu.hl, exp->state.hl);
         ok = false;
     }
     if (exp->state.af_ != cpu.af2) {
-        printf("\n  %s: AF': 0x%04X (expected 0x%04X)", inp->desc, cpu.af2, exp->state.af_);
+        out(res, "\n  %s: AF': 0x%04X (expected 0x%04X)", inp->desc, cpu.af2, exp->state.af_);
         ok = false;
     }
     if (exp->state.bc_ != cpu.bc2) {
-        printf("\n  %s: BC': 0x%04X (expected 0x%04X)", inp->desc, cpu.bc2, exp->state.bc_);
+        out(res, "\n  %s: BC': 0x%04X (expected 0x%04X)", inp->desc, cpu.bc2, exp->state.bc_);
         ok = false;
     }
     if (exp->state.de_ != cpu.de2) {
-        printf("\n  %s: DE': 0x%04X (expected 0x%04X)", inp->desc, cpu.de2, exp->state.de_);
+        out(res, "\n  %s: DE': 0x%04X (expected 0x%04X)", inp->desc, cpu.de2, exp->state.de_);
         ok = false;
     }
     if (exp->state.hl_ != cpu.hl2) {
-        printf("\n  %s: HL': 0x%04X (expected 0x%04X)", inp->desc, cpu.hl2, exp->state.hl_);
+        out(res, "\n  %s: HL': 0x%04X (expected 0x%04X)", inp->desc, cpu.hl2, exp->state.hl_);
         ok = false;
     }
     if (exp->state.ix != cpu.ix) {
-        printf("\n  %s: IX: 0x%04X (expected 0x%04X)", inp->desc, cpu.ix, exp->state.ix);
+        out(res, "\n  %s: IX: 0x%04X (expected 0x%04X)", inp->desc, cpu.ix, exp->state.ix);
         ok = false;
     }
     if (exp->state.iy != cpu.iy) {
-        printf("\n  %s: IY: 0x%04X (expected 0x%04X)", inp->desc, cpu.iy, exp->state.iy);
+        out(res, "\n  %s: IY: 0x%04X (expected 0x%04X)", inp->desc, cpu.iy, exp->state.iy);
         ok = false;
     }
     if (exp->state.sp != cpu.sp) {
-        printf("\n  %s: SP: 0x%04X (expected 0x%04X)", inp->desc, cpu.sp, exp->state.sp);
+        out(res, "\n  %s: SP: 0x%04X (expected 0x%04X)", inp->desc, cpu.sp, exp->state.sp);
         ok = false;
     }
     if (exp->state.pc != (cpu.pc-1)) {
-        printf("\n  %s: PC: 0x%04X (expected 0x%04X)", inp->desc, cpu.pc, exp->state.pc);
+        out(res, "\n  %s: PC: 0x%04X (expected 0x%04X)", inp->desc, cpu.pc, exp->state.pc);
         ok = false;
     }
     if (exp->state.i != cpu.i) {
-        printf("\n  %s: I: 0x%02X (expected 0x%02X)", inp->desc, cpu.i, exp->state.i);
+        out(res, "\n  %s: I: 0x%02X (expected 0x%02X)", inp->desc, cpu.i, exp->state.i);
         ok = false;
     }
     if (exp->state.r != cpu.r) {
-        printf("\n  %s: R: 0x%02X (expected 0x%02X)", inp->desc, cpu.r, exp->state.r);
+        out(res, "\n  %s: R: 0x%02X (expected 0x%02X)", inp->desc, cpu.r, exp->state.r);
         ok = false;
     }
     if (exp->state.iff1 != cpu.iff1) {
-        printf("\n  %s: IFF1: %s (expected %s)", inp->desc, cpu.iff1?"true":"false", exp->state.iff1?"true":"false");
+        out(res, "\n  %s: IFF1: %s (expected %s)", inp->desc, cpu.iff1?"true":"false", exp->state.iff1?"true":"false");
         ok = false;
     }
     if (exp->state.iff2 != cpu.iff2) {
-        printf("\n  %s: IFF2: %s (expected %s)", inp->desc, cpu.iff2?"true":"false", exp->state.iff2?"true":"false");
+        out(res, "\n  %s: IFF2: %s (expected %s)", inp->desc, cpu.iff2?"true":"false", exp->state.iff2?"true":"false");
         ok = false;
     }
     if (exp->state.im != cpu.im) {
-        printf("\n  %s: IM: 0x%02X (expected 0x%02X)", inp->desc, cpu.im, exp->state.im);
+        out(res, "\n  %s: IM: 0x%02X (expected 0x%02X)", inp->desc, cpu.im, exp->state.im);
         ok = false;
     }
     if ((0 != exp->state.halted) != (0 != (pins & Z80_HALT))) {
-        printf("\n  %s: HALT: %s (expected %s)", inp->desc, (pins&Z80_HALT)?"true":"false", exp->state.halted?"true":"false");
+        out(res, "\n  %s: HALT: %s (expected %s)", inp->desc, (pins&Z80_HALT)?"true":"false", exp->state.halted?"true":"false");
         ok = false;
     }
     // check memory content
+    chunk = exp->chunks;
     for (int i = 0; i < exp->num_chunks; i++) {
-        fuse_mem_t* chunk = &(exp->chunks[i]);
-        uint16_t addr = chunk->addr;
-        for (int bi = 0; bi < chunk->num_bytes; bi++) {
-            if (chunk->bytes[bi] != mem[(addr+bi) & 0xFFFF]) {
-                printf("\n  %s: BYTE AT 0x%04X IS 0x%02X (expected 0x%02X)", inp->desc,
+        uint16_t addr = rd16(chunk);
+        int num_bytes = chunk[2];
+        const uint8_t* bytes = &chunk[3];
+        for (int bi = 0; bi < num_bytes; bi++) {
+            if (bytes[bi] != mem[(addr+bi) & 0xFFFF]) {
+                out(res, "\n  %s: BYTE AT 0x%04X IS 0x%02X (expected 0x%02X)", inp->desc,
                     (addr+bi) & 0xFFFF,
                     mem[(addr+bi) & 0xFFFF],
-                    chunk->bytes[bi]);
+                    bytes[bi]);
                 ok = false;
             }
         }
+        chunk += 3 + num_bytes;
     }
     return ok;
 }
 
+static void job_func(int job_index, int worker_index, void* user_data) {
+    (void)user_data;
+    // one 64 KByte memory per worker thread
+    if (0 == state.mem[worker_index]) {
+        state.mem[worker_index] = malloc(1<<16);
+    }
+    fuse_test_t inp, exp;
+    fuse_get_test(fuse_input, job_index, &inp);
+    fuse_get_test(fuse_expected, job_index, &exp);
+    fuse_result_t* res = &state.results[job_index];
+    res->ok = run_test(&inp, &exp, state.mem[worker_index], res);
+}
+
 int main() {
-    assert(fuse_expected_num == fuse_input_num);
+    assert(fuse_num_tests(fuse_expected) == fuse_num_tests(fuse_input));
     printf("FUSE Z80 TEST\n");
+    stm_setup();
+    state.num_tests = fuse_num_tests(fuse_input);
+    state.results = calloc((size_t)state.num_tests, sizeof(fuse_result_t));
+    uint64_t start_time = stm_now();
+    const int num_workers = jobpool_run(&(jobpool_desc_t){
+        .num_jobs = state.num_tests,
+        .func = job_func,
+    });
+    double wall_secs = stm_sec(stm_since(start_time));
     int num_failed = 0;
-    for (int i = 0; i < fuse_input_num; i++) {
-        if (!run_test(&fuse_input[i], &fuse_expected[i])) {
+    for (int i = 0; i < state.num_tests; i++) {
+        printf("%s", state.results[i].output);
+        if (!state.results[i].ok) {
             num_failed++;
         }
     }
     printf("\n");
+    // timing goes to stderr so that stdout stays identical to the single-threaded runner
+    fprintf(stderr, "%d tests in %.3fsecs on %d thread(s)\n", state.num_tests, wall_secs, num_workers);
+    for (int i = 0; i < JOBPOOL_MAX_THREADS; i++) {
+        free(state.mem[i]);
+    }
+    free(state.results);
     if (0 == num_failed) {
         printf("All tests succeeded.\n");
         return 0;
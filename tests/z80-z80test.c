@@ -0,0 +1,448 @@
+//------------------------------------------------------------------------------
+//  z80-z80test.c
+//
+//  Runs Patrik Rak's z80test-1.0 suite (z80full, z80doc, z80flags,
+//  z80docflags, z80ccf and z80memptr) headless through the ZX Spectrum
+//  48K emulator.
+//
+//  The .tap files are loaded with the regular LOAD "" command, but the
+//  ROM tape loader routine LD-BYTES is trapped (via the debug callback)
+//  and replaced with a direct copy of the next tape block into memory.
+//  The results are scraped from the screen by matching the character
+//  cells against the ROM font.
+//
+//  Like z80-zex, each test of each program runs as a separate job on all
+//  CPU cores (see jobpool.h) in its own ZX Spectrum, which starts from a
+//  snapshot of the booted machine, with a patched copy of the program
+//  which only contains this one test in its test table.
+//
+//  Usage:
+//
+//  z80-z80test [z80full|z80doc|z80flags|z80docflags|z80ccf|z80memptr...]
+//
+//  Without arguments all programs are run.
+//------------------------------------------------------------------------------
+#define CHIPS_IMPL
+#include "chips/chips_common.h"
+#include "chips/z80.h"
+#include "chips/beeper.h"
+#include "chips/ay38910.h"
+#include "chips/kbd.h"
+#include "chips/mem.h"
+#include "chips/clk.h"
+#include "systems/zx.h"
+#include "zx-roms.h"
+#include "z80test-dump.h"
+#define SOKOL_IMPL
+#include "sokol_time.h"
+#include "jobpool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h> // PRIu64
+
+#define FRAME_USEC (20000)
+// frames to wait for the ZX Spectrum to boot
+#define BOOT_FRAMES (150)
+// frames between typed keys
+#define KEY_DELAY_FRAMES (6)
+// frames between checks for the final result message
+#define CHECK_FRAMES (25)
+// max emulated time per test
+#define TIMEOUT_SECS (3600)
+#define MAX_TESTS (256)
+#define MAX_JOBS (6 * MAX_TESTS)
+// ROM entry of LD-BYTES, and the ROM font of character codes 0x20..0x7F
+#define LD_BYTES_ADDR (0x0556)
+#define FONT_ADDR (0x3D00)
+#define SCREEN_COLUMNS (32)
+#define SCREEN_ROWS (24)
+#define TEXT_SIZE ((SCREEN_COLUMNS + 1) * SCREEN_ROWS + 1)
+
+typedef struct {
+    const char* name;
+    const uint8_t* tap;
+    size_t tap_num_bytes;
+    // the CODE block, and the test table and LD BC,0 instruction in it
+    size_t code_offset;
+    uint16_t code_addr;
+    uint16_t ld_bc_addr;
+    uint16_t table_addr;
+    int num_tests;
+    bool selected;
+} program_t;
+
+// the result of one test
+typedef struct {
+    const program_t* prog;
+    int test;
+    bool done;
+    bool ok;
+    double emu_secs;
+    double host_secs;
+    char* header;       // the program's title line
+    char* output;       // the test's output lines
+} job_t;
+
+// per-job ZX Spectrum and tape loader state
+typedef struct {
+    zx_t zx;
+    // set by the debug callback when LD-BYTES is called
+    bool stopped;
+    const job_t* job;
+    uint8_t* tap;
+    size_t tap_pos;
+} machine_t;
+
+static program_t programs[6] = {
+    { .name = "z80full", .tap = dump_z80full_tap, .tap_num_bytes = sizeof(dump_z80full_tap) },
+    { .name = "z80doc", .tap = dump_z80doc_tap, .tap_num_bytes = sizeof(dump_z80doc_tap) },
+    { .name = "z80flags", .tap = dump_z80flags_tap, .tap_num_bytes = sizeof(dump_z80flags_tap) },
+    { .name = "z80docflags", .tap = dump_z80docflags_tap, .tap_num_bytes = sizeof(dump_z80docflags_tap) },
+    { .name = "z80ccf", .tap = dump_z80ccf_tap, .tap_num_bytes = sizeof(dump_z80ccf_tap) },
+    { .name = "z80memptr", .tap = dump_z80memptr_tap, .tap_num_bytes = sizeof(dump_z80memptr_tap) },
+};
+#define NUM_PROGRAMS (int)(sizeof(programs) / sizeof(programs[0]))
+
+static struct {
+    zx_t boot;
+    uint32_t boot_version;
+    job_t jobs[MAX_JOBS];
+    int num_jobs;
+} state;
+
+static void dummy_audio_callback(const float* samples, int num_samples, void* user_data) {
+    (void)samples;
+    (void)num_samples;
+    (void)user_data;
+}
+
+// stop the emulation on the first opcode fetch of LD-BYTES
+static void debug_callback(void* user_data, uint64_t pins) {
+    machine_t* m = (machine_t*) user_data;
+    if (((pins & (Z80_M1|Z80_MREQ)) == (Z80_M1|Z80_MREQ)) && (Z80_GET_ADDR(pins) == LD_BYTES_ADDR)) {
+        m->stopped = true;
+    }
+}
+
+// the debug callback is only installed for test machines, not for booting
+static void init_zx(zx_t* zx, machine_t* m) {
+    zx_init(zx, &(zx_desc_t){
+        .type = ZX_TYPE_48K,
+        .audio = { .callback = { .func = dummy_audio_callback } },
+        .roms = {
+            .zx48k = { .ptr=dump_amstrad_zx48k_bin, .size=sizeof(dump_amstrad_zx48k_bin) },
+            .zx128_0 = { .ptr=dump_amstrad_zx128k_0_bin, .size=sizeof(dump_amstrad_zx128k_0_bin) },
+            .zx128_1 = { .ptr=dump_amstrad_zx128k_1_bin, .size=sizeof(dump_amstrad_zx128k_1_bin) },
+        },
+        .debug = {
+            .callback = { .func = m ? debug_callback : 0, .user_data = m },
+            .stopped = m ? &m->stopped : 0,
+        },
+    });
+}
+
+// emulate LD-BYTES with the next tape block: A is the expected flag byte,
+// IX the destination address, DE the number of bytes, carry set for LOAD
+// (and clear for VERIFY), returns with carry set on success
+static void ld_bytes(machine_t* m) {
+    z80_t* cpu = &m->zx.cpu;
+    bool success = false;
+    if ((m->tap_pos + 3) <= m->job->prog->tap_num_bytes) {
+        const uint8_t* blk = &m->tap[m->tap_pos];
+        const size_t blk_len = blk[0] | (blk[1]<<8);
+        if ((blk_len >= 2) && ((m->tap_pos + 2 + blk_len) <= m->job->prog->tap_num_bytes) && (blk[2] == cpu->a)) {
+            size_t num = blk_len - 2;
+            if (num > cpu->de) {
+                num = cpu->de;
+            }
+            if (cpu->f & Z80_CF) {
+                for (size_t i = 0; i < num; i++) {
+                    mem_wr(&m->zx.mem, (uint16_t)(cpu->ix + i), blk[3 + i]);
+                }
+            }
+            cpu->ix += (uint16_t)num;
+            cpu->de -= (uint16_t)num;
+            success = true;
+        }
+        m->tap_pos += 2 + blk_len;
+    }
+    if (success) {
+        cpu->f |= Z80_CF;
+    }
+    else {
+        cpu->f &= ~Z80_CF;
+    }
+    // return to the caller
+    const uint16_t ret_addr = mem_rd(&m->zx.mem, cpu->sp) | (mem_rd(&m->zx.mem, cpu->sp + 1)<<8);
+    cpu->sp += 2;
+    m->zx.pins = z80_prefetch(cpu, ret_addr);
+}
+
+// find the test table and the LD BC,0 which initializes the test counter
+// in the program's main driver (LD BC,0 followed by LD HL,testtable)
+static bool find_test_table(program_t* prog) {
+    const uint8_t* tap = prog->tap;
+    size_t pos = 0;
+    // the CODE block is the data block following a CODE header (type 3)
+    uint16_t code_addr = 0;
+    bool code_header = false;
+    while ((pos + 3) <= prog->tap_num_bytes) {
+        const size_t blk_len = tap[pos] | (tap[pos+1]<<8);
+        const uint8_t* blk = &tap[pos + 2];
+        if ((pos + 2 + blk_len) > prog->tap_num_bytes) {
+            return false;
+        }
+        if ((blk[0] == 0x00) && (blk_len >= 18) && (blk[1] == 3)) {
+            code_addr = blk[14] | (blk[15]<<8);
+            code_header = true;
+        }
+        else if ((blk[0] == 0xFF) && code_header) {
+            prog->code_offset = pos + 3;
+            prog->code_addr = code_addr;
+            const uint8_t* code = &blk[1];
+            const size_t code_len = blk_len - 2;
+            for (size_t i = 0; (i + 6) <= code_len && (i < 256); i++) {
+                if ((code[i] == 0x01) && (code[i+1] == 0x00) && (code[i+2] == 0x00) && (code[i+3] == 0x21)) {
+                    prog->ld_bc_addr = (uint16_t)(code_addr + i);
+                    prog->table_addr = code[i+4] | (code[i+5]<<8);
+                    // the table is a zero-terminated list of test vector addresses
+                    size_t offset = (size_t)(prog->table_addr - code_addr);
+                    prog->num_tests = 0;
+                    while (((offset + 2) <= code_len) && (code[offset] | code[offset+1])) {
+                        prog->num_tests++;
+                        offset += 2;
+                    }
+                    return (prog->num_tests > 0) && (prog->num_tests <= MAX_TESTS);
+                }
+            }
+            return false;
+        }
+        pos += 2 + blk_len;
+    }
+    return false;
+}
+
+// match a screen character cell against the ROM font
+static char scrape_char(mem_t* mem, int col, int row) {
+    uint8_t cell[8];
+    bool empty = true;
+    for (int line = 0; line < 8; line++) {
+        const uint16_t addr = 0x4000 | ((row & 0x18)<<8) | (line<<8) | ((row & 7)<<5) | col;
+        cell[line] = mem_rd(mem, addr);
+        empty &= (cell[line] == 0);
+    }
+    if (empty) {
+        return ' ';
+    }
+    for (int c = 0x21; c < 0x80; c++) {
+        bool match = true;
+        for (int line = 0; match && (line < 8); line++) {
+            match = mem_rd(mem, (uint16_t)(FONT_ADDR + (c - 0x20) * 8 + line)) == cell[line];
+        }
+        if (match) {
+            // the copyright sign
+            return (c == 0x7F) ? 'c' : (char)c;
+        }
+    }
+    return '?';
+}
+
+// scrape the screen as text, one line per character row with trailing spaces stripped
+static void scrape_screen(mem_t* mem, char* text) {
+    int pos = 0;
+    for (int row = 0; row < SCREEN_ROWS; row++) {
+        int len = 0;
+        for (int col = 0; col < SCREEN_COLUMNS; col++) {
+            text[pos + col] = scrape_char(mem, col, row);
+            if (text[pos + col] != ' ') {
+                len = col + 1;
+            }
+        }
+        pos += len;
+        text[pos++] = '\n';
+    }
+    text[pos] = 0;
+}
+
+static char* copy_text(const char* str, size_t len) {
+    char* res = malloc(len + 1);
+    memcpy(res, str, len);
+    res[len] = 0;
+    return res;
+}
+
+// split the scraped screen into the title line and the test output
+// (everything between the title and the "Result:" line)
+static void parse_screen(job_t* job, const char* text) {
+    const char* nl = strchr(text, '\n');
+    const char* result = strstr(text, "Result: ");
+    job->header = copy_text(text, (size_t)(nl - text));
+    const char* start = nl + 1;
+    while (*start == '\n') {
+        start++;
+    }
+    const char* end = result ? result : (text + strlen(text));
+    while ((end > start) && (end[-1] == '\n')) {
+        end--;
+    }
+    job->output = copy_text(start, (size_t)(end - start));
+    job->ok = result && (0 != strstr(result, "all tests passed."));
+}
+
+static void run_test(job_t* job) {
+    const program_t* prog = job->prog;
+    machine_t* m = calloc(1, sizeof(machine_t));
+    init_zx(&m->zx, m);
+    zx_load_snapshot(&m->zx, state.boot_version, &state.boot);
+    m->job = job;
+
+    // patch the test table to only contain this test, and the test
+    // counter to print the original test number
+    m->tap = malloc(prog->tap_num_bytes);
+    memcpy(m->tap, prog->tap, prog->tap_num_bytes);
+    uint8_t* code = &m->tap[prog->code_offset];
+    const size_t table = prog->table_addr - prog->code_addr;
+    const size_t entry = table + 2 * job->test;
+    code[table] = code[entry];
+    code[table+1] = code[entry+1];
+    code[table+2] = 0;
+    code[table+3] = 0;
+    code[prog->ld_bc_addr - prog->code_addr + 1] = (uint8_t)job->test;
+
+    // type LOAD "" (the J key in keyword mode) and run until the result is printed
+    const char* input = "j\"\"\r";
+    char* screen = malloc(TEXT_SIZE);
+    uint64_t usec = 0;
+    int frame = 0;
+    while (!job->done && (usec < (TIMEOUT_SECS * 1000000ULL))) {
+        frame++;
+        if (*input && (0 == (frame % KEY_DELAY_FRAMES))) {
+            zx_key_down(&m->zx, *input);
+            zx_key_up(&m->zx, *input);
+            input++;
+        }
+        zx_exec(&m->zx, FRAME_USEC);
+        if (m->stopped) {
+            ld_bytes(m);
+            m->stopped = false;
+        }
+        usec += FRAME_USEC;
+        if (0 == (frame % CHECK_FRAMES)) {
+            scrape_screen(&m->zx.mem, screen);
+            const char* result = strstr(screen, "Result: ");
+            job->done = result && (strstr(result, "passed.") || strstr(result, "failed."));
+        }
+    }
+    scrape_screen(&m->zx.mem, screen);
+    parse_screen(job, screen);
+    job->emu_secs = usec / 1000000.0;
+    free(screen);
+    free(m->tap);
+    zx_discard(&m->zx);
+    free(m);
+}
+
+static void job_func(int job_index, int worker_index, void* user_data) {
+    (void)worker_index;
+    (void)user_data;
+    job_t* job = &state.jobs[job_index];
+    const uint64_t start = stm_now();
+    run_test(job);
+    job->host_secs = stm_sec(stm_since(start));
+}
+
+// print the merged output of all tests of a program, returns false if any test failed
+static bool print_results(const program_t* prog) {
+    double emu_secs = 0.0;
+    double host_secs = 0.0;
+    int num_failed = 0;
+    for (int i = 0; i < state.num_jobs; i++) {
+        const job_t* job = &state.jobs[i];
+        if (job->prog != prog) {
+            continue;
+        }
+        if (job->test == 0) {
+            printf("%s\n\n", job->header);
+        }
+        // append the timing to the first output line
+        const char* nl = strchr(job->output, '\n');
+        const int len = nl ? (int)(nl - job->output) : (int)strlen(job->output);
+        if (0 == len) {
+            printf("%s test %d", prog->name, job->test);
+        }
+        printf("%.*s (%.1f emulated secs, %.3fsecs)%s\n", len, job->output, job->emu_secs, job->host_secs,
+            job->done ? "" : " TIMEOUT");
+        if (nl) {
+            printf("%s\n", nl + 1);
+        }
+        emu_secs += job->emu_secs;
+        host_secs += job->host_secs;
+        if (!job->ok) {
+            num_failed++;
+        }
+    }
+    printf("\n%s: %.1f emulated secs in %.3fsecs\n", prog->name, emu_secs, host_secs);
+    if (0 == num_failed) {
+        printf("\n ALL %s TESTS PASSED!\n\n", prog->name);
+        return true;
+    }
+    else {
+        printf("\n %d of %d %s TESTS FAILED!\n\n", num_failed, prog->num_tests, prog->name);
+        return false;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    stm_setup();
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
+        program_t* prog = &programs[p];
+        prog->selected = (argc < 2);
+        for (int i = 1; i < argc; i++) {
+            if (0 == strcmp(argv[i], prog->name)) {
+                prog->selected = true;
+            }
+        }
+        if (!prog->selected) {
+            continue;
+        }
+        if (!find_test_table(prog)) {
+            printf("%s: failed to find test table!\n", prog->name);
+            return 10;
+        }
+        for (int t = 0; t < prog->num_tests; t++) {
+            job_t* job = &state.jobs[state.num_jobs++];
+            job->prog = prog;
+            job->test = t;
+        }
+    }
+    if (0 == state.num_jobs) {
+        printf("no tests selected!\n");
+        return 10;
+    }
+
+    // boot the ZX Spectrum once, the jobs start from a snapshot
+    zx_t* zx = calloc(1, sizeof(zx_t));
+    init_zx(zx, 0);
+    for (int i = 0; i < BOOT_FRAMES; i++) {
+        zx_exec(zx, FRAME_USEC);
+    }
+    state.boot_version = zx_save_snapshot(zx, &state.boot);
+    zx_discard(zx);
+    free(zx);
+
+    uint64_t start_time = stm_now();
+    const int num_workers = jobpool_run(&(jobpool_desc_t){
+        .num_jobs = state.num_jobs,
+        .func = job_func,
+    });
+    double wall_secs = stm_sec(stm_since(start_time));
+
+    bool success = true;
+    for (int p = 0; p < NUM_PROGRAMS; p++) {
+        if (programs[p].selected) {
+            success &= print_results(&programs[p]);
+        }
+    }
+    printf("%d tests in %.3fsecs on %d thread(s)\n", state.num_jobs, wall_secs, num_workers);
+    return success ? 0 : 10;
+}
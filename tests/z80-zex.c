@@ -3,118 +3,274 @@
 //
 //  Runs Frank Cringle's zexdoc and zexall test through the Z80 emu. Provide
 //  a minimal CP/M environment to make these work.
+//
+//  Each exerciser runs a list of independent test groups, which is
+//  sharded here: every test group runs as a separate job (on all CPU
+//  cores, see jobpool.h) in its own Z80 and 64 KByte memory with a
+//  patched copy of the program which only contains this one group in its
+//  test table. The output of the jobs is merged in the original order,
+//  so it looks like the output of a monolithic run.
 //------------------------------------------------------------------------------
 #define CHIPS_IMPL
 #include "chips/z80.h"
 #define SOKOL_IMPL
 #include "sokol_time.h"
 #include "roms/zex-dump.h"
+#include "jobpool.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <inttypes.h> // PRIu64
 
 #define MEM_SIZE (1<<16)
 #define MEM_MASK (MEM_SIZE-1)
-#define OUTPUT_SIZE (1<<16)
+#define OUTPUT_SIZE (1<<12)
+#define MAX_GROUPS (128)
 
-static struct {
+// a CP/M machine running one test group
+typedef struct {
     z80_t cpu;
     uint8_t mem[MEM_SIZE];
     int out_pos;
     char output[OUTPUT_SIZE];
+    // output position at the start of the last BDOS call
+    int last_call_pos;
+    // output position after the first BDOS call (the exerciser's banner)
+    int banner_end_pos;
+    int num_calls;
+} machine_t;
+
+typedef struct {
+    const char* name;
+    const uint8_t* prog;
+    size_t prog_num_bytes;
+    uint16_t table_addr;
+    int num_groups;
+} program_t;
+
+// the result of one test group
+typedef struct {
+    const program_t* prog;
+    int group;
+    bool ok;
+    uint64_t ticks;
+    double secs;
+    char* output;       // the group's output (test name and result)
+    char* banner;       // the exerciser's banner, only kept for group 0
+    char* footer;       // the exerciser's final message, only kept for the last group
+} job_t;
+
+static program_t programs[2] = {
+    { .name = "ZEXDOC", .prog = dump_zexdoc_com, .prog_num_bytes = sizeof(dump_zexdoc_com) },
+    { .name = "ZEXALL", .prog = dump_zexall_com, .prog_num_bytes = sizeof(dump_zexall_com) },
+};
+
+static struct {
+    job_t jobs[2 * MAX_GROUPS];
+    int num_jobs;
 } state;
 
-static void put_char(char c) {
-    if (state.out_pos < OUTPUT_SIZE) {
-        state.output[state.out_pos++] = c;
+static void put_char(machine_t* m, char c) {
+    if (m->out_pos < (OUTPUT_SIZE - 1)) {
+        m->output[m->out_pos++] = c;
     }
-    putchar(c);
 }
 
-static uint64_t tick(uint64_t pins) {
-    pins = z80_tick(&state.cpu, pins);
+static uint64_t tick(machine_t* m, uint64_t pins) {
+    pins = z80_tick(&m->cpu, pins);
     if (pins & Z80_MREQ) {
         const uint16_t addr = Z80_GET_ADDR(pins);
         if (pins & Z80_RD) {
-            const uint8_t data = state.mem[addr];
+            const uint8_t data = m->mem[addr];
             Z80_SET_DATA(pins, data);
         }
         else if (pins & Z80_WR) {
             const uint8_t data = Z80_GET_DATA(pins);
-            state.mem[addr] = data;
+            m->mem[addr] = data;
         }
     }
     return pins;
 }
 
 // emulate character and string output CP/M system calls
-static bool cpm_bdos(void) {
+static bool cpm_bdos(machine_t* m) {
     bool retval = true;
-    if (2 == state.cpu.c) {
+    m->last_call_pos = m->out_pos;
+    if (2 == m->cpu.c) {
         // output character in register E
-        put_char(state.cpu.e);
+        put_char(m, m->cpu.e);
     }
-    else if (9 == state.cpu.c) {
+    else if (9 == m->cpu.c) {
         // output $-terminated string pointed to by register DE
         uint8_t c;
-        uint16_t addr = state.cpu.de;
-        while ((c = state.mem[addr++ & MEM_MASK]) != '$') {
-            put_char(c);
+        uint16_t addr = m->cpu.de;
+        while ((c = m->mem[addr++ & MEM_MASK]) != '$') {
+            put_char(m, c);
         }
     }
     else {
-        printf("Unhandled CP/M system call: %d\n", state.cpu.c);
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Unhandled CP/M system call: %d\n", m->cpu.c);
+        for (const char* p = msg; *p; p++) {
+            put_char(m, *p);
+        }
         retval = false;
     }
+    if (0 == m->num_calls++) {
+        m->banner_end_pos = m->out_pos;
+    }
     // emulate a RET
-    uint8_t z = state.mem[state.cpu.sp++];
-    uint8_t w = state.mem[state.cpu.sp++];
-    state.cpu.wz = (w<<8) | z;
-    state.cpu.pc = state.cpu.wz;
+    uint8_t z = m->mem[m->cpu.sp++];
+    uint8_t w = m->mem[m->cpu.sp++];
+    m->cpu.wz = (w<<8) | z;
+    m->cpu.pc = m->cpu.wz;
     return retval;
 }
 
-static bool run_test(const char* name, uint8_t* prog, size_t prog_num_bytes) {
+// find the test table, the program starts with a JP to the start code,
+// which loads the table address into HL 12 bytes in (LD HL,tests)
+static bool find_test_table(program_t* prog) {
+    const uint8_t* p = prog->prog;
+    const uint16_t start = p[1] | (p[2]<<8);
+    const size_t ld_hl = (size_t)(start - 0x0100) + 12;
+    if ((p[0] != 0xC3) || ((ld_hl + 3) > prog->prog_num_bytes) || (p[ld_hl] != 0x21)) {
+        return false;
+    }
+    prog->table_addr = p[ld_hl+1] | (p[ld_hl+2]<<8);
+    // the table is a zero-terminated list of test descriptor addresses
+    prog->num_groups = 0;
+    size_t offset = (size_t)(prog->table_addr - 0x0100);
+    while (((offset + 2) <= prog->prog_num_bytes) && (p[offset] | p[offset+1])) {
+        prog->num_groups++;
+        offset += 2;
+    }
+    return (prog->num_groups > 0) && (prog->num_groups <= MAX_GROUPS);
+}
+
+static char* copy_output(const char* str, int len) {
+    char* res = malloc((size_t)len + 1);
+    memcpy(res, str, (size_t)len);
+    res[len] = 0;
+    return res;
+}
+
+// run a single test group of a program
+static void run_group(job_t* job) {
+    const program_t* prog = job->prog;
+    machine_t* m = calloc(1, sizeof(machine_t));
+    memcpy(&m->mem[0x0100], prog->prog, prog->prog_num_bytes);
+    // patch the test table to only contain this group
+    const uint16_t table = prog->table_addr;
+    const uint16_t entry = table + 2 * job->group;
+    m->mem[table] = m->mem[entry];
+    m->mem[table+1] = m->mem[entry+1];
+    m->mem[table+2] = 0;
+    m->mem[table+3] = 0;
+
     bool running = true;
     uint64_t ticks = 0;
-
-    memset(state.output, 0, sizeof(state.output));
-    memset(state.mem, 0, sizeof(state.mem));
-    memcpy(&state.mem[0x0100], prog, prog_num_bytes);
-    uint64_t pins = z80_init(&state.cpu);
-    state.cpu.sp = 0xF000;
-    z80_prefetch(&state.cpu, 0x0100);
+    uint64_t pins = z80_init(&m->cpu);
+    m->cpu.sp = 0xF000;
+    z80_prefetch(&m->cpu, 0x0100);
     uint64_t start_time = stm_now();
     while (running) {
-        pins = tick(pins);
+        pins = tick(m, pins);
         ticks++;
         // check for BDOS call
-        if (state.cpu.pc == 5) {
-            running = cpm_bdos();
+        if (m->cpu.pc == 5) {
+            running = cpm_bdos(m);
         }
-        else if (state.cpu.pc == 0) {
+        else if (m->cpu.pc == 0) {
             running = false;
         }
     }
-    double dur = stm_sec(stm_since(start_time));
-    printf("\n%s: %"PRIu64" cycles in %.3fsecs (%.2f MHz)\n", name, ticks, dur, (ticks/dur)/1000000.0);
-
-    /* check if an error occurred */
-    if (state.out_pos > 0) {
-        state.output[state.out_pos-1] = 0;
-        if (strstr((const char*)state.output, "ERROR")) {
-            return false;
+    job->secs = stm_sec(stm_since(start_time));
+    job->ticks = ticks;
+
+    // split the output into banner, group output and footer
+    m->output[m->out_pos] = 0;
+    int start = m->banner_end_pos;
+    int end = m->last_call_pos;
+    if ((m->num_calls < 2) || (end < start)) {
+        start = 0;
+        end = m->out_pos;
+    }
+    job->output = copy_output(&m->output[start], end - start);
+    job->banner = copy_output(m->output, start);
+    job->footer = copy_output(&m->output[end], m->out_pos - end);
+    job->ok = (m->num_calls >= 3) && (0 == strstr(job->output, "ERROR")) && (0 == strstr(job->output, "Unhandled"));
+    free(m);
+}
+
+static void job_func(int job_index, int worker_index, void* user_data) {
+    (void)worker_index;
+    (void)user_data;
+    run_group(&state.jobs[job_index]);
+}
+
+// print the merged output of all groups of a program, returns false if any group failed
+static bool print_results(const program_t* prog) {
+    uint64_t ticks = 0;
+    double secs = 0.0;
+    int num_failed = 0;
+    for (int i = 0; i < state.num_jobs; i++) {
+        const job_t* job = &state.jobs[i];
+        if (job->prog != prog) {
+            continue;
+        }
+        if (job->group == 0) {
+            printf("%s", job->banner);
+        }
+        // strip the group's trailing line break to append the timing
+        int len = (int)strlen(job->output);
+        while ((len > 0) && ((job->output[len-1] == '\n') || (job->output[len-1] == '\r'))) {
+            len--;
+        }
+        printf("%.*s (%"PRIu64" cycles, %.3fsecs)\n", len, job->output, job->ticks, job->secs);
+        if (job->group == (prog->num_groups - 1)) {
+            printf("%s", job->footer);
         }
-        else {
-            printf("\n\n ALL %s TESTS PASSED!\n", name);
+        ticks += job->ticks;
+        secs += job->secs;
+        if (!job->ok) {
+            num_failed++;
         }
     }
-    return true;
+    printf("\n%s: %"PRIu64" cycles in %.3fsecs (%.2f MHz)\n", prog->name, ticks, secs, (ticks/secs)/1000000.0);
+    if (0 == num_failed) {
+        printf("\n\n ALL %s TESTS PASSED!\n\n", prog->name);
+        return true;
+    }
+    else {
+        printf("\n\n %d %s TEST GROUP(S) FAILED!\n\n", num_failed, prog->name);
+        return false;
+    }
 }
 
 int main() {
     stm_setup();
-    if (!run_test("ZEXALL", dump_zexall_com, sizeof(dump_zexall_com))) {
-        return 10;
+    for (int p = 0; p < 2; p++) {
+        program_t* prog = &programs[p];
+        if (!find_test_table(prog)) {
+            printf("%s: failed to find test table!\n", prog->name);
+            return 10;
+        }
+        for (int g = 0; g < prog->num_groups; g++) {
+            job_t* job = &state.jobs[state.num_jobs++];
+            job->prog = prog;
+            job->group = g;
+        }
+    }
+    uint64_t start_time = stm_now();
+    const int num_workers = jobpool_run(&(jobpool_desc_t){
+        .num_jobs = state.num_jobs,
+        .func = job_func,
+    });
+    double wall_secs = stm_sec(stm_since(start_time));
+
+    bool success = true;
+    for (int p = 0; p < 2; p++) {
+        success &= print_results(&programs[p]);
     }
-    return 0;
+    printf("%d test groups in %.3fsecs on %d thread(s)\n", state.num_jobs, wall_secs, num_workers);
+    return success ? 0 : 10;
 }